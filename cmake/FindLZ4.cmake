@@ -0,0 +1,22 @@
+# - Try to find LZ4
+# Once done this will define
+#
+#  LZ4_FOUND - system has liblz4
+#  LZ4_INCLUDE_DIRS - the liblz4 include directory
+#  LZ4_LIBRARIES - Link these to use liblz4
+#
+
+find_path(LZ4_INCLUDE_DIR NAMES lz4frame.h)
+
+find_library(LZ4_LIBRARY NAMES lz4 liblz4)
+
+set(LZ4_INCLUDE_DIRS ${LZ4_INCLUDE_DIR})
+set(LZ4_LIBRARIES ${LZ4_LIBRARY})
+
+INCLUDE(FindPackageHandleStandardArgs)
+# handle the QUIETLY and REQUIRED arguments and set LZ4_FOUND to TRUE if
+# all listed variables are TRUE
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4 DEFAULT_MSG LZ4_LIBRARY LZ4_INCLUDE_DIR)
+
+# show the LZ4_INCLUDE_DIRS and LZ4_LIBRARIES variables only in the advanced view
+mark_as_advanced(LZ4_INCLUDE_DIRS LZ4_LIBRARIES)
@@ -0,0 +1,22 @@
+# - Try to find Zstandard
+# Once done this will define
+#
+#  ZSTD_FOUND - system has libzstd
+#  ZSTD_INCLUDE_DIRS - the libzstd include directory
+#  ZSTD_LIBRARIES - Link these to use libzstd
+#
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+
+find_library(ZSTD_LIBRARY NAMES zstd zstd_static libzstd)
+
+set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+set(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+
+INCLUDE(FindPackageHandleStandardArgs)
+# handle the QUIETLY and REQUIRED arguments and set ZSTD_FOUND to TRUE if
+# all listed variables are TRUE
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Zstd DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
+
+# show the ZSTD_INCLUDE_DIRS and ZSTD_LIBRARIES variables only in the advanced view
+mark_as_advanced(ZSTD_INCLUDE_DIRS ZSTD_LIBRARIES)
@@ -1115,6 +1115,13 @@ public:
 	struct msecnode_t	*touching_rendersectors; // this is the list of sectors that this thing interesects with it's max(radius, renderradius).
 	int validcount;
 
+	// An area around the actor that no line passes through. As long as the actor stays inside it
+	// and in the same sector, its sector lists do not need to be rebuilt when it moves.
+	DVector2			SecNodeFreeMin, SecNodeFreeMax;
+	sector_t			*SecNodeSector;		// nullptr if there is no such area
+	double				SecNodeRadius, SecNodeRenderRadius;
+	int					SecNodeGeneration;
+
 
 	TObjPtr<AActor*>	Inventory;		// [RH] This actor's inventory
 	uint32_t			InventoryID;	// A unique ID to keep track of inventory items
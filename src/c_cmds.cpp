@@ -485,7 +485,7 @@ UNSAFE_CCMD (exec)
 
 void execLogfile(const char *fn, bool append)
 {
-	if ((Logfile = fopen(fn, append? "a" : "w")))
+	if (C_OpenLog(fn, append))
 	{
 		const char *timestr = myasctime();
 		Printf("Log started: %s\n", timestr);
@@ -503,8 +503,7 @@ UNSAFE_CCMD (logfile)
 	{
 		const char *timestr = myasctime();
 		Printf("Log stopped: %s\n", timestr);
-		fclose (Logfile);
-		Logfile = NULL;
+		C_CloseLog();
 	}
 
 	if (argv.argc() >= 2)
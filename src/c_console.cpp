@@ -32,6 +32,8 @@
 **
 */
 
+#include <thread>
+#include <atomic>
 #include "templates.h"
 #include "p_setup.h"
 #include "i_system.h"
@@ -61,6 +63,8 @@
 #include "c_consolebuffer.h"
 #include "g_levellocals.h"
 #include "vm.h"
+#include "stats.h"
+#include "ringqueue.h"
 
 
 #include "gi.h"
@@ -466,8 +470,6 @@ int PrintColors[PRINTLEVELS+2] = { CR_RED, CR_GOLD, CR_GRAY, CR_GREEN, CR_GREEN,
 
 static void setmsgcolor (int index, int color);
 
-FILE *Logfile = NULL;
-
 
 FIntCVar msglevel ("msg", 0, CVAR_ARCHIVE);
 
@@ -800,17 +802,29 @@ void FNotifyBuffer::AddString(int printlevel, FString source)
 
 void AddToConsole (int printlevel, const char *text)
 {
-	conbuffer->AddText(printlevel, text, Logfile);
+	conbuffer->AddText(printlevel, text, true);
 }
 
-/* Adds a string to the console and also to the notify buffer */
-int PrintString (int printlevel, const char *outline)
+static thread_local FOutputCapture *OutputCapture;
+
+void C_SetOutputCapture(FOutputCapture *capture)
 {
-	if (printlevel < msglevel || *outline == '\0')
-	{
-		return 0;
-	}
+	OutputCapture = capture;
+}
+
+struct FQueuedPrint
+{
+	int PrintLevel;
+	char *Text;
+};
 
+// Static initialization runs on the main thread.
+static const std::thread::id MainThreadID = std::this_thread::get_id();
+static TRingQueue<FQueuedPrint, 1024> PrintQueue;
+static std::atomic<int> PrintQueueOverflows;
+
+static void PrintToConsole (int printlevel, const char *outline)
+{
 	if (printlevel != PRINT_LOG)
 	{
 		I_PrintStr (outline);
@@ -821,14 +835,67 @@ int PrintString (int printlevel, const char *outline)
 			NotifyStrings.AddString(printlevel, outline);
 		}
 	}
-	else if (Logfile != NULL)
+	else
 	{
-		fputs (outline, Logfile);
-		fflush (Logfile);
+		C_WriteLog (outline);
+	}
+}
+
+//==========================================================================
+//
+// Messages from other threads are inserted in one go the next time the
+// main thread prints something or the console ticks.
+//
+//==========================================================================
+
+void C_FlushPrintQueue ()
+{
+	FQueuedPrint print;
+	while (PrintQueue.Pop(print))
+	{
+		PrintToConsole (print.PrintLevel, print.Text);
+		delete[] print.Text;
+	}
+}
+
+/* Adds a string to the console and also to the notify buffer */
+int PrintString (int printlevel, const char *outline)
+{
+	if (printlevel < msglevel || *outline == '\0')
+	{
+		return 0;
+	}
+
+	if (OutputCapture != nullptr)
+	{
+		OutputCapture->Print(printlevel, outline);
+	}
+	else if (std::this_thread::get_id() != MainThreadID)
+	{
+		FQueuedPrint print = { printlevel, copystring(outline) };
+		if (!PrintQueue.Push(print))
+		{
+			// At least keep it in the log.
+			delete[] print.Text;
+			C_WriteLog (outline);
+			PrintQueueOverflows++;
+		}
+	}
+	else
+	{
+		C_FlushPrintQueue ();
+		PrintToConsole (printlevel, outline);
 	}
 	return (int)strlen (outline);
 }
 
+ADD_STAT(console)
+{
+	FString out;
+	out.Format("Console: %d messages from other threads did not fit into the queue", PrintQueueOverflows.load());
+	return out;
+}
+
 extern bool gameisdead;
 
 int VPrintf (int printlevel, const char *format, va_list parms)
@@ -909,6 +976,8 @@ void C_Ticker()
 	static int lasttic = 0;
 	consoletic++;
 
+	C_FlushPrintQueue ();
+
 	if (lasttic == 0)
 		lasttic = consoletic - 1;
 
@@ -62,6 +62,24 @@ void C_NewModeAdjust (void);
 
 void C_Ticker (void);
 
+// Takes the output of threads that may not print directly, so that it can be passed on later.
+struct FOutputCapture
+{
+	virtual void Print(int printlevel, const char *string) = 0;
+};
+
+// Redirects everything the calling thread prints. nullptr restores regular output.
+void C_SetOutputCapture(FOutputCapture *capture);
+
+// The log file is written by a background thread. C_WriteLog can be called from any thread.
+bool C_OpenLog(const char *filename, bool append);
+void C_CloseLog();
+void C_WriteLog(const char *text);
+void C_FlushLog();
+
+// Passes on what other threads have printed. Only the main thread may use the console.
+void C_FlushPrintQueue();
+
 void AddToConsole (int printlevel, const char *string);
 int PrintString (int printlevel, const char *string);
 int PrintStringHigh (const char *string);
@@ -45,7 +45,6 @@
 
 FConsoleBuffer::FConsoleBuffer()
 {
-	mLogFile = NULL;
 	mAddType = NEWLINE;
 	mLastFont = NULL;
 	mLastDisplayWidth = -1;
@@ -95,7 +94,7 @@ void FConsoleBuffer::FreeBrokenText(unsigned start, unsigned end)
 //
 //==========================================================================
 
-void FConsoleBuffer::AddText(int printlevel, const char *text, FILE *logfile)
+void FConsoleBuffer::AddText(int printlevel, const char *text, bool log)
 {
 	FString build = TEXTCOLOR_TAN;
 	
@@ -138,7 +137,7 @@ void FConsoleBuffer::AddText(int printlevel, const char *text, FILE *logfile)
 	// don't bother about linefeeds etc. inside the text, we'll let the formatter sort this out later.
 	build.AppendCStrPart(text, textsize);
 	mConsoleText.Push(build);
-	if (logfile != NULL) WriteLineToLog(logfile, text);
+	if (log) C_WriteLog(text);
 }
 
 //==========================================================================
@@ -147,70 +146,11 @@ void FConsoleBuffer::AddText(int printlevel, const char *text, FILE *logfile)
 //
 //==========================================================================
 
-void FConsoleBuffer::WriteLineToLog(FILE *LogFile, const char *outline)
+void FConsoleBuffer::WriteContentToLog()
 {
-	// Strip out any color escape sequences before writing to the log file
-	TArray<char> copy(strlen(outline)+1);
-	const char * srcp = outline;
-	char * dstp = copy.Data();
-
-	while (*srcp != 0)
-	{
-
-		if (*srcp != TEXTCOLOR_ESCAPE)
-		{
-			switch (*srcp)
-			{
-				case '\35':
-					*dstp++ = '<';
-					break;
-				
-				case '\36':
-					*dstp++ = '-';
-					break;
-				
-				case '\37':
-					*dstp++ = '>';
-					break;
-					
-				default:
-					*dstp++=*srcp;
-					break;
-			}
-			srcp++;
-		}
-		else if (srcp[1] == '[')
-		{
-			srcp+=2;
-			while (*srcp != ']' && *srcp != 0) srcp++;
-			if (*srcp == ']') srcp++;
-		}
-		else
-		{
-			if (srcp[1]!=0) srcp+=2;
-			else break;
-		}
-	}
-	*dstp=0;
-
-	fputs (copy.Data(), LogFile);
-	fflush (LogFile);
-}
-
-//==========================================================================
-//
-//
-//
-//==========================================================================
-
-void FConsoleBuffer::WriteContentToLog(FILE *LogFile)
-{
-	if (LogFile != NULL)
+	for (unsigned i = 0; i < mConsoleText.Size(); i++)
 	{
-		for (unsigned i = 0; i < mConsoleText.Size(); i++)
-		{
-			WriteLineToLog(LogFile, mConsoleText[i]);
-		}
+		C_WriteLog(mConsoleText[i]);
 	}
 }
 
@@ -220,9 +160,9 @@ void FConsoleBuffer::WriteContentToLog(FILE *LogFile)
 //
 //==========================================================================
 
-void FConsoleBuffer::Linefeed(FILE *Logfile)
+void FConsoleBuffer::Linefeed(bool log)
 {
-	if (mAddType != NEWLINE && Logfile != NULL) fputc('\n', Logfile);
+	if (mAddType != NEWLINE && log) C_WriteLog("\n");
 	mAddType = NEWLINE;
 }
 
@@ -239,13 +179,13 @@ static const char bar2[] = TEXTCOLOR_RED "\35\36\36\36\36\36\36\36\36\36\36\36\3
 static const char bar3[] = TEXTCOLOR_RED "\35\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36"
 						  "\36\36\36\36\36\36\36\36\36\36\36\36\37" TEXTCOLOR_NORMAL "\n";
 
-void FConsoleBuffer::AddMidText(const char *string, bool bold, FILE *Logfile)
+void FConsoleBuffer::AddMidText(const char *string, bool bold, bool log)
 {
-	Linefeed(Logfile);
-	AddText (-1, bold? bar2 : bar1, Logfile);
-	AddText (-1, string, Logfile);
-	Linefeed(Logfile);
-	AddText(-1, bar3, Logfile);
+	Linefeed(log);
+	AddText (-1, bold? bar2 : bar1, log);
+	AddText (-1, string, log);
+	Linefeed(log);
+	AddText(-1, bar3, log);
 }
 
 //==========================================================================
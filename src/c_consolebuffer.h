@@ -52,7 +52,6 @@ class FConsoleBuffer
 	TArray<TArray<FBrokenLines>> m_BrokenConsoleText;	// This holds the structures returned by V_BreakLines and is used for memory management.
 	TArray<unsigned int> mBrokenStart;		
 	TArray<FBrokenLines> mBrokenLines;		// This holds the single lines, indexed by mBrokenStart and is used for printing.
-	FILE * mLogFile;
 	EAddType mAddType;
 	int mTextLines;
 	bool mBufferWasCleared;
@@ -61,19 +60,18 @@ class FConsoleBuffer
 	int mLastDisplayWidth;
 	bool mLastLineNeedsUpdate;
 
-	void WriteLineToLog(FILE *LogFile, const char *outline);
 	void FreeBrokenText(unsigned int start = 0, unsigned int end = INT_MAX);
 
-	void Linefeed(FILE *Logfile);
+	void Linefeed(bool log);
 	
 public:
 	FConsoleBuffer();
 	~FConsoleBuffer();
-	void AddText(int printlevel, const char *string, FILE *logfile = NULL);
-	void AddMidText(const char *string, bool bold, FILE *logfile);
+	void AddText(int printlevel, const char *string, bool log = false);
+	void AddMidText(const char *string, bool bold, bool log);
 	void FormatText(FFont *formatfont, int displaywidth);
 	void ResizeBuffer(unsigned newsize);
-	void WriteContentToLog(FILE *logfile);
+	void WriteContentToLog();
 	void Clear()
 	{
 		mBufferWasCleared = true;
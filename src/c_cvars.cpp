@@ -47,6 +47,7 @@
 
 #include "menu/menu.h"
 #include "vm.h"
+#include "stats.h"
 
 struct FLatchedValue
 {
@@ -63,6 +64,20 @@ bool FBaseCVar::m_UseCallback = false;
 
 FBaseCVar *CVars = NULL;
 
+// All cvars are also kept in a hash table for finding them by name.
+enum { CVAR_HASH_SIZE = 1024 };
+static FBaseCVar *CVarHash[CVAR_HASH_SIZE];
+
+// Incremented whenever a cvar is created or destroyed to invalidate the name cache.
+static unsigned int CVarGeneration = 1;
+
+struct FCVarNameCacheEntry
+{
+	FBaseCVar *CVar;
+	unsigned int Generation;
+};
+static TArray<FCVarNameCacheEntry> CVarNameCache;
+
 int cvar_defflags;
 
 FBaseCVar::FBaseCVar (const char *var_name, uint32_t flags, void (*callback)(FBaseCVar &))
@@ -94,6 +109,11 @@ FBaseCVar::FBaseCVar (const char *var_name, uint32_t flags, void (*callback)(FBa
 		Name = copystring (var_name);
 		m_Next = CVars;
 		CVars = this;
+
+		FBaseCVar **bucket = &CVarHash[MakeKey (var_name) % CVAR_HASH_SIZE];
+		m_HashNext = *bucket;
+		*bucket = this;
+		CVarGeneration++;
 	}
 
 	if (var)
@@ -121,17 +141,25 @@ FBaseCVar::~FBaseCVar ()
 {
 	if (Name)
 	{
-		FBaseCVar *var, *prev;
-
-		var = FindCVar (Name, &prev);
+		FBaseCVar **link;
 
-		if (var == this)
+		for (link = &CVars; *link != nullptr; link = &(*link)->m_Next)
 		{
-			if (prev)
-				prev->m_Next = m_Next;
-			else
-				CVars = m_Next;
+			if (*link == this)
+			{
+				*link = m_Next;
+				break;
+			}
+		}
+		for (link = &CVarHash[MakeKey (Name) % CVAR_HASH_SIZE]; *link != nullptr; link = &(*link)->m_HashNext)
+		{
+			if (*link == this)
+			{
+				*link = m_HashNext;
+				break;
+			}
 		}
+		CVarGeneration++;
 		C_RemoveTabCommand(Name);
 		delete[] Name;
 	}
@@ -1567,14 +1595,14 @@ void C_ForgetCVars (void)
 FBaseCVar *FindCVar (const char *var_name, FBaseCVar **prev)
 {
 	FBaseCVar *var;
-	FBaseCVar *dummy;
 
 	if (var_name == NULL)
 		return NULL;
 
 	if (prev == NULL)
-		prev = &dummy;
+		return FindCVarSub (var_name, (int)strlen (var_name));
 
+	// Only the list knows the predecessor.
 	var = CVars;
 	*prev = NULL;
 	while (var)
@@ -1587,11 +1615,33 @@ FBaseCVar *FindCVar (const char *var_name, FBaseCVar **prev)
 	return var;
 }
 
+FBaseCVar *FindCVar (FName name)
+{
+	unsigned int index = name.GetIndex();
+
+	if (index < CVarNameCache.Size() && CVarNameCache[index].Generation == CVarGeneration)
+	{
+		return CVarNameCache[index].CVar;
+	}
+	if (index >= CVarNameCache.Size())
+	{
+		unsigned int oldsize = CVarNameCache.Size();
+		CVarNameCache.Resize(index + 1);
+		for (unsigned int i = oldsize; i <= index; i++)
+		{
+			CVarNameCache[i] = { nullptr, 0 };
+		}
+	}
+	FBaseCVar *var = FindCVar (name.GetChars(), nullptr);
+	CVarNameCache[index] = { var, CVarGeneration };
+	return var;
+}
+
 DEFINE_ACTION_FUNCTION(_CVar, FindCVar)
 {
 	PARAM_PROLOGUE;
 	PARAM_NAME(name);
-	ACTION_RETURN_POINTER(FindCVar(name, nullptr));
+	ACTION_RETURN_POINTER(FindCVar(name));
 }
 
 DEFINE_ACTION_FUNCTION(_CVar, GetCVar)
@@ -1609,7 +1659,7 @@ FBaseCVar *FindCVarSub (const char *var_name, int namelen)
 	if (var_name == NULL)
 		return NULL;
 
-	var = CVars;
+	var = CVarHash[MakeKey (var_name, namelen) % CVAR_HASH_SIZE];
 	while (var)
 	{
 		const char *probename = var->GetName ();
@@ -1619,14 +1669,13 @@ FBaseCVar *FindCVarSub (const char *var_name, int namelen)
 		{
 			break;
 		}
-		var = var->m_Next;
+		var = var->m_HashNext;
 	}
 	return var;
 }
 
-FBaseCVar *GetCVar(AActor *activator, const char *cvarname)
+static FBaseCVar *GetCVar(AActor *activator, FBaseCVar *cvar)
 {
-	FBaseCVar *cvar = FindCVar(cvarname, nullptr);
 	// Either the cvar doesn't exist, or it's for a mod that isn't loaded, so return nullptr.
 	if (cvar == nullptr || (cvar->GetFlags() & CVAR_IGNORE))
 	{
@@ -1641,12 +1690,22 @@ FBaseCVar *GetCVar(AActor *activator, const char *cvarname)
 			{
 				return nullptr;
 			}
-			return GetUserCVar(int(activator->player - players), cvarname);
+			return GetUserCVar(int(activator->player - players), cvar->GetName());
 		}
 		return cvar;
 	}
 }
 
+FBaseCVar *GetCVar(AActor *activator, const char *cvarname)
+{
+	return GetCVar(activator, FindCVar(cvarname, nullptr));
+}
+
+FBaseCVar *GetCVar(AActor *activator, FName cvarname)
+{
+	return GetCVar(activator, FindCVar(cvarname));
+}
+
 FBaseCVar *GetUserCVar(int playernum, const char *cvarname)
 {
 	if ((unsigned)playernum >= MAXPLAYERS || !playeringame[playernum])
@@ -1820,11 +1879,11 @@ CCMD (unset)
 
 CCMD (get)
 {
-	FBaseCVar *var, *prev;
+	FBaseCVar *var;
 
 	if (argv.argc() >= 2)
 	{
-		if ( (var = FindCVar (argv[1], &prev)) )
+		if ( (var = FindCVar (argv[1], NULL)) )
 		{
 			UCVarValue val;
 			val = var->GetGenericRep (CVAR_String);
@@ -1843,12 +1902,12 @@ CCMD (get)
 
 CCMD (toggle)
 {
-	FBaseCVar *var, *prev;
+	FBaseCVar *var;
 	UCVarValue val;
 
 	if (argv.argc() > 1)
 	{
-		if ( (var = FindCVar (argv[1], &prev)) )
+		if ( (var = FindCVar (argv[1], NULL)) )
 		{
 			var->MarkUnsafe();
 
@@ -1935,3 +1994,72 @@ CCMD (archivecvar)
 		}
 	}
 }
+
+//===========================================================================
+//
+// Measures the cost of a lookup with the old list walk, the hash table and
+// the name cache while the number of registered cvars grows.
+//
+//===========================================================================
+
+static FBaseCVar *FindCVarLinear (const char *var_name)
+{
+	for (FBaseCVar *var = CVars; var != nullptr; var = var->GetNext())
+	{
+		if (stricmp (var->GetName (), var_name) == 0) return var;
+	}
+	return nullptr;
+}
+
+CCMD (benchcvarlookup)
+{
+	static const int extracounts[] = { 0, 1000, 2000, 4000, 8000 };
+	const int numlookups = 256;
+	const int repeats = 100;
+	TArray<FBaseCVar *> extras;
+
+	for (int extracount : extracounts)
+	{
+		while ((int)extras.Size() < extracount)
+		{
+			FStringf name("__benchcvar%u", extras.Size());
+			extras.Push(C_CreateCVar(name, CVAR_Int, CVAR_UNSETTABLE));
+		}
+
+		// Look up a spread of names across the whole list, including one that doesn't exist.
+		TArray<FBaseCVar *> all;
+		for (FBaseCVar *var = CVars; var != nullptr; var = var->GetNext()) all.Push(var);
+		TArray<FString> names;
+		TArray<FName> fnames;
+		for (int i = 0; i < numlookups - 1; i++)
+		{
+			names.Push(all[(unsigned)i * all.Size() / (numlookups - 1)]->GetName());
+		}
+		names.Push("__nonexistent_cvar");
+		for (auto &name : names) fnames.Push(name);
+
+		cycle_t linear, hashed, cached;
+		int found = 0;
+		linear.Reset();
+		hashed.Reset();
+		cached.Reset();
+
+		linear.Clock();
+		for (int r = 0; r < repeats; r++) for (auto &name : names) found += FindCVarLinear(name) != nullptr;
+		linear.Unclock();
+
+		hashed.Clock();
+		for (int r = 0; r < repeats; r++) for (auto &name : names) found += FindCVar(name, nullptr) != nullptr;
+		hashed.Unclock();
+
+		cached.Clock();
+		for (int r = 0; r < repeats; r++) for (auto name : fnames) found += FindCVar(name) != nullptr;
+		cached.Unclock();
+
+		double scale = 1e6 / (repeats * numlookups);
+		Printf("%5u cvars: linear %8.1f ns, hashed %6.1f ns, cached %6.1f ns per lookup (%d found)\n",
+			all.Size(), linear.TimeMS() * scale, hashed.TimeMS() * scale, cached.TimeMS() * scale, found / 3);
+	}
+
+	for (auto var : extras) delete var;
+}
@@ -157,6 +157,7 @@ private:
 
 	void (*m_Callback)(FBaseCVar &);
 	FBaseCVar *m_Next;
+	FBaseCVar *m_HashNext;
 
 	static bool m_UseCallback;
 	static bool m_DoNoSet;
@@ -193,8 +194,13 @@ void C_BackupCVars (void);
 FBaseCVar *FindCVar (const char *var_name, FBaseCVar **prev);
 FBaseCVar *FindCVarSub (const char *var_name, int namelen);
 
+// Same, but remembers the result for the name, so that looking up the same
+// name again is only an array access until a cvar gets created or destroyed.
+FBaseCVar *FindCVar (FName name);
+
 // Used for ACS and DECORATE.
 FBaseCVar *GetCVar(AActor *activator, const char *cvarname);
+FBaseCVar *GetCVar(AActor *activator, FName cvarname);
 FBaseCVar *GetUserCVar(int playernum, const char *cvarname);
 
 // Create a new cvar with the specified name and type
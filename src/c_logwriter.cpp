@@ -0,0 +1,353 @@
+/*
+** c_logwriter.cpp
+** Writes the log file on a background thread
+**
+** Every printed message used to be written and flushed to the log file
+** right away, which made heavy debug output very expensive. Now messages
+** are put into a lock free queue and a writer thread strips the color
+** codes and writes them in batches. When the queue is full, messages are
+** dropped and the log notes how many were lost. A line that is the same
+** as the one before it is only counted, like syslog does.
+**
+** log_flush controls when the file gets flushed:
+** 0: only when the log is closed or the engine dies
+** 1: after each batch written by the writer thread
+** 2: each message is written and flushed by the thread that prints it
+**
+** When the engine dies, C_FlushLog stops the writer thread and writes what
+** is still queued. The file stays open, and everything printed afterwards,
+** including the error message itself, is written directly.
+**
+*/
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "c_console.h"
+#include "c_cvars.h"
+#include "cmdlib.h"
+#include "stats.h"
+#include "i_system.h"
+#include "v_text.h"
+#include "ringqueue.h"
+
+FILE *Logfile = NULL;
+
+static std::atomic<int> LogFlushMode(1);
+
+CUSTOM_CVAR(Int, log_flush, 1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+	else if (self > 2) self = 2;
+	else LogFlushMode = self;
+}
+
+static TRingQueue<char *, 4096> LogQueue;
+static std::mutex LogMutex;			// held by whichever thread writes to the file
+static std::condition_variable LogWakeup;
+static std::thread LogThread;
+static std::atomic<bool> LogThreadRunning;
+static std::atomic<bool> LogOpen;		// Logfile != NULL, for the threads that don't hold LogMutex
+static std::atomic<bool> LogThreadExit;
+static std::atomic<int> LogDropped;
+
+// Everything below is protected by LogMutex.
+static TArray<char> LogStripped;
+static FString LogLastLine;
+static bool LogAtLineStart = true;
+static int LogRepeats;
+static int LogTotalWritten, LogTotalMerged, LogTotalDropped;
+
+//==========================================================================
+//
+// Strip out any color escape sequences before writing to the log file
+//
+//==========================================================================
+
+static void WriteStripped(const char *text)
+{
+	LogStripped.Resize((unsigned)strlen(text) + 1);
+	char *dstp = LogStripped.Data();
+
+	while (*text != 0)
+	{
+		if (*text != TEXTCOLOR_ESCAPE)
+		{
+			switch (*text)
+			{
+			case '\35':	*dstp++ = '<';	break;
+			case '\36':	*dstp++ = '-';	break;
+			case '\37':	*dstp++ = '>';	break;
+			default:	*dstp++ = *text;	break;
+			}
+			text++;
+		}
+		else if (text[1] == '[')
+		{
+			text += 2;
+			while (*text != ']' && *text != 0) text++;
+			if (*text == ']') text++;
+		}
+		else
+		{
+			if (text[1] != 0) text += 2;
+			else break;
+		}
+	}
+	*dstp = 0;
+	fputs(LogStripped.Data(), Logfile);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void WriteRepeats()
+{
+	if (LogRepeats > 0)
+	{
+		fprintf(Logfile, "(last message repeated %d time%s)\n", LogRepeats, LogRepeats == 1 ? "" : "s");
+		LogRepeats = 0;
+	}
+}
+
+static void WriteMessage(const char *text)
+{
+	size_t len = strlen(text);
+	bool isline = LogAtLineStart && len > 1 && text[len - 1] == '\n';
+
+	if (isline && LogLastLine.Compare(text) == 0)
+	{
+		LogRepeats++;
+		LogTotalMerged++;
+		return;
+	}
+	WriteRepeats();
+	WriteStripped(text);
+	LogTotalWritten++;
+	LogLastLine = isline ? text : "";
+	LogAtLineStart = len > 0 && text[len - 1] == '\n';
+}
+
+//==========================================================================
+//
+// Writes everything that has been queued. The caller must hold LogMutex.
+//
+//==========================================================================
+
+static bool WritePending()
+{
+	bool wrote = false;
+	char *text;
+	while (LogQueue.Pop(text))
+	{
+		if (Logfile != NULL)
+		{
+			WriteMessage(text);
+			wrote = true;
+		}
+		delete[] text;
+	}
+
+	int dropped = LogDropped.exchange(0);
+	if (dropped > 0 && Logfile != NULL)
+	{
+		WriteRepeats();
+		fprintf(Logfile, "%s(%d messages dropped, the log could not keep up)\n", LogAtLineStart ? "" : "\n", dropped);
+		LogAtLineStart = true;
+		LogLastLine = "";
+		LogTotalDropped += dropped;
+		wrote = true;
+	}
+	return wrote;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void LogThreadMain()
+{
+	std::unique_lock<std::mutex> lock(LogMutex);
+	while (!LogThreadExit)
+	{
+		if (WritePending() && LogFlushMode > 0 && Logfile != NULL)
+		{
+			fflush(Logfile);
+		}
+		// Producers don't take the mutex so a wakeup may get lost. The timeout limits how late such a message gets written.
+		LogWakeup.wait_for(lock, std::chrono::milliseconds(20), []() { return LogThreadExit || !LogQueue.IsEmpty(); });
+	}
+}
+
+//==========================================================================
+//
+// Can be called from any thread.
+//
+//==========================================================================
+
+void C_WriteLog(const char *text)
+{
+	if (!LogOpen || *text == 0) return;
+
+	bool queued = false;
+	if (LogFlushMode < 2 && LogThreadRunning)
+	{
+		char *copy = copystring(text);
+		if (LogQueue.Push(copy))
+		{
+			LogWakeup.notify_one();
+			queued = true;
+		}
+		else
+		{
+			delete[] copy;
+			LogDropped++;
+			return;
+		}
+		// If the thread was stopped in the meantime, whoever stopped it may already have written the queue.
+		if (LogThreadRunning) return;
+	}
+
+	std::lock_guard<std::mutex> lock(LogMutex);
+	if (Logfile != NULL)
+	{
+		WritePending();
+		if (!queued) WriteMessage(text);
+		fflush(Logfile);
+	}
+}
+
+//==========================================================================
+//
+// Stops the writer thread. Messages that are printed afterwards are
+// written directly.
+//
+//==========================================================================
+
+static void StopLogThread()
+{
+	if (LogThreadRunning.exchange(false))
+	{
+		LogThreadExit = true;
+		LogWakeup.notify_one();
+		// A crash handler may be running on the writer thread itself.
+		if (LogThread.get_id() == std::this_thread::get_id()) LogThread.detach();
+		else LogThread.join();
+	}
+}
+
+//==========================================================================
+//
+// Gets everything that has been printed so far into the file, for when
+// the engine is about to die. This is also called by the crash handlers,
+// on POSIX systems from inside the signal handler, so it gives up after a
+// second on a lock that the crashed thread may hold. The writer thread
+// needs that lock to quit, so it only gets joined once the lock has been
+// taken and released again. Otherwise it is told to quit and left alone.
+//
+//==========================================================================
+
+void C_FlushLog()
+{
+	bool running = LogThreadRunning.exchange(false);
+	if (running)
+	{
+		LogThreadExit = true;
+		LogWakeup.notify_one();
+		// A crash handler may be running on the writer thread itself, which may be holding the lock.
+		if (LogThread.get_id() == std::this_thread::get_id())
+		{
+			LogThread.detach();
+			return;
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(LogMutex, std::defer_lock);
+	for (int i = 0; !lock.try_lock(); i++)
+	{
+		if (i == 1000)
+		{
+			if (running) LogThread.detach();
+			return;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	if (Logfile != NULL)
+	{
+		WritePending();
+		WriteRepeats();
+		fflush(Logfile);
+	}
+	lock.unlock();
+	if (running) LogThread.join();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool C_OpenLog(const char *filename, bool append)
+{
+	C_CloseLog();
+
+	FILE *file = fopen(filename, append ? "a" : "w");
+	if (file == NULL) return false;
+
+	{
+		std::lock_guard<std::mutex> lock(LogMutex);
+		Logfile = file;
+		LogOpen = true;
+		LogAtLineStart = true;
+		LogLastLine = "";
+		LogRepeats = 0;
+	}
+	LogThreadExit = false;
+	LogThread = std::thread(LogThreadMain);
+	LogThreadRunning = true;
+	atterm(C_CloseLog);
+	return true;
+}
+
+void C_CloseLog()
+{
+	StopLogThread();
+
+	std::lock_guard<std::mutex> lock(LogMutex);
+	if (Logfile != NULL)
+	{
+		WritePending();
+		WriteRepeats();
+		fclose(Logfile);
+		Logfile = NULL;
+		LogOpen = false;
+	}
+}
+
+// In case the engine exits without running its atterm functions. A thread that is still running would abort the program here.
+static struct FLogCloser
+{
+	~FLogCloser() { C_CloseLog(); }
+} LogCloser;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ADD_STAT(log)
+{
+	std::lock_guard<std::mutex> lock(LogMutex);
+	FString out;
+	out.Format("Log: %s, %d messages written, %d repeats merged, %d dropped",
+		Logfile == NULL ? "closed" : LogThreadRunning ? "writer thread" : "direct", LogTotalWritten, LogTotalMerged, LogTotalDropped);
+	return out;
+}
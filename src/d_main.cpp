@@ -102,6 +102,8 @@
 #include "i_system.h"
 #include "g_cvars.h"
 #include "r_data/r_vanillatrans.h"
+#include "startupprofile.h"
+#include "d_startupgraph.h"
 
 EXTERN_CVAR(Bool, hud_althud)
 EXTERN_CVAR(Int, vr_mode)
@@ -2312,8 +2314,11 @@ void D_DoomMain (void)
 		}
 	}
 
+	StartupProfile_Start(Args->CheckValue("-profilestartup"));
+
 	if (!batchrun) Printf(PRINT_LOG, "%s version %s\n", GAMENAME, GetVersionString());
 
+	StartupProfile_Phase("D_DoomInit");
 	D_DoomInit();
 
 	extern void D_ConfirmSendStats();
@@ -2339,6 +2344,7 @@ void D_DoomMain (void)
 
 	do
 	{
+		StartupProfile_Phase("IWAD selection");
 		PClass::StaticInit();
 		PType::StaticInit();
 
@@ -2373,6 +2379,7 @@ void D_DoomMain (void)
 			I_FatalError ("You cannot -file with the shareware version. Register!");
 		}
 
+		StartupProfile_Phase("Config and autoexec");
 		FBaseCVar::DisableCallbacks();
 		GameConfig->DoGameSetup (gameinfo.ConfigName);
 
@@ -2409,6 +2416,7 @@ void D_DoomMain (void)
 		}
 
 		if (!batchrun) Printf ("W_Init: Init WADfiles.\n");
+		StartupProfile_Phase("W_Init");
 		Wads.InitMultipleFiles (allwads);
 		allwads.Clear();
 		allwads.ShrinkToFit();
@@ -2417,6 +2425,7 @@ void D_DoomMain (void)
 		GameConfig->DoKeySetup(gameinfo.ConfigName);
 
 		// Now that wads are loaded, define mod-specific cvars.
+		StartupProfile_Phase("CVARINFO and LANGUAGE");
 		ParseCVarInfo();
 
 		// Actually exec command line commands and exec files.
@@ -2440,19 +2449,23 @@ void D_DoomMain (void)
 		if (!restart)
 		{
 			if (!batchrun) Printf ("I_Init: Setting up machine state.\n");
+			StartupProfile_Phase("I_Init");
 			I_Init ();
 		}
 
 		if (!batchrun) Printf ("V_Init: allocate screen.\n");
+		StartupProfile_Phase("V_Init");
 		V_Init (!!restart);
 
 		// Base systems have been inited; enable cvar callbacks
 		FBaseCVar::EnableCallbacks ();
 
 		if (!batchrun) Printf ("S_Init: Setting up sound.\n");
+		StartupProfile_Phase("S_Init");
 		S_Init ();
 
 		if (!batchrun) Printf ("ST_Init: Init startup screen.\n");
+		StartupProfile_Phase("ST_Init");
 		if (!restart)
 		{
 			StartScreen = FStartupScreen::CreateInstance (TexMan.GuesstimateNumTextures() + 5);
@@ -2464,33 +2477,59 @@ void D_DoomMain (void)
 
 		CheckCmdLine();
 
+		// Everything from here up to the translations only reads definition lumps into its own
+		// data, so the steps that don't depend on each other can run in parallel.
+		StartupProfile_Phase("Startup steps");
+		FStartupGraph steps;
+
 		// [RH] Load sound environments
-		S_ParseReverbDef ();
+		steps.Add("S_ParseReverbDef", []() { S_ParseReverbDef (); }, {}, FStartupGraph::MainThread);
 
 		// [RH] Parse any SNDINFO lumps
-		if (!batchrun) Printf ("S_InitData: Load sound definitions.\n");
-		S_InitData ();
+		steps.Add("S_InitData", []()
+		{
+			if (!batchrun) Printf ("S_InitData: Load sound definitions.\n");
+			S_InitData ();
+		}, {}, FStartupGraph::MainThread);
 
 		// [RH] Parse through all loaded mapinfo lumps
-		if (!batchrun) Printf ("G_ParseMapInfo: Load map definitions.\n");
-		G_ParseMapInfo (iwad_info->MapInfo);
-		ReadStatistics();
+		steps.Add("G_ParseMapInfo", [=]()
+		{
+			if (!batchrun) Printf ("G_ParseMapInfo: Load map definitions.\n");
+			G_ParseMapInfo (iwad_info->MapInfo);
+		}, { "S_ParseReverbDef", "S_InitData" }, FStartupGraph::MainThread);
+		steps.Add("ReadStatistics", []() { ReadStatistics(); });
 
 		// MUSINFO must be parsed after MAPINFO
-		S_ParseMusInfo();
+		steps.Add("S_ParseMusInfo", []() { S_ParseMusInfo(); }, { "G_ParseMapInfo" }, FStartupGraph::MainThread);
 
-		if (!batchrun) Printf ("Texman.Init: Init texture manager.\n");
-		TexMan.Init();
-		C_InitConback();
+		// The textures themselves only need the lump directory. Skies, animations and switches also need MAPINFO and SNDINFO.
+		steps.Add("Texman.AddTextures", []()
+		{
+			if (!batchrun) Printf ("Texman.Init: Init texture manager.\n");
+			TexMan.AddTextures();
+		});
+		steps.Add("Texman.Init", []() { TexMan.FinishInit(); }, { "Texman.AddTextures", "S_InitData", "G_ParseMapInfo" }, FStartupGraph::MainThread);
+		steps.Add("C_InitConback", []() { C_InitConback(); }, { "Texman.Init" }, FStartupGraph::MainThread);
 
-		StartScreen->Progress();
-		V_InitFonts();
+		steps.Add("V_InitFonts", []()
+		{
+			StartScreen->Progress();
+			V_InitFonts();
+		}, { "Texman.Init" }, FStartupGraph::MainThread);
 
 		// [CW] Parse any TEAMINFO lumps.
-		if (!batchrun) Printf ("ParseTeamInfo: Load team definitions.\n");
-		TeamLibrary.ParseTeamInfo ();
+		steps.Add("ParseTeamInfo", []()
+		{
+			if (!batchrun) Printf ("ParseTeamInfo: Load team definitions.\n");
+			TeamLibrary.ParseTeamInfo ();
+		});
 
-		R_ParseTrnslate();
+		// Fonts and TEXTURES also create translations, so this must come after them to get the same translation numbers.
+		steps.Add("R_ParseTrnslate", []() { R_ParseTrnslate(); }, { "Texman.AddTextures", "V_InitFonts" }, FStartupGraph::MainThread);
+		steps.Run();
+
+		StartupProfile_Phase("LoadActors");
 		PClassActor::StaticInit ();
 
 		// [GRB] Initialize player class list
@@ -2507,16 +2546,20 @@ void D_DoomMain (void)
 
 		StartScreen->Progress ();
 
+		StartupProfile_Phase("ParseGLDefs");
 		ParseGLDefs();
 
 		if (!batchrun) Printf ("R_Init: Init %s refresh subsystem.\n", gameinfo.ConfigName.GetChars());
+		StartupProfile_Phase("R_Init");
 		StartScreen->LoadingStatus ("Loading graphics", 0x3f);
 		R_Init ();
 
 		if (!batchrun) Printf ("DecalLibrary: Load decals.\n");
+		StartupProfile_Phase("DecalLibrary");
 		DecalLibrary.ReadAllDecals ();
 
 		// Load embedded Dehacked patches
+		StartupProfile_Phase("Dehacked");
 		D_LoadDehLumps(FromIWAD);
 
 		// [RH] Add any .deh and .bex files on the command line.
@@ -2546,6 +2589,7 @@ void D_DoomMain (void)
 		FinishDehPatch();
 
 		if (!batchrun) Printf("M_Init: Init menus.\n");
+		StartupProfile_Phase("M_Init");
 		M_Init();
 
 		// clean up the compiler symbols which are not needed any longer.
@@ -2566,6 +2610,7 @@ void D_DoomMain (void)
 		primaryLevel->BotInfo.wanted_botnum = primaryLevel->BotInfo.getspawned.Size();
 
 		if (!batchrun) Printf ("P_Init: Init Playloop state.\n");
+		StartupProfile_Phase("P_Init");
 		StartScreen->LoadingStatus ("Init game engine", 0x3f);
 		AM_StaticInit();
 		P_Init ();
@@ -2594,6 +2639,7 @@ void D_DoomMain (void)
 		if (!restart)
 		{
 			if (!batchrun) Printf ("D_CheckNetGame: Checking network game status.\n");
+			StartupProfile_Phase("D_CheckNetGame");
 			StartScreen->LoadingStatus ("Checking network game status.", 0x3f);
 			D_CheckNetGame ();
 		}
@@ -2609,11 +2655,15 @@ void D_DoomMain (void)
 		iwad_man = NULL;
 
 		// [RH] Run any saved commands from the command line or autoexec.cfg now.
+		StartupProfile_Phase("C_RunDelayedCommands");
 		gamestate = GS_FULLCONSOLE;
 		Net_NewMakeTic ();
 		C_RunDelayedCommands();
 		gamestate = GS_STARTUP;
 
+		// Startup is complete, everything after this point is part of starting the game.
+		StartupProfile_Finish();
+
 		if (!restart)
 		{
 			// start the apropriate game based on parms
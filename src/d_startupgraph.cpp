@@ -0,0 +1,297 @@
+/*
+** d_startupgraph.cpp
+** Runs the independent parts of the engine startup in parallel
+**
+** Each step runs exactly once. Main thread steps keep the order they were
+** added in, worker steps start as soon as the steps they depend on are
+** done. Afterwards the time of every step and the critical path through
+** the graph are printed. That path is what the startup of these steps
+** cannot get below no matter how many threads are available.
+**
+*/
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include "ctpl.h"
+#include "doomtype.h"
+#include "doomerrors.h"
+#include "templates.h"
+#include "c_console.h"
+#include "m_argv.h"
+#include "i_time.h"
+#include "st_start.h"
+#include "w_wad.h"
+#include "startupprofile.h"
+#include "d_startupgraph.h"
+
+extern bool batchrun;
+
+struct FCapturedLine
+{
+	int PrintLevel;
+	FString Text;
+};
+
+struct FStartupGraph::FTask : public FOutputCapture
+{
+	FString Name;
+	std::function<void()> Func;
+	TArray<unsigned> Deps;
+	int Flags;
+	bool Done = false;
+	bool OnWorker = false;
+	bool Reported = false;
+	uint64_t Start = 0;
+	uint64_t End = 0;
+	std::exception_ptr Error;
+	TArray<FCapturedLine> Output;
+
+	void Print(int printlevel, const char *string) override
+	{
+		Output.Push({ printlevel, string });
+	}
+
+	void Execute()
+	{
+		FStartupProfileScope profile(Name);
+		Start = I_nsTime();
+		try
+		{
+			Func();
+		}
+		catch (...)
+		{
+			Error = std::current_exception();
+		}
+		End = I_nsTime();
+	}
+};
+
+static thread_local bool IsStartupWorker;
+static std::atomic<int> DeferredProgress;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FStartupGraph::~FStartupGraph()
+{
+}
+
+void FStartupGraph::Progress()
+{
+	if (IsStartupWorker) DeferredProgress++;
+	else StartScreen->Progress();
+}
+
+//==========================================================================
+//
+// Dependencies are given by name and must have been added before, which
+// also rules out cycles.
+//
+//==========================================================================
+
+void FStartupGraph::Add(const char *name, std::function<void()> func, std::initializer_list<const char *> deps, int flags)
+{
+	auto task = new FTask;
+	task->Name = name;
+	task->Func = std::move(func);
+	task->Flags = flags;
+	for (auto dep : deps)
+	{
+		unsigned i;
+		for (i = 0; i < Tasks.Size() && Tasks[i]->Name.Compare(dep) != 0; i++)
+		{
+		}
+		if (i == Tasks.Size())
+		{
+			I_FatalError("Startup step %s depends on unknown step %s", name, dep);
+		}
+		task->Deps.Push(i);
+	}
+	Tasks.Push(task);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FStartupGraph::Run()
+{
+	int numworkers = 0;
+	if (!Args->CheckParm("-serialstartup"))
+	{
+		for (auto task : Tasks)
+		{
+			if (!(task->Flags & MainThread)) numworkers++;
+		}
+		numworkers = MIN(numworkers, (int)std::thread::hardware_concurrency() - 1);
+	}
+
+	uint64_t start = I_nsTime();
+	if (numworkers <= 0)
+	{
+		for (auto task : Tasks)
+		{
+			task->Execute();
+			task->Done = true;
+			if (task->Error) std::rethrow_exception(task->Error);
+		}
+		Report(0, start, I_nsTime());
+		Tasks.DeleteAndClear();
+		return;
+	}
+
+	std::mutex mutex;
+	std::condition_variable finished;
+	ctpl::thread_pool pool(numworkers);
+	std::exception_ptr error;
+	unsigned nextmain = 0;
+	int running = 0;
+
+	auto isready = [&](FTask *task)
+	{
+		for (auto dep : task->Deps)
+		{
+			if (!Tasks[dep]->Done) return false;
+		}
+		return true;
+	};
+
+	Wads.SetThreadedAccess(true);
+	DeferredProgress = 0;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		// Pass on what the workers have finished.
+		for (auto task : Tasks)
+		{
+			if (task->OnWorker && task->Done && !task->Reported)
+			{
+				task->Reported = true;
+				running--;
+				for (auto &line : task->Output)
+				{
+					PrintString(line.PrintLevel, line.Text);
+				}
+				task->Output.Clear();
+				if (task->Error && !error) error = task->Error;
+			}
+		}
+		for (int progress = DeferredProgress.exchange(0); progress > 0; progress--)
+		{
+			StartScreen->Progress();
+		}
+
+		if (!error)
+		{
+			for (auto task : Tasks)
+			{
+				if (!(task->Flags & MainThread) && !task->OnWorker && isready(task))
+				{
+					task->OnWorker = true;
+					running++;
+					pool.push([&, task](int)
+					{
+						IsStartupWorker = true;
+						C_SetOutputCapture(task);
+						task->Execute();
+						C_SetOutputCapture(nullptr);
+						IsStartupWorker = false;
+
+						std::lock_guard<std::mutex> guard(mutex);
+						task->Done = true;
+						finished.notify_one();
+					});
+				}
+			}
+
+			while (nextmain < Tasks.Size() && !(Tasks[nextmain]->Flags & MainThread)) nextmain++;
+			if (nextmain < Tasks.Size() && isready(Tasks[nextmain]))
+			{
+				auto task = Tasks[nextmain++];
+				lock.unlock();
+				task->Execute();
+				lock.lock();
+				task->Done = true;
+				if (task->Error) error = task->Error;
+				continue;
+			}
+		}
+
+		if (running == 0 && (error || nextmain == Tasks.Size())) break;
+		finished.wait_for(lock, std::chrono::milliseconds(10));
+	}
+	lock.unlock();
+	Wads.SetThreadedAccess(false);
+
+	if (error) std::rethrow_exception(error);
+	Report(numworkers, start, I_nsTime());
+	Tasks.DeleteAndClear();
+}
+
+//==========================================================================
+//
+// The critical path only counts the declared dependencies and the order
+// of the main thread steps, so a serial run also shows how long a
+// parallel one would take at best.
+//
+//==========================================================================
+
+void FStartupGraph::Report(int numworkers, uint64_t start, uint64_t end)
+{
+	if (batchrun) return;
+
+	TArray<uint64_t> finish(Tasks.Size(), true);
+	TArray<int> previous(Tasks.Size(), true);
+	uint64_t work = 0;
+	int lastmain = -1;
+	int last = -1;
+
+	for (unsigned i = 0; i < Tasks.Size(); i++)
+	{
+		auto task = Tasks[i];
+		uint64_t ready = 0;
+		previous[i] = -1;
+		for (auto dep : task->Deps)
+		{
+			if (finish[dep] > ready)
+			{
+				ready = finish[dep];
+				previous[i] = dep;
+			}
+		}
+		if ((task->Flags & MainThread) && lastmain >= 0 && finish[lastmain] > ready)
+		{
+			ready = finish[lastmain];
+			previous[i] = lastmain;
+		}
+		if (task->Flags & MainThread) lastmain = i;
+
+		finish[i] = ready + task->End - task->Start;
+		work += task->End - task->Start;
+		if (last < 0 || finish[i] > finish[last]) last = i;
+	}
+
+	FString path;
+	for (int i = last; i >= 0; i = previous[i])
+	{
+		path = path.IsEmpty() ? Tasks[i]->Name : Tasks[i]->Name + " > " + path;
+	}
+
+	FString mode = numworkers > 0 ? FStringf("%d workers", numworkers) : FString("serial");
+	Printf("Startup steps: %.2f ms (%s), %.2f ms of work, critical path %.2f ms: %s\n",
+		(end - start) / 1000000., mode.GetChars(), work / 1000000., last >= 0 ? finish[last] / 1000000. : 0., path.GetChars());
+	for (auto task : Tasks)
+	{
+		DPrintf(DMSG_NOTIFY, "  %s: %.2f ms%s\n", task->Name.GetChars(), (task->End - task->Start) / 1000000., task->OnWorker ? " (worker)" : "");
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <initializer_list>
+#include "tarray.h"
+
+//==========================================================================
+//
+// Startup task graph
+//
+// Runs a group of startup steps that declare what they depend on. Steps
+// which are not marked as main thread only are handed to worker threads as
+// soon as their dependencies are done, while the main thread works through
+// the others in the order they were added. That order must be a valid
+// serial order. -serialstartup runs everything in it on the main thread.
+//
+// Worker steps must not touch anything that another step may use at the
+// same time unless one depends on the other. Their console output is held
+// back and printed by the main thread once they are done. Steps that create
+// FNames must run on the main thread, since name indices have to come out
+// the same on every startup.
+//
+//==========================================================================
+
+class FStartupGraph
+{
+public:
+	enum
+	{
+		MainThread = 1,		// uses the startup screen, the VM, creates names or uses other state that belongs to the main thread
+	};
+
+	~FStartupGraph();
+
+	void Add(const char *name, std::function<void()> func, std::initializer_list<const char *> deps = {}, int flags = 0);
+	void Run();
+
+	// StartScreen->Progress() for code that may also run on a worker.
+	static void Progress();
+
+private:
+	struct FTask;
+	TDeletingArray<FTask *> Tasks;
+
+	void Report(int numworkers, uint64_t start, uint64_t end);
+};
@@ -78,6 +78,7 @@
 #include "g_hub.h"
 #include "g_levellocals.h"
 #include "events.h"
+#include "hwrenderer/utility/hw_benchscene.h"
 
 
 static FRandom pr_dmspawn ("DMSpawn");
@@ -2766,6 +2767,7 @@ bool G_CheckDemoStatus (void)
 
 		if (timingdemo)
 			endtime = I_GetTime () - starttime;
+		BenchScene_Finish();
 
 		C_RestoreCVars ();		// [RH] Restore cvars demo might have changed
 		M_Free (demobuffer);
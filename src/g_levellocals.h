@@ -51,6 +51,7 @@
 #include "p_effect.h"
 #include "d_player.h"
 #include "p_destructible.h"
+#include "p_enemy.h"
 #include "r_data/r_sections.h"
 #include "r_data/r_canvastexture.h"
 #include "r_data/r_interpolate.h"
@@ -443,6 +444,7 @@ public:
 
 	FBlockmap blockmap;
 	TArray<polyblock_t *> PolyBlockMap;
+	FSoundGraph SoundGraph;
 	FUDMFKeyMap UDMFKeys[4];
 
 	// These are copies of the loaded map data that get used by the savegame code to skip unaltered fields
@@ -27,6 +27,7 @@
 #include "g_levellocals.h"
 #include "p_maputl.h"
 #include "actor.h"
+#include "stats.h"
 
 //=============================================================================
 // phares 3/21/98
@@ -289,6 +290,98 @@ msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector
 	return sector_list;
 }
 
+//=============================================================================
+//
+// P_KeepSecNodeLists
+//
+// Checks whether a moving actor's sector lists can be reused as they are.
+// This is the case if it is still in the same sector and has not left the
+// area around it that no line passes through, because then both lists
+// contain nothing but the actor's own sector.
+//
+//=============================================================================
+
+static int SecNodeLists, SecNodeListsKept;
+
+bool P_KeepSecNodeLists(AActor *thing)
+{
+	SecNodeLists++;
+	if (thing->SecNodeSector == nullptr || thing->SecNodeSector != thing->Sector ||
+		thing->SecNodeRadius != thing->radius || thing->SecNodeRenderRadius != thing->renderradius ||
+		thing->SecNodeGeneration != thing->Level->blockmap.polygeneration)
+	{
+		return false;
+	}
+
+	double radius = thing->renderradius >= 0 ? MAX(thing->radius, thing->renderradius) : thing->radius;
+	if (thing->X() - radius <= thing->SecNodeFreeMin.X || thing->X() + radius >= thing->SecNodeFreeMax.X ||
+		thing->Y() - radius <= thing->SecNodeFreeMin.Y || thing->Y() + radius >= thing->SecNodeFreeMax.Y)
+	{
+		return false;
+	}
+	SecNodeListsKept++;
+	return true;
+}
+
+//=============================================================================
+//
+// P_FindSecNodeFreeArea
+//
+// Called after an actor's sector lists have been rebuilt. Looks for a margin
+// around the actor that no line passes through so that the following moves
+// can skip the rebuild. If a line already crosses the actor, there is none.
+//
+//=============================================================================
+
+void P_FindSecNodeFreeArea(AActor *thing)
+{
+	static const double margins[] = { 64, 32, 16 };
+	const int nummargins = countof(margins);
+
+	double radius = thing->renderradius >= 0 ? MAX(thing->radius, thing->renderradius) : thing->radius;
+	int best = 0;
+
+	FBoundingBox box(thing->X(), thing->Y(), radius + margins[0]);
+	FBlockLinesIterator it(thing->Level, box);
+	line_t *ld;
+
+	while (best < nummargins && (ld = it.Next()))
+	{
+		// A line that crosses the area for one margin crosses it for all larger ones, too.
+		while (best < nummargins)
+		{
+			FBoundingBox mbox(thing->X(), thing->Y(), radius + margins[best]);
+			if (!mbox.inRange(ld) || mbox.BoxOnLineSide(ld) != -1) break;
+			best++;
+		}
+	}
+
+	if (best == nummargins)
+	{
+		thing->SecNodeSector = nullptr;
+		return;
+	}
+	double size = radius + margins[best];
+	thing->SecNodeFreeMin = { thing->X() - size, thing->Y() - size };
+	thing->SecNodeFreeMax = { thing->X() + size, thing->Y() + size };
+	thing->SecNodeSector = thing->Sector;
+	thing->SecNodeRadius = thing->radius;
+	thing->SecNodeRenderRadius = thing->renderradius;
+	thing->SecNodeGeneration = thing->Level->blockmap.polygeneration;
+}
+
+void P_ResetSecNodeCounters()
+{
+	SecNodeLists = SecNodeListsKept = 0;
+}
+
+ADD_STAT(secnodes)
+{
+	FString out;
+	out.Format("Sector lists linked = %d, kept = %d", SecNodeLists, SecNodeListsKept);
+	return out;
+}
+
 //=============================================================================
 //
 // P_DelPortalnode
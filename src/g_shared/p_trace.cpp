@@ -67,6 +67,7 @@ struct FTraceInfo
 	double startfrac;
 	double limitz;
 	int ptflags;
+	FTraceCandidates *Candidates;
 
 	// These are required for 3D-floor checking
 	// to create a fake sector with a floor 
@@ -105,6 +106,180 @@ struct FTraceInfo
 
 static bool EditTraceResult (uint32_t flags, FTraceResults &res);
 
+//==========================================================================
+//
+// A path traverser that takes the things of a block from a
+// FTraceCandidates cache, if one is available
+//
+//==========================================================================
+
+class FCandidatePathTraverse : public FPathTraverse
+{
+	FTraceCandidates *Candidates;
+	TMap<AActor *, bool> Checked;	// things that span several blocks and have already been added
+	int checkedvalidcount = 0;
+
+	void AddThingIntercepts(int bx, int by, FBlockThingsIterator &it, bool compatible);
+
+public:
+	FCandidatePathTraverse(FLevelLocals *l, FTraceCandidates *candidates, double x1, double y1, double x2, double y2, int flags, double startfrac)
+		: FPathTraverse(l)
+	{
+		Candidates = candidates;
+		init(x1, y1, x2, y2, flags, startfrac);
+	}
+};
+
+//==========================================================================
+//
+// FCandidatePathTraverse :: AddThingIntercepts
+//
+// Must return the same things in the same order as the block iterator
+// so that the traced result does not depend on the cache being used.
+//
+//==========================================================================
+
+void FCandidatePathTraverse::AddThingIntercepts(int bx, int by, FBlockThingsIterator &it, bool compatible)
+{
+	const FTraceCandidates::Entry *list;
+	unsigned count;
+
+	if (Candidates == nullptr)
+	{
+		FPathTraverse::AddThingIntercepts(bx, by, it, compatible);
+		return;
+	}
+
+	// Each (re)initialization of the traverser starts a new list of checked things, just like the block iterator does.
+	if (checkedvalidcount != validcount)
+	{
+		if (Checked.CountUsed() > 0) Checked.Clear();
+		checkedvalidcount = validcount;
+	}
+
+	if (!Candidates->GetBlock(bx, by, list, count))
+	{
+		// Outside the cached area. This block's things still need to be filtered
+		// against the ones that already came out of the cache.
+		FBlockThingsIterator bit(Level, bx, by, bx, by);
+		AActor *thing;
+
+		while ((thing = bit.Next(compatible)))
+		{
+			if (!compatible)
+			{
+				if (Checked.CheckKey(thing)) continue;
+				Checked.Insert(thing, true);
+			}
+			AddThingIntercept(thing, compatible);
+		}
+		return;
+	}
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		const FTraceCandidates::Entry &entry = list[i];
+		if (entry.MultiBlock)
+		{
+			if (compatible)
+			{
+				if (!entry.Centered) continue;
+			}
+			else
+			{
+				if (Checked.CheckKey(entry.Thing)) continue;
+				Checked.Insert(entry.Thing, true);
+			}
+		}
+		AddThingIntercept(entry.Thing, compatible);
+	}
+}
+
+//==========================================================================
+//
+// FTraceCandidates :: Init
+//
+// Sets up an empty cache for all blocks touched by the given box.
+//
+//==========================================================================
+
+void FTraceCandidates::Init(FLevelLocals *l, const FBoundingBox &box)
+{
+	Level = l;
+	linkgeneration = Level->blockmap.linkgeneration;
+	minx = MAX(0, Level->blockmap.GetBlockX(box.Left()));
+	miny = MAX(0, Level->blockmap.GetBlockY(box.Bottom()));
+	maxx = MIN(Level->blockmap.bmapwidth - 1, Level->blockmap.GetBlockX(box.Right()));
+	maxy = MIN(Level->blockmap.bmapheight - 1, Level->blockmap.GetBlockY(box.Top()));
+	Things.Clear();
+	Blocks.Clear();
+	if (minx <= maxx && miny <= maxy)
+	{
+		Blocks.Resize((maxx - minx + 1) * (maxy - miny + 1));
+		for (auto &span : Blocks)
+		{
+			span.Start = ~0u;
+			span.Count = 0;
+		}
+	}
+}
+
+//==========================================================================
+//
+// FTraceCandidates :: IsValid
+//
+// The cache becomes useless as soon as any actor gets relinked.
+//
+//==========================================================================
+
+bool FTraceCandidates::IsValid(FLevelLocals *l) const
+{
+	return Level == l && linkgeneration == l->blockmap.linkgeneration;
+}
+
+//==========================================================================
+//
+// FTraceCandidates :: GetBlock
+//
+// Returns false if the block is outside the cached area.
+//
+//==========================================================================
+
+bool FTraceCandidates::GetBlock(int bx, int by, const Entry *&list, unsigned &count)
+{
+	if (bx < minx || bx > maxx || by < miny || by > maxy)
+	{
+		return false;
+	}
+	Span &span = Blocks[(by - miny) * (maxx - minx + 1) + (bx - minx)];
+
+	if (span.Start == ~0u)
+	{
+		// first time this block is needed so collect its things now.
+		double blockleft = (bx * FBlockmap::MAPBLOCKUNITS) + Level->blockmap.bmaporgx;
+		double blockright = blockleft + FBlockmap::MAPBLOCKUNITS;
+		double blockbottom = (by * FBlockmap::MAPBLOCKUNITS) + Level->blockmap.bmaporgy;
+		double blocktop = blockbottom + FBlockmap::MAPBLOCKUNITS;
+
+		span.Start = Things.Size();
+		for (FBlockNode *block = Level->blockmap.blocklinks[by * Level->blockmap.bmapwidth + bx]; block != nullptr; block = block->NextActor)
+		{
+			AActor *me = block->Me;
+			Entry entry;
+
+			entry.Thing = me;
+			entry.MultiBlock = !(block->NextBlock == nullptr && block->PrevBlock == &me->BlockNode);
+			entry.Centered = me->X() >= blockleft && me->X() < blockright &&
+				me->Y() >= blockbottom && me->Y() < blocktop;
+			Things.Push(entry);
+		}
+		span.Count = Things.Size() - span.Start;
+	}
+	list = Things.Data() + span.Start;
+	count = span.Count;
+	return true;
+}
+
 
 
 static void GetPortalTransition(DVector3 &pos, sector_t *&sec)
@@ -151,7 +326,7 @@ static bool isLiquid(F3DFloor *ff)
 
 bool Trace(const DVector3 &start, sector_t *sector, const DVector3 &direction, double maxDist,
 	ActorFlags actorMask, uint32_t wallMask, AActor *ignore, FTraceResults &res, uint32_t flags,
-	ETraceStatus(*callback)(FTraceResults &res, void *), void *callbackdata)
+	ETraceStatus(*callback)(FTraceResults &res, void *), void *callbackdata, FTraceCandidates *candidates)
 {
 	FTraceInfo inf;
 	FTraceResults tempResult;
@@ -178,6 +353,7 @@ bool Trace(const DVector3 &start, sector_t *sector, const DVector3 &direction, d
 	inf.sectorsel=0;
 	inf.startfrac = 0;
 	inf.limitz = inf.Start.Z;
+	inf.Candidates = (candidates != nullptr && candidates->IsValid(inf.Level)) ? candidates : nullptr;
 	memset(&res, 0, sizeof(res));
 
 	if ((flags & TRACE_ReportPortals) && callback != NULL)
@@ -779,7 +955,7 @@ bool FTraceInfo::TraceTraverse (int ptflags)
 	// Do a 3D floor check in the starting sector
 	Setup3DFloors();
 
-	FPathTraverse it(Level, Start.X, Start.Y, Vec.X * MaxDist, Vec.Y * MaxDist, ptflags | PT_DELTA, startfrac);
+	FCandidatePathTraverse it(Level, Candidates, Start.X, Start.Y, Vec.X * MaxDist, Vec.Y * MaxDist, ptflags | PT_DELTA, startfrac);
 	intercept_t *in;
 	int lastsplashsector = -1;
 
@@ -38,11 +38,13 @@
 #include "actor.h"
 #include "cmdlib.h"
 #include "textures/textures.h"
+#include "m_bbox.h"
 
 struct sector_t;
 struct line_t;
 class AActor;
 struct F3DFloor;
+struct FLevelLocals;
 
 enum ETraceResult
 {
@@ -111,9 +113,47 @@ enum ETraceStatus
 	TRACE_Abort,		// stop the trace, returning no hits
 };
 
+//==========================================================================
+//
+// Blockmap things collected once for an area that several traces from
+// the same origin pass through (e.g. all pellets of a shotgun blast),
+// so that each trace does not have to walk the block links again.
+// The collected lists are only used as long as no actor has been linked
+// into or unlinked from the blockmap since they were gathered.
+//
+//==========================================================================
+
+class FTraceCandidates
+{
+public:
+	struct Entry
+	{
+		AActor *Thing;
+		bool MultiBlock;	// linked into more than one block, needs to be filtered for duplicates
+		bool Centered;		// the thing's center lies inside this block (for compatibility traces)
+	};
+
+	void Init(FLevelLocals *Level, const FBoundingBox &box);
+	bool IsValid(FLevelLocals *Level) const;
+	bool GetBlock(int bx, int by, const Entry *&list, unsigned &count);
+
+private:
+	struct Span
+	{
+		unsigned Start;
+		unsigned Count;
+	};
+
+	FLevelLocals *Level = nullptr;
+	int minx = 0, miny = 0, maxx = -1, maxy = -1;
+	int linkgeneration = 0;
+	TArray<Span> Blocks;	// gathered on first use
+	TArray<Entry> Things;
+};
+
 bool Trace(const DVector3 &start, sector_t *sector, const DVector3 &direction, double maxDist,
 	ActorFlags ActorMask, uint32_t WallMask, AActor *ignore, FTraceResults &res, uint32_t traceFlags = 0,
-	ETraceStatus(*callback)(FTraceResults &res, void *) = NULL, void *callbackdata = NULL);
+	ETraceStatus(*callback)(FTraceResults &res, void *) = NULL, void *callbackdata = NULL, FTraceCandidates *candidates = NULL);
 
 // [ZZ] this is the object that's used for ZScript
 class DLineTracer : public DObject
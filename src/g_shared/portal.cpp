@@ -345,6 +345,7 @@ bool FLevelLocals::ChangePortalLine(line_t *line, int destid)
 	if (line->portalindex >= linePortals.Size()) return false;
 	FLinePortal *port = &linePortals[line->portalindex];
 	if (port->mType == PORTT_LINKED) return false;	// linked portals cannot be changed.
+	SoundGraph.Clear();
 	if (destid == 0) port->mDestination = nullptr;
 	port->mDestination = FindPortalDestination(line, destid);
 	if (port->mDestination == nullptr)
@@ -870,6 +871,8 @@ void FLevelLocals::CreateLinkedPortals()
 	int id = 1;
 	bool bogus = false;
 
+	SoundGraph.Clear();
+
 	for(auto &s : sectorPortals)
 	{
 		if (s.mType == PORTS_LINKEDPORTAL)
@@ -1025,7 +1025,7 @@ class CommandDrawNumber : public CommandDrawString
 			usePrefix(false), interpolationSpeed(0), drawValue(0), length(3),
 			lowValue(-1), lowTranslation(CR_UNTRANSLATED), highValue(-1),
 			highTranslation(CR_UNTRANSLATED), value(CONSTANT),
-			inventoryItem(NULL), cvarName(nullptr)
+			inventoryItem(NULL), cvarName(NAME_None)
 		{
 		}
 
@@ -1601,7 +1601,7 @@ class CommandDrawNumber : public CommandDrawString
 		PClassActor			*inventoryItem;
 
 		FString				prefixPadding;
-		FString				cvarName;
+		FName				cvarName;
 
 		friend class CommandDrawInventoryBar;
 };
@@ -3545,7 +3545,7 @@ class CommandIfCVarInt : public SBarInfoNegatableFlowControl
 			SetTruth(result, block, statusBar);
 		}
 	protected:
-		FString		cvarname;
+		FName		cvarname;
 		FBaseCVar	*cvar;
 		int			value;
 		bool		equalcomp;
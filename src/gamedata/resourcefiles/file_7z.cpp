@@ -33,6 +33,8 @@
 **
 */
 
+#include <mutex>
+
 // Note that 7z made the unwise decision to include windows.h :(
 #include "7z.h"
 #include "7zCrc.h"
@@ -116,10 +118,9 @@ struct C7zArchive
 
 	C7zArchive(FileReader &file) : ArchiveStream(file)
 	{
-		if (g_CrcTable[1] == 0)
-		{
-			CrcGenerateTable();
-		}
+		// Archives may be opened on several threads at once.
+		static std::once_flag crcinit;
+		std::call_once(crcinit, []() { CrcGenerateTable(); });
 		file.Seek(0, FileReader::SeekSet);
 		LookToRead2_CreateVTable(&LookStream, false);
 		LookStream.realStream = &ArchiveStream.s;
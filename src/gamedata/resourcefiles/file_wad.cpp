@@ -388,7 +388,6 @@ void FWadFile::SetNamespace(const char *startmarker, const char *endmarker, name
 
 void FWadFile::SkinHack ()
 {
-	static int namespc = ns_firstskin;
 	bool skinned = false;
 	bool hasmap = false;
 	uint32_t i;
@@ -410,11 +409,11 @@ void FWadFile::SkinHack ()
 				skinned = true;
 				uint32_t j;
 
+				// FWadCollection gives each skin WAD its own namespace when it gets added.
 				for (j = 0; j < NumLumps; j++)
 				{
-					Lumps[j].Namespace = namespc;
+					Lumps[j].Namespace = ns_firstskin;
 				}
-				namespc++;
 			}
 		}
 		if ((lump->Name[0] == 'M' &&
@@ -34,8 +34,12 @@
 */
 
 #include <time.h>
+#include <sys/stat.h>
 #include "file_zip.h"
 #include "cmdlib.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "c_cvars.h"
 #include "templates.h"
 #include "v_text.h"
 #include "w_wad.h"
@@ -66,6 +70,13 @@ static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int L
 		case METHOD_DEFLATE:
 		case METHOD_BZIP2:
 		case METHOD_LZMA:
+#ifdef HAVE_ZSTD
+		case METHOD_ZSTD:
+		case METHOD_ZSTD_OLD:
+#endif
+#ifdef HAVE_LZ4
+		case METHOD_LZ4:
+#endif
 		{
 			FileReader frz;
 			if (frz.OpenDecompressor(Reader, LumpSize, Method, false))
@@ -102,6 +113,36 @@ static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int L
 	return true;
 }
 
+//==========================================================================
+//
+// Zstandard and LZ4 are only available if the engine was built with them.
+//
+//==========================================================================
+
+static bool IsSupportedMethod(int method)
+{
+	switch (method)
+	{
+	case METHOD_STORED:
+	case METHOD_DEFLATE:
+	case METHOD_LZMA:
+	case METHOD_BZIP2:
+	case METHOD_IMPLODE:
+	case METHOD_SHRINK:
+#ifdef HAVE_ZSTD
+	case METHOD_ZSTD:
+	case METHOD_ZSTD_OLD:
+#endif
+#ifdef HAVE_LZ4
+	case METHOD_LZ4:
+#endif
+		return true;
+
+	default:
+		return false;
+	}
+}
+
 bool FCompressedBuffer::Decompress(char *destbuffer)
 {
 	FileReader mr;
@@ -176,6 +217,7 @@ bool FZipFile::Open(bool quiet)
 	uint32_t centraldir = Zip_FindCentralDir(Reader);
 	FZipEndOfCentralDirectory info;
 	int skipped = 0;
+	bool warned = false;
 
 	Lumps = NULL;
 
@@ -197,15 +239,28 @@ bool FZipFile::Open(bool quiet)
 		return false;
 	}
 
-	NumLumps = LittleShort(info.NumEntries);
-	Lumps = new FZipLump[NumLumps];
-
 	// Load the entire central directory. Too bad that this contains variable length entries...
 	int dirsize = LittleLong(info.DirectorySize);
 	void *directory = malloc(dirsize);
 	Reader.Seek(LittleLong(info.DirectoryOffset), FileReader::SeekSet);
 	Reader.Read(directory, dirsize);
 
+	uint8_t dirhash[16];
+	MD5Context md5;
+	md5.Update((const uint8_t *)directory, dirsize);
+	md5.Final(dirhash);
+
+	if (LoadDirectoryCache(info, dirhash))
+	{
+		free(directory);
+		if (!quiet && !batchrun) Printf(TEXTCOLOR_NORMAL ", %d lumps\n", NumLumps);
+		PostProcessArchive(&Lumps[0], sizeof(FZipLump));
+		return true;
+	}
+
+	NumLumps = LittleShort(info.NumEntries);
+	Lumps = new FZipLump[NumLumps];
+
 	char *dirptr = (char*)directory;
 	FZipLump *lump_p = Lumps;
 
@@ -313,15 +368,11 @@ bool FZipFile::Open(bool quiet)
 
 		// Ignore unknown compression formats
 		zip_fh->Method = LittleShort(zip_fh->Method);
-		if (zip_fh->Method != METHOD_STORED &&
-			zip_fh->Method != METHOD_DEFLATE &&
-			zip_fh->Method != METHOD_LZMA &&
-			zip_fh->Method != METHOD_BZIP2 &&
-			zip_fh->Method != METHOD_IMPLODE &&
-			zip_fh->Method != METHOD_SHRINK)
+		if (!IsSupportedMethod(zip_fh->Method))
 		{
 			if (!quiet) Printf(TEXTCOLOR_YELLOW "\n%s: '%s' uses an unsupported compression algorithm (#%d).\n", FileName.GetChars(), name.GetChars(), zip_fh->Method);
 			skipped++;
+			warned = true;
 			continue;
 		}
 		// Also ignore encrypted entries
@@ -330,31 +381,20 @@ bool FZipFile::Open(bool quiet)
 		{
 			if (!quiet) Printf(TEXTCOLOR_YELLOW "\n%s: '%s' is encrypted. Encryption is not supported.\n", FileName.GetChars(), name.GetChars());
 			skipped++;
+			warned = true;
 			continue;
 		}
 
 		FixPathSeperator(name);
 		name.ToLower();
 
-		lump_p->LumpNameSetup(name);
 		lump_p->LumpSize = LittleLong(zip_fh->UncompressedSize);
-		lump_p->Owner = this;
-		// The start of the Reader will be determined the first time it is accessed.
-		lump_p->Flags = LUMPF_ZIPFILE | LUMPFZIP_NEEDFILESTART;
 		lump_p->Method = uint8_t(zip_fh->Method);
-		if (lump_p->Method != METHOD_STORED) lump_p->Flags |= LUMPF_COMPRESSED;
 		lump_p->GPFlags = zip_fh->Flags;
 		lump_p->CRC32 = zip_fh->CRC32;
 		lump_p->CompressedSize = LittleLong(zip_fh->CompressedSize);
 		lump_p->Position = LittleLong(zip_fh->LocalHeaderOffset);
-		lump_p->CheckEmbedded();
-
-		// Ignore some very specific names
-		if (0 == stricmp("dehacked.exe", name))
-		{
-			memset(lump_p->Name, 0, sizeof(lump_p->Name));
-		}
-
+		SetupLump(lump_p, name);
 		lump_p++;
 	}
 	// Resize the lump record array to its actual size
@@ -362,11 +402,221 @@ bool FZipFile::Open(bool quiet)
 	free(directory);
 
 	if (!quiet && !batchrun) Printf(TEXTCOLOR_NORMAL ", %d lumps\n", NumLumps);
+
+	// Entries that got skipped with a warning are not cached so that the warning shows up every time.
+	if (!warned) PrepareDirectoryCache(info, dirhash);
 	
 	PostProcessArchive(&Lumps[0], sizeof(FZipLump));
 	return true;
 }
 
+//==========================================================================
+//
+// Everything else about a lump follows from its name and the fields
+// from its directory entry.
+//
+//==========================================================================
+
+void FZipFile::SetupLump(FZipLump *lump_p, const FString &name)
+{
+	lump_p->LumpNameSetup(name);
+	lump_p->Owner = this;
+	// The start of the Reader will be determined the first time it is accessed.
+	lump_p->Flags = LUMPF_ZIPFILE | LUMPFZIP_NEEDFILESTART;
+	if (lump_p->Method != METHOD_STORED) lump_p->Flags |= LUMPF_COMPRESSED;
+	lump_p->CheckEmbedded();
+
+	// Ignore some very specific names
+	if (0 == stricmp("dehacked.exe", name))
+	{
+		memset(lump_p->Name, 0, sizeof(lump_p->Name));
+	}
+}
+
+//==========================================================================
+//
+// Directory cache
+//
+// Reading the central directory of a large archive means walking through
+// thousands of variable length entries and fixing up their names. The
+// result of that gets stored in the cache directory and is used as long as
+// the archive's size, modification time, end of directory record and the
+// hash of the raw central directory are unchanged. Reading the directory
+// in one piece for the hash is cheap compared to parsing it. The cache holds
+// the directory before PostProcessArchive, because filtering depends on the
+// game being played.
+//
+// Archives may be opened on several threads at once, so Open only prepares
+// the cache file. It gets written when the file system asks for it from the
+// main thread.
+//
+// The cache never leaves the machine that wrote it, so everything is
+// stored in native byte order.
+//
+//==========================================================================
+
+CVAR(Bool, zip_dircache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+static const char ZipCacheMagic[4] = { 'Z', 'D', 'I', 'R' };
+static const uint32_t ZipCacheVersion = 2;
+static const unsigned ZipCacheMaxFiles = 256;
+
+struct FZipCacheHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	int64_t FileSize;
+	int64_t FileTime;
+	FZipEndOfCentralDirectory EndOfDir;
+	uint8_t DirectoryHash[16];
+	uint32_t NumLumps;
+};
+
+struct FZipCacheEntry
+{
+	int32_t LumpSize;
+	int32_t CompressedSize;
+	int32_t Position;
+	uint32_t CRC32;
+	uint16_t GPFlags;
+	uint8_t Method;
+	uint8_t Pad;
+	uint32_t NameLength;
+};
+
+bool FZipFile::GetCacheKey(const FZipEndOfCentralDirectory &info, const uint8_t *dirhash, FString &path, FZipCacheHeader &header)
+{
+	if (!zip_dircache) return false;
+
+	// Archives inside other archives have no file of their own to check.
+	struct stat fileinfo;
+	if (stat(FileName, &fileinfo) != 0 || fileinfo.st_size != Reader.GetLength()) return false;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, ZipCacheMagic, 4);
+	header.Version = ZipCacheVersion;
+	header.FileSize = fileinfo.st_size;
+	header.FileTime = fileinfo.st_mtime;
+	header.EndOfDir = info;
+	memcpy(header.DirectoryHash, dirhash, sizeof(header.DirectoryHash));
+	header.NumLumps = LittleShort(info.NumEntries);
+
+	uint8_t digest[16];
+	MD5Context md5;
+	md5.Update((const uint8_t *)FileName.GetChars(), (unsigned)FileName.Len());
+	md5.Final(digest);
+
+	// This may run on a worker thread. StoreDirectoryCache creates the directory on the main thread.
+	path = M_GetCachePath(false);
+	path << "/archives/";
+	for (int i = 0; i < 16; i++)
+	{
+		path.AppendFormat("%02x", digest[i]);
+	}
+	path << ".zdc";
+	return true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FZipFile::LoadDirectoryCache(const FZipEndOfCentralDirectory &info, const uint8_t *dirhash)
+{
+	FString path;
+	FZipCacheHeader header;
+	if (!GetCacheKey(info, dirhash, path, header)) return false;
+
+	TArray<uint8_t> data;
+	{
+		FileReader fr;
+		if (!fr.OpenFile(path)) return false;
+		auto len = fr.GetLength();
+		if (len < (long)sizeof(header)) return false;
+		data.Resize((unsigned)len);
+		if (fr.Read(data.Data(), len) != len) return false;
+	}
+	if (memcmp(data.Data(), &header, sizeof(header)) != 0) return false;
+
+	// NumLumps is an upper limit here because the cache doesn't contain skipped entries.
+	uint8_t *pos = data.Data() + sizeof(header);
+	uint8_t *end = data.Data() + data.Size();
+	Lumps = new FZipLump[header.NumLumps];
+	unsigned count = 0;
+	while (pos < end)
+	{
+		FZipCacheEntry entry;
+		if (count == header.NumLumps || end - pos < (ptrdiff_t)sizeof(entry)) break;
+		memcpy(&entry, pos, sizeof(entry));
+		pos += sizeof(entry);
+		if ((size_t)(end - pos) < entry.NameLength || !IsSupportedMethod(entry.Method)) break;
+
+		FZipLump *lump_p = &Lumps[count++];
+		lump_p->LumpSize = entry.LumpSize;
+		lump_p->CompressedSize = entry.CompressedSize;
+		lump_p->Position = entry.Position;
+		lump_p->CRC32 = entry.CRC32;
+		lump_p->GPFlags = entry.GPFlags;
+		lump_p->Method = entry.Method;
+		SetupLump(lump_p, FString((const char *)pos, entry.NameLength));
+		pos += entry.NameLength;
+	}
+	if (pos != end)
+	{
+		DPrintf(DMSG_WARNING, "Discarding directory cache %s for %s\n", path.GetChars(), FileName.GetChars());
+		delete[] Lumps;
+		Lumps = NULL;
+		remove(path);
+		return false;
+	}
+	NumLumps = count;
+	return true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FZipFile::PrepareDirectoryCache(const FZipEndOfCentralDirectory &info, const uint8_t *dirhash)
+{
+	FZipCacheHeader header;
+	if (!GetCacheKey(info, dirhash, CachePath, header)) return;
+
+	CacheData.Resize(sizeof(header));
+	memcpy(CacheData.Data(), &header, sizeof(header));
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		auto &lump = Lumps[i];
+		FZipCacheEntry entry = { lump.LumpSize, lump.CompressedSize, lump.Position, lump.CRC32, lump.GPFlags, lump.Method, 0, (uint32_t)lump.FullName.Len() };
+		auto at = CacheData.Reserve(sizeof(entry) + entry.NameLength);
+		memcpy(&CacheData[at], &entry, sizeof(entry));
+		memcpy(&CacheData[at + sizeof(entry)], lump.FullName.GetChars(), entry.NameLength);
+	}
+}
+
+void FZipFile::StoreDirectoryCache()
+{
+	if (CacheData.Size() == 0) return;
+
+	FString dir = M_GetCachePath(true);
+	dir << "/archives/";
+	CreatePath(dir);
+
+	FileWriter *fw = FileWriter::Open(CachePath);
+	if (fw != nullptr)
+	{
+		bool ok = fw->Write(CacheData.Data(), CacheData.Size()) == CacheData.Size();
+		delete fw;
+		if (!ok) remove(CachePath);
+		else M_PruneCache(dir, ZipCacheMaxFiles);
+	}
+	CacheData.Reset();
+}
+
 //==========================================================================
 //
 // Zip file
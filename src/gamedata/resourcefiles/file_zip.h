@@ -38,14 +38,26 @@ private:
 //
 //==========================================================================
 
+struct FZipEndOfCentralDirectory;
+struct FZipCacheHeader;
+
 class FZipFile : public FResourceFile
 {
 	FZipLump *Lumps;
 
+	FString CachePath;
+	TArray<uint8_t> CacheData;	// directory cache prepared by Open
+
+	void SetupLump(FZipLump *lump, const FString &name);
+	bool GetCacheKey(const FZipEndOfCentralDirectory &info, const uint8_t *dirhash, FString &path, FZipCacheHeader &header);
+	bool LoadDirectoryCache(const FZipEndOfCentralDirectory &info, const uint8_t *dirhash);
+	void PrepareDirectoryCache(const FZipEndOfCentralDirectory &info, const uint8_t *dirhash);
+
 public:
 	FZipFile(const char * filename, FileReader &file);
 	virtual ~FZipFile();
 	bool Open(bool quiet);
+	virtual void StoreDirectoryCache();
 	virtual FResourceLump *GetLump(int no) { return ((unsigned)no < NumLumps)? &Lumps[no] : NULL; }
 };
 
@@ -116,6 +116,9 @@ public:
 	virtual bool Open(bool quiet) = 0;
 	virtual FResourceLump *GetLump(int no) = 0;
 	FResourceLump *FindLump(const char *name);
+
+	// Writes out what Open prepared to speed up the next start. Only the main thread may call this.
+	virtual void StoreDirectoryCache() {}
 };
 
 struct FUncompressedLump : public FResourceLump
@@ -0,0 +1,253 @@
+/*
+** zipbench.cpp
+** Compares the compression methods available for zip entries
+**
+** benchzip compresses every entry of a sample archive with each method
+** this build can read, one entry at a time just like in a zip file, and
+** then measures how fast they decompress through the same decompressors
+** the engine uses for loading lumps. This shows packagers what each
+** method costs in size and in loading time for their actual content.
+** Entries are compressed at high levels because that is what packaged
+** mods use; decompression speed hardly depends on the level.
+**
+*/
+
+#include <zlib.h>
+#include <bzlib.h>
+#include "LzmaEnc.h"
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include "resourcefile.h"
+#include "w_wad.h"
+#include "c_dispatch.h"
+#include "doomerrors.h"
+#include "i_time.h"
+#include "cmdlib.h"
+#include "templates.h"
+
+extern ISzAlloc g_Alloc;
+
+//==========================================================================
+//
+// Compressors that produce the data as it would be stored in a zip.
+//
+//==========================================================================
+
+static bool CompressStored(const TArray<uint8_t> &in, TArray<uint8_t> &out)
+{
+	out = in;
+	return true;
+}
+
+static bool CompressDeflate(const TArray<uint8_t> &in, TArray<uint8_t> &out)
+{
+	z_stream stream = {};
+	if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+	out.Resize((unsigned)deflateBound(&stream, in.Size()));
+	stream.next_in = (Bytef *)in.Data();
+	stream.avail_in = in.Size();
+	stream.next_out = out.Data();
+	stream.avail_out = out.Size();
+	int err = deflate(&stream, Z_FINISH);
+	out.Resize((unsigned)stream.total_out);
+	deflateEnd(&stream);
+	return err == Z_STREAM_END;
+}
+
+static bool CompressBZip2(const TArray<uint8_t> &in, TArray<uint8_t> &out)
+{
+	unsigned int outsize = in.Size() + in.Size() / 100 + 600;
+	out.Resize(outsize);
+	if (BZ2_bzBuffToBuffCompress((char *)out.Data(), &outsize, (char *)in.Data(), in.Size(), 9, 0, 0) != BZ_OK) return false;
+	out.Resize(outsize);
+	return true;
+}
+
+static bool CompressLZMA(const TArray<uint8_t> &in, TArray<uint8_t> &out)
+{
+	CLzmaEncProps props;
+	LzmaEncProps_Init(&props);
+	props.level = 9;
+
+	// Zip stores a 4 byte header with the LZMA SDK version and the size of the properties in front of them.
+	const unsigned header = 4 + LZMA_PROPS_SIZE;
+	SizeT propssize = LZMA_PROPS_SIZE;
+	SizeT outsize = in.Size() + in.Size() / 3 + 128;
+	out.Resize(unsigned(header + outsize));
+	out[0] = 9;
+	out[1] = 20;
+	out[2] = LZMA_PROPS_SIZE;
+	out[3] = 0;
+	if (LzmaEncode(&out[header], &outsize, in.Data(), in.Size(), &props, &out[4], &propssize, 0, nullptr, &g_Alloc, &g_Alloc) != SZ_OK) return false;
+	out.Resize(unsigned(header + outsize));
+	return true;
+}
+
+#ifdef HAVE_ZSTD
+static bool CompressZstd(const TArray<uint8_t> &in, TArray<uint8_t> &out)
+{
+	out.Resize((unsigned)ZSTD_compressBound(in.Size()));
+	size_t outsize = ZSTD_compress(out.Data(), out.Size(), in.Data(), in.Size(), 19);
+	if (ZSTD_isError(outsize)) return false;
+	out.Resize((unsigned)outsize);
+	return true;
+}
+#endif
+
+#ifdef HAVE_LZ4
+static bool CompressLZ4(const TArray<uint8_t> &in, TArray<uint8_t> &out)
+{
+	LZ4F_preferences_t prefs = {};
+	prefs.compressionLevel = 9;
+	prefs.frameInfo.contentSize = in.Size();
+	out.Resize((unsigned)LZ4F_compressFrameBound(in.Size(), &prefs));
+	size_t outsize = LZ4F_compressFrame(out.Data(), out.Size(), in.Data(), in.Size(), &prefs);
+	if (LZ4F_isError(outsize)) return false;
+	out.Resize((unsigned)outsize);
+	return true;
+}
+#endif
+
+static const struct
+{
+	const char *Name;
+	int Method;
+	bool (*Compress)(const TArray<uint8_t> &in, TArray<uint8_t> &out);
+} ZipMethods[] =
+{
+	{ "stored", METHOD_STORED, CompressStored },
+	{ "deflate", METHOD_DEFLATE, CompressDeflate },
+	{ "bzip2", METHOD_BZIP2, CompressBZip2 },
+	{ "lzma", METHOD_LZMA, CompressLZMA },
+#ifdef HAVE_ZSTD
+	{ "zstd", METHOD_ZSTD, CompressZstd },
+#endif
+#ifdef HAVE_LZ4
+	{ "lz4", METHOD_LZ4, CompressLZ4 },
+#endif
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static bool DecompressEntry(const TArray<uint8_t> &data, int method, TArray<uint8_t> &out)
+{
+	FileReader mr;
+	mr.OpenMemory(data.Data(), data.Size());
+	if (method == METHOD_STORED)
+	{
+		return mr.Read(out.Data(), out.Size()) == out.Size();
+	}
+	FileReader dec;
+	if (!dec.OpenDecompressor(mr, out.Size(), method, false)) return false;
+	return dec.Read(out.Data(), out.Size()) == out.Size();
+}
+
+//==========================================================================
+//
+// benchzip [archive] [passes]
+//
+// Without an archive the first loaded file, i.e. the engine's own, is used.
+//
+//==========================================================================
+
+CCMD(benchzip)
+{
+	FString filename = argv.argc() > 1 ? FString(argv[1]) : FString(Wads.GetWadFullName(0));
+	int passes = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 3;
+
+	FResourceFile *resfile = FResourceFile::OpenResourceFile(filename, true);
+	if (resfile == nullptr)
+	{
+		Printf("%s: cannot open archive\n", filename.GetChars());
+		return;
+	}
+
+	TArray<TArray<uint8_t>> entries;
+	size_t total = 0;
+	for (uint32_t i = 0; i < resfile->LumpCount(); i++)
+	{
+		FResourceLump *lump = resfile->GetLump(i);
+		if (lump->LumpSize <= 0) continue;
+		auto &entry = entries[entries.Reserve(1)];
+		entry.Resize(lump->LumpSize);
+		auto reader = lump->NewReader();
+		reader.Read(entry.Data(), entry.Size());
+		total += entry.Size();
+	}
+	delete resfile;
+
+	if (total == 0)
+	{
+		Printf("%s: archive is empty\n", filename.GetChars());
+		return;
+	}
+	Printf("%s: %u entries, %.2f MB, %d passes\n", filename.GetChars(), entries.Size(), total / 1048576., passes);
+	Printf("%-8s %10s %7s %12s\n", "method", "size", "ratio", "decompress");
+
+	for (auto &method : ZipMethods)
+	{
+		TArray<TArray<uint8_t>> compressed(entries.Size(), true);
+		size_t compressedsize = 0;
+		bool ok = true;
+		for (unsigned i = 0; i < entries.Size() && ok; i++)
+		{
+			ok = method.Compress(entries[i], compressed[i]);
+			compressedsize += compressed[i].Size();
+		}
+		if (!ok)
+		{
+			Printf("%-8s compression failed\n", method.Name);
+			continue;
+		}
+
+		TArray<uint8_t> out;
+		uint64_t start = 0;
+		try
+		{
+			// Verify everything once before the timing starts so that the comparison doesn't end up in the time.
+			for (unsigned i = 0; i < entries.Size() && ok; i++)
+			{
+				out.Resize(entries[i].Size());
+				ok = DecompressEntry(compressed[i], method.Method, out) && memcmp(out.Data(), entries[i].Data(), out.Size()) == 0;
+			}
+			if (!ok)
+			{
+				Printf("%-8s decompressed data does not match\n", method.Name);
+				continue;
+			}
+
+			start = I_nsTime();
+			for (int pass = 0; pass < passes && ok; pass++)
+			{
+				for (unsigned i = 0; i < entries.Size() && ok; i++)
+				{
+					out.Resize(entries[i].Size());
+					ok = DecompressEntry(compressed[i], method.Method, out);
+				}
+			}
+		}
+		catch (CRecoverableError &err)
+		{
+			Printf("%-8s %s\n", method.Name, err.GetMessage());
+			continue;
+		}
+		double seconds = (I_nsTime() - start) / 1e9;
+
+		if (!ok)
+		{
+			Printf("%-8s decompression failed\n", method.Name);
+			continue;
+		}
+		Printf("%-8s %7.2f MB %6.1f%% %7.1f MB/s\n", method.Name, compressedsize / 1048576., compressedsize * 100. / total,
+			seconds > 0 ? total * passes / 1048576. / seconds : 0.);
+	}
+}
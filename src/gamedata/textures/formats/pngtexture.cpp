@@ -41,6 +41,8 @@
 #include "bitmap.h"
 #include "imagehelpers.h"
 #include "image.h"
+#include "c_dispatch.h"
+#include "stats.h"
 
 //==========================================================================
 //
@@ -511,51 +513,114 @@ int FPNGTexture::CopyPixels(FBitmap *bmp, int conversion)
 		transpal = true;
 	}
 
-	uint8_t * Pixels = new uint8_t[pixwidth * Height];
-
 	lump->Seek (StartOfIDAT, FileReader::SeekSet);
 	lump->Read(&len, 4);
 	lump->Read(&id, 4);
-	M_ReadIDAT (*lump, Pixels, Width, Height, pixwidth, BitDepth, ColorType, Interlace, BigLong((unsigned int)len));
 
+	// Rows get converted as they are decoded so that the image never needs to exist in PNG format as a whole.
+	std::function<void(int, const uint8_t *)> rowfunc;
 	switch (ColorType)
 	{
 	case 0:
 	case 3:
-		bmp->CopyPixelData(0, 0, Pixels, Width, Height, 1, Width, 0, pe);
+		rowfunc = [&](int y, const uint8_t *row) { bmp->CopyPixelData(0, y, row, Width, 1, 1, Width, 0, pe); };
 		break;
 
 	case 2:
 		if (!HaveTrans)
 		{
-			bmp->CopyPixelDataRGB(0, 0, Pixels, Width, Height, 3, pixwidth, 0, CF_RGB);
+			rowfunc = [&](int y, const uint8_t *row) { bmp->CopyPixelDataRGB(0, y, row, Width, 1, 3, pixwidth, 0, CF_RGB); };
 		}
 		else
 		{
-			bmp->CopyPixelDataRGB(0, 0, Pixels, Width, Height, 3, pixwidth, 0, CF_RGBT, nullptr,
-				NonPaletteTrans[0], NonPaletteTrans[1], NonPaletteTrans[2]);
+			rowfunc = [&](int y, const uint8_t *row)
+			{
+				bmp->CopyPixelDataRGB(0, y, row, Width, 1, 3, pixwidth, 0, CF_RGBT, nullptr,
+					NonPaletteTrans[0], NonPaletteTrans[1], NonPaletteTrans[2]);
+			};
 			transpal = true;
 		}
 		break;
 
 	case 4:
-		bmp->CopyPixelDataRGB(0, 0, Pixels, Width, Height, 2, pixwidth, 0, CF_IA);
+		rowfunc = [&](int y, const uint8_t *row) { bmp->CopyPixelDataRGB(0, y, row, Width, 1, 2, pixwidth, 0, CF_IA); };
 		transpal = -1;
 		break;
 
 	case 6:
-		bmp->CopyPixelDataRGB(0, 0, Pixels, Width, Height, 4, pixwidth, 0, CF_RGBA);
+		rowfunc = [&](int y, const uint8_t *row) { bmp->CopyPixelDataRGB(0, y, row, Width, 1, 4, pixwidth, 0, CF_RGBA); };
 		transpal = -1;
 		break;
 
 	default:
-		break;
+		return transpal;
 
 	}
-	delete[] Pixels;
+	M_ReadIDAT (*lump, Width, Height, BitDepth, ColorType, Interlace, BigLong((unsigned int)len), rowfunc);
 	return transpal;
 }
 
+//==========================================================================
+//
+// Decodes every PNG lump with the reference and the optimized decoder
+// and reports the throughput of both.
+//
+//==========================================================================
+
+EXTERN_CVAR(Bool, png_fastdecode)
+
+CCMD(benchpng)
+{
+	TArray<FPNGTexture *> images;
+	double bytes = 0;
+
+	for (int i = 0; i < Wads.GetNumLumps(); i++)
+	{
+		if (Wads.LumpLength(i) < 8) continue;
+
+		uint32_t signature[2] = {};
+		auto fr = Wads.OpenLumpReader(i);
+		fr.Read(signature, 8);
+		if (signature[0] != MAKE_ID(137,'P','N','G') || signature[1] != MAKE_ID(13,10,26,10)) continue;
+
+		auto image = dynamic_cast<FPNGTexture *>(FImageSource::GetImage(i, ETextureType::Any));
+		if (image == nullptr) continue;
+		images.Push(image);
+		bytes += image->GetWidth() * image->GetHeight() * 4.;
+	}
+
+	if (images.Size() == 0)
+	{
+		Printf("No PNG lumps loaded\n");
+		return;
+	}
+
+	int passes = argv.argc() > 1 ? MAX(1, atoi(argv[1])) : 1;
+	bool fastdecode = png_fastdecode;
+	Printf("Decoding %u PNG lumps (%.1f MB) %d times\n", images.Size(), bytes / (1024 * 1024), passes);
+
+	for (int fast = 0; fast < 2; fast++)
+	{
+		png_fastdecode = !!fast;
+		cycle_t clock;
+		clock.Reset();
+		clock.Clock();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (auto image : images)
+			{
+				FBitmap bmp;
+				bmp.Create(image->GetWidth(), image->GetHeight());
+				image->CopyPixels(&bmp, 0);
+			}
+		}
+		clock.Unclock();
+		double ms = clock.TimeMS();
+		Printf("%s: %.1f ms, %.1f MB/s\n", fast ? "Optimized" : "Reference", ms, bytes * passes / (1024 * 1024) / (ms / 1000));
+	}
+	png_fastdecode = fastdecode;
+}
+
 
 
 //==========================================================================
@@ -44,6 +44,18 @@
 #include "xbr/xbrz_old.h"
 #include "parallel_for.h"
 #include "hwrenderer/textures/hw_material.h"
+#include "m_misc.h"
+#include "cmdlib.h"
+#include "files.h"
+#include "m_swap.h"
+#include "md5.h"
+#include "stats.h"
+#include "doomerrors.h"
+#include <zlib.h>
+#include <sys/stat.h>
+#include <mutex>
+#include <memory>
+#include <algorithm>
 
 EXTERN_CVAR(Int, gl_texture_hqresizemult)
 CUSTOM_CVAR(Int, gl_texture_hqresizemode, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
@@ -258,13 +270,9 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		HQnX_asm::InitLUTs();
-		initdone = true;
-	}
+	// The initialization must be thread safe because textures can be precached on worker threads.
+	static bool initdone = (HQnX_asm::InitLUTs(), true);
+	(void)initdone;
 
 	HQnX_asm::CImage cImageIn;
 	cImageIn.SetImage(inputBuffer, inWidth, inHeight, 32);
@@ -285,13 +293,8 @@ static unsigned char *hqNxHelper( void (HQX_CALLCONV *hqNxFunction) ( unsigned*,
 							  int &outWidth,
 							  int &outHeight )
 {
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		hqxInit();
-		initdone = true;
-	}
+	static bool initdone = (hqxInit(), true);
+	(void)initdone;
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
@@ -346,6 +349,266 @@ static void xbrzOldScale(size_t factor, const uint32_t* src, uint32_t* trg, int
 }
 
 
+//===========================================================================
+// 
+// Disk cache for upscaled textures
+//
+// The scalers are by far the most expensive part of texture creation so
+// their output is stored in the cache directory, one zlib compressed file
+// per texture. The key is a hash of the input buffer, which already has
+// palette conversion and translations applied, plus the scaler settings,
+// so it does not matter where the texture came from.
+//
+//===========================================================================
+
+CVAR(Bool, gl_texture_hqresize_cache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CUSTOM_CVAR(Int, gl_texture_hqresize_cachesize, 256, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 1) self = 1;
+}
+
+static const char HQCacheMagic[4] = { 'Z', 'D', 'H', 'Q' };
+static const uint32_t HQCacheVersion = 1;
+
+struct FHQCacheEntry
+{
+	size_t size;
+	int64_t stamp;
+};
+
+static std::mutex HQCacheMutex;
+static TMap<FString, FHQCacheEntry> HQCacheIndex;
+static FString HQCachePath;
+static size_t HQCacheSize;
+static int64_t HQCacheStamp;
+static bool HQCacheScanned;
+static int HQCacheHits, HQCacheMisses;
+static double HQCacheLoadTime, HQCacheStoreTime;
+
+//===========================================================================
+// 
+// Builds the index of files already in the cache. The file times give the
+// initial LRU order, everything used during this session is newer.
+//
+//===========================================================================
+
+static void HQCache_Scan()
+{
+	HQCacheScanned = true;
+	HQCachePath = M_GetCachePath(true);
+	HQCachePath << "/hqresize/";
+	CreatePath(HQCachePath);
+
+	TArray<FFileList> list;
+	try
+	{
+		ScanDirectory(list, HQCachePath);
+	}
+	catch (CRecoverableError &)
+	{
+		return;
+	}
+
+	for (auto &file : list)
+	{
+		struct stat info;
+		if (file.isDirectory || stat(file.Filename, &info) != 0) continue;
+
+		FString name = ExtractFileBase(file.Filename);
+		if (name.Len() != 32) continue;
+		HQCacheIndex[name] = { (size_t)info.st_size, (int64_t)info.st_mtime };
+		HQCacheSize += (size_t)info.st_size;
+		HQCacheStamp = MAX<int64_t>(HQCacheStamp, info.st_mtime);
+	}
+}
+
+//===========================================================================
+// 
+// Deletes the least recently used files until the cache fits its limit.
+//
+//===========================================================================
+
+static void HQCache_Evict()
+{
+	size_t limit = (size_t)gl_texture_hqresize_cachesize * 1024 * 1024;
+	if (HQCacheSize <= limit) return;
+
+	TArray<std::pair<int64_t, FString>> files;
+	TMap<FString, FHQCacheEntry>::Iterator it(HQCacheIndex);
+	TMap<FString, FHQCacheEntry>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		files.Push(std::make_pair(pair->Value.stamp, pair->Key));
+	}
+	std::sort(files.begin(), files.end());
+
+	for (auto &file : files)
+	{
+		if (HQCacheSize <= limit) break;
+		FString path = HQCachePath + file.second + ".zdhq";
+		remove(path);
+		HQCacheSize -= HQCacheIndex[file.second].size;
+		HQCacheIndex.Remove(file.second);
+	}
+}
+
+//===========================================================================
+// 
+//
+//
+//===========================================================================
+
+static FString HQCache_Key(const uint8_t *buffer, int width, int height, int type, int mult)
+{
+	uint32_t header[5] = { HQCacheVersion, (uint32_t)width, (uint32_t)height, (uint32_t)type, (uint32_t)mult };
+	uint8_t digest[16];
+	MD5Context md5;
+	md5.Update((const uint8_t *)header, sizeof(header));
+	md5.Update(buffer, width * height * 4);
+	md5.Final(digest);
+
+	FString key;
+	for (int i = 0; i < 16; i++)
+	{
+		key.AppendFormat("%02x", digest[i]);
+	}
+	return key;
+}
+
+//===========================================================================
+// 
+// Replaces the input buffer with the cached upscaled version if there is one.
+//
+//===========================================================================
+
+static bool HQCache_Load(const FString &key, FTextureBuffer &texbuffer, int outWidth, int outHeight)
+{
+	cycle_t clock;
+	clock.Reset();
+	clock.Clock();
+
+	FString path;
+	{
+		std::lock_guard<std::mutex> lock(HQCacheMutex);
+		if (!HQCacheScanned) HQCache_Scan();
+		auto entry = HQCacheIndex.CheckKey(key);
+		if (entry == nullptr)
+		{
+			HQCacheMisses++;
+			return false;
+		}
+		entry->stamp = ++HQCacheStamp;
+		path = HQCachePath + key + ".zdhq";
+	}
+
+	uint8_t *buffer = nullptr;
+	try
+	{
+		FileReader fr;
+		if (!fr.OpenFile(path))
+			throw std::runtime_error("Could not open cache file");
+
+		char magic[4];
+		if (fr.Read(magic, 4) != 4 || memcmp(magic, HQCacheMagic, 4) != 0)
+			throw std::runtime_error("Not a texture cache file");
+
+		uint32_t width = fr.ReadUInt32();
+		uint32_t height = fr.ReadUInt32();
+		uint32_t packedsize = fr.ReadUInt32();
+		if (width != (uint32_t)outWidth || height != (uint32_t)outHeight || packedsize > width * height * 8)
+			throw std::runtime_error("Texture cache file does not match");
+
+		TArray<uint8_t> packed(packedsize, true);
+		if (fr.Read(packed.Data(), packedsize) != packedsize)
+			throw std::runtime_error("Read error");
+
+		uLongf size = width * height * 4;
+		buffer = new uint8_t[size];
+		if (uncompress(buffer, &size, packed.Data(), packedsize) != Z_OK || size != width * height * 4)
+			throw std::runtime_error("Texture cache file is corrupt");
+	}
+	catch (...)
+	{
+		delete[] buffer;
+		std::lock_guard<std::mutex> lock(HQCacheMutex);
+		auto entry = HQCacheIndex.CheckKey(key);
+		if (entry != nullptr)
+		{
+			remove(path);
+			HQCacheSize -= entry->size;
+			HQCacheIndex.Remove(key);
+		}
+		HQCacheMisses++;
+		return false;
+	}
+
+	delete[] texbuffer.mBuffer;
+	texbuffer.mBuffer = buffer;
+	texbuffer.mWidth = outWidth;
+	texbuffer.mHeight = outHeight;
+
+	clock.Unclock();
+	std::lock_guard<std::mutex> lock(HQCacheMutex);
+	HQCacheHits++;
+	HQCacheLoadTime += clock.TimeMS();
+	return true;
+}
+
+//===========================================================================
+// 
+//
+//
+//===========================================================================
+
+static void HQCache_Store(const FString &key, const FTextureBuffer &texbuffer)
+{
+	cycle_t clock;
+	clock.Reset();
+	clock.Clock();
+
+	// Compression is done outside the lock, the scalers already spent far more time than this.
+	uLong size = texbuffer.mWidth * texbuffer.mHeight * 4;
+	uLongf packedsize = compressBound(size);
+	TArray<uint8_t> packed(16 + packedsize, true);
+	if (compress2(packed.Data() + 16, &packedsize, texbuffer.mBuffer, size, 1) != Z_OK) return;
+
+	memcpy(&packed[0], HQCacheMagic, 4);
+	uint32_t header[3] = { LittleLong((uint32_t)texbuffer.mWidth), LittleLong((uint32_t)texbuffer.mHeight), LittleLong((uint32_t)packedsize) };
+	memcpy(&packed[4], header, 12);
+	size_t filesize = 16 + packedsize;
+
+	std::lock_guard<std::mutex> lock(HQCacheMutex);
+	if (!HQCacheScanned) HQCache_Scan();
+	if (HQCacheIndex.CheckKey(key) != nullptr) return;
+
+	FString path = HQCachePath + key + ".zdhq";
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(path));
+	if (fw == nullptr) return;
+	if (fw->Write(packed.Data(), filesize) != filesize)
+	{
+		fw.reset();
+		remove(path);
+		return;
+	}
+	fw.reset();
+
+	HQCacheIndex[key] = { filesize, ++HQCacheStamp };
+	HQCacheSize += filesize;
+	HQCache_Evict();
+
+	clock.Unclock();
+	HQCacheStoreTime += clock.TimeMS();
+}
+
+ADD_STAT(hqcache)
+{
+	std::lock_guard<std::mutex> lock(HQCacheMutex);
+	FString out;
+	out.Format("HQ cache: %d hits (%.1f ms), %d misses, %.1f ms writing, %.1f MB on disk",
+		HQCacheHits, HQCacheLoadTime, HQCacheMisses, HQCacheStoreTime, HQCacheSize / (1024. * 1024.));
+	return out;
+}
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in texbuffer.mBuffer, frees texbuffer.mBuffer and returns
@@ -402,7 +665,19 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 
 	if (!checkonly)
 	{
-		if (type == 1)
+		FString cachekey;
+		bool cached = false;
+		if (gl_texture_hqresize_cache)
+		{
+			cachekey = HQCache_Key(texbuffer.mBuffer, inWidth, inHeight, type, mult);
+			cached = HQCache_Load(cachekey, texbuffer, inWidth * mult, inHeight * mult);
+		}
+
+		if (cached)
+		{
+			// already upscaled by a previous run.
+		}
+		else if (type == 1)
 		{
 			if (mult == 2)
 				texbuffer.mBuffer = scaleNxHelper(&scale2x, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
@@ -442,6 +717,11 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 			texbuffer.mBuffer = normalNxHelper(&normalNx, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
 		else
 			return;
+
+		if (cachekey.IsNotEmpty() && !cached)
+		{
+			HQCache_Store(cachekey, texbuffer);
+		}
 	}
 	else
 	{
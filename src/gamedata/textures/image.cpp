@@ -173,11 +173,12 @@ TArray<uint8_t> FImageSource::GetPalettedPixels(int conversion)
 int FImageSource::CopyPixels(FBitmap *bmp, int conversion)
 {
 	if (conversion == luminance) conversion = normal;	// luminance images have no use as an RGB source.
-	PalEntry *palette = screen->GetPalette();
+	// Work on a copy of the palette so that images can be converted on multiple threads at once.
+	PalEntry palette[256];
+	memcpy(palette, screen->GetPalette(), sizeof(palette));
 	for(int i=1;i<256;i++) palette[i].a = 255;	// set proper alpha values
 	auto ppix = CreatePalettedPixels(conversion);
 	bmp->CopyPixelData(0, 0, ppix.Data(), Width, Height, Height, 1, 0, palette, nullptr);
-	for(int i=1;i<256;i++) palette[i].a = 0;
 	return 0;
 }
 
@@ -54,6 +54,7 @@
 #include "image.h"
 #include "formats/multipatchtexture.h"
 #include "doomerrors.h"
+#include "d_startupgraph.h"
 
 // On the Alpha, accessing the shorts directly if they aren't aligned on a
 // 4-byte boundary causes unaligned access warnings. Why it does this at
@@ -388,7 +389,7 @@ void FMultipatchTextureBuilder::AddTexturesLump(const void *lumpdata, int lumpsi
 		if (j + 1 == firstdup)
 		{
 			BuildTexture((const uint8_t *)maptex + offset, patchlookup.Data(), numpatches, isStrife, deflumpnum, (i == 1 && texture1) ? ETextureType::FirstDefined : ETextureType::Wall);
-			StartScreen->Progress();
+			FStartupGraph::Progress();
 		}
 	}
 }
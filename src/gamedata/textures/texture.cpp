@@ -175,6 +175,7 @@ FTexture::~FTexture ()
 	if (link == this) Wads.SetLinkedTexture(SourceLump, nullptr);
 	if (areas != nullptr) delete[] areas;
 	areas = nullptr;
+	ClearPrecachedBuffers();
 
 	for (int i = 0; i < 2; i++)
 	{
@@ -677,6 +678,23 @@ FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 {
 	FTextureBuffer result;
 
+	if (translation <= 0)
+	{
+		for (unsigned i = 0; i < PrecachedBuffers.Size(); i++)
+		{
+			auto &pb = PrecachedBuffers[i];
+			if (pb.flags == flags)
+			{
+				result.mBuffer = pb.mBuffer;
+				result.mWidth = pb.mWidth;
+				result.mHeight = pb.mHeight;
+				result.mContentId = pb.mContentId;
+				PrecachedBuffers.Delete(i);
+				return result;
+			}
+		}
+	}
+
 	unsigned char * buffer = nullptr;
 	int W, H;
 	int isTransparent = -1;
@@ -741,6 +759,24 @@ FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 	return result;
 }
 
+//===========================================================================
+// 
+// Buffers created by the precaching code
+//
+//===========================================================================
+
+void FTexture::AddPrecachedBuffer(int flags, FTextureBuffer &&buffer)
+{
+	PrecachedBuffers.Push({ flags, buffer.mBuffer, buffer.mWidth, buffer.mHeight, buffer.mContentId });
+	buffer.mBuffer = nullptr;
+}
+
+void FTexture::ClearPrecachedBuffers()
+{
+	for (auto &pb : PrecachedBuffers) delete[] pb.mBuffer;
+	PrecachedBuffers.Clear();
+}
+
 //===========================================================================
 // 
 // Dummy texture for the 0-entry.
@@ -55,6 +55,8 @@
 #include "image.h"
 #include "formats/multipatchtexture.h"
 #include "swrenderer/textures/r_swtexture.h"
+#include "startupprofile.h"
+#include "d_startupgraph.h"
 
 FTextureManager TexMan;
 
@@ -535,7 +537,7 @@ void FTextureManager::AddGroup(int wadnum, int ns, ETextureType usetype)
 			{
 				CreateTexture (firsttx, usetype);
 			}
-			StartScreen->Progress();
+			FStartupGraph::Progress();
 		}
 		else if (ns == ns_flats && Wads.GetLumpFlags(firsttx) & LUMPF_MAYBEFLAT)
 		{
@@ -543,7 +545,7 @@ void FTextureManager::AddGroup(int wadnum, int ns, ETextureType usetype)
 			{
 				CreateTexture (firsttx, usetype);
 			}
-			StartScreen->Progress();
+			FStartupGraph::Progress();
 		}
 	}
 }
@@ -607,7 +609,7 @@ void FTextureManager::AddHiresTextures (int wadnum)
 						}
 					}
 				}
-				StartScreen->Progress();
+				FStartupGraph::Progress();
 			}
 		}
 	}
@@ -622,6 +624,7 @@ void FTextureManager::AddHiresTextures (int wadnum)
 void FTextureManager::LoadTextureDefs(int wadnum, const char *lumpname, FMultipatchTextureBuilder &build)
 {
 	int remapLump, lastLump;
+	FStartupProfileScope profile(lumpname);
 
 	lastLump = 0;
 
@@ -659,7 +662,7 @@ void FTextureManager::ParseTextureDef(int lump, FMultipatchTextureBuilder &build
 
 			tlist.Clear();
 			int amount = ListTextures(sc.String, tlist);
-			FName texname = sc.String;
+			FString texname = sc.String;
 
 			sc.MustGetString();
 			int lumpnum = Wads.CheckNumForFullName(sc.String, true, ns_patches);
@@ -814,7 +817,7 @@ void FTextureManager::AddPatches (int lumpnum)
 		{
 			CreateTexture (Wads.CheckNumForName (name, ns_patches), ETextureType::WallPatch);
 		}
-		StartScreen->Progress();
+		FStartupGraph::Progress();
 	}
 }
 
@@ -858,6 +861,7 @@ void FTextureManager::AddTexturesForWad(int wadnum, FMultipatchTextureBuilder &b
 {
 	int firsttexture = Textures.Size();
 	int lumpcount = Wads.GetNumLumps();
+	FStartupProfileScope profile("AddTexturesForWad", Wads.GetWadName(wadnum));
 
 	FirstTextureForFile.Push(firsttexture);
 
@@ -1014,6 +1018,21 @@ FTexture *GetBackdropTexture();
 FTexture *CreateShaderTexture(bool, bool);
 
 void FTextureManager::Init()
+{
+	AddTextures();
+	FinishInit();
+}
+
+//==========================================================================
+//
+// FTextureManager :: AddTextures
+//
+// Creates the textures from all loaded files. This only depends on the
+// lump directory and may run on a worker thread during startup.
+//
+//==========================================================================
+
+void FTextureManager::AddTextures()
 {
 	DeleteAll();
 	GenerateGlobalBrightmapFromColormap();
@@ -1039,7 +1058,10 @@ void FTextureManager::Init()
 	{
 		AddTexturesForWad(i, build);
 	}
-	build.ResolveAllPatches();
+	{
+		FStartupProfileScope profile("ResolveAllPatches");
+		build.ResolveAllPatches();
+	}
 
 	// Add one marker so that the last WAD is easier to handle and treat
 	// Build tiles as a completely separate block.
@@ -1061,7 +1083,18 @@ void FTextureManager::Init()
 			texture->UseType = ETextureType::Null;
 		}
 	}
+}
 
+//==========================================================================
+//
+// FTextureManager :: FinishInit
+//
+// Everything that also needs MAPINFO and the sound definitions.
+//
+//==========================================================================
+
+void FTextureManager::FinishInit()
+{
 	// Hexen parallax skies use color 0 to indicate transparency on the front
 	// layer, so we must not remap color 0 on these textures. Unfortunately,
 	// the only way to identify these textures is to check the MAPINFO.
@@ -336,6 +336,7 @@ public:
 	const FString &GetName() const { return Name; }
 	bool allowNoDecals() const { return bNoDecals; }
 	bool isScaled() const { return Scale.X != 1 || Scale.Y != 1; }
+	FTexture *GetHiresTexture() const { return HiresTexture; }
 	bool isMasked() const { return bMasked; }
 	int GetSkyOffset() const { return SkyOffset; }
 	FTextureID GetID() const { return id; }
@@ -493,7 +494,20 @@ public:
 	FTextureBuffer CreateTexBuffer(int translation, int flags = 0);
 	bool GetTranslucency();
 
+	// Untranslated buffers created ahead of time by the precaching code. CreateTexBuffer hands them out when called with the same flags.
+	void AddPrecachedBuffer(int flags, FTextureBuffer &&buffer);
+	void ClearPrecachedBuffers();
+
 private:
+	struct FPrecachedBuffer
+	{
+		int flags;
+		uint8_t *mBuffer;
+		int mWidth, mHeight;
+		uint64_t mContentId;
+	};
+	TArray<FPrecachedBuffer> PrecachedBuffers;
+
 	int CheckDDPK3();
 	int CheckExternalFile(bool & hascolorkey);
 	bool LoadHiresTexture(FTextureBuffer &texbuffer, bool checkonly);
@@ -601,6 +615,8 @@ public:
 	void LoadTextureX(int wadnum, FMultipatchTextureBuilder &build);
 	void AddTexturesForWad(int wadnum, FMultipatchTextureBuilder &build);
 	void Init();
+	void AddTextures();
+	void FinishInit();
 	void DeleteAll();
 	void SpriteAdjustChanged();
 
@@ -39,6 +39,9 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <mutex>
+#include <thread>
+#include <future>
 
 #include "doomtype.h"
 #include "m_argv.h"
@@ -52,6 +55,10 @@
 #include "md5.h"
 #include "doomstat.h"
 #include "vm.h"
+#include "startupprofile.h"
+#include "c_console.h"
+#include "templates.h"
+#include "ctpl.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -123,6 +130,60 @@ void FWadCollection::DeleteAll ()
 	Files.Clear();
 }
 
+//==========================================================================
+//
+// Finds a file and reads its directory. This doesn't touch the lump list,
+// so it can be done on a worker thread.
+//
+//==========================================================================
+
+static FResourceFile *OpenFileOrDirectory(const char *filename, FileReader *wadr, FileReader &wadreader)
+{
+	bool isdir = false;
+
+	if (wadr == nullptr)
+	{
+		// Does this exist? If so, is it a directory?
+		if (!DirEntryExists(filename, &isdir))
+		{
+			Printf(TEXTCOLOR_RED "%s: File or Directory not found\n", filename);
+			PrintLastError();
+			return NULL;
+		}
+
+		if (!isdir)
+		{
+			if (!wadreader.OpenFile(filename))
+			{ // Didn't find file
+				Printf (TEXTCOLOR_RED "%s: File not found\n", filename);
+				PrintLastError ();
+				return NULL;
+			}
+		}
+	}
+	else wadreader = std::move(*wadr);
+
+	if (!batchrun) Printf (" adding %s", filename);
+
+	if (!isdir)
+		return FResourceFile::OpenResourceFile(filename, wadreader);
+	else
+		return FResourceFile::OpenDirectory(filename);
+}
+
+// A file opened by a worker, with the output that goes with it.
+struct FOpenedFile : public FOutputCapture
+{
+	FResourceFile *resfile = nullptr;
+	FileReader reader;
+	TArray<std::pair<int, FString>> output;
+
+	void Print(int printlevel, const char *string) override
+	{
+		output.Push(std::make_pair(printlevel, FString(string)));
+	}
+};
+
 //==========================================================================
 //
 // W_InitMultipleFiles
@@ -136,16 +197,64 @@ void FWadCollection::DeleteAll ()
 
 void FWadCollection::InitMultipleFiles (TArray<FString> &filenames)
 {
-	int numfiles;
-
 	// open all the files, load headers, and count lumps
 	DeleteAll();
-	numfiles = 0;
+	SkinNamespace = ns_firstskin;
 
-	for(unsigned i=0;i<filenames.Size(); i++)
+	// Reading the directories only depends on the files themselves, so all of them get opened at
+	// once. They are added in the given order as they become ready, so the lump order stays the same.
+	int numworkers = Args->CheckParm("-serialstartup") ? 0 : MIN<int>(filenames.Size(), std::thread::hardware_concurrency());
+	if (numworkers <= 1)
 	{
-		int baselump = NumLumps;
-		AddFile (filenames[i]);
+		for (unsigned i = 0; i < filenames.Size(); i++)
+		{
+			AddFile (filenames[i]);
+		}
+	}
+	else
+	{
+		TArray<FOpenedFile> opened;
+		opened.Resize(filenames.Size());
+		ctpl::thread_pool pool(numworkers);
+		TArray<std::future<void>> done;
+		done.Resize(filenames.Size());
+		for (unsigned i = 0; i < filenames.Size(); i++)
+		{
+			done[i] = pool.push([&, i](int)
+			{
+				FStartupProfileScope profile("OpenFile", filenames[i]);
+				C_SetOutputCapture(&opened[i]);
+				try
+				{
+					opened[i].resfile = OpenFileOrDirectory(filenames[i], nullptr, opened[i].reader);
+				}
+				catch (...)
+				{
+					C_SetOutputCapture(nullptr);
+					throw;
+				}
+				C_SetOutputCapture(nullptr);
+			});
+		}
+		for (unsigned i = 0; i < filenames.Size(); i++)
+		{
+			done[i].get();
+			for (auto &line : opened[i].output)
+			{
+				PrintString(line.first, line.second);
+			}
+			if (opened[i].resfile != nullptr)
+			{
+				FStartupProfileScope profile("AddFile", filenames[i]);
+				AddResourceFile(filenames[i], opened[i].resfile, opened[i].reader);
+			}
+		}
+	}
+
+	// The files may have been opened on several threads, so their caches are written here.
+	for (auto file : Files)
+	{
+		file->StoreDirectoryCache();
 	}
 
 	NumLumps = LumpInfo.Size();
@@ -200,85 +309,98 @@ int FWadCollection::AddExternalFile(const char *filename)
 
 void FWadCollection::AddFile (const char *filename, FileReader *wadr)
 {
-	int startlump;
-	bool isdir = false;
 	FileReader wadreader;
+	FStartupProfileScope profile("AddFile", filename);
 
-	if (wadr == nullptr)
+	FResourceFile *resfile = OpenFileOrDirectory(filename, wadr, wadreader);
+	if (resfile != NULL)
 	{
-		// Does this exist? If so, is it a directory?
-		if (!DirEntryExists(filename, &isdir))
-		{
-			Printf(TEXTCOLOR_RED "%s: File or Directory not found\n", filename);
-			PrintLastError();
-			return;
-		}
-
-		if (!isdir)
-		{
-			if (!wadreader.OpenFile(filename))
-			{ // Didn't find file
-				Printf (TEXTCOLOR_RED "%s: File not found\n", filename);
-				PrintLastError ();
-				return;
-			}
-		}
+		AddResourceFile(filename, resfile, wadreader);
 	}
-	else wadreader = std::move(*wadr);
+}
 
-	if (!batchrun) Printf (" adding %s", filename);
-	startlump = NumLumps;
+//==========================================================================
+//
+// Adds the lumps of an opened file to the lump list.
+//
+//==========================================================================
 
-	FResourceFile *resfile;
-	
-	if (!isdir)
-		resfile = FResourceFile::OpenResourceFile(filename, wadreader);
-	else
-		resfile = FResourceFile::OpenDirectory(filename);
+void FWadCollection::AddResourceFile(const char *filename, FResourceFile *resfile, FileReader &wadreader)
+{
+	uint32_t lumpstart = LumpInfo.Size();
 
-	if (resfile != NULL)
+	resfile->SetFirstLump(lumpstart);
+	for (uint32_t i=0; i < resfile->LumpCount(); i++)
 	{
-		uint32_t lumpstart = LumpInfo.Size();
+		FResourceLump *lump = resfile->GetLump(i);
+		FWadCollection::LumpRecord *lump_p = &LumpInfo[LumpInfo.Reserve(1)];
 
-		resfile->SetFirstLump(lumpstart);
-		for (uint32_t i=0; i < resfile->LumpCount(); i++)
-		{
-			FResourceLump *lump = resfile->GetLump(i);
-			FWadCollection::LumpRecord *lump_p = &LumpInfo[LumpInfo.Reserve(1)];
+		lump_p->lump = lump;
+		lump_p->wadnum = Files.Size();
+	}
 
-			lump_p->lump = lump;
-			lump_p->wadnum = Files.Size();
+	// Skin WADs are numbered in load order, no matter in which order they were opened.
+	if (resfile->LumpCount() > 0 && resfile->GetLump(0)->Namespace == ns_firstskin)
+	{
+		for (uint32_t i = 0; i < resfile->LumpCount(); i++)
+		{
+			resfile->GetLump(i)->Namespace = SkinNamespace;
 		}
+		SkinNamespace++;
+	}
+
+	if (static_cast<int>(Files.Size()) == GetIwadNum() && gameinfo.gametype == GAME_Strife && gameinfo.flags & GI_SHAREWARE)
+	{
+		resfile->FindStrifeTeaserVoices();
+	}
+	Files.Push(resfile);
 
-		if (static_cast<int>(Files.Size()) == GetIwadNum() && gameinfo.gametype == GAME_Strife && gameinfo.flags & GI_SHAREWARE)
+	for (uint32_t i=0; i < resfile->LumpCount(); i++)
+	{
+		FResourceLump *lump = resfile->GetLump(i);
+		if (lump->Flags & LUMPF_EMBEDDED)
 		{
-			resfile->FindStrifeTeaserVoices();
+			FString path;
+			path.Format("%s:%s", filename, lump->FullName.GetChars());
+			auto embedded = lump->NewReader();
+			AddFile(path, &embedded);
 		}
-		Files.Push(resfile);
+	}
+
+	if (hashfile)
+	{
+		FStartupProfileScope hashprofile("Hash files");
+		uint8_t cksum[16];
+		char cksumout[33];
+		memset(cksumout, 0, sizeof(cksumout));
 
-		for (uint32_t i=0; i < resfile->LumpCount(); i++)
+		if (wadreader.isOpen())
 		{
-			FResourceLump *lump = resfile->GetLump(i);
-			if (lump->Flags & LUMPF_EMBEDDED)
+			MD5Context md5;
+			wadreader.Seek(0, FileReader::SeekSet);
+			md5.Update(wadreader, (unsigned)wadreader.GetLength());
+			md5.Final(cksum);
+
+			for (size_t j = 0; j < sizeof(cksum); ++j)
 			{
-				FString path;
-				path.Format("%s:%s", filename, lump->FullName.GetChars());
-				auto embedded = lump->NewReader();
-				AddFile(path, &embedded);
+				sprintf(cksumout + (j * 2), "%02X", cksum[j]);
 			}
+
+			fprintf(hashfile, "file: %s, hash: %s, size: %d\n", filename, cksumout, (int)wadreader.GetLength());
 		}
 
-		if (hashfile)
+		else
+			fprintf(hashfile, "file: %s, Directory structure\n", filename);
+
+		for (uint32_t i = 0; i < resfile->LumpCount(); i++)
 		{
-			uint8_t cksum[16];
-			char cksumout[33];
-			memset(cksumout, 0, sizeof(cksumout));
+			FResourceLump *lump = resfile->GetLump(i);
 
-			if (wadreader.isOpen())
+			if (!(lump->Flags & LUMPF_EMBEDDED))
 			{
 				MD5Context md5;
-				wadreader.Seek(0, FileReader::SeekSet);
-				md5.Update(wadreader, (unsigned)wadreader.GetLength());
+				auto reader = lump->NewReader();
+				md5.Update(reader, lump->LumpSize);
 				md5.Final(cksum);
 
 				for (size_t j = 0; j < sizeof(cksum); ++j)
@@ -286,35 +408,11 @@ void FWadCollection::AddFile (const char *filename, FileReader *wadr)
 					sprintf(cksumout + (j * 2), "%02X", cksum[j]);
 				}
 
-				fprintf(hashfile, "file: %s, hash: %s, size: %d\n", filename, cksumout, (int)wadreader.GetLength());
-			}
-
-			else
-				fprintf(hashfile, "file: %s, Directory structure\n", filename);
-
-			for (uint32_t i = 0; i < resfile->LumpCount(); i++)
-			{
-				FResourceLump *lump = resfile->GetLump(i);
-
-				if (!(lump->Flags & LUMPF_EMBEDDED))
-				{
-					MD5Context md5;
-					auto reader = lump->NewReader();
-					md5.Update(reader, lump->LumpSize);
-					md5.Final(cksum);
-
-					for (size_t j = 0; j < sizeof(cksum); ++j)
-					{
-						sprintf(cksumout + (j * 2), "%02X", cksum[j]);
-					}
-
-					fprintf(hashfile, "file: %s, lump: %s, hash: %s, size: %d\n", filename,
-						lump->FullName.IsNotEmpty() ? lump->FullName.GetChars() : lump->Name,
-						cksumout, lump->LumpSize);
-				}
+				fprintf(hashfile, "file: %s, lump: %s, hash: %s, size: %d\n", filename,
+					lump->FullName.IsNotEmpty() ? lump->FullName.GetChars() : lump->Name,
+					cksumout, lump->LumpSize);
 			}
 		}
-		return;
 	}
 }
 
@@ -707,6 +805,7 @@ void FWadCollection::InitHashChains (void)
 {
 	char name[8];
 	unsigned int i, j;
+	FStartupProfileScope profile("InitHashChains");
 
 	// Mark all buckets as empty
 	memset (FirstLumpIndex, 255, NumLumps*sizeof(FirstLumpIndex[0]));
@@ -1326,6 +1425,8 @@ DEFINE_ACTION_FUNCTION(_Wads, ReadLump)
 	ACTION_RETURN_STRING(isLumpValid ? Wads.ReadLump(lump).GetString() : FString());
 }
 
+static std::mutex ThreadedAccessMutex;
+
 //==========================================================================
 //
 // OpenLumpReader
@@ -1343,6 +1444,24 @@ FileReader FWadCollection::OpenLumpReader(int lump)
 	}
 
 	auto rl = LumpInfo[lump].lump;
+
+	if (ThreadedAccess)
+	{
+		// Neither the lump cache's reference counts nor the containing file's reader
+		// may be used by several threads at once so each caller gets its own copy.
+		FileReader rdr;
+		rdr.OpenMemoryArray([=](TArray<uint8_t> &data)
+		{
+			std::lock_guard<std::mutex> lock(ThreadedAccessMutex);
+			auto cache = (const uint8_t *)rl->CacheLump();
+			data.Resize(rl->LumpSize);
+			if (rl->LumpSize > 0) memcpy(data.Data(), cache, rl->LumpSize);
+			rl->ReleaseCache();
+			return true;
+		});
+		return rdr;
+	}
+
 	auto rd = rl->GetReader();
 
 	if (rl->RefCount == 0 && rd != nullptr && !rd->GetBuffer() && !(rl->Flags & (LUMPF_BLOODCRYPT | LUMPF_COMPRESSED)))
@@ -1361,6 +1480,12 @@ FileReader FWadCollection::ReopenLumpReader(int lump, bool alwayscache)
 		I_Error("ReopenLumpReader: %u >= NumLumps", lump);
 	}
 
+	// The reader returned for threaded access already is independent of the containing file.
+	if (ThreadedAccess)
+	{
+		return OpenLumpReader(lump);
+	}
+
 	auto rl = LumpInfo[lump].lump;
 	auto rd = rl->GetReader();
 
@@ -154,6 +154,7 @@ public:
 
 	FileReader OpenLumpReader(int lump);		// opens a reader that redirects to the containing file's one.
 	FileReader ReopenLumpReader(int lump, bool alwayscache = false);		// opens an independent reader.
+	void SetThreadedAccess(bool on) { ThreadedAccess = on; }	// while set, lumps may be opened from several threads at once.
 
 	int FindLump (const char *name, int *lastlump, bool anyns=false);		// [RH] Find lumps with duplication
 	int FindLumpMulti (const char **names, int *lastlump, bool anyns = false, int *nameindex = NULL); // same with multiple possible names
@@ -202,6 +203,8 @@ protected:
 	uint32_t NumWads;
 
 	int IwadIndex;
+	int SkinNamespace = ns_firstskin;	// for the next WAD with an S_SKIN lump
+	bool ThreadedAccess = false;
 
 	void InitHashChains ();								// [RH] Set up the lumpinfo hashing
 
@@ -210,6 +213,7 @@ private:
 	void RenameNerve();
 	void FixMacHexen();
 	void DeleteAll();
+	void AddResourceFile(const char *filename, FResourceFile *resfile, FileReader &wadreader);
 	FileReader * GetFileReader(int wadnum);	// Gets a FileReader object to the entire WAD
 };
 
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <time.h>
+#include <algorithm>
 
 #include "r_defs.h"
 
@@ -60,6 +61,7 @@
 #include "m_png.h"
 
 #include "cmdlib.h"
+#include "doomerrors.h"
 
 #include "g_game.h"
 #include "gi.h"
@@ -689,3 +691,39 @@ FString M_ZLibError(int zerr)
 		return errs[-zerr - 1];
 	}
 }
+
+//==========================================================================
+//
+// M_PruneCache
+//
+// Only keeps the maxfiles most recently written files in a cache directory.
+//
+//==========================================================================
+
+void M_PruneCache(const char *dir, unsigned maxfiles)
+{
+	TArray<FFileList> list;
+	try
+	{
+		ScanDirectory(list, dir);
+	}
+	catch (CRecoverableError &)
+	{
+		return;
+	}
+
+	TArray<std::pair<time_t, FString>> files;
+	for (auto &file : list)
+	{
+		struct stat info;
+		if (file.isDirectory || stat(file.Filename, &info) != 0) continue;
+		files.Push(std::make_pair(info.st_mtime, file.Filename));
+	}
+	if (files.Size() <= maxfiles) return;
+
+	std::sort(files.begin(), files.end(), [](const std::pair<time_t, FString> &a, const std::pair<time_t, FString> &b) { return a.first < b.first; });
+	for (unsigned i = 0; i < files.Size() - maxfiles; i++)
+	{
+		remove(files[i].second);
+	}
+}
@@ -47,6 +47,7 @@ void M_SaveCustomKeys (FConfigFile *config, char *section, char *subsection, siz
 
 
 FString M_ZLibError(int zerrnum);
+void M_PruneCache(const char *dir, unsigned maxfiles);
 
 // Get special directory paths (defined in m_specialpaths.cpp)
 
@@ -47,6 +47,7 @@
 #include "i_soundfont.h"
 #include "i_system.h"
 #include "v_video.h"
+#include "startupprofile.h"
 
 
 void ClearSaveGames();
@@ -990,6 +991,7 @@ static void ParseAddOptionMenu(FScanner &sc)
 void M_ParseMenuDefs()
 {
 	int lump, lastlump = 0;
+	FStartupProfileScope profile("MENUDEF");
 
 	OptionSettings.mTitleColor = V_FindFontColor(gameinfo.mTitleColor);
 	OptionSettings.mFontColor = V_FindFontColor(gameinfo.mFontColor);
@@ -1482,6 +1484,7 @@ static void InitKeySections()
 
 void M_CreateMenus()
 {
+	FStartupProfileScope profile("M_CreateMenus");
 	BuildEpisodeMenu();
 	BuildPlayerclassMenu();
 	InitCrosshairsList();
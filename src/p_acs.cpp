@@ -835,6 +835,10 @@ BoundsCheckingArray<FWorldGlobalArray, NUM_GLOBALVARS> ACS_GlobalArrays;
 
 using FACSStackMemory = BoundsCheckingArray<int32_t, STACK_SIZE>;
 
+// For the ACS stat, which compares the time spent in natively compiled code to the total.
+static cycle_t ACSJitTime;
+static int ACSInstructions, ACSBlockInstructions, ACSJitInstructions;
+
 struct FACSStack
 {
 	FACSStackMemory buffer;
@@ -2683,6 +2687,12 @@ bool FBehavior::Init(FLevelLocals *Level, int lumpnum, FileReader * fr, int len,
 
 FBehavior::~FBehavior ()
 {
+	TMapIterator<uint32_t, FACSBlock *> it(Blocks);
+	TMap<uint32_t, FACSBlock *>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		delete pair->Value;
+	}
 	if (Scripts != NULL)
 	{
 		delete[] Scripts;
@@ -3414,6 +3424,8 @@ cycle_t ACSTime;
 void DACSThinker::Tick ()
 {
 	ACSTime.Reset();
+	ACSJitTime.Reset();
+	ACSInstructions = ACSBlockInstructions = ACSJitInstructions = 0;
 	ACSTime.Clock();
 	DLevelScript *script = Scripts;
 
@@ -6755,6 +6767,513 @@ inline int getshort (int *&pc)
 	return res;
 }
 
+CVAR(Bool, acs_predecode, true, 0)
+#ifdef HAVE_VM_JIT
+CVAR(Bool, acs_jit, true, 0)
+#endif
+
+//==========================================================================
+//
+// DecodeBlock
+//
+// Collects the p-codes starting at pc that can be pre-decoded, up to the
+// first one that needs the regular interpreter.
+//
+// Only stack operations, arithmetic, variable access and jumps get
+// pre-decoded. These make up the loops where dispatch and operand decoding
+// are most of the time spent. Everything else calls into the engine and
+// is left to the interpreter's switch, where decoding costs little next to
+// the actual work. Blocks are decoded when they are first reached rather
+// than when the module is loaded, because they start wherever the
+// interpreter has stopped, which isn't known in advance.
+//
+//==========================================================================
+
+static void DecodeBlock(FBehavior *module, int *pc, FACSBlock &block)
+{
+	ACSFormat fmt = module->GetFormat();
+
+	auto local = [&](FACSBlockInstr &instr, EACSBlockOp op)
+	{
+		instr.Op = op;
+		instr.Arg = NEXTBYTE;
+	};
+	auto mapvar = [&](FACSBlockInstr &instr, EACSBlockOp op)
+	{
+		int num = NEXTBYTE;
+		instr.Op = EACSBlockOp(op - ABOP_PushLocal + ABOP_PushVar);
+		instr.Var = num >= 0 && num < NUM_MAPVARS ? module->MapVars[num] : nullptr;
+	};
+	auto worldvar = [&](FACSBlockInstr &instr, EACSBlockOp op)
+	{
+		int num = NEXTBYTE;
+		instr.Op = EACSBlockOp(op - ABOP_PushLocal + ABOP_PushVar);
+		instr.Var = num >= 0 && num < NUM_WORLDVARS ? &ACS_WorldVars[num] : nullptr;
+	};
+	auto globalvar = [&](FACSBlockInstr &instr, EACSBlockOp op)
+	{
+		int num = NEXTBYTE;
+		instr.Op = EACSBlockOp(op - ABOP_PushLocal + ABOP_PushVar);
+		instr.Var = num >= 0 && num < NUM_GLOBALVARS ? &ACS_GlobalVars[num] : nullptr;
+	};
+
+	while (block.Code.Size() < 512)
+	{
+		int *start = pc;
+		int pcd;
+
+		if (fmt == ACS_LittleEnhanced)
+		{
+			pcd = getbyte(pc);
+			if (pcd >= 256-16)
+			{
+				pcd = (256-16) + ((pcd - (256-16)) << 8) + getbyte(pc);
+			}
+		}
+		else
+		{
+			pcd = NEXTWORD;
+		}
+
+		FACSBlockInstr instr = { ABOP_Push, 0, nullptr, module->PC2Ofs(start), 0, -1, 0 };
+		switch (pcd)
+		{
+		case PCD_PUSHNUMBER:		instr.Arg = uallong(pc[0]); pc++;	break;
+		case PCD_PUSHBYTE:			instr.Arg = getbyte(pc);			break;
+		case PCD_DROP:				instr.Op = ABOP_Drop;			break;
+		case PCD_DUP:				instr.Op = ABOP_Dup;			break;
+		case PCD_SWAP:				instr.Op = ABOP_Swap;			break;
+		case PCD_ADD:				instr.Op = ABOP_Add;			break;
+		case PCD_SUBTRACT:			instr.Op = ABOP_Sub;			break;
+		case PCD_MULTIPLY:			instr.Op = ABOP_Mul;			break;
+		case PCD_DIVIDE:			instr.Op = ABOP_Div;			break;
+		case PCD_MODULUS:			instr.Op = ABOP_Mod;			break;
+		case PCD_ANDBITWISE:		instr.Op = ABOP_And;			break;
+		case PCD_ORBITWISE:			instr.Op = ABOP_Or;				break;
+		case PCD_EORBITWISE:		instr.Op = ABOP_Xor;			break;
+		case PCD_LSHIFT:			instr.Op = ABOP_LShift;			break;
+		case PCD_RSHIFT:			instr.Op = ABOP_RShift;			break;
+		case PCD_EQ:				instr.Op = ABOP_EQ;				break;
+		case PCD_NE:				instr.Op = ABOP_NE;				break;
+		case PCD_LT:				instr.Op = ABOP_LT;				break;
+		case PCD_GT:				instr.Op = ABOP_GT;				break;
+		case PCD_LE:				instr.Op = ABOP_LE;				break;
+		case PCD_GE:				instr.Op = ABOP_GE;				break;
+		case PCD_ANDLOGICAL:		instr.Op = ABOP_AndLogical;		break;
+		case PCD_ORLOGICAL:			instr.Op = ABOP_OrLogical;		break;
+		case PCD_UNARYMINUS:		instr.Op = ABOP_Negate;			break;
+		case PCD_NEGATEBINARY:		instr.Op = ABOP_NegateBinary;	break;
+		case PCD_NEGATELOGICAL:		instr.Op = ABOP_NegateLogical;	break;
+
+		case PCD_PUSHSCRIPTVAR:		local(instr, ABOP_PushLocal);		break;
+		case PCD_ASSIGNSCRIPTVAR:	local(instr, ABOP_AssignLocal);		break;
+		case PCD_ADDSCRIPTVAR:		local(instr, ABOP_AddLocal);		break;
+		case PCD_SUBSCRIPTVAR:		local(instr, ABOP_SubLocal);		break;
+		case PCD_MULSCRIPTVAR:		local(instr, ABOP_MulLocal);		break;
+		case PCD_INCSCRIPTVAR:		local(instr, ABOP_IncLocal);		break;
+		case PCD_DECSCRIPTVAR:		local(instr, ABOP_DecLocal);		break;
+
+		case PCD_PUSHMAPVAR:		mapvar(instr, ABOP_PushLocal);		break;
+		case PCD_ASSIGNMAPVAR:		mapvar(instr, ABOP_AssignLocal);	break;
+		case PCD_ADDMAPVAR:			mapvar(instr, ABOP_AddLocal);		break;
+		case PCD_SUBMAPVAR:			mapvar(instr, ABOP_SubLocal);		break;
+		case PCD_MULMAPVAR:			mapvar(instr, ABOP_MulLocal);		break;
+		case PCD_INCMAPVAR:			mapvar(instr, ABOP_IncLocal);		break;
+		case PCD_DECMAPVAR:			mapvar(instr, ABOP_DecLocal);		break;
+
+		case PCD_PUSHWORLDVAR:		worldvar(instr, ABOP_PushLocal);	break;
+		case PCD_ASSIGNWORLDVAR:	worldvar(instr, ABOP_AssignLocal);	break;
+		case PCD_ADDWORLDVAR:		worldvar(instr, ABOP_AddLocal);		break;
+		case PCD_SUBWORLDVAR:		worldvar(instr, ABOP_SubLocal);		break;
+		case PCD_MULWORLDVAR:		worldvar(instr, ABOP_MulLocal);		break;
+		case PCD_INCWORLDVAR:		worldvar(instr, ABOP_IncLocal);		break;
+		case PCD_DECWORLDVAR:		worldvar(instr, ABOP_DecLocal);		break;
+
+		case PCD_PUSHGLOBALVAR:		globalvar(instr, ABOP_PushLocal);	break;
+		case PCD_ASSIGNGLOBALVAR:	globalvar(instr, ABOP_AssignLocal);	break;
+		case PCD_ADDGLOBALVAR:		globalvar(instr, ABOP_AddLocal);	break;
+		case PCD_SUBGLOBALVAR:		globalvar(instr, ABOP_SubLocal);	break;
+		case PCD_MULGLOBALVAR:		globalvar(instr, ABOP_MulLocal);	break;
+		case PCD_INCGLOBALVAR:		globalvar(instr, ABOP_IncLocal);	break;
+		case PCD_DECGLOBALVAR:		globalvar(instr, ABOP_DecLocal);	break;
+
+		case PCD_GOTO:
+		case PCD_IFGOTO:
+		case PCD_IFNOTGOTO:
+			instr.Op = pcd == PCD_GOTO ? ABOP_Goto : pcd == PCD_IFGOTO ? ABOP_IfGoto : ABOP_IfNotGoto;
+			instr.Target = LittleLong(*pc);
+			pc++;
+			break;
+
+		case PCD_CASEGOTO:
+			instr.Op = ABOP_CaseGoto;
+			instr.Arg = uallong(pc[0]);
+			instr.Target = uallong(pc[1]);
+			pc += 2;
+			break;
+
+		default:
+			pc = start;
+			goto done;
+		}
+
+		if (instr.Op >= ABOP_PushVar && instr.Op <= ABOP_DecVar && instr.Var == nullptr)
+		{
+			// Let the interpreter complain about it.
+			pc = start;
+			break;
+		}
+		block.Code.Push(instr);
+		if (instr.Op == ABOP_Goto)
+		{
+			break;
+		}
+	}
+done:
+	FACSBlockInstr exit = { ABOP_Exit, 0, nullptr, module->PC2Ofs(pc), 0, -1, 0 };
+	block.Code.Push(exit);
+}
+
+//==========================================================================
+//
+// AnalyzeBlock
+//
+// Determines the stack depth at every instruction along with the range of
+// stack slots the block accesses, so that the bounds only need to be checked
+// once on entry. A jump can only stay inside the block if the depth at its
+// destination is the same as after the jump.
+//
+//==========================================================================
+
+static void AnalyzeBlock(FACSBlock &block)
+{
+	TArray<FACSBlockInstr> &code = block.Code;
+	int depth = 0;
+
+	block.Lowest = block.Highest = 0;
+	block.UsesLocals = block.HasLoops = false;
+	block.Compiled = false;
+	block.Native = nullptr;
+
+	for (auto &instr : code)
+	{
+		int reads = 0, change = 0;
+
+		instr.Depth = depth;
+		switch (instr.Op)
+		{
+		case ABOP_Push:
+		case ABOP_PushLocal:
+		case ABOP_PushVar:
+			change = 1;
+			break;
+
+		case ABOP_Dup:
+			reads = 1;
+			change = 1;
+			break;
+
+		case ABOP_Swap:
+			reads = 2;
+			break;
+
+		case ABOP_Negate:
+		case ABOP_NegateBinary:
+		case ABOP_NegateLogical:
+		case ABOP_CaseGoto:
+			reads = 1;
+			break;
+
+		case ABOP_IncLocal:
+		case ABOP_DecLocal:
+		case ABOP_IncVar:
+		case ABOP_DecVar:
+		case ABOP_Goto:
+		case ABOP_Exit:
+			break;
+
+		case ABOP_Drop:
+		case ABOP_AssignLocal:
+		case ABOP_AddLocal:
+		case ABOP_SubLocal:
+		case ABOP_MulLocal:
+		case ABOP_AssignVar:
+		case ABOP_AddVar:
+		case ABOP_SubVar:
+		case ABOP_MulVar:
+		case ABOP_IfGoto:
+		case ABOP_IfNotGoto:
+			reads = 1;
+			change = -1;
+			break;
+
+		default:	// binary operators
+			reads = 2;
+			change = -1;
+			break;
+		}
+		block.Lowest = MIN(block.Lowest, depth - reads);
+		depth += change;
+		block.Highest = MAX(block.Highest, depth);
+
+		if (instr.Op >= ABOP_PushLocal && instr.Op <= ABOP_DecLocal)
+		{
+			block.UsesLocals = true;
+		}
+	}
+
+	for (unsigned i = 0; i < code.Size(); i++)
+	{
+		if (code[i].Op >= ABOP_Goto && code[i].Op <= ABOP_CaseGoto)
+		{
+			int target = code[i].Depth - (code[i].Op == ABOP_Goto ? 0 : 1);
+			for (unsigned j = 0; j < code.Size() - 1; j++)
+			{
+				if (code[j].Offset == code[i].Target)
+				{
+					if (code[j].Depth == target)
+					{
+						code[i].TargetIndex = j;
+						if (j <= i) block.HasLoops = true;
+					}
+					break;
+				}
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// FBehavior :: GetBlock
+//
+// Returns the pre-decoded p-codes at pc, decoding them the first time they
+// are needed. Returns nullptr if there is nothing worth decoding there.
+//
+//==========================================================================
+
+FACSBlock *FBehavior::GetBlock(int *pc)
+{
+	uint32_t ofs = PC2Ofs(pc);
+
+	if (ofs >= (uint32_t)DataSize)
+	{
+		return nullptr;
+	}
+	if (NoBlocks.Size() == 0)
+	{
+		NoBlocks.Resize((DataSize + 31) / 32);
+		memset(&NoBlocks[0], 0, NoBlocks.Size() * sizeof(uint32_t));
+	}
+	if (NoBlocks[ofs >> 5] & (1u << (ofs & 31)))
+	{
+		return nullptr;
+	}
+
+	FACSBlock **found = Blocks.CheckKey(ofs);
+	if (found != nullptr)
+	{
+		return *found;
+	}
+
+	FACSBlock *block = new FACSBlock;
+	DecodeBlock(this, pc, *block);
+
+	// A single instruction is not worth leaving the interpreter for.
+	if (block->Code.Size() <= 2)
+	{
+		delete block;
+		NoBlocks[ofs >> 5] |= 1u << (ofs & 31);
+		return nullptr;
+	}
+	AnalyzeBlock(*block);
+	Blocks[ofs] = block;
+	return block;
+}
+
+//==========================================================================
+//
+// RunBlock
+//
+// Executes a pre-decoded block. Compilers that support it get threaded
+// dispatch, where every handler jumps straight to the next one.
+//
+//==========================================================================
+
+#if defined(__GNUC__)
+#define ACS_THREADED_DISPATCH
+#endif
+
+static int RunBlock(const FACSBlock &block, FACSBlockFrame *frame)
+{
+	const FACSBlockInstr *const code = &block.Code[0];
+	int sp = frame->SP;
+
+	if (sp + block.Lowest < 0 || sp + block.Highest > STACK_SIZE)
+	{
+		frame->Instructions = 0;
+		frame->Jumped = false;
+		return code[0].Offset;
+	}
+
+	int32_t *const Stack = frame->Stack;
+	int32_t *const locals = frame->Locals;
+	const uint32_t numlocals = frame->NumLocals;
+	const int budget = frame->Instructions;
+	const FACSBlockInstr *ip = code;
+	int count = 0;
+	uint32_t exitofs;
+	bool jumped = false;
+	int temp;
+
+#ifdef ACS_THREADED_DISPATCH
+	static const void *const handlers[NUM_ABOPS] =
+	{
+		&&op_Push, &&op_Drop, &&op_Dup, &&op_Swap,
+		&&op_Add, &&op_Sub, &&op_Mul, &&op_Div, &&op_Mod, &&op_And, &&op_Or, &&op_Xor, &&op_LShift, &&op_RShift,
+		&&op_EQ, &&op_NE, &&op_LT, &&op_GT, &&op_LE, &&op_GE, &&op_AndLogical, &&op_OrLogical,
+		&&op_Negate, &&op_NegateBinary, &&op_NegateLogical,
+		&&op_PushLocal, &&op_AssignLocal, &&op_AddLocal, &&op_SubLocal, &&op_MulLocal, &&op_IncLocal, &&op_DecLocal,
+		&&op_PushVar, &&op_AssignVar, &&op_AddVar, &&op_SubVar, &&op_MulVar, &&op_IncVar, &&op_DecVar,
+		&&op_Goto, &&op_IfGoto, &&op_IfNotGoto, &&op_CaseGoto,
+		&&op_Exit
+	};
+#define BLOCKOP(op)		op_##op
+#define DISPATCH()		goto *handlers[ip->Op]
+#else
+#define BLOCKOP(op)		case ABOP_##op
+#define DISPATCH()		continue
+#endif
+#define NEXT()			{ count++; ip++; DISPATCH(); }
+#define BAIL()			{ exitofs = ip->Offset; goto leave; }
+#define CHECKLOCAL()	if ((uint32_t)ip->Arg >= numlocals) BAIL()
+#define TRANSFER() \
+	if (ip->TargetIndex < 0 || (ip->TargetIndex <= int(ip - code) && count >= budget)) \
+	{ \
+		exitofs = ip->Target; \
+		jumped = true; \
+		goto leave; \
+	} \
+	ip = code + ip->TargetIndex; \
+	DISPATCH();
+
+#ifdef ACS_THREADED_DISPATCH
+	DISPATCH();
+	{
+#else
+	for (;;) switch (ip->Op)
+	{
+#endif
+	BLOCKOP(Push):			PushToStack(ip->Arg);	NEXT();
+	BLOCKOP(Drop):			sp--;	NEXT();
+	BLOCKOP(Dup):			Stack[sp] = Stack[sp-1]; sp++;	NEXT();
+	BLOCKOP(Swap):			swapvalues(Stack[sp-2], Stack[sp-1]);	NEXT();
+
+	BLOCKOP(Add):			STACK(2) = STACK(2) + STACK(1); sp--;	NEXT();
+	BLOCKOP(Sub):			STACK(2) = STACK(2) - STACK(1); sp--;	NEXT();
+	BLOCKOP(Mul):			STACK(2) = STACK(2) * STACK(1); sp--;	NEXT();
+	BLOCKOP(Div):			if (STACK(1) == 0) BAIL(); STACK(2) = STACK(2) / STACK(1); sp--;	NEXT();
+	BLOCKOP(Mod):			if (STACK(1) == 0) BAIL(); STACK(2) = STACK(2) % STACK(1); sp--;	NEXT();
+	BLOCKOP(And):			STACK(2) = (STACK(2) & STACK(1)); sp--;	NEXT();
+	BLOCKOP(Or):			STACK(2) = (STACK(2) | STACK(1)); sp--;	NEXT();
+	BLOCKOP(Xor):			STACK(2) = (STACK(2) ^ STACK(1)); sp--;	NEXT();
+	BLOCKOP(LShift):		STACK(2) = (STACK(2) << STACK(1)); sp--;	NEXT();
+	BLOCKOP(RShift):		STACK(2) = (STACK(2) >> STACK(1)); sp--;	NEXT();
+	BLOCKOP(EQ):			STACK(2) = (STACK(2) == STACK(1)); sp--;	NEXT();
+	BLOCKOP(NE):			STACK(2) = (STACK(2) != STACK(1)); sp--;	NEXT();
+	BLOCKOP(LT):			STACK(2) = (STACK(2) < STACK(1)); sp--;	NEXT();
+	BLOCKOP(GT):			STACK(2) = (STACK(2) > STACK(1)); sp--;	NEXT();
+	BLOCKOP(LE):			STACK(2) = (STACK(2) <= STACK(1)); sp--;	NEXT();
+	BLOCKOP(GE):			STACK(2) = (STACK(2) >= STACK(1)); sp--;	NEXT();
+	BLOCKOP(AndLogical):	STACK(2) = (STACK(2) && STACK(1)); sp--;	NEXT();
+	BLOCKOP(OrLogical):		STACK(2) = (STACK(2) || STACK(1)); sp--;	NEXT();
+
+	BLOCKOP(Negate):		STACK(1) = -STACK(1);	NEXT();
+	BLOCKOP(NegateBinary):	STACK(1) = ~STACK(1);	NEXT();
+	BLOCKOP(NegateLogical):	STACK(1) = !STACK(1);	NEXT();
+
+	BLOCKOP(PushLocal):		CHECKLOCAL(); PushToStack(locals[ip->Arg]);	NEXT();
+	BLOCKOP(AssignLocal):	CHECKLOCAL(); locals[ip->Arg] = STACK(1); sp--;	NEXT();
+	BLOCKOP(AddLocal):		CHECKLOCAL(); locals[ip->Arg] += STACK(1); sp--;	NEXT();
+	BLOCKOP(SubLocal):		CHECKLOCAL(); locals[ip->Arg] -= STACK(1); sp--;	NEXT();
+	BLOCKOP(MulLocal):		CHECKLOCAL(); locals[ip->Arg] *= STACK(1); sp--;	NEXT();
+	BLOCKOP(IncLocal):		CHECKLOCAL(); ++locals[ip->Arg];	NEXT();
+	BLOCKOP(DecLocal):		CHECKLOCAL(); --locals[ip->Arg];	NEXT();
+
+	BLOCKOP(PushVar):		PushToStack(*ip->Var);	NEXT();
+	BLOCKOP(AssignVar):		*ip->Var = STACK(1); sp--;	NEXT();
+	BLOCKOP(AddVar):		*ip->Var += STACK(1); sp--;	NEXT();
+	BLOCKOP(SubVar):		*ip->Var -= STACK(1); sp--;	NEXT();
+	BLOCKOP(MulVar):		*ip->Var *= STACK(1); sp--;	NEXT();
+	BLOCKOP(IncVar):		*ip->Var += 1;	NEXT();
+	BLOCKOP(DecVar):		*ip->Var -= 1;	NEXT();
+
+	BLOCKOP(Goto):
+		count++;
+		TRANSFER();
+
+	BLOCKOP(IfGoto):
+	BLOCKOP(IfNotGoto):
+		temp = STACK(1);
+		sp--;
+		count++;
+		if ((temp != 0) == (ip->Op == ABOP_IfGoto))
+		{
+			TRANSFER();
+		}
+		ip++;
+		DISPATCH();
+
+	BLOCKOP(CaseGoto):
+		count++;
+		if (STACK(1) == ip->Arg)
+		{
+			sp--;
+			TRANSFER();
+		}
+		ip++;
+		DISPATCH();
+
+	BLOCKOP(Exit):
+		exitofs = ip->Offset;
+		goto leave;
+	}
+
+#undef BLOCKOP
+#undef DISPATCH
+#undef NEXT
+#undef BAIL
+#undef CHECKLOCAL
+#undef TRANSFER
+
+leave:
+	frame->SP = sp;
+	frame->Instructions = count;
+	frame->Jumped = jumped;
+	return exitofs;
+}
+
+#ifdef HAVE_VM_JIT
+//==========================================================================
+//
+// GetNativeBlock
+//
+// Compiles a block to native code the first time it is run with the JIT on.
+//
+//==========================================================================
+
+static ACSJitFunc GetNativeBlock(FBehavior *module, FACSBlock *block)
+{
+	if (!block->Compiled)
+	{
+		FStringf name("ACS %s:%u", module->GetModuleName(), block->Code[0].Offset);
+		block->Native = ACSJitCompile(*block, STACK_SIZE, name);
+		block->Compiled = true;
+	}
+	return block->Native;
+}
+#endif
+
 static bool CharArrayParms(int &capacity, int &offset, int &a, FACSStackMemory& Stack, int &sp, bool ranged)
 {
 	if (ranged)
@@ -6873,6 +7392,8 @@ int DLevelScript::RunScript()
 	const char *lookup;
 	int optstart = -1;
 	int temp;
+	const bool useblocks = acs_predecode;
+	FACSBlockFrame blockframe;
 
 	while (state == SCRIPT_Running)
 	{
@@ -6883,6 +7404,52 @@ int DLevelScript::RunScript()
 			break;
 		}
 
+		if (useblocks)
+		{
+			// Run as much as possible from pre-decoded blocks, following jumps into
+			// other blocks. The interpreter executes the instruction they stop at.
+			// Once the blocks have used up the runaway limit, the check above
+			// terminates the script.
+			FACSBlock *block;
+			blockframe.Jumped = true;
+			while (blockframe.Jumped && runaway < 2000000 && (block = activeBehavior->GetBlock(pc)) != nullptr)
+			{
+				blockframe.Stack = Stack.Pointer();
+				blockframe.Locals = locals.Pointer();
+				blockframe.NumLocals = (uint32_t)locals.Size();
+				blockframe.SP = sp;
+				blockframe.Instructions = MAX(2000000 - (int)runaway, 0);
+
+				int ofs;
+#ifdef HAVE_VM_JIT
+				ACSJitFunc native = acs_jit ? GetNativeBlock(activeBehavior, block) : nullptr;
+				if (native != nullptr)
+				{
+					ACSJitTime.Clock();
+					ofs = native(&blockframe);
+					ACSJitTime.Unclock();
+					ACSJitInstructions += blockframe.Instructions;
+				}
+				else
+#endif
+				{
+					ofs = RunBlock(*block, &blockframe);
+				}
+				pc = activeBehavior->Ofs2PC(ofs);
+				sp = blockframe.SP;
+				runaway += blockframe.Instructions;
+				ACSBlockInstructions += blockframe.Instructions;
+				if (blockframe.Instructions == 0)
+				{
+					break;
+				}
+			}
+			if (runaway >= 2000000)
+			{
+				continue;
+			}
+		}
+
 		if (fmt == ACS_LittleEnhanced)
 		{
 			pcd = getbyte(pc);
@@ -10202,6 +10769,7 @@ scriptwait:
  		}
  	}
 
+	ACSInstructions += runaway;
 	if (runaway != 0 && InModuleScriptNumber >= 0)
 	{
 		auto scriptptr = activeBehavior->GetScriptPtr(InModuleScriptNumber);
@@ -10786,5 +11354,6 @@ CCMD(acsprofile)
 
 ADD_STAT(ACS)
 {
-	return FStringf("ACS time: %f ms", ACSTime.TimeMS());
+	return FStringf("ACS time: %f ms, native: %f ms, instructions: %d interpreted, %d pre-decoded, %d native", ACSTime.TimeMS(), ACSJitTime.TimeMS(),
+		ACSInstructions - ACSBlockInstructions, ACSBlockInstructions - ACSJitInstructions, ACSJitInstructions);
 }
@@ -38,6 +38,7 @@
 #include "doomtype.h"
 #include "dthinker.h"
 #include "doomerrors.h"
+#include "p_acsblock.h"
 
 #define LOCAL_SIZE				20
 #define NUM_MAPVARS				128
@@ -200,6 +201,16 @@ public:
 		return memory;
 	}
 
+	int32_t *Pointer()
+	{
+		return memory;
+	}
+
+	size_t Size() const
+	{
+		return count;
+	}
+
 private:
 	int32_t *memory;
 	size_t count;
@@ -379,6 +390,7 @@ public:
 	ACSProfileInfo *GetFunctionProfileData(int index) { return index >= 0 && index < NumFunctions ? &FunctionProfileData[index] : NULL; }
 	ACSProfileInfo *GetFunctionProfileData(ScriptFunction *func) { return GetFunctionProfileData((int)(func - (ScriptFunction *)Functions)); }
 	const char *LookupString (uint32_t index, bool forprint = false) const;
+	FACSBlock *GetBlock (int *pc);
 
 	BoundsCheckingArray<int32_t *, NUM_MAPVARS> MapVars;
 
@@ -410,6 +422,8 @@ private:
 	TArray<FBehavior *> Imports;
 	char ModuleName[9];
 	TArray<int> JumpPoints;
+	TMap<uint32_t, FACSBlock *> Blocks;	// pre-decoded p-codes by offset
+	TArray<uint32_t> NoBlocks;			// bit set for every offset that was found not worth decoding
 
 	void LoadScriptsDirectory ();
 
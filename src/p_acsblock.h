@@ -0,0 +1,119 @@
+/*
+** p_acsblock.h
+** Pre-decoded runs of simple ACS p-codes
+**
+** The decoder in p_acs.cpp translates everything it can handle into a
+** FACSBlock, starting at some address and ending at the first p-code that
+** needs the regular interpreter. All operands are fully decoded, variables
+** resolved to their addresses and jumps inside the block resolved to
+** instruction indices. A block is either run by the threaded interpreter
+** in p_acs.cpp or compiled to native code by p_acsjit.cpp. Both execute it
+** on the script's stack and return the offset where the interpreter has to
+** continue. Anything that would fail in the interpreter (division by zero,
+** out of bounds stack or local variable accesses) makes the block return
+** early at that instruction so the interpreter can deal with it.
+**
+*/
+
+#ifndef __P_ACSBLOCK_H__
+#define __P_ACSBLOCK_H__
+
+#include "tarray.h"
+
+struct FACSBlockFrame
+{
+	int32_t *Stack;			// start of the script's stack
+	int32_t *Locals;
+	uint32_t NumLocals;
+	int SP;					// in/out
+	int Instructions;		// in: how many may be executed before the runaway check; out: how many were
+	bool Jumped;			// out: true if the block was left through a jump
+};
+
+typedef int (*ACSJitFunc)(FACSBlockFrame *frame);
+
+enum EACSBlockOp
+{
+	ABOP_Push,				// Arg
+	ABOP_Drop,
+	ABOP_Dup,
+	ABOP_Swap,
+
+	// Binary operators, replacing STACK(2) with STACK(2) op STACK(1)
+	ABOP_Add,
+	ABOP_Sub,
+	ABOP_Mul,
+	ABOP_Div,
+	ABOP_Mod,
+	ABOP_And,
+	ABOP_Or,
+	ABOP_Xor,
+	ABOP_LShift,
+	ABOP_RShift,
+	ABOP_EQ,
+	ABOP_NE,
+	ABOP_LT,
+	ABOP_GT,
+	ABOP_LE,
+	ABOP_GE,
+	ABOP_AndLogical,
+	ABOP_OrLogical,
+
+	// Unary operators on STACK(1)
+	ABOP_Negate,
+	ABOP_NegateBinary,
+	ABOP_NegateLogical,
+
+	// Script variables, Arg is the local's index
+	ABOP_PushLocal,
+	ABOP_AssignLocal,
+	ABOP_AddLocal,
+	ABOP_SubLocal,
+	ABOP_MulLocal,
+	ABOP_IncLocal,
+	ABOP_DecLocal,
+
+	// Map, world and global variables, Var points to the variable
+	ABOP_PushVar,
+	ABOP_AssignVar,
+	ABOP_AddVar,
+	ABOP_SubVar,
+	ABOP_MulVar,
+	ABOP_IncVar,
+	ABOP_DecVar,
+
+	// Jumps, Target is the destination's offset
+	ABOP_Goto,
+	ABOP_IfGoto,
+	ABOP_IfNotGoto,
+	ABOP_CaseGoto,			// Arg is the case value
+
+	ABOP_Exit,				// always the last instruction, Offset is where the interpreter continues
+
+	NUM_ABOPS
+};
+
+struct FACSBlockInstr
+{
+	EACSBlockOp Op;
+	int Arg;
+	int32_t *Var;
+	uint32_t Offset;		// offset of the p-code this was decoded from
+	uint32_t Target;
+	int TargetIndex;		// index of the jump's destination if it is inside the block, otherwise -1
+	int Depth;				// stack depth before this instruction, relative to the entry
+};
+
+struct FACSBlock
+{
+	TArray<FACSBlockInstr> Code;
+	int Lowest, Highest;	// range of stack slots the block accesses, relative to the entry
+	bool UsesLocals;
+	bool HasLoops;
+	bool Compiled;			// Native has been set
+	ACSJitFunc Native;
+};
+
+ACSJitFunc ACSJitCompile(const FACSBlock &block, int stacksize, const char *name);
+
+#endif
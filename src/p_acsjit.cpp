@@ -0,0 +1,533 @@
+/*
+** p_acsjit.cpp
+** Compiles straight runs of simple ACS p-codes to native code
+**
+** The block has already been analyzed by the decoder. All stack accesses
+** go directly to the script's stack in memory, so the
+** interpreter can take over at any instruction boundary without having to
+** know anything about the generated code.
+**
+*/
+
+#include "p_acsblock.h"
+#include "jitintern.h"
+
+namespace
+{
+
+struct ACSJitExit
+{
+	asmjit::Label Label;
+	uint32_t Offset;
+	int Depth;
+	bool Jumped;
+};
+
+class ACSJitCompiler
+{
+public:
+	ACSJitCompiler(asmjit::CodeHolder *code, const FACSBlock &block, int stacksize)
+		: cc(code), Block(block), Code(block.Code), StackSize(stacksize) { }
+
+	asmjit::CCFunc *Codegen();
+
+private:
+	void Setup();
+	void EmitInstruction(unsigned i);
+	void EmitBinary(const FACSBlockInstr &instr);
+	void EmitTransfer(unsigned i);
+	void EmitExits();
+	void FlushCount();
+	asmjit::Label NewExit(uint32_t offset, int depth, bool jumped);
+
+	asmjit::X86Mem Stack(int depth, int index) const
+	{
+		return asmjit::x86::dword_ptr(stack, (depth - index) * 4);
+	}
+
+	asmjit::X86Compiler cc;
+	const FACSBlock &Block;
+	const TArray<FACSBlockInstr> &Code;
+	int StackSize;
+
+	TArray<bool> IsTarget;
+	TArray<asmjit::Label> Labels;
+	TArray<ACSJitExit> Exits;
+	int Pending = 0;
+
+	asmjit::CCFunc *func = nullptr;
+	asmjit::X86Gp frame, stack, locals, numlocals, count, budget;
+};
+
+//==========================================================================
+//
+// ACSJitCompiler :: NewExit
+//
+//==========================================================================
+
+asmjit::Label ACSJitCompiler::NewExit(uint32_t offset, int depth, bool jumped)
+{
+	ACSJitExit exit = { cc.newLabel(), offset, depth, jumped };
+	Exits.Push(exit);
+	return exit.Label;
+}
+
+//==========================================================================
+//
+// ACSJitCompiler :: FlushCount
+//
+// The instruction count is only updated where control flow can leave
+// the current straight sequence of instructions.
+//
+//==========================================================================
+
+void ACSJitCompiler::FlushCount()
+{
+	if (Pending > 0)
+	{
+		cc.add(count, Pending);
+		Pending = 0;
+	}
+}
+
+//==========================================================================
+//
+// ACSJitCompiler :: Setup
+//
+//==========================================================================
+
+void ACSJitCompiler::Setup()
+{
+	using namespace asmjit;
+
+	frame = cc.newIntPtr("frame");
+	stack = cc.newIntPtr("stack");
+	count = cc.newInt32("count");
+
+	func = cc.addFunc(FuncSignature1<int, void *>());
+	cc.setArg(0, frame);
+
+	cc.xor_(count, count);
+
+	// Leave the whole block to the interpreter if any access would be out of bounds.
+	auto sp = cc.newInt32("sp");
+	auto bail = NewExit(Code[0].Offset, 0, false);
+	cc.mov(sp, x86::dword_ptr(frame, offsetof(FACSBlockFrame, SP)));
+	cc.cmp(sp, -Block.Lowest);
+	cc.jl(bail);
+	cc.cmp(sp, StackSize - Block.Highest);
+	cc.jg(bail);
+
+	auto spq = cc.newIntPtr("spq");
+	cc.movsxd(spq, sp);
+	cc.mov(stack, x86::ptr(frame, offsetof(FACSBlockFrame, Stack)));
+	cc.lea(stack, x86::ptr(stack, spq, 2));
+
+	if (Block.UsesLocals)
+	{
+		locals = cc.newIntPtr("locals");
+		numlocals = cc.newInt32("numlocals");
+		cc.mov(locals, x86::ptr(frame, offsetof(FACSBlockFrame, Locals)));
+		cc.mov(numlocals, x86::dword_ptr(frame, offsetof(FACSBlockFrame, NumLocals)));
+	}
+	if (Block.HasLoops)
+	{
+		budget = cc.newInt32("budget");
+		cc.mov(budget, x86::dword_ptr(frame, offsetof(FACSBlockFrame, Instructions)));
+	}
+}
+
+//==========================================================================
+//
+// ACSJitCompiler :: EmitTransfer
+//
+// Jump from instruction i to its destination. Stays inside the block where
+// possible. Jumps backwards are loops and need to respect the runaway limit.
+//
+//==========================================================================
+
+void ACSJitCompiler::EmitTransfer(unsigned i)
+{
+	int j = Code[i].TargetIndex;
+	uint32_t target = Code[i].Target;
+	int depth = Code[i].Depth - (Code[i].Op == ABOP_Goto ? 0 : 1);
+
+	FlushCount();
+	if (j >= 0)
+	{
+		if (j <= (int)i)
+		{
+			cc.cmp(count, budget);
+			cc.jge(NewExit(target, depth, true));
+		}
+		cc.jmp(Labels[j]);
+	}
+	else
+	{
+		cc.jmp(NewExit(target, depth, true));
+	}
+}
+
+//==========================================================================
+//
+// ACSJitCompiler :: EmitBinary
+//
+//==========================================================================
+
+void ACSJitCompiler::EmitBinary(const FACSBlockInstr &instr)
+{
+	using namespace asmjit;
+
+	int d = instr.Depth;
+	auto a = cc.newInt32();
+
+	cc.mov(a, Stack(d, 2));
+	switch (instr.Op)
+	{
+	case ABOP_Add:	cc.add(a, Stack(d, 1));	break;
+	case ABOP_Sub:	cc.sub(a, Stack(d, 1));	break;
+	case ABOP_Mul:	cc.imul(a, Stack(d, 1));	break;
+	case ABOP_And:	cc.and_(a, Stack(d, 1));	break;
+	case ABOP_Or:	cc.or_(a, Stack(d, 1));	break;
+	case ABOP_Xor:	cc.xor_(a, Stack(d, 1));	break;
+
+	case ABOP_LShift:
+	case ABOP_RShift:
+	{
+		auto b = cc.newInt32();
+		cc.mov(b, Stack(d, 1));
+		if (instr.Op == ABOP_LShift) cc.shl(a, b);
+		else cc.sar(a, b);
+		break;
+	}
+
+	case ABOP_Div:
+	case ABOP_Mod:
+	{
+		// Division by 0 and INT_MIN / -1 are left to the interpreter.
+		auto bail = NewExit(instr.Offset, d, false);
+		auto b = cc.newInt32();
+		auto rem = cc.newInt32();
+		cc.mov(b, Stack(d, 1));
+		cc.test(b, b);
+		cc.je(bail);
+		cc.cmp(b, -1);
+		cc.je(bail);
+		cc.cdq(rem, a);
+		cc.idiv(rem, a, b);
+		if (instr.Op == ABOP_Mod) cc.mov(a, rem);
+		break;
+	}
+
+	case ABOP_EQ:
+	case ABOP_NE:
+	case ABOP_LT:
+	case ABOP_GT:
+	case ABOP_LE:
+	case ABOP_GE:
+	{
+		auto r = cc.newInt32();
+		cc.xor_(r, r);
+		cc.cmp(a, Stack(d, 1));
+		switch (instr.Op)
+		{
+		case ABOP_EQ:	cc.sete(r.r8Lo());	break;
+		case ABOP_NE:	cc.setne(r.r8Lo());	break;
+		case ABOP_LT:	cc.setl(r.r8Lo());	break;
+		case ABOP_GT:	cc.setg(r.r8Lo());	break;
+		case ABOP_LE:	cc.setle(r.r8Lo());	break;
+		default:		cc.setge(r.r8Lo());	break;
+		}
+		a = r;
+		break;
+	}
+
+	case ABOP_AndLogical:
+	case ABOP_OrLogical:
+	{
+		auto r = cc.newInt32();
+		auto b = cc.newInt32();
+		cc.xor_(r, r);
+		cc.test(a, a);
+		cc.setne(r.r8Lo());
+		cc.xor_(b, b);
+		cc.cmp(Stack(d, 1), 0);
+		cc.setne(b.r8Lo());
+		if (instr.Op == ABOP_AndLogical) cc.and_(r, b);
+		else cc.or_(r, b);
+		a = r;
+		break;
+	}
+
+	default:
+		I_FatalError("ACS JIT error: Unknown operation %d\n", instr.Op);
+	}
+	cc.mov(Stack(d, 2), a);
+}
+
+//==========================================================================
+//
+// ACSJitCompiler :: EmitInstruction
+//
+//==========================================================================
+
+void ACSJitCompiler::EmitInstruction(unsigned i)
+{
+	using namespace asmjit;
+
+	const FACSBlockInstr &instr = Code[i];
+	int d = instr.Depth;
+
+	if (instr.Op == ABOP_Exit)
+	{
+		FlushCount();
+		cc.jmp(NewExit(instr.Offset, d, false));
+		return;
+	}
+	else if (instr.Op >= ABOP_PushLocal && instr.Op <= ABOP_DecLocal)
+	{
+		// The interpreter aborts with an error here.
+		FlushCount();
+		cc.cmp(numlocals, instr.Arg);
+		cc.jbe(NewExit(instr.Offset, d, false));
+	}
+	else if (instr.Op == ABOP_Div || instr.Op == ABOP_Mod)
+	{
+		FlushCount();
+	}
+	Pending++;
+
+	// The variable operated on, if any
+	X86Mem mem;
+	if (instr.Op >= ABOP_PushLocal && instr.Op <= ABOP_DecLocal)
+	{
+		mem = x86::dword_ptr(locals, instr.Arg * 4);
+	}
+	else if (instr.Op >= ABOP_PushVar && instr.Op <= ABOP_DecVar)
+	{
+		auto var = cc.newIntPtr();
+		cc.mov(var, imm_ptr(instr.Var));
+		mem = x86::dword_ptr(var);
+	}
+
+	switch (instr.Op)
+	{
+	case ABOP_Push:
+		cc.mov(Stack(d, 0), instr.Arg);
+		break;
+
+	case ABOP_Drop:
+		break;
+
+	case ABOP_Dup:
+	{
+		auto a = cc.newInt32();
+		cc.mov(a, Stack(d, 1));
+		cc.mov(Stack(d, 0), a);
+		break;
+	}
+
+	case ABOP_Swap:
+	{
+		auto a = cc.newInt32();
+		auto b = cc.newInt32();
+		cc.mov(a, Stack(d, 1));
+		cc.mov(b, Stack(d, 2));
+		cc.mov(Stack(d, 2), a);
+		cc.mov(Stack(d, 1), b);
+		break;
+	}
+
+	case ABOP_Negate:
+		cc.neg(Stack(d, 1));
+		break;
+
+	case ABOP_NegateBinary:
+		cc.not_(Stack(d, 1));
+		break;
+
+	case ABOP_NegateLogical:
+	{
+		auto r = cc.newInt32();
+		cc.xor_(r, r);
+		cc.cmp(Stack(d, 1), 0);
+		cc.sete(r.r8Lo());
+		cc.mov(Stack(d, 1), r);
+		break;
+	}
+
+	case ABOP_PushLocal:
+	case ABOP_PushVar:
+	{
+		auto a = cc.newInt32();
+		cc.mov(a, mem);
+		cc.mov(Stack(d, 0), a);
+		break;
+	}
+
+	case ABOP_AssignLocal:
+	case ABOP_AssignVar:
+	{
+		auto a = cc.newInt32();
+		cc.mov(a, Stack(d, 1));
+		cc.mov(mem, a);
+		break;
+	}
+
+	case ABOP_AddLocal:
+	case ABOP_SubLocal:
+	case ABOP_MulLocal:
+	case ABOP_AddVar:
+	case ABOP_SubVar:
+	case ABOP_MulVar:
+	{
+		auto a = cc.newInt32();
+		cc.mov(a, mem);
+		if (instr.Op == ABOP_AddLocal || instr.Op == ABOP_AddVar) cc.add(a, Stack(d, 1));
+		else if (instr.Op == ABOP_SubLocal || instr.Op == ABOP_SubVar) cc.sub(a, Stack(d, 1));
+		else cc.imul(a, Stack(d, 1));
+		cc.mov(mem, a);
+		break;
+	}
+
+	case ABOP_IncLocal:
+	case ABOP_IncVar:
+		cc.add(mem, 1);
+		break;
+
+	case ABOP_DecLocal:
+	case ABOP_DecVar:
+		cc.sub(mem, 1);
+		break;
+
+	case ABOP_Goto:
+		EmitTransfer(i);
+		break;
+
+	case ABOP_IfGoto:
+	case ABOP_IfNotGoto:
+	{
+		auto skip = cc.newLabel();
+		auto a = cc.newInt32();
+		cc.mov(a, Stack(d, 1));
+		FlushCount();
+		cc.test(a, a);
+		if (instr.Op == ABOP_IfGoto) cc.je(skip);
+		else cc.jne(skip);
+		EmitTransfer(i);
+		cc.bind(skip);
+		break;
+	}
+
+	case ABOP_CaseGoto:
+	{
+		auto skip = cc.newLabel();
+		FlushCount();
+		cc.cmp(Stack(d, 1), instr.Arg);
+		cc.jne(skip);
+		EmitTransfer(i);
+		cc.bind(skip);
+		break;
+	}
+
+	default:
+		EmitBinary(instr);
+		break;
+	}
+}
+
+//==========================================================================
+//
+// ACSJitCompiler :: EmitExits
+//
+// Every way out of the block stores the new stack pointer and the number
+// of executed instructions and returns where to continue.
+//
+//==========================================================================
+
+void ACSJitCompiler::EmitExits()
+{
+	using namespace asmjit;
+
+	for (auto &exit : Exits)
+	{
+		cc.bind(exit.Label);
+		cc.mov(x86::dword_ptr(frame, offsetof(FACSBlockFrame, Instructions)), count);
+		if (exit.Depth != 0)
+		{
+			cc.add(x86::dword_ptr(frame, offsetof(FACSBlockFrame, SP)), exit.Depth);
+		}
+		cc.mov(x86::byte_ptr(frame, offsetof(FACSBlockFrame, Jumped)), (int)exit.Jumped);
+		auto ret = cc.newInt32();
+		cc.mov(ret, (int)exit.Offset);
+		cc.ret(ret);
+	}
+}
+
+//==========================================================================
+//
+// ACSJitCompiler :: Codegen
+//
+//==========================================================================
+
+asmjit::CCFunc *ACSJitCompiler::Codegen()
+{
+	Setup();
+
+	IsTarget.Resize(Code.Size());
+	for (unsigned i = 0; i < Code.Size(); i++)
+	{
+		Labels.Push(cc.newLabel());
+		IsTarget[i] = false;
+	}
+	for (unsigned i = 0; i < Code.Size(); i++)
+	{
+		if (Code[i].TargetIndex >= 0) IsTarget[Code[i].TargetIndex] = true;
+	}
+
+	for (unsigned i = 0; i < Code.Size(); i++)
+	{
+		if (IsTarget[i])
+		{
+			FlushCount();
+			cc.bind(Labels[i]);
+		}
+		EmitInstruction(i);
+	}
+
+	EmitExits();
+
+	cc.endFunc();
+	cc.finalize();
+	return func;
+}
+
+}
+
+//==========================================================================
+//
+// ACSJitCompile
+//
+//==========================================================================
+
+ACSJitFunc ACSJitCompile(const FACSBlock &block, int stacksize, const char *name)
+{
+	using namespace asmjit;
+
+	try
+	{
+		ThrowingErrorHandler errorHandler;
+		CodeHolder holder;
+		holder.init(GetHostCodeInfo());
+		holder.setErrorHandler(&errorHandler);
+
+		ACSJitCompiler compiler(&holder, block, stacksize);
+		CCFunc *func = compiler.Codegen();
+		return reinterpret_cast<ACSJitFunc>(AddJitFunction(&holder, func, name, "", TArray<JitLineInfo>()));
+	}
+	catch (const std::exception &e)
+	{
+		Printf("%s: Unexpected ACS JIT error: %s\n", name, e.what());
+		return nullptr;
+	}
+}
@@ -40,6 +40,8 @@ struct FBlockmap
 	double				bmaporgx;
 	double				bmaporgy;		// origin of block map
 	FBlockNode**		blocklinks; 	// for thing chains
+	int					linkgeneration = 0;	// bumped whenever a thing enters or leaves the blockmap
+	int					polygeneration = 0;	// bumped whenever a polyobject gets relinked
 
 	// mapblocks are used to check movement
 	// against lines and things
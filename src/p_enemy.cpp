@@ -49,6 +49,7 @@
 #include "g_levellocals.h"
 #include "vm.h"
 #include "actorinlines.h"
+#include "stats.h"
 
 #include "gi.h"
 
@@ -123,19 +124,93 @@ struct NoiseTarget
 	int soundblocks;
 };
 static TArray<NoiseTarget> NoiseList(128);
+static int NoiseFloods, NoiseSectors;
 
-static void NoiseMarkSector(sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
+//----------------------------------------------------------------------------
+//
+// FSoundGraph :: Build
+//
+//----------------------------------------------------------------------------
+
+void FSoundGraph::Build(FLevelLocals *Level)
 {
+	Nodes.Resize(Level->sectors.Size());
+	Edges.Clear();
+	for (auto &sec : Level->sectors)
+	{
+		Node &node = Nodes[sec.Index()];
+		node.floorplane = sec.floorplane;
+		node.ceilingplane = sec.ceilingplane;
+		node.planeversion = 0;
+		node.checkedgeneration = 0;
+		node.floodgeneration = 0;
+		node.soundblocks = 0;
+		node.firstedge = Edges.Size();
+		node.numedges = sec.Lines.Size();
+
+		for (auto check : sec.Lines)
+		{
+			Edge edge;
+			edge.line = check;
+			edge.other = nullptr;
+			edge.above = edge.below = nullptr;
+			edge.aboveportal = edge.belowportal = UINT_MAX;
+			edge.closed = false;
+			edge.version = edge.otherversion = -1;
+
+			// Early out for one-sided and intra-sector lines
+			if (check->sidedef[1] != nullptr && check->sidedef[0]->sector != check->sidedef[1]->sector)
+			{
+				edge.other = check->sidedef[0]->sector == &sec ? check->sidedef[1]->sector : check->sidedef[0]->sector;
+			}
+			Edges.Push(edge);
+		}
+	}
+	Generation = 0;
+}
+
+//----------------------------------------------------------------------------
+//
+// FSoundGraph :: PlaneVersion
+//
+// Sector movers do not notify anyone when they change a plane so this
+// compares against the last known planes, but only once per flood.
+//
+//----------------------------------------------------------------------------
+
+int FSoundGraph::PlaneVersion(sector_t *sec)
+{
+	Node &node = Nodes[sec->Index()];
+
+	if (node.checkedgeneration != Generation)
+	{
+		node.checkedgeneration = Generation;
+		if (node.floorplane != sec->floorplane || node.ceilingplane != sec->ceilingplane)
+		{
+			node.floorplane = sec->floorplane;
+			node.ceilingplane = sec->ceilingplane;
+			node.planeversion++;
+		}
+	}
+	return node.planeversion;
+}
+
+static void NoiseMarkSector(FSoundGraph &graph, sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
+{
+	FSoundGraph::Node &node = graph.Nodes[sec->Index()];
+
 	// wake up all monsters in this sector
-	if (sec->validcount == validcount
-		&& sec->soundtraversed <= soundblocks + 1)
+	if (node.floodgeneration == graph.Generation
+		&& node.soundblocks <= soundblocks + 1)
 	{
 		return; 		// already flooded
 	}
 
-	sec->validcount = validcount;
-	sec->soundtraversed = soundblocks + 1;
+	node.floodgeneration = graph.Generation;
+	node.soundblocks = soundblocks + 1;
+	sec->soundtraversed = soundblocks + 1;	// only kept up to date for scripts that read it.
 	sec->SoundTarget = soundtarget;
+	NoiseSectors++;
 
 	// [RH] Set this in the actors in the sector instead of the sector itself.
 	for (AActor *actor = sec->thinglist; actor != NULL; actor = actor->snext)
@@ -149,25 +224,73 @@ static void NoiseMarkSector(sector_t *sec, AActor *soundtarget, bool splash, AAc
 	NoiseList.Push({ sec, soundblocks });
 }
 
+//----------------------------------------------------------------------------
+//
+// checks for a closed door between two sectors
+//
+//----------------------------------------------------------------------------
 
-static void P_RecursiveSound(sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
+static bool NoiseLineClosed(FSoundGraph &graph, FSoundGraph::Edge &edge, sector_t *sec)
+{
+	int version = graph.PlaneVersion(sec);
+	int otherversion = graph.PlaneVersion(edge.other);
+
+	// Polyobject lines can move so their result cannot be kept.
+	if (edge.version == version && edge.otherversion == otherversion && !(edge.line->sidedef[0]->Flags & WALLF_POLYOBJ))
+	{
+		return edge.closed;
+	}
+
+	line_t *check = edge.line;
+	sector_t *other = edge.other;
+	edge.closed = (sec->floorplane.ZatPoint(check->v1->fPos()) >=
+		other->ceilingplane.ZatPoint(check->v1->fPos()) &&
+		sec->floorplane.ZatPoint(check->v2->fPos()) >=
+		other->ceilingplane.ZatPoint(check->v2->fPos()))
+		|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
+			sec->ceilingplane.ZatPoint(check->v1->fPos()) &&
+			other->floorplane.ZatPoint(check->v2->fPos()) >=
+			sec->ceilingplane.ZatPoint(check->v2->fPos()))
+		|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
+			other->ceilingplane.ZatPoint(check->v1->fPos()) &&
+			other->floorplane.ZatPoint(check->v2->fPos()) >=
+			other->ceilingplane.ZatPoint(check->v2->fPos()));
+	edge.version = version;
+	edge.otherversion = otherversion;
+	return edge.closed;
+}
+
+static void P_RecursiveSound(FSoundGraph &graph, sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
 {
 	bool checkabove = !sec->PortalBlocksSound(sector_t::ceiling);
 	bool checkbelow = !sec->PortalBlocksSound(sector_t::floor);
+	const FSoundGraph::Node &node = graph.Nodes[sec->Index()];
 
-	for (auto check : sec->Lines)
+	for (unsigned i = 0; i < node.numedges; i++)
 	{
+		FSoundGraph::Edge &edge = graph.Edges[node.firstedge + i];
+		line_t *check = edge.line;
+
 		// check sector portals
 		// I wish there was a better method to do this than randomly looking through the portal at a few places...
+		// The found sectors are kept until the sector gets a different portal or the graph is cleared.
+		if (checkabove && edge.aboveportal != sec->Portals[sector_t::ceiling])
+		{
+			edge.above = sec->Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling));
+			edge.aboveportal = sec->Portals[sector_t::ceiling];
+		}
+		if (checkbelow && edge.belowportal != sec->Portals[sector_t::floor])
+		{
+			edge.below = sec->Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor));
+			edge.belowportal = sec->Portals[sector_t::floor];
+		}
 		if (checkabove)
 		{
-			sector_t *upper = sec->Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling));
-			NoiseMarkSector(upper, soundtarget, splash, emitter, soundblocks, maxdist);
+			NoiseMarkSector(graph, edge.above, soundtarget, splash, emitter, soundblocks, maxdist);
 		}
 		if (checkbelow)
 		{
-			sector_t *lower = sec->Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor));
-			NoiseMarkSector(lower, soundtarget, splash, emitter, soundblocks, maxdist);
+			NoiseMarkSector(graph, edge.below, soundtarget, splash, emitter, soundblocks, maxdist);
 		}
 
 		// ... and line portals;
@@ -176,39 +299,19 @@ static void P_RecursiveSound(sector_t *sec, AActor *soundtarget, bool splash, AA
 		{
 			if (port->mDestination)
 			{
-				NoiseMarkSector(port->mDestination->frontsector, soundtarget, splash, emitter, soundblocks, maxdist);
+				NoiseMarkSector(graph, port->mDestination->frontsector, soundtarget, splash, emitter, soundblocks, maxdist);
 			}
 		}
 
 
-		if (check->sidedef[1] == NULL ||
+		if (edge.other == nullptr ||
 			!(check->flags & ML_TWOSIDED))
 		{
 			continue;
 		}
 
-		// Early out for intra-sector lines
-		if (check->sidedef[0]->sector == check->sidedef[1]->sector) continue;
-
-		sector_t *other;
-		if (check->sidedef[0]->sector == sec)
-			other = check->sidedef[1]->sector;
-		else
-			other = check->sidedef[0]->sector;
-
 		// check for closed door
-		if ((sec->floorplane.ZatPoint(check->v1->fPos()) >=
-			other->ceilingplane.ZatPoint(check->v1->fPos()) &&
-			sec->floorplane.ZatPoint(check->v2->fPos()) >=
-			other->ceilingplane.ZatPoint(check->v2->fPos()))
-			|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
-				sec->ceilingplane.ZatPoint(check->v1->fPos()) &&
-				other->floorplane.ZatPoint(check->v2->fPos()) >=
-				sec->ceilingplane.ZatPoint(check->v2->fPos()))
-			|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
-				other->ceilingplane.ZatPoint(check->v1->fPos()) &&
-				other->floorplane.ZatPoint(check->v2->fPos()) >=
-				other->ceilingplane.ZatPoint(check->v2->fPos())))
+		if (NoiseLineClosed(graph, edge, sec))
 		{
 			continue;
 		}
@@ -216,11 +319,11 @@ static void P_RecursiveSound(sector_t *sec, AActor *soundtarget, bool splash, AA
 		if (check->flags & ML_SOUNDBLOCK)
 		{
 			if (!soundblocks)
-				NoiseMarkSector(other, soundtarget, splash, emitter, 1, maxdist);
+				NoiseMarkSector(graph, edge.other, soundtarget, splash, emitter, 1, maxdist);
 		}
 		else
 		{
-			NoiseMarkSector(other, soundtarget, splash, emitter, soundblocks, maxdist);
+			NoiseMarkSector(graph, edge.other, soundtarget, splash, emitter, soundblocks, maxdist);
 		}
 	}
 }
@@ -245,15 +348,35 @@ void P_NoiseAlert (AActor *emitter, AActor *target, bool splash, double maxdist)
 	if (target != NULL && target->player && (target->player->cheats & CF_NOTARGET))
 		return;
 
-	validcount++;
+	FSoundGraph &graph = emitter->Level->SoundGraph;
+	if (graph.Nodes.Size() != emitter->Level->sectors.Size())
+	{
+		graph.Build(emitter->Level);
+	}
+	// Each flood gets a new generation so that nothing needs to be reset between floods.
+	graph.Generation++;
+	NoiseFloods++;
+
 	NoiseList.Clear();
-	NoiseMarkSector(emitter->Sector, target, splash, emitter, 0, maxdist);
+	NoiseMarkSector(graph, emitter->Sector, target, splash, emitter, 0, maxdist);
 	for (unsigned i = 0; i < NoiseList.Size(); i++)
 	{
-		P_RecursiveSound(NoiseList[i].sec, target, splash, emitter, NoiseList[i].soundblocks, maxdist);
+		P_RecursiveSound(graph, NoiseList[i].sec, target, splash, emitter, NoiseList[i].soundblocks, maxdist);
 	}
 }
 
+void P_ResetNoiseCounters ()
+{
+	NoiseFloods = NoiseSectors = 0;
+}
+
+ADD_STAT (noise)
+{
+	FString out;
+	out.Format ("Noise alerts = %d, sectors flooded = %d", NoiseFloods, NoiseSectors);
+	return out;
+}
+
 //----------------------------------------------------------------------------
 //
 // AActor :: CheckMeleeRange
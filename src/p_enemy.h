@@ -3,10 +3,58 @@
 
 #include "dobject.h"
 #include "vectors.h"
+#include "r_defs.h"
 
 struct sector_t;
 class AActor;
 class PClass;
+struct FLevelLocals;
+
+//
+// Sector adjacency for P_NoiseAlert, built on first use in a level.
+// Whether a line is closed for sound is remembered until the plane
+// heights on either side change.
+//
+struct FSoundGraph
+{
+	struct Edge
+	{
+		line_t *line;
+		sector_t *other;		// sector on the other side of a two-sided line, nullptr if sound cannot pass through
+		sector_t *above;		// sectors behind this sector's ceiling/floor portal at the line's center
+		sector_t *below;
+		unsigned aboveportal;	// sector portals 'above' and 'below' were found for
+		unsigned belowportal;
+		bool closed;
+		int version;			// plane versions of both sectors the 'closed' flag was calculated for
+		int otherversion;
+	};
+
+	struct Node
+	{
+		secplane_t floorplane;
+		secplane_t ceilingplane;
+		int planeversion;
+		int checkedgeneration;	// flood that last compared the planes
+		int floodgeneration;	// flood that last reached this sector
+		int soundblocks;
+		unsigned firstedge;
+		unsigned numedges;
+	};
+
+	TArray<Node> Nodes;
+	TArray<Edge> Edges;
+	int Generation = 0;
+
+	void Build(FLevelLocals *Level);
+	// Must be called whenever the portal groups or line portals change.
+	void Clear()
+	{
+		Nodes.Clear();
+		Edges.Clear();
+	}
+	int PlaneVersion(sector_t *sec);
+};
 
 
 enum dirtype_t
@@ -47,6 +95,7 @@ struct FLookExParams
 
 int P_HitFriend (AActor *self);
 void P_NoiseAlert (AActor *emmiter, AActor *target, bool splash=false, double maxdist=0);
+void P_ResetNoiseCounters ();
 
 bool P_CheckMeleeRange2 (AActor *actor);
 int P_Move (AActor *actor);
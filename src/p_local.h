@@ -320,6 +320,7 @@ enum	// P_LineAttack flags
 
 AActor *P_LineAttack(AActor *t1, DAngle angle, double distance, DAngle pitch, int damage, FName damageType, PClassActor *pufftype, int flags = 0, FTranslatedLineTarget *victim = NULL, int *actualdamage = NULL, double sz = 0.0, double offsetforward = 0.0, double offsetside = 0.0);
 AActor *P_LineAttack(AActor *t1, DAngle angle, double distance, DAngle pitch, int damage, FName damageType, FName pufftype, int flags = 0, FTranslatedLineTarget *victim = NULL, int *actualdamage = NULL, double sz = 0.0, double offsetforward = 0.0, double offsetside = 0.0);
+void P_LineAttackBatch(AActor *t1, int numshots, const DAngle *angles, const DAngle *pitches, const int *damages, double distance, FName damageType, PClassActor *pufftype, int flags = 0, AActor **puffs = NULL, FTranslatedLineTarget *victims = NULL, int *actualdamages = NULL, double sz = 0.0, double offsetforward = 0.0, double offsetside = 0.0);
 
 enum	// P_LineTrace flags
 {
@@ -411,6 +412,9 @@ template<class nodetype, class linktype>
 nodetype* P_DelSecnode(nodetype *, nodetype *linktype::*head);
 
 msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector_list, msecnode_t *sector_t::*seclisthead);
+bool	P_KeepSecNodeLists(AActor *thing);
+void	P_FindSecNodeFreeArea(AActor *thing);
+void	P_ResetSecNodeCounters();
 double	P_GetMoveFactor(const AActor *mo, double *frictionp);	// phares  3/6/98
 double		P_GetFriction(const AActor *mo, double *frictionfactor);
 
@@ -4371,42 +4371,44 @@ static ETraceStatus CheckForActor(FTraceResults &res, void *userdata)
 
 //==========================================================================
 //
-// P_LineAttack
-//
-// if damage == 0, it is just a test trace that will leave linetarget set
+// Everything about a hitscan attack that does not depend on the
+// direction of the shot. P_LineAttackBatch only sets this up once
+// for all of its shots.
 //
 //==========================================================================
 
-AActor *P_LineAttack(AActor *t1, DAngle angle, double distance,
-	DAngle pitch, int damage, FName damageType, PClassActor *pufftype, int flags, FTranslatedLineTarget*victim, int *actualdamage, 
+struct FLineAttackSetup
+{
+	AActor *t1;
+	PClassActor *pufftype;
+	AActor *puffDefaults;
+	FName damageType;
+	Origin TData;
+	uint32_t tflags;
+	int flags;
+	int pflag;
+	int puffFlags;
+	bool nointeract;
+	bool spawnSky;
+	double shootz;
+	double sz;
+	double offsetforward;
+	double offsetside;
+};
+
+static void InitLineAttack(FLineAttackSetup &la, AActor *t1, FName damageType, PClassActor *pufftype, int flags,
 	double sz, double offsetforward, double offsetside)
 {
 	bool nointeract = !!(flags & LAF_NOINTERACT);
-	DVector3 direction;
 	double shootz;
-	FTraceResults trace;
-	Origin TData;
+	Origin &TData = la.TData;
 	TData.Caller = t1;
-	bool killPuff = false;
-	AActor *puff = NULL;
 	int pflag = 0;
 	int puffFlags = (flags & LAF_ISMELEEATTACK) ? PF_MELEERANGE : 0;
 	bool spawnSky = false;
 	if (flags & LAF_NORANDOMPUFFZ)
 		puffFlags |= PF_NORANDOMZ;
 
-	if (victim != NULL)
-	{
-		memset(victim, 0, sizeof(*victim));
-	}
-	if (actualdamage != NULL)
-	{
-		*actualdamage = 0;
-	}
-
-	double pc = pitch.Cos();
-
-	direction = { pc * angle.Cos(), pc * angle.Sin(), -pitch.Sin() };
 	shootz = t1->Center() - t1->Floorclip + t1->AttackOffset();
 
 	if (t1->player != NULL)
@@ -4476,6 +4478,59 @@ AActor *P_LineAttack(AActor *t1, DAngle angle, double distance,
 		tflags |= TRACE_HitSky;
 	}
 
+	la.t1 = t1;
+	la.pufftype = pufftype;
+	la.puffDefaults = puffDefaults;
+	la.damageType = damageType;
+	la.tflags = tflags;
+	la.flags = flags;
+	la.pflag = pflag;
+	la.puffFlags = puffFlags;
+	la.nointeract = nointeract;
+	la.spawnSky = spawnSky;
+	la.shootz = shootz;
+	la.sz = sz;
+	la.offsetforward = offsetforward;
+	la.offsetside = offsetside;
+}
+
+//==========================================================================
+//
+// Fires a single shot of a hitscan attack
+//
+//==========================================================================
+
+static AActor *DoLineAttack(const FLineAttackSetup &la, DAngle angle, double distance, DAngle pitch, int damage,
+	FTranslatedLineTarget *victim, int *actualdamage, FTraceCandidates *candidates)
+{
+	AActor *t1 = la.t1;
+	PClassActor *pufftype = la.pufftype;
+	AActor *puffDefaults = la.puffDefaults;
+	FName damageType = la.damageType;
+	int flags = la.flags;
+	int pflag = la.pflag;
+	int puffFlags = la.puffFlags;
+	bool nointeract = la.nointeract;
+	bool spawnSky = la.spawnSky;
+	Origin TData = la.TData;
+	DVector3 direction;
+	FTraceResults trace;
+	bool killPuff = false;
+	AActor *puff = NULL;
+
+	if (victim != NULL)
+	{
+		memset(victim, 0, sizeof(*victim));
+	}
+	if (actualdamage != NULL)
+	{
+		*actualdamage = 0;
+	}
+
+	double pc = pitch.Cos();
+
+	direction = { pc * angle.Cos(), pc * angle.Sin(), -pitch.Sin() };
+
 	// [MC] Check the flags and set the position according to what is desired.
 	// LAF_ABSPOSITION: Treat the offset parameters as direct coordinates.
 	// LAF_ABSOFFSET: Ignore the angle.
@@ -4484,27 +4539,27 @@ AActor *P_LineAttack(AActor *t1, DAngle angle, double distance,
 
 	if (flags & LAF_ABSPOSITION)
 	{
-		tempos = DVector3(offsetforward, offsetside, sz);
+		tempos = DVector3(la.offsetforward, la.offsetside, la.sz);
 	}
 	else if (flags & LAF_ABSOFFSET)
 	{
-		tempos = t1->Vec2OffsetZ(offsetforward, offsetside, shootz);
+		tempos = t1->Vec2OffsetZ(la.offsetforward, la.offsetside, la.shootz);
 	}
-	else if (0.0 == offsetforward && 0.0 == offsetside)
+	else if (0.0 == la.offsetforward && 0.0 == la.offsetside)
 	{
 		// Default case so exact comparison is enough
-		tempos = t1->PosAtZ(shootz);
+		tempos = t1->PosAtZ(la.shootz);
 	}
 	else
 	{
 		const double s = angle.Sin();
 		const double c = angle.Cos();
-		tempos = t1->Vec2OffsetZ(offsetforward * c + offsetside * s, offsetforward * s - offsetside * c, shootz);
+		tempos = t1->Vec2OffsetZ(la.offsetforward * c + la.offsetside * s, la.offsetforward * s - la.offsetside * c, la.shootz);
 	}
 
 	// Perform the trace.
 	if (!Trace(tempos, t1->Sector, direction, distance, MF_SHOOTABLE, 
-		ML_BLOCKEVERYTHING | ML_BLOCKHITSCAN, t1, trace, tflags, CheckForActor, &TData))
+		ML_BLOCKEVERYTHING | ML_BLOCKHITSCAN, t1, trace, la.tflags, CheckForActor, &TData, candidates))
 	{ // hit nothing
 		if (!nointeract && puffDefaults && puffDefaults->ActiveSound)
 		{ // Play miss sound
@@ -4693,6 +4748,82 @@ AActor *P_LineAttack(AActor *t1, DAngle angle, double distance,
 	return puff;
 }
 
+//==========================================================================
+//
+// P_LineAttack
+//
+// if damage == 0, it is just a test trace that will leave linetarget set
+//
+//==========================================================================
+
+AActor *P_LineAttack(AActor *t1, DAngle angle, double distance,
+	DAngle pitch, int damage, FName damageType, PClassActor *pufftype, int flags, FTranslatedLineTarget*victim, int *actualdamage, 
+	double sz, double offsetforward, double offsetside)
+{
+	FLineAttackSetup la;
+
+	InitLineAttack(la, t1, damageType, pufftype, flags, sz, offsetforward, offsetside);
+	return DoLineAttack(la, angle, distance, pitch, damage, victim, actualdamage, nullptr);
+}
+
+//==========================================================================
+//
+// P_LineAttackBatch
+//
+// Fires several shots from the same origin, like the pellets of a shotgun.
+// The result is the same as calling P_LineAttack for each shot in order,
+// but the puff setup is only done once and the blockmap things along the
+// shots' paths are only collected once for all of them.
+//
+// puffs, victims and actualdamages are optional and receive one entry per shot.
+//
+//==========================================================================
+
+void P_LineAttackBatch(AActor *t1, int numshots, const DAngle *angles, const DAngle *pitches, const int *damages,
+	double distance, FName damageType, PClassActor *pufftype, int flags, AActor **puffs, FTranslatedLineTarget *victims,
+	int *actualdamages, double sz, double offsetforward, double offsetside)
+{
+	FLineAttackSetup la;
+	FTraceCandidates candidates;
+	FBoundingBox box;
+	bool boxset = false;
+
+	if (numshots <= 0) return;
+	InitLineAttack(la, t1, damageType, pufftype, flags, sz, offsetforward, offsetside);
+
+	// Get the area all shots can pass through, unless they start at an absolute position
+	// which may be anywhere on the map.
+	if (!(flags & LAF_ABSPOSITION))
+	{
+		DVector2 start = t1->Pos().XY();
+		double radius = fabs(offsetforward) + fabs(offsetside);
+
+		box.ClearBox();
+		box.AddToBox(DVector2(start.X - radius, start.Y - radius));
+		box.AddToBox(DVector2(start.X + radius, start.Y + radius));
+		for (int i = 0; i < numshots; i++)
+		{
+			DVector2 end = start + angles[i].ToVector(distance * pitches[i].Cos());
+			box.AddToBox(DVector2(end.X - radius, end.Y - radius));
+			box.AddToBox(DVector2(end.X + radius, end.Y + radius));
+		}
+		boxset = true;
+	}
+
+	for (int i = 0; i < numshots; i++)
+	{
+		// Anything getting moved by the previous shots invalidates the collected things.
+		if (boxset && !candidates.IsValid(t1->Level))
+		{
+			candidates.Init(t1->Level, box);
+		}
+		AActor *puff = DoLineAttack(la, angles[i], distance, pitches[i], damages[i],
+			victims != nullptr ? &victims[i] : nullptr, actualdamages != nullptr ? &actualdamages[i] : nullptr,
+			boxset ? &candidates : nullptr);
+		if (puffs != nullptr) puffs[i] = puff;
+	}
+}
+
 AActor *P_LineAttack(AActor *t1, DAngle angle, double distance,
 	DAngle pitch, int damage, FName damageType, FName pufftype, int flags, FTranslatedLineTarget *victim, int *actualdamage, 
 	double sz, double offsetforward, double offsetside)
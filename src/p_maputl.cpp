@@ -333,6 +333,8 @@ void AActor::UnlinkFromWorld (FLinkContext *ctx)
 		// [RH] Unlink from all blocks this actor uses
 		FBlockNode *block = this->BlockNode;
 
+		if (block != NULL) Level->blockmap.linkgeneration++;
+
 		while (block != NULL)
 		{
 			if (block->NextActor != NULL)
@@ -494,12 +496,25 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 		// When a node is deleted, its sector links (the links starting
 		// at sector_t->touching_thinglist) are broken. When a node is
 		// added, new sector links are created.
-		touching_sectorlist = P_CreateSecNodeList(this, radius, ctx != nullptr? ctx->sector_list : nullptr, &sector_t::touching_thinglist);	// Attach to thing
-		if (renderradius >= 0) touching_rendersectors = P_CreateSecNodeList(this, MAX(radius, renderradius), ctx != nullptr ? ctx->render_list : nullptr, &sector_t::touching_renderthings);
+		// If the actor only moved within an area no line passes through, the lists
+		// it just got removed from still contain just its sector and can be reused.
+		if (ctx != nullptr && ctx->sector_list != nullptr && P_KeepSecNodeLists(this))
+		{
+			touching_sectorlist = ctx->sector_list;
+			touching_rendersectors = ctx->render_list;
+		}
 		else
 		{
-			touching_rendersectors = nullptr;
-			if (ctx != nullptr) P_DelSeclist(ctx->render_list, &sector_t::touching_renderthings);
+			touching_sectorlist = P_CreateSecNodeList(this, radius, ctx != nullptr? ctx->sector_list : nullptr, &sector_t::touching_thinglist);	// Attach to thing
+			if (renderradius >= 0) touching_rendersectors = P_CreateSecNodeList(this, MAX(radius, renderradius), ctx != nullptr ? ctx->render_list : nullptr, &sector_t::touching_renderthings);
+			else
+			{
+				touching_rendersectors = nullptr;
+				if (ctx != nullptr) P_DelSeclist(ctx->render_list, &sector_t::touching_renderthings);
+			}
+			// Spawned actors often never move, so only look for a free area when it gets relinked.
+			if (ctx != nullptr) P_FindSecNodeFreeArea(this);
+			else SecNodeSector = nullptr;
 		}
 	}
 
@@ -511,6 +526,7 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 
 		Level->CollectConnectedGroups(Sector->PortalGroup, Pos(), Top(), radius, check);
 
+		Level->blockmap.linkgeneration++;
 		BlockNode = NULL;
 		FBlockNode **alink = &this->BlockNode;
 		for (int i = -1; i < (int)check.Size(); i++)
@@ -1223,163 +1239,175 @@ void FPathTraverse::AddThingIntercepts (int bx, int by, FBlockThingsIterator &it
 	it.SwitchBlock(bx, by);
 	while ((thing = it.Next(compatible)))
 	{
-		int numfronts = 0;
-		divline_t line;
-		int i;
+		AddThingIntercept(thing, compatible);
+	}
+}
 
+//===========================================================================
+//
+// FPathTraverse :: AddThingIntercept
+//
+// Checks a single thing against the trace
+//
+//===========================================================================
 
-		if (!compatible)
-		{
-			// [RH] Don't check a corner to corner crossection for hit.
-			// Instead, check against the actual bounding box (but not if compatibility optioned.)
+void FPathTraverse::AddThingIntercept(AActor *thing, bool compatible)
+{
+	int numfronts = 0;
+	divline_t line;
+	int i;
 
-			// There's probably a smarter way to determine which two sides
-			// of the thing face the trace than by trying all four sides...
-			for (i = 0; i < 4; ++i)
+	if (!compatible)
+	{
+		// [RH] Don't check a corner to corner crossection for hit.
+		// Instead, check against the actual bounding box (but not if compatibility optioned.)
+
+		// There's probably a smarter way to determine which two sides
+		// of the thing face the trace than by trying all four sides...
+		for (i = 0; i < 4; ++i)
+		{
+			switch (i)
 			{
-				switch (i)
-				{
-				case 0:		// Top edge
-					line.y = thing->Y() + thing->radius;
-					if (trace.y < line.y) continue;
-					line.x = thing->X() + thing->radius;
-					line.dx = -thing->radius * 2;
-					line.dy = 0;
-					break;
-
-				case 1:		// Right edge
-					line.x = thing->X() + thing->radius;
-					if (trace.x < line.x) continue;
-					line.y = thing->Y() - thing->radius;
-					line.dx = 0;
-					line.dy = thing->radius * 2;
-					break;
-
-				case 2:		// Bottom edge
-					line.y = thing->Y() - thing->radius;
-					if (trace.y > line.y) continue;
-					line.x = thing->X() - thing->radius;
-					line.dx = thing->radius * 2;
-					line.dy = 0;
-					break;
-
-				case 3:		// Left edge
-					line.x = thing->X() - thing->radius;
-					if (trace.x > line.x) continue;
-					line.y = thing->Y() + thing->radius;
-					line.dx = 0;
-					line.dy = thing->radius * -2;
-					break;
-				}
-				// Check if this side is facing the trace origin
-				numfronts++;
+			case 0:		// Top edge
+				line.y = thing->Y() + thing->radius;
+				if (trace.y < line.y) continue;
+				line.x = thing->X() + thing->radius;
+				line.dx = -thing->radius * 2;
+				line.dy = 0;
+				break;
+
+			case 1:		// Right edge
+				line.x = thing->X() + thing->radius;
+				if (trace.x < line.x) continue;
+				line.y = thing->Y() - thing->radius;
+				line.dx = 0;
+				line.dy = thing->radius * 2;
+				break;
+
+			case 2:		// Bottom edge
+				line.y = thing->Y() - thing->radius;
+				if (trace.y > line.y) continue;
+				line.x = thing->X() - thing->radius;
+				line.dx = thing->radius * 2;
+				line.dy = 0;
+				break;
+
+			case 3:		// Left edge
+				line.x = thing->X() - thing->radius;
+				if (trace.x > line.x) continue;
+				line.y = thing->Y() + thing->radius;
+				line.dx = 0;
+				line.dy = thing->radius * -2;
+				break;
+			}
+			// Check if this side is facing the trace origin
+			numfronts++;
 
-				// If it is, see if the trace crosses it
-				if (P_PointOnDivlineSide (line.x, line.y, &trace) !=
-					P_PointOnDivlineSide (line.x + line.dx, line.y + line.dy, &trace))
-				{
-					// It's a hit
-					double frac = P_InterceptVector (&trace, &line);
-					if (frac < Startfrac)
-					{ // behind source
-						if (Startfrac > 0)
+			// If it is, see if the trace crosses it
+			if (P_PointOnDivlineSide (line.x, line.y, &trace) !=
+				P_PointOnDivlineSide (line.x + line.dx, line.y + line.dy, &trace))
+			{
+				// It's a hit
+				double frac = P_InterceptVector (&trace, &line);
+				if (frac < Startfrac)
+				{ // behind source
+					if (Startfrac > 0)
+					{
+						// check if the trace starts within this actor
+						switch (i)
 						{
-							// check if the trace starts within this actor
-							switch (i)
-							{
-							case 0:
-								line.y -= 2 * thing->radius;
-								break;
-
-							case 1:
-								line.x -= 2 * thing->radius;
-								break;
-
-							case 2:
-								line.y += 2 * thing->radius;
-								break;
-
-							case 3:
-								line.x += 2 * thing->radius;
-								break;
-							}
-							double frac2 = P_InterceptVector(&trace, &line);
-							if (frac2 >= Startfrac) goto addit;
+						case 0:
+							line.y -= 2 * thing->radius;
+							break;
+
+						case 1:
+							line.x -= 2 * thing->radius;
+							break;
+
+						case 2:
+							line.y += 2 * thing->radius;
+							break;
+
+						case 3:
+							line.x += 2 * thing->radius;
+							break;
 						}
-						continue;
+						double frac2 = P_InterceptVector(&trace, &line);
+						if (frac2 >= Startfrac) goto addit;
 					}
-				addit:
-					intercept_t newintercept;
-					newintercept.frac = frac;
-					newintercept.isaline = false;
-					newintercept.done = false;
-					newintercept.d.thing = thing;
-					intercepts.Push (newintercept);
-					break;
+					continue;
 				}
-			}
-
-			// If none of the sides was facing the trace, then the trace
-			// must have started inside the box, so add it as an intercept.
-			if (numfronts == 0)
-			{
+			addit:
 				intercept_t newintercept;
-				newintercept.frac = 0;
+				newintercept.frac = frac;
 				newintercept.isaline = false;
 				newintercept.done = false;
 				newintercept.d.thing = thing;
 				intercepts.Push (newintercept);
+				break;
 			}
 		}
+
+		// If none of the sides was facing the trace, then the trace
+		// must have started inside the box, so add it as an intercept.
+		if (numfronts == 0)
+		{
+			intercept_t newintercept;
+			newintercept.frac = 0;
+			newintercept.isaline = false;
+			newintercept.done = false;
+			newintercept.d.thing = thing;
+			intercepts.Push (newintercept);
+		}
+	}
+	else
+	{
+		// Old code for compatibility purposes
+		double 		x1, y1, x2, y2;
+		int 			s1, s2;
+		divline_t		dl;
+		double 		frac;
+			
+		bool tracepositive = (trace.dx * trace.dy)>0;
+					
+		// check a corner to corner crossection for hit
+		if (tracepositive)
+		{
+			x1 = thing->X() - thing->radius;
+			y1 = thing->Y() + thing->radius;
+					
+			x2 = thing->X() + thing->radius;
+			y2 = thing->Y() - thing->radius;					
+		}
 		else
 		{
-			// Old code for compatibility purposes
-			double 		x1, y1, x2, y2;
-			int 			s1, s2;
-			divline_t		dl;
-			double 		frac;
-				
-			bool tracepositive = (trace.dx * trace.dy)>0;
-						
-			// check a corner to corner crossection for hit
-			if (tracepositive)
-			{
-				x1 = thing->X() - thing->radius;
-				y1 = thing->Y() + thing->radius;
-						
-				x2 = thing->X() + thing->radius;
-				y2 = thing->Y() - thing->radius;					
-			}
-			else
-			{
-				x1 = thing->X() - thing->radius;
-				y1 = thing->Y() - thing->radius;
-						
-				x2 = thing->X() + thing->radius;
-				y2 = thing->Y() + thing->radius;					
-			}
+			x1 = thing->X() - thing->radius;
+			y1 = thing->Y() - thing->radius;
+					
+			x2 = thing->X() + thing->radius;
+			y2 = thing->Y() + thing->radius;					
+		}
+		
+		s1 = P_PointOnDivlineSide (x1, y1, &trace);
+		s2 = P_PointOnDivlineSide (x2, y2, &trace);
+
+		if (s1 != s2)
+		{
+			dl.x = x1;
+			dl.y = y1;
+			dl.dx = x2-x1;
+			dl.dy = y2-y1;
 			
-			s1 = P_PointOnDivlineSide (x1, y1, &trace);
-			s2 = P_PointOnDivlineSide (x2, y2, &trace);
+			frac = P_InterceptVector (&trace, &dl);
 
-			if (s1 != s2)
+			if (frac >= Startfrac)
 			{
-				dl.x = x1;
-				dl.y = y1;
-				dl.dx = x2-x1;
-				dl.dy = y2-y1;
-				
-				frac = P_InterceptVector (&trace, &dl);
-
-				if (frac >= Startfrac)
-				{
-					intercept_t newintercept;
-					newintercept.frac = frac;
-					newintercept.isaline = false;
-					newintercept.done = false;
-					newintercept.d.thing = thing;
-					intercepts.Push (newintercept);
-				}
+				intercept_t newintercept;
+				newintercept.frac = frac;
+				newintercept.isaline = false;
+				newintercept.done = false;
+				newintercept.d.thing = thing;
+				intercepts.Push (newintercept);
 			}
 		}
 	}
@@ -372,6 +372,7 @@ protected:
 
 	virtual void AddLineIntercepts(int bx, int by);
 	virtual void AddThingIntercepts(int bx, int by, FBlockThingsIterator &it, bool compatible);
+	void AddThingIntercept(AActor *thing, bool compatible);
 	FPathTraverse(FLevelLocals *l) 
 	{
 		Level = l;
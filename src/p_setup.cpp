@@ -292,6 +292,7 @@ void FLevelLocals::ClearLevelData()
 	ClearPortals();
 
 	tagManager.Clear();
+	SoundGraph.Clear();
 	ClearTIDHashes();
 	if (SpotState) SpotState->Destroy();
 	SpotState = nullptr;
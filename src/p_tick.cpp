@@ -125,6 +125,8 @@ void P_Ticker (void)
 		S_ResumeSound (false);
 
 	P_ResetSightCounters (false);
+	P_ResetNoiseCounters ();
+	P_ResetSecNodeCounters ();
 	R_ClearInterpolationPath();
 
 	// Since things will be moving, it's okay to interpolate them in the renderer.
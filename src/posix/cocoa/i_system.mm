@@ -36,6 +36,7 @@
 #include <fnmatch.h>
 #include <sys/sysctl.h>
 
+#include "c_console.h"
 #include "d_protocol.h"
 #include "doomdef.h"
 #include "doomerrors.h"
@@ -149,6 +150,7 @@ static void I_FatalError(const char* const error, va_list ap)
 		// Record error to log (if logging)
 		if (Logfile)
 		{
+			C_FlushLog();
 			fprintf(Logfile, "\n**** DIED WITH FATAL ERROR:\n%s\n", errortext);
 			fflush(Logfile);
 		}
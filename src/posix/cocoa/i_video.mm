@@ -52,6 +52,7 @@
 #include "gl/renderer/gl_renderer.h"
 #include "gl/system/gl_framebuffer.h"
 #include "gl/textures/gl_samplers.h"
+#include "hwrenderer/utility/hw_benchscene.h"
 
 
 @implementation NSWindow(ExitAppOnClose)
@@ -556,7 +557,10 @@ void I_ShutdownGraphics()
 
 void I_InitGraphics()
 {
-	Video = new CocoaVideo;
+	if (BenchScene_Active())
+		Video = BenchScene_CreateVideo();
+	else
+		Video = new CocoaVideo;
 	atterm(I_ShutdownGraphics);
 }
 
@@ -43,6 +43,7 @@
 #include "m_argv.h"
 #include "doomerrors.h"
 #include "swrenderer/r_swrenderer.h"
+#include "hwrenderer/utility/hw_benchscene.h"
 
 IVideo *Video;
 
@@ -65,6 +66,14 @@ void I_ShutdownGraphics ()
 
 void I_InitGraphics ()
 {
+	if (BenchScene_Active())
+	{
+		// Runs without a window, so there's no need for the video subsystem.
+		Video = BenchScene_CreateVideo();
+		atterm (I_ShutdownGraphics);
+		return;
+	}
+
 #ifdef __APPLE__
 	SDL_SetHint(SDL_HINT_VIDEO_MAC_FULLSCREEN_SPACES, "0");
 #endif // __APPLE__
@@ -142,6 +142,9 @@ static int DoomSpecificInfo (char *buffer, char *end)
 	int size = end-buffer-2;
 	int i, p;
 
+	// Get the log up to the crash into the file before anything else can go wrong.
+	C_FlushLog();
+
 	p = 0;
 	p += snprintf (buffer+p, size-p, GAMENAME" version %s (%s)\n", GetVersionString(), GetGitHash());
 #ifdef __VERSION__
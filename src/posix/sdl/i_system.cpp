@@ -51,6 +51,7 @@
 #include "d_net.h"
 #include "g_game.h"
 #include "c_dispatch.h"
+#include "c_console.h"
 
 #include "gameconfigfile.h"
 
@@ -198,8 +199,8 @@ void I_FatalError (const char *error, va_list ap)
 		// Record error to log (if logging)
 		if (Logfile)
 		{
-			fprintf (Logfile, "\n**** DIED WITH FATAL ERROR:\n%s\n", errortext);
-			fflush (Logfile);
+			C_FlushLog();
+			C_WriteLog(FStringf("\n**** DIED WITH FATAL ERROR:\n%s\n", errortext));
 		}
 //		throw CFatalError (errortext);
 		fprintf (stderr, "%s\n", errortext);
@@ -52,6 +52,7 @@
 #include "gl/renderer/gl_renderer.h"
 #include "gl/system/gl_framebuffer.h"
 #include "gl/shaders/gl_shader.h"
+#include "hwrenderer/utility/hw_benchscene.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -420,6 +421,8 @@ void ProcessSDLWindowEvent(const SDL_WindowEvent &event)
 // each platform has its own specific version of this function.
 void I_SetWindowTitle(const char* caption)
 {
+	if (BenchScene_Active()) return;	// runs without a window
+
 	auto window = static_cast<SystemGLFrameBuffer *>(screen)->GetSDLWindow();
 	if (caption)
 		SDL_SetWindowTitle(window, caption);
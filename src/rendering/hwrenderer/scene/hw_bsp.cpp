@@ -35,20 +35,30 @@
 #include "ctpl.h"
 #include "hwrenderer/scene/hw_fakeflat.h"
 #include "hwrenderer/scene/hw_clipper.h"
+#include "hwrenderer/scene/hw_coverage.h"
 #include "hwrenderer/scene/hw_drawstructs.h"
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "hwrenderer/scene/hw_portal.h"
 #include "hwrenderer/utility/hw_clock.h"
 #include "hwrenderer/data/flatvertices.h"
 
+#include <thread>
+
 #ifdef ARCH_IA32
 #include <immintrin.h>
 #endif // ARCH_IA32
 
 CVAR(Bool, gl_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CUSTOM_CVAR(Int, gl_multithread_workers, MAX_BSP_WORKERS, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 1) self = 1;
+	else if (self > MAX_BSP_WORKERS) self = MAX_BSP_WORKERS;
+}
 
 thread_local bool isWorkerThread;
-ctpl::thread_pool renderPool(1);
+thread_local HWWorkerDrawLists *workerDrawLists;
+HWWorkerDrawLists WorkerDrawLists[MAX_BSP_WORKERS];
+ctpl::thread_pool renderPool(MAX_BSP_WORKERS);
 bool inited = false;
 
 struct RenderJob
@@ -68,11 +78,36 @@ struct RenderJob
 	seg_t *seg;
 };
 
+//==========================================================================
+//
+// Which worker processes a job type, by number of workers.
+// Walls and portal jobs both modify the portal list and the render hack
+// data, so they have to stay on one thread, and so do the sprite jobs,
+// because things are only processed once per frame by checking their
+// validcount. Everything else a job writes to outside the draw lists is
+// owned by a single job type.
+//
+//==========================================================================
+
+static const uint8_t JobWorker[MAX_BSP_WORKERS][RenderJob::TerminateJob] =
+{
+	// Flat, Wall, Sprite, Particle, Portal
+	{ 0, 0, 0, 0, 0 },
+	{ 1, 0, 1, 1, 0 },
+	{ 1, 0, 2, 2, 0 },
+};
+
+//==========================================================================
+//
+// Filled by the BSP traversal only. Every worker walks the entire queue
+// with its own read index and skips the jobs of the others, so there is
+// no contention between the consumers.
+//
+//==========================================================================
 
 class RenderJobQueue
 {
 	RenderJob pool[300000];	// Way more than ever needed. The largest ever seen on a single viewpoint is around 40000.
-	std::atomic<int> readindex{};
 	std::atomic<int> writeindex{};
 public:
 	void AddJob(int type, subsector_t *sub, seg_t *seg = nullptr)
@@ -83,7 +118,7 @@ public:
 		writeindex++;	// update index only after the value has been written.
 	}
 
-	RenderJob *GetJob()
+	RenderJob *GetJob(int &readindex)
 	{
 		if (readindex < writeindex) return &pool[readindex++];
 		return nullptr;
@@ -91,45 +126,71 @@ public:
 	
 	void ReleaseAll()
 	{
-		readindex = 0;
 		writeindex = 0;
 	}
 };
 
 static RenderJobQueue jobQueue;	// One static queue is sufficient here. This code will never be called recursively.
 
-void HWDrawInfo::WorkerThread()
+//==========================================================================
+//
+// The queue is empty. Yielding right away would be too costly and possibly
+// cause further delays down the line if the thread is halted, so spin for
+// a short while first. If the main thread still has nothing, it is busy
+// clipping and there is no point in keeping a core blocked.
+//
+//==========================================================================
+
+static void WaitForJob(int &spins)
+{
+	if (spins < 64)
+	{
+		spins++;
+#ifdef ARCH_IA32
+		for (int i = 0; i < 10; i++) _mm_pause();
+#endif // ARCH_IA32
+	}
+	else
+	{
+		std::this_thread::yield();
+	}
+}
+
+void HWDrawInfo::WorkerThread(int worker, int numworkers)
 {
 	sector_t *front, *back;
+	int readindex = 0;
+	int spins = 0;
 
-	WTTotal.Clock();
+	// All workers run at the same time, so only the first one gets to measure.
+	if (worker == 0) WTTotal.Clock();
 	isWorkerThread = true;	// for adding asserts in GL API code. The worker thread may never call any GL API.
+	workerDrawLists = numworkers > 1 ? &WorkerDrawLists[worker] : nullptr;
+	RenderDataArena = &WorkerDrawLists[worker].allocator;
 	while (true)
 	{
-		auto job = jobQueue.GetJob();
+		auto job = jobQueue.GetJob(readindex);
 		if (job == nullptr)
 		{
-#ifdef ARCH_IA32
-			// The queue is empty. But yielding would be too costly here and possibly cause further delays down the line if the thread is halted.
-			// So instead add a few pause instructions and retry immediately.
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-#endif // ARCH_IA32
+			WaitForJob(spins);
+			continue;
+		}
+		spins = 0;
+		if (job->type != RenderJob::TerminateJob && JobWorker[numworkers - 1][job->type] != worker)
+		{
+			continue;
+		}
+		if (workerDrawLists != nullptr)
+		{
+			workerDrawLists->currentjob = readindex - 1;
 		}
+
 		// Note that the main thread MUST have prepared the fake sectors that get used below!
 		// This worker thread cannot prepare them itself without costly synchronization.
-		else switch (job->type)
+		switch (job->type)
 		{
 		case RenderJob::TerminateJob:
-			WTTotal.Unclock();
+			if (worker == 0) WTTotal.Unclock();
 			return;
 
 		case RenderJob::WallJob:
@@ -309,6 +370,10 @@ void HWDrawInfo::AddLine (seg_t *seg, bool portalclip)
 			{
 				clipper.SafeAddClipRange(startAngle, endAngle);
 			}
+			else if (mCoverage)
+			{
+				mCoverage->AddLine(seg, startAngle, endAngle, currentsector, backsector);
+			}
 		}
 	}
 	else 
@@ -645,7 +710,9 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		}
 	}
 
-	AddLines(sub, fakesector);
+	// Subsectors hidden behind partial walls only need to get their things processed.
+	bool occluded = mCoverage != nullptr && !mCoverage->CheckSubsector(sub);
+	if (!occluded) AddLines(sub, fakesector);
 
 	// BSP is traversed by subsector.
 	// A sector might have been split into several
@@ -672,7 +739,7 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		}
 	}
 
-	if (gl_render_flats)
+	if (gl_render_flats && !occluded)
 	{
 		// Subsectors with only 2 lines cannot have any area
 		if (sub->numlines>2 || (sub->hacked&1)) 
@@ -785,7 +852,7 @@ void HWDrawInfo::RenderBSPNode (void *node)
 		side ^= 1;
 
 		// It is not necessary to use the slower precise version here
-		if (!mClipper->CheckBox(bsp->bbox[side]))
+		if (!mClipper->CheckBox(bsp->bbox[side]) || (mCoverage && !mCoverage->CheckNode(bsp->bbox[side])))
 		{
 			if (!(no_renderflags[bsp->Index()] & SSRF_SEEN))
 				return;
@@ -796,6 +863,61 @@ void HWDrawInfo::RenderBSPNode (void *node)
 	DoSubsector ((subsector_t *)((uint8_t *)node - 1));
 }
 
+//==========================================================================
+//
+// Appends the workers' draw items to the draw lists in the order of the
+// jobs that produced them.
+//
+//==========================================================================
+
+void HWDrawInfo::MergeWorkerDrawLists(int numworkers)
+{
+	for (int list = 0; list < GLDL_TYPES; list++)
+	{
+		auto &dest = drawlists[list];
+		unsigned pos[MAX_BSP_WORKERS] = {};
+
+		while (true)
+		{
+			// Each worker's items are already sorted by job and no job is processed by more than one worker.
+			int worker = -1;
+			unsigned job = UINT_MAX;
+			for (int i = 0; i < numworkers; i++)
+			{
+				auto &jobs = WorkerDrawLists[i].jobs[list];
+				if (pos[i] < jobs.Size() && jobs[pos[i]] < job)
+				{
+					job = jobs[pos[i]];
+					worker = i;
+				}
+			}
+			if (worker < 0) break;
+
+			auto &src = WorkerDrawLists[worker].drawlists[list];
+			auto &item = src.drawitems[pos[worker]++];
+			switch (item.rendertype)
+			{
+			case GLDIT_WALL:
+				dest.drawitems.Push(GLDrawItem(GLDIT_WALL, dest.walls.Push(src.walls[item.index])));
+				break;
+
+			case GLDIT_FLAT:
+				dest.drawitems.Push(GLDrawItem(GLDIT_FLAT, dest.flats.Push(src.flats[item.index])));
+				break;
+
+			case GLDIT_SPRITE:
+				dest.drawitems.Push(GLDrawItem(GLDIT_SPRITE, dest.sprites.Push(src.sprites[item.index])));
+				break;
+			}
+		}
+		for (int i = 0; i < numworkers; i++)
+		{
+			WorkerDrawLists[i].drawlists[list].Reset();
+			WorkerDrawLists[i].jobs[list].Clear();
+		}
+	}
+}
+
 void HWDrawInfo::RenderBSP(void *node)
 {
 	Bsp.Clock();
@@ -806,26 +928,44 @@ void HWDrawInfo::RenderBSP(void *node)
 
 	validcount++;	// used for processing sidedefs only once by the renderer.
 
+	// The coverage buffer depends on an uninterrupted front to back traversal from inside the level.
+	mCoverage = (mCurrentPortal == nullptr && mClipPortal == nullptr) ? HWCoverage::Start(mClipper, Viewpoint) : nullptr;
+
 	multithread = gl_multithread;
 	if (multithread)
 	{
+		static const int maxworkers = MAX((int)std::thread::hardware_concurrency() - 1, 1);
+		int numworkers = MIN(*gl_multithread_workers, maxworkers);
+		std::future<void> futures[MAX_BSP_WORKERS];
+
 		jobQueue.ReleaseAll();
-		auto future = renderPool.push([&](int id) {
-			WorkerThread();
-		});
+		for (int i = 0; i < numworkers; i++)
+		{
+			futures[i] = renderPool.push([=](int id) {
+				WorkerThread(i, numworkers);
+			});
+		}
 		RenderBSPNode(node);
 
 		jobQueue.AddJob(RenderJob::TerminateJob, nullptr, nullptr);
 		Bsp.Unclock();
 		MTWait.Clock();
-		future.wait();
+		for (int i = 0; i < numworkers; i++)
+		{
+			futures[i].wait();
+		}
 		MTWait.Unclock();
+		if (numworkers > 1)
+		{
+			MergeWorkerDrawLists(numworkers);
+		}
 	}
 	else
 	{
 		RenderBSPNode(node);
 		Bsp.Unclock();
 	}
+	mCoverage = nullptr;
 	// Process all the sprites on the current portal's back side which touch the portal.
 	if (mCurrentPortal != nullptr) mCurrentPortal->RenderAttached(this);
 
@@ -418,10 +418,8 @@ angle_t Clipper::PointToPseudoAngle(double x, double y)
 	  {2,1,3,0}
 	};
 
-bool Clipper::CheckBox(const float *bspcoord) 
+bool Clipper::GetBoxAngles(const float *bspcoord, angle_t &startAngle, angle_t &endAngle)
 {
-	angle_t angle1, angle2;
-
 	int        boxpos;
 	const uint8_t* check;
 	
@@ -431,12 +429,19 @@ bool Clipper::CheckBox(const float *bspcoord)
 	boxpos = (vp->Pos.X <= bspcoord[BOXLEFT] ? 0 : vp->Pos.X < bspcoord[BOXRIGHT ] ? 1 : 2) +
 		(vp->Pos.Y >= bspcoord[BOXTOP ] ? 0 : vp->Pos.Y > bspcoord[BOXBOTTOM] ? 4 : 8);
 	
-	if (boxpos == 5) return true;
+	if (boxpos == 5) return false;
 	
 	check = checkcoord[boxpos];
-	angle1 = PointToPseudoAngle (bspcoord[check[0]], bspcoord[check[1]]);
-	angle2 = PointToPseudoAngle (bspcoord[check[2]], bspcoord[check[3]]);
-	
-	return SafeCheckRange(angle2, angle1);
+	endAngle = PointToPseudoAngle (bspcoord[check[0]], bspcoord[check[1]]);
+	startAngle = PointToPseudoAngle (bspcoord[check[2]], bspcoord[check[3]]);
+	return true;
+}
+
+bool Clipper::CheckBox(const float *bspcoord) 
+{
+	angle_t startAngle, endAngle;
+
+	if (!GetBoxAngles(bspcoord, startAngle, endAngle)) return true;
+	return SafeCheckRange(startAngle, endAngle);
 }
 
@@ -150,6 +150,7 @@ public:
     angle_t PointToPseudoAngle(double x, double y);
 
 	bool CheckBox(const float *bspcoord);
+	bool GetBoxAngles(const float *bspcoord, angle_t &startAngle, angle_t &endAngle);	// returns false if the viewpoint is inside the box
 
 	// Used to speed up angle calculations during clipping
 	inline angle_t GetClipAngle(vertex_t *v)
@@ -0,0 +1,350 @@
+/*
+** hw_coverage.cpp
+** Occlusion culling by partial walls
+**
+** Each column of the buffer is a narrow wedge of directions around the
+** viewer. When the BSP traversal passes a two-sided line, every ray in the
+** columns completely covered by it must get through the line's opening, so
+** the column's visible slope range can be narrowed to that opening. The
+** bounds are computed conservatively from the nearest and farthest points
+** of the line. Anything that lets rays pass over a ceiling or below a floor
+** (sky, plane portals, missing or masked upper and lower textures, height
+** transfers, line portals) opens the affected columns for good.
+**
+** Subsectors whose contents fall outside the visible slope range in all
+** columns they span are not processed. Their things and particles are
+** still handled because sprites can extend beyond their sector.
+**
+** The buffer is off by default and enabled with gl_coverage 1.
+** gl_coverage 2 runs the buffer but culls nothing, so the stat shows how
+** much it would discard beyond what the Clipper already does.
+**
+*/
+
+#include <float.h>
+#include "r_defs.h"
+#include "r_sky.h"
+#include "r_utility.h"
+#include "p_lnspec.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "textures/textures.h"
+#include "g_shared/p_3dfloors.h"
+#include "hw_coverage.h"
+#include "hw_clipper.h"
+
+CVAR(Int, gl_coverage, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+static HWCoverage staticCoverage;	// like the clipper, only one scene is processed at a time.
+
+//==========================================================================
+//
+// Returns the coverage buffer for the main scene or null if it cannot
+// be used from the current viewpoint.
+//
+//==========================================================================
+
+HWCoverage *HWCoverage::Start(Clipper *clipper, const FRenderViewpoint &vp)
+{
+	if (gl_coverage <= 0) return nullptr;
+
+	// The slope ranges are only meaningful if the viewer is inside the space
+	// its sector encloses.
+	sector_t *sec = vp.sector;
+	if (sec == nullptr || sec->GetHeightSec()) return nullptr;
+	if (vp.Pos.Z > sec->ceilingplane.ZatPoint(vp.Pos) || vp.Pos.Z < sec->floorplane.ZatPoint(vp.Pos)) return nullptr;
+
+	auto cov = &staticCoverage;
+	cov->clipper = clipper;
+	cov->viewpos = vp.Pos;
+	cov->cull = gl_coverage == 1;
+	cov->Clear();
+	return cov;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void HWCoverage::Clear()
+{
+	for (int i = 0; i < NUM_COLUMNS; i++)
+	{
+		lo[i] = -FLT_MAX;
+		hi[i] = FLT_MAX;
+		bottomopen[i] = FLT_MAX;
+		topopen[i] = -FLT_MAX;
+	}
+	checkedSubsectors = culledSubsectors = culledNodes = 0;
+}
+
+//==========================================================================
+//
+// Marks all columns that overlap the range as no longer bounded
+//
+//==========================================================================
+
+void HWCoverage::OpenRange(angle_t start, angle_t end, bool top, bool bottom)
+{
+	unsigned first = start >> COLUMN_SHIFT;
+	unsigned last = end >> COLUMN_SHIFT;
+	for (unsigned i = first; i <= last; i++)
+	{
+		if (top) topopen[i] = FLT_MAX;
+		if (bottom) bottomopen[i] = -FLT_MAX;
+	}
+}
+
+//==========================================================================
+//
+// Narrows all columns that lie completely inside the range.
+// Columns that were opened before keep their range.
+//
+//==========================================================================
+
+void HWCoverage::NarrowRange(angle_t start, angle_t end, float bottom, float top)
+{
+	unsigned first = unsigned((uint64_t(start) + (1u << COLUMN_SHIFT) - 1) >> COLUMN_SHIFT);
+	unsigned last = unsigned((uint64_t(end) + 1) >> COLUMN_SHIFT);
+	for (unsigned i = first; i < last; i++)
+	{
+		lo[i] = MAX(lo[i], MIN(bottom, bottomopen[i]));
+		hi[i] = MIN(hi[i], MAX(top, topopen[i]));
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool HWCoverage::IsRangeVisible(angle_t start, angle_t end, float bottom, float top)
+{
+	unsigned first = start >> COLUMN_SHIFT;
+	unsigned last = end >> COLUMN_SHIFT;
+	for (unsigned i = first; i <= last; i++)
+	{
+		if (lo[i] < hi[i] && lo[i] <= top && hi[i] >= bottom) return true;
+	}
+	return false;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static bool IsOpenPlane(sector_t *sec, int plane)
+{
+	return sec->GetTexture(plane) == skyflatnum || sec->Portals[plane] != 0;
+}
+
+static bool IsSolidTexture(side_t *side, int part)
+{
+	FTexture *tex = TexMan.GetTexture(side->GetTexture(part), true);
+	return tex != nullptr && tex->isValid() && !tex->isMasked();
+}
+
+//==========================================================================
+//
+// Called for every visible, front facing two-sided line whose sides
+// belong to different sectors.
+//
+//==========================================================================
+
+void HWCoverage::AddLine(seg_t *seg, angle_t startAngle, angle_t endAngle, sector_t *frontsector, sector_t *backsector)
+{
+	line_t *line = seg->linedef;
+	if (line->isVisualPortal() || line->special == Line_Horizon || seg->frontsector->GetHeightSec() || seg->backsector->GetHeightSec())
+	{
+		Open(startAngle, endAngle, true, true);
+		return;
+	}
+
+	double fc1 = frontsector->ceilingplane.ZatPoint(seg->v1);
+	double fc2 = frontsector->ceilingplane.ZatPoint(seg->v2);
+	double ff1 = frontsector->floorplane.ZatPoint(seg->v1);
+	double ff2 = frontsector->floorplane.ZatPoint(seg->v2);
+	double bc1 = backsector->ceilingplane.ZatPoint(seg->v1);
+	double bc2 = backsector->ceilingplane.ZatPoint(seg->v2);
+	double bf1 = backsector->floorplane.ZatPoint(seg->v1);
+	double bf2 = backsector->floorplane.ZatPoint(seg->v2);
+
+	// Rays that pass the opening may still leave through a sky or portal in the back sector.
+	bool opentop = IsOpenPlane(frontsector, sector_t::ceiling) || IsOpenPlane(backsector, sector_t::ceiling) ||
+		((bc1 < fc1 || bc2 < fc2) && !IsSolidTexture(seg->sidedef, side_t::top));
+	bool openbottom = IsOpenPlane(frontsector, sector_t::floor) || IsOpenPlane(backsector, sector_t::floor) ||
+		((bf1 > ff1 || bf2 > ff2) && !IsSolidTexture(seg->sidedef, side_t::bottom));
+
+	if (opentop || openbottom)
+	{
+		Open(startAngle, endAngle, opentop, openbottom);
+		if (opentop && openbottom) return;
+	}
+
+	// Distance range of the line from the viewer.
+	DVector2 v1 = seg->v1->fPos() - viewpos.XY();
+	DVector2 delta = seg->v2->fPos() - seg->v1->fPos();
+	double len = delta.LengthSquared();
+	double t = len > 0 ? clamp(-(v1 | delta) / len, 0., 1.) : 0.;
+	double dmin = (v1 + delta * t).Length();
+	if (dmin < 1) return;	// too close to give any usable range.
+	double dmax = MAX(v1.Length(), (v1 + delta).Length());
+
+	float top = FLT_MAX, bottom = -FLT_MAX;
+	if (!opentop)
+	{
+		double z = MIN(MAX(fc1, fc2), MAX(bc1, bc2)) - viewpos.Z;
+		top = float(z / (z >= 0 ? dmin : dmax));
+	}
+	if (!openbottom)
+	{
+		double z = MAX(MIN(ff1, ff2), MIN(bf1, bf2)) - viewpos.Z;
+		bottom = float(z / (z <= 0 ? dmin : dmax));
+	}
+	Narrow(startAngle, endAngle, bottom, top);
+}
+
+//==========================================================================
+//
+// Checks whether anything between the heights inside the box may be visible.
+//
+//==========================================================================
+
+bool HWCoverage::CheckBox(const float *bbox, double bottom, double top)
+{
+	angle_t startAngle, endAngle;
+	if (!clipper->GetBoxAngles(bbox, startAngle, endAngle)) return true;
+
+	double dx = MAX(MAX(bbox[BOXLEFT] - viewpos.X, viewpos.X - bbox[BOXRIGHT]), 0.);
+	double dy = MAX(MAX(bbox[BOXBOTTOM] - viewpos.Y, viewpos.Y - bbox[BOXTOP]), 0.);
+	double dmin = sqrt(dx * dx + dy * dy);
+	if (dmin < 1) return true;
+	double fx = MAX(fabs(bbox[BOXLEFT] - viewpos.X), fabs(bbox[BOXRIGHT] - viewpos.X));
+	double fy = MAX(fabs(bbox[BOXBOTTOM] - viewpos.Y), fabs(bbox[BOXTOP] - viewpos.Y));
+	double dmax = sqrt(fx * fx + fy * fy);
+
+	float ftop = FLT_MAX, fbottom = -FLT_MAX;
+	if (top < FLT_MAX)
+	{
+		double z = top - viewpos.Z;
+		ftop = float(z / (z >= 0 ? dmin : dmax));
+	}
+	if (bottom > -FLT_MAX)
+	{
+		double z = bottom - viewpos.Z;
+		fbottom = float(z / (z <= 0 ? dmin : dmax));
+	}
+
+	if (startAngle > endAngle)
+	{
+		return IsRangeVisible(startAngle, ANGLE_MAX, fbottom, ftop) || IsRangeVisible(0, endAngle, fbottom, ftop);
+	}
+	return IsRangeVisible(startAngle, endAngle, fbottom, ftop);
+}
+
+//==========================================================================
+//
+// A node is hidden if all the columns it spans are closed.
+//
+//==========================================================================
+
+bool HWCoverage::CheckNode(const float *bbox)
+{
+	if (CheckBox(bbox, -FLT_MAX, FLT_MAX)) return true;
+	culledNodes++;
+	return !cull;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void PlaneRange(const secplane_t &plane, const float *bbox, double &bottom, double &top)
+{
+	if (!plane.isSlope())
+	{
+		double z = plane.ZatPoint(0., 0.);
+		bottom = MIN(bottom, z);
+		top = MAX(top, z);
+		return;
+	}
+	static const int corners[4][2] = { { BOXLEFT, BOXTOP }, { BOXRIGHT, BOXTOP }, { BOXLEFT, BOXBOTTOM }, { BOXRIGHT, BOXBOTTOM } };
+	for (auto &c : corners)
+	{
+		double z = plane.ZatPoint(bbox[c[0]], bbox[c[1]]);
+		bottom = MIN(bottom, z);
+		top = MAX(top, z);
+	}
+}
+
+static void SectorRange(sector_t *sec, const float *bbox, double &bottom, double &top)
+{
+	PlaneRange(sec->floorplane, bbox, bottom, top);
+	PlaneRange(sec->ceilingplane, bbox, bottom, top);
+	for (auto ff : sec->e->XFloor.ffloors)
+	{
+		PlaneRange(*ff->top.plane, bbox, bottom, top);
+		PlaneRange(*ff->bottom.plane, bbox, bottom, top);
+	}
+}
+
+//==========================================================================
+//
+// A subsector is hidden if its walls, planes and 3D floors lie outside
+// the visible slope range of all the columns it spans.
+//
+//==========================================================================
+
+bool HWCoverage::CheckSubsector(subsector_t *sub)
+{
+	sector_t *sector = sub->sector;
+	if (sub->hacked || sub->polys != nullptr || sector->GetHeightSec() || sub->render_sector != sector) return true;
+
+	float bbox[4] = { -FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX };	// top, bottom, left, right
+	seg_t *seg = sub->firstline;
+	for (uint32_t i = 0; i < sub->numlines; i++, seg++)
+	{
+		if (seg->linedef != nullptr && (seg->linedef->isVisualPortal() || seg->linedef->special == Line_Horizon)) return true;
+		float x = (float)seg->v1->fX(), y = (float)seg->v1->fY();
+		bbox[BOXTOP] = MAX(bbox[BOXTOP], y);
+		bbox[BOXBOTTOM] = MIN(bbox[BOXBOTTOM], y);
+		bbox[BOXLEFT] = MIN(bbox[BOXLEFT], x);
+		bbox[BOXRIGHT] = MAX(bbox[BOXRIGHT], x);
+	}
+
+	// The walls of the subsector's lines may reach up and down to the back sectors' planes.
+	double bottom = FLT_MAX, top = -FLT_MAX;
+	SectorRange(sector, bbox, bottom, top);
+	seg = sub->firstline;
+	for (uint32_t i = 0; i < sub->numlines; i++, seg++)
+	{
+		if (seg->backsector != nullptr && seg->backsector != sector) SectorRange(seg->backsector, bbox, bottom, top);
+	}
+	if (IsOpenPlane(sector, sector_t::ceiling)) top = FLT_MAX;
+	if (IsOpenPlane(sector, sector_t::floor)) bottom = -FLT_MAX;
+
+	checkedSubsectors++;
+	if (CheckBox(bbox, bottom, top)) return true;
+	culledSubsectors++;
+	return !cull;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ADD_STAT(coverage)
+{
+	auto &cov = staticCoverage;
+	return FStringf("Coverage%s: %d of %d subsectors, %d nodes hidden", gl_coverage == 2 ? " (compare)" : "",
+		cov.culledSubsectors, cov.checkedSubsectors, cov.culledNodes);
+}
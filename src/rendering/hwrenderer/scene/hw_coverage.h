@@ -0,0 +1,86 @@
+#pragma once
+
+#include "doomtype.h"
+#include "vectors.h"
+
+class Clipper;
+struct FRenderViewpoint;
+struct seg_t;
+struct subsector_t;
+struct sector_t;
+
+//==========================================================================
+//
+// Coverage buffer
+//
+// Splits the pseudo-angle circle around the viewer into fixed columns and
+// keeps for each of them the range of slopes (height above the eye divided
+// by distance) that view rays can still pass through after all the
+// two-sided lines processed so far. Where the Clipper can only discard
+// what lies behind fully closed walls this also catches everything that
+// is hidden behind steps, windows and other partial walls.
+//
+// Everything here only works for the main scene because it relies on the
+// BSP being traversed front to back from a viewpoint inside the level.
+//
+//==========================================================================
+
+class HWCoverage
+{
+public:
+	enum
+	{
+		COLUMN_BITS = 12,
+		NUM_COLUMNS = 1 << COLUMN_BITS,
+		COLUMN_SHIFT = 32 - COLUMN_BITS,
+	};
+
+private:
+	// Kept as separate arrays so that the per-column loops vectorize.
+	float lo[NUM_COLUMNS];			// lowest slope that can still be seen
+	float hi[NUM_COLUMNS];			// highest slope that can still be seen
+	float bottomopen[NUM_COLUMNS];	// -FLT_MAX if rays may already have passed below a floor
+	float topopen[NUM_COLUMNS];		// FLT_MAX if rays may already have passed above a ceiling
+
+	Clipper *clipper;
+	DVector3 viewpos;
+	bool cull;
+
+	void OpenRange(angle_t start, angle_t end, bool top, bool bottom);
+	void NarrowRange(angle_t start, angle_t end, float bottom, float top);
+	bool IsRangeVisible(angle_t start, angle_t end, float bottom, float top);
+
+	void Open(angle_t startAngle, angle_t endAngle, bool top, bool bottom)
+	{
+		if (startAngle > endAngle)
+		{
+			OpenRange(startAngle, ANGLE_MAX, top, bottom);
+			OpenRange(0, endAngle, top, bottom);
+		}
+		else OpenRange(startAngle, endAngle, top, bottom);
+	}
+
+	void Narrow(angle_t startAngle, angle_t endAngle, float bottom, float top)
+	{
+		if (startAngle > endAngle)
+		{
+			NarrowRange(startAngle, ANGLE_MAX, bottom, top);
+			NarrowRange(0, endAngle, bottom, top);
+		}
+		else NarrowRange(startAngle, endAngle, bottom, top);
+	}
+
+	void Clear();
+	bool CheckBox(const float *bbox, double bottom, double top);
+
+public:
+	int checkedSubsectors;
+	int culledSubsectors;
+	int culledNodes;
+
+	static HWCoverage *Start(Clipper *clipper, const FRenderViewpoint &vp);
+
+	void AddLine(seg_t *seg, angle_t startAngle, angle_t endAngle, sector_t *frontsector, sector_t *backsector);
+	bool CheckNode(const float *bbox);
+	bool CheckSubsector(subsector_t *sub);
+};
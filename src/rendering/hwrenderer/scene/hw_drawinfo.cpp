@@ -408,7 +408,7 @@ void HWViewpointUniforms::SetDefaults()
 
 GLDecal *HWDrawInfo::AddDecal(bool onmirror)
 {
-	auto decal = (GLDecal*)RenderDataAllocator.Alloc(sizeof(GLDecal));
+	auto decal = (GLDecal*)RenderDataArena->Alloc(sizeof(GLDecal));
 	Decals[onmirror ? 1 : 0].Push(decal);
 	return decal;
 }
@@ -474,11 +474,13 @@ void HWDrawInfo::RenderScene(FRenderState &state)
 
 	if (gl_sort_textures)
 	{
+		SortLists.Clock();
 		drawlists[GLDL_PLAINWALLS].SortWalls();
 		drawlists[GLDL_PLAINFLATS].SortFlats();
 		drawlists[GLDL_MASKEDWALLS].SortWalls();
 		drawlists[GLDL_MASKEDFLATS].SortFlats();
 		drawlists[GLDL_MASKEDWALLSOFS].SortWalls();
+		SortLists.Unclock();
 	}
 
 	// Part 1: solid geometry. This is set up so that there are no transparent parts
@@ -30,6 +30,7 @@ struct particle_t;
 struct FDynLightData;
 struct HUDSprite;
 class Clipper;
+class HWCoverage;
 class HWPortal;
 class FFlatVertexBuffer;
 class IRenderQueue;
@@ -94,6 +95,29 @@ enum DrawListType
 	GLDL_TYPES,
 };
 
+enum
+{
+	MAX_BSP_WORKERS = 3
+};
+
+//==========================================================================
+//
+// Draw items produced by one of the BSP worker threads. These get merged
+// into the draw info's lists in job order after the traversal, so the
+// result is the same as if a single thread had processed all jobs.
+//
+//==========================================================================
+
+struct HWWorkerDrawLists
+{
+	HWDrawList drawlists[GLDL_TYPES];
+	TArray<unsigned> jobs[GLDL_TYPES];	// the job that produced each draw item
+	unsigned currentjob;
+	FMemArena allocator{ 1024 * 1024 };
+};
+
+extern HWWorkerDrawLists WorkerDrawLists[MAX_BSP_WORKERS];
+
 
 struct HWDrawInfo
 {
@@ -145,6 +169,7 @@ struct HWDrawInfo
 	HWPortal *mCurrentPortal;
 	//FRotator mAngles;
 	Clipper *mClipper;
+	HWCoverage *mCoverage = nullptr;	// only set while the main scene's BSP is traversed
 	FRenderViewpoint Viewpoint;
 	HWViewpointUniforms VPUniforms;	// per-viewpoint uniform state
 	TArray<HWPortal *> Portals;
@@ -190,7 +215,9 @@ private:
 	subsector_t *currentsubsector;	// used by the line processing code.
 	sector_t *currentsector;
 
-	void WorkerThread();
+	void WorkerThread(int worker, int numworkers);
+	void MergeWorkerDrawLists(int numworkers);
+	HWDrawList &GetDrawList(int list);
 
 	void UnclipSubsector(subsector_t *sub);
 	
@@ -30,19 +30,23 @@
 #include "doomstat.h"
 #include "actor.h"
 #include "g_levellocals.h"
+#include "p_lnspec.h"
 #include "hwrenderer/scene/hw_drawstructs.h"
 #include "hwrenderer/scene/hw_drawlist.h"
 #include "hwrenderer/data/flatvertices.h"
 #include "hwrenderer/utility/hw_clock.h"
+#include "hwrenderer/textures/hw_material.h"
 #include "hw_renderstate.h"
 #include "hw_drawinfo.h"
 #include "hw_fakeflat.h"
 
 FMemArena RenderDataAllocator(1024*1024);	// Use large blocks to reduce allocation time.
+thread_local FMemArena *RenderDataArena = &RenderDataAllocator;	// BSP worker threads use their own.
 
 void ResetRenderDataAllocator()
 {
 	RenderDataAllocator.FreeAll();
+	for (auto &worker : WorkerDrawLists) worker.allocator.FreeAll();
 }
 
 //==========================================================================
@@ -710,23 +714,89 @@ void HWDrawList::Sort(HWDrawInfo *di)
 
 //==========================================================================
 //
-// Sorting the drawitems first by texture and then by light level
+// Sorting the drawitems by material
+//
+// Every item gets a 64 bit key with the material in the upper half and
+// the remaining material state in the lower half. A stable radix sort
+// on these keys keeps items that share a material in the order the BSP
+// traversal added them, i.e. roughly front to back.
 //
 //==========================================================================
 
-void HWDrawList::SortWalls()
+struct SortKeyItem
 {
-	if (drawitems.Size() > 1)
+	uint64_t key;
+	GLDrawItemType rendertype;
+	int index;
+};
+
+static TArray<SortKeyItem> SortKeys, SortTemp;	// only the main thread sorts.
+
+static inline uint64_t MaterialSortKey(FMaterial *mat, unsigned state)
+{
+	return (uint64_t(mat ? mat->GetSortIndex() : 0) << 32) | state;
+}
+
+//==========================================================================
+//
+// LSD radix sort with 8 bit digits. Digits that are the same for all items
+// get skipped, which with the usual number of materials leaves only 2 or
+// 3 of the 8 passes.
+//
+//==========================================================================
+
+static void RadixSort(TArray<GLDrawItem> &drawitems)
+{
+	unsigned count = SortKeys.Size();
+	unsigned histogram[8][256] = {};
+
+	for (auto &item : SortKeys)
+	{
+		for (int d = 0; d < 8; d++) histogram[d][(item.key >> (d * 8)) & 255]++;
+	}
+
+	SortTemp.Resize(count);
+	SortKeyItem *src = &SortKeys[0];
+	SortKeyItem *dst = &SortTemp[0];
+	for (int d = 0; d < 8; d++)
 	{
-		std::sort(drawitems.begin(), drawitems.end(), [=](const GLDrawItem &a, const GLDrawItem &b) -> bool
+		unsigned *bucket = histogram[d];
+		int shift = d * 8;
+		if (bucket[(src[0].key >> shift) & 255] == count) continue;
+
+		unsigned offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			unsigned n = bucket[i];
+			bucket[i] = offset;
+			offset += n;
+		}
+		for (unsigned i = 0; i < count; i++)
 		{
-			GLWall * w1 = walls[a.index];
-			GLWall * w2 = walls[b.index];
+			dst[bucket[(src[i].key >> shift) & 255]++] = src[i];
+		}
+		std::swap(src, dst);
+	}
 
-			if (w1->gltexture != w2->gltexture) return w1->gltexture < w2->gltexture;
-			return (w1->flags & 3) < (w2->flags & 3);
+	for (unsigned i = 0; i < count; i++)
+	{
+		drawitems[i].rendertype = src[i].rendertype;
+		drawitems[i].index = src[i].index;
+	}
+}
 
-		});
+void HWDrawList::SortWalls()
+{
+	if (drawitems.Size() > 1)
+	{
+		SortKeys.Resize(drawitems.Size());
+		for (unsigned i = 0; i < drawitems.Size(); i++)
+		{
+			GLWall *w = walls[drawitems[i].index];
+			// clamp mode and glow are the state SetMaterial and RenderTexturedWall change per wall.
+			SortKeys[i] = { MaterialSortKey(w->gltexture, (w->flags & (GLWall::GLWF_CLAMPX | GLWall::GLWF_CLAMPY | GLWall::GLWF_GLOW))), drawitems[i].rendertype, drawitems[i].index };
+		}
+		RadixSort(drawitems);
 	}
 }
 
@@ -734,12 +804,14 @@ void HWDrawList::SortFlats()
 {
 	if (drawitems.Size() > 1)
 	{
-		std::sort(drawitems.begin(), drawitems.end(), [=](const GLDrawItem &a, const GLDrawItem &b)
+		SortKeys.Resize(drawitems.Size());
+		for (unsigned i = 0; i < drawitems.Size(); i++)
 		{
-			GLFlat * w1 = flats[a.index];
-			GLFlat* w2 = flats[b.index];
-			return w1->gltexture < w2->gltexture;
-		});
+			GLFlat *f = flats[drawitems[i].index];
+			// sky box flats are drawn with a different clamp mode.
+			SortKeys[i] = { MaterialSortKey(f->gltexture, f->sector->special == GLSector_Skybox), drawitems[i].rendertype, drawitems[i].index };
+		}
+		RadixSort(drawitems);
 	}
 }
 
@@ -752,7 +824,7 @@ void HWDrawList::SortFlats()
 
 GLWall *HWDrawList::NewWall()
 {
-	auto wall = (GLWall*)RenderDataAllocator.Alloc(sizeof(GLWall));
+	auto wall = (GLWall*)RenderDataArena->Alloc(sizeof(GLWall));
 	drawitems.Push(GLDrawItem(GLDIT_WALL, walls.Push(wall)));
 	return wall;
 }
@@ -764,7 +836,7 @@ GLWall *HWDrawList::NewWall()
 //==========================================================================
 GLFlat *HWDrawList::NewFlat()
 {
-	auto flat = (GLFlat*)RenderDataAllocator.Alloc(sizeof(GLFlat));
+	auto flat = (GLFlat*)RenderDataArena->Alloc(sizeof(GLFlat));
 	drawitems.Push(GLDrawItem(GLDIT_FLAT,flats.Push(flat)));
 	return flat;
 }
@@ -776,7 +848,7 @@ GLFlat *HWDrawList::NewFlat()
 //==========================================================================
 GLSprite *HWDrawList::NewSprite()
 {	
-	auto sprite = (GLSprite*)RenderDataAllocator.Alloc(sizeof(GLSprite));
+	auto sprite = (GLSprite*)RenderDataArena->Alloc(sizeof(GLSprite));
 	drawitems.Push(GLDrawItem(GLDIT_SPRITE, sprites.Push(sprite)));
 	return sprite;
 }
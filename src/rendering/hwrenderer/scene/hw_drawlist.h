@@ -3,6 +3,7 @@
 #include "memarena.h"
 
 extern FMemArena RenderDataAllocator;
+extern thread_local FMemArena *RenderDataArena;
 void ResetRenderDataAllocator();
 struct HWDrawInfo;
 class GLWall;
@@ -29,6 +29,22 @@
 
 EXTERN_CVAR(Bool, gl_seamless)
 
+extern thread_local HWWorkerDrawLists *workerDrawLists;
+
+//==========================================================================
+//
+// On a BSP worker thread, draw items go to the worker's own lists.
+// Each call must be followed by adding exactly one item to the list.
+//
+//==========================================================================
+
+HWDrawList &HWDrawInfo::GetDrawList(int list)
+{
+	if (workerDrawLists == nullptr) return drawlists[list];
+	workerDrawLists->jobs[list].Push(workerDrawLists->currentjob);
+	return workerDrawLists->drawlists[list];
+}
+
 //==========================================================================
 //
 // 
@@ -39,7 +55,7 @@ void HWDrawInfo::AddWall(GLWall *wall)
 {
 	if (wall->flags & GLWall::GLWF_TRANSLUCENT)
 	{
-		auto newwall = drawlists[GLDL_TRANSLUCENT].NewWall();
+		auto newwall = GetDrawList(GLDL_TRANSLUCENT).NewWall();
 		*newwall = *wall;
 	}
 	else
@@ -55,7 +71,7 @@ void HWDrawInfo::AddWall(GLWall *wall)
 		{
 			list = masked ? GLDL_MASKEDWALLS : GLDL_PLAINWALLS;
 		}
-		auto newwall = drawlists[list].NewWall();
+		auto newwall = GetDrawList(list).NewWall();
 		*newwall = *wall;
 	}
 }
@@ -69,7 +85,7 @@ void HWDrawInfo::AddWall(GLWall *wall)
 void HWDrawInfo::AddMirrorSurface(GLWall *w)
 {
 	w->type = RENDERWALL_MIRRORSURFACE;
-	auto newwall = drawlists[GLDL_TRANSLUCENTBORDER].NewWall();
+	auto newwall = GetDrawList(GLDL_TRANSLUCENTBORDER).NewWall();
 	*newwall = *w;
 
 	// Invalidate vertices to allow setting of texture coordinates
@@ -121,7 +137,7 @@ void HWDrawInfo::AddFlat(GLFlat *flat, bool fog)
 		bool masked = flat->gltexture->isMasked() && ((flat->renderflags&SSRF_RENDER3DPLANES) || flat->stack);
 		list = masked ? GLDL_MASKEDFLATS : GLDL_PLAINFLATS;
 	}
-	auto newflat = drawlists[list].NewFlat();
+	auto newflat = GetDrawList(list).NewFlat();
 	*newflat = *flat;
 }
 
@@ -144,7 +160,7 @@ void HWDrawInfo::AddSprite(GLSprite *sprite, bool translucent)
 		list = GLDL_MODELS;
 	}
 
-	auto newsprt = drawlists[list].NewSprite();
+	auto newsprt = GetDrawList(list).NewSprite();
 	*newsprt = *sprite;
 }
 
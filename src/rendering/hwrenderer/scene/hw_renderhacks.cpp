@@ -90,12 +90,12 @@ void HWDrawInfo::DispatchRenderHacks()
 
 static gl_subsectorrendernode *NewSubsectorRenderNode()
 {
-    return (gl_subsectorrendernode*)RenderDataAllocator.Alloc(sizeof(gl_subsectorrendernode));
+    return (gl_subsectorrendernode*)RenderDataArena->Alloc(sizeof(gl_subsectorrendernode));
 }
 
 static gl_floodrendernode *NewFloodRenderNode()
 {
-    return (gl_floodrendernode*)RenderDataAllocator.Alloc(sizeof(gl_floodrendernode));
+    return (gl_floodrendernode*)RenderDataArena->Alloc(sizeof(gl_floodrendernode));
 }
 
 //==========================================================================
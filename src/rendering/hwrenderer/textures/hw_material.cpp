@@ -20,6 +20,7 @@
 //--------------------------------------------------------------------------
 //
 
+#include <mutex>
 #include "w_wad.h"
 #include "m_png.h"
 #include "sbar.h"
@@ -136,7 +137,10 @@ void IHardwareTexture::Resize(int swidth, int sheight, int width, int height, un
 
 FMaterial::FMaterial(FTexture * tx, bool expanded)
 {
+	static unsigned SortIndexCounter;	// only ever created by ValidateTexture, which holds the lock.
+
 	mShaderIndex = SHADER_Default;
+	mSortIndex = ++SortIndexCounter;
 	sourcetex = tex = tx;
 
 	if (tx->UseType == ETextureType::SWCanvas && static_cast<FWrapperTexture*>(tx)->GetColorFormat() == 0)
@@ -225,8 +229,11 @@ FMaterial::FMaterial(FTexture * tx, bool expanded)
 	SetSpriteRect();
 
 	mTextureLayers.ShrinkToFit();
-	tx->Material[expanded] = this;
+	// The translucency is otherwise determined lazily, but the hardware renderer's BSP worker
+	// threads query it for everything that has a material, so it must be known before this gets published.
 	if (tx->isHardwareCanvas()) tx->bTranslucent = 0;
+	else tx->GetTranslucency();
+	tx->Material[expanded] = this;
 }
 
 //===========================================================================
@@ -449,6 +456,8 @@ int FMaterial::GetAreas(FloatRect **pAreas) const
 	}
 }
 
+static std::recursive_mutex CreateMutex;	// recursive because the constructor validates the texture layers.
+
 //==========================================================================
 //
 // Gets a texture from the texture manager and checks its validity for
@@ -466,6 +475,11 @@ again:
 		FMaterial *hwtex = tex->Material[expand];
 		if (hwtex == NULL && create)
 		{
+			// The hardware renderer's BSP worker threads may get here at the same time.
+			std::lock_guard<std::recursive_mutex> lock(CreateMutex);
+			hwtex = tex->Material[expand];
+			if (hwtex != NULL) return hwtex;
+
 			if (expand)
 			{
 				if (tex->isWarped() || tex->isHardwareCanvas() || tex->shaderindex >= FIRST_USER_SHADER || (tex->shaderindex >= SHADER_Specular && tex->shaderindex <= SHADER_PBRBrightmap))
@@ -44,6 +44,7 @@ class FMaterial
 	short mRenderHeight;
 	bool mExpanded;
 	bool mTrimResult;
+	unsigned mSortIndex;	// creation order, used as the material's draw list sort key
 	uint16_t trim[4];
 
 	float mSpriteU[2], mSpriteV[2];
@@ -61,6 +62,7 @@ public:
 	void Precache();
 	void PrecacheList(SpriteHits &translations);
 	int GetShaderIndex() const { return mShaderIndex; }
+	unsigned GetSortIndex() const { return mSortIndex; }
 	void AddTextureLayer(FTexture *tex)
 	{
 		ValidateTexture(tex, false);
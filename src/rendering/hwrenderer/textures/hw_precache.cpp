@@ -35,7 +35,214 @@
 #include "hwrenderer/textures/hw_material.h"
 #include "image.h"
 #include "v_video.h"
+#include "stats.h"
+#include "c_console.h"
+#include "ctpl.h"
+#include "hwrenderer/utility/hw_cvars.h"
+#include "formats/multipatchtexture.h"
+#include <thread>
 
+// 0 picks a number of decoding threads from the number of CPU cores, 1 decodes everything on the main thread.
+CVAR(Int, gl_precache_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+static ctpl::thread_pool precachePool;
+
+static const char *PrecacheFormatNames[] = { "png", "jpg", "dds", "tga", "pcx", "composite", "lump" };
+enum { NUM_PRECACHE_FORMATS = countof(PrecacheFormatNames) };
+
+struct FPrecacheStats
+{
+	int count;
+	double time;		// decoding time summed over all threads
+	uint64_t bytes;		// size of the created buffers
+};
+static FPrecacheStats PrecacheStats[NUM_PRECACHE_FORMATS];
+static double PrecacheTime;
+static int PrecacheWorkers;
+
+//==========================================================================
+//
+// All buffers of one texture are created by the same job because
+// creating them updates the texture's transparency information.
+// Whatever a worker prints while decoding is kept with the job and
+// passed on by the main thread when the job is finished.
+//
+//==========================================================================
+
+struct FPrecacheJob final : public FOutputCapture
+{
+	enum { MAX_BUFFERS = 3 };	// plain, hires and expanded
+
+	FTexture *tex;
+	int numbuffers = 0;
+	int flags[MAX_BUFFERS];			// as passed to CreateTexBuffer by the upload
+	int decodeflags[MAX_BUFFERS];	// the same without the hires check if there is no hires replacement
+	FTextureBuffer buffers[MAX_BUFFERS];
+	int format[MAX_BUFFERS];
+	double time[MAX_BUFFERS];
+	std::future<void> done;
+	TArray<std::pair<int, FString>> output;
+
+	void Print(int printlevel, const char *string) override
+	{
+		output.Push(std::make_pair(printlevel, FString(string)));
+	}
+
+	void Run()
+	{
+		for (int i = 0; i < numbuffers; i++)
+		{
+			cycle_t clock;
+			clock.Reset();
+			clock.Clock();
+			buffers[i] = tex->CreateTexBuffer(0, decodeflags[i]);
+			clock.Unclock();
+			time[i] = clock.TimeMS();
+		}
+	}
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static int GetPrecacheFormat(FTexture *tex, int flags)
+{
+	if ((flags & CTF_CheckHires) && tex->GetHiresTexture() != nullptr) tex = tex->GetHiresTexture();
+	auto img = tex->GetImage();
+	if (dynamic_cast<FMultiPatchTexture*>(img) != nullptr) return 5;
+
+	const char *name = img->LumpNum() < 0 ? nullptr : Wads.GetLumpFullName(img->LumpNum());
+	const char *dot = name == nullptr ? nullptr : strrchr(name, '.');
+	if (dot != nullptr && strchr(dot, '/') == nullptr)
+	{
+		if (!stricmp(dot + 1, "jpeg")) return 1;
+		for (int i = 0; i < 5; i++)
+		{
+			if (!stricmp(dot + 1, PrecacheFormatNames[i])) return i;
+		}
+	}
+	return 6;
+}
+
+//==========================================================================
+//
+// Queues the creation of a material layer's untranslated texture buffer
+// with the flags the upload is going to use.
+//
+//==========================================================================
+
+static void AddPrecacheBuffer(TArray<FPrecacheJob*> &jobs, TMap<FTexture*, FPrecacheJob*> &texjobs, FTexture *tex, int flags)
+{
+	if (tex == nullptr || !tex->isValid() || tex->isSWCanvas() || tex->isHardwareCanvas() || tex->GetImage() == nullptr) return;
+
+	FPrecacheJob *job;
+	auto pjob = texjobs.CheckKey(tex);
+	if (pjob == nullptr)
+	{
+		job = new FPrecacheJob;
+		job->tex = tex;
+		jobs.Push(job);
+		texjobs[tex] = job;
+	}
+	else job = *pjob;
+
+	flags |= CTF_ProcessData;
+	for (int i = 0; i < job->numbuffers; i++)
+	{
+		if (job->flags[i] == flags) return;
+	}
+
+	int decodeflags = flags;
+	if (flags & CTF_CheckHires)
+	{
+		// Look for the replacement here so that the workers never need to search for files.
+		tex->CreateTexBuffer(0, CTF_CheckHires | CTF_CheckOnly);
+		if (tex->GetHiresTexture() == nullptr) decodeflags &= ~CTF_CheckHires;
+	}
+	int n = job->numbuffers++;
+	job->flags[n] = flags;
+	job->decodeflags[n] = decodeflags;
+	job->format[n] = GetPrecacheFormat(tex, decodeflags);
+}
+
+static void AddPrecacheMaterial(TArray<FPrecacheJob*> &jobs, TMap<FTexture*, FPrecacheJob*> &texjobs, FMaterial *mat)
+{
+	// This must match what the upload in PrecacheMaterial does.
+	auto tex = mat->tex;
+	int flags = mat->isExpanded() ? CTF_Expand : (gl_texture_usehires && !tex->isScaled()) ? CTF_CheckHires : 0;
+	AddPrecacheBuffer(jobs, texjobs, tex, flags);
+	for (int i = 1; i < mat->GetLayers(); i++)
+	{
+		FTexture *layer;
+		mat->GetLayer(i, 0, &layer);
+		AddPrecacheBuffer(jobs, texjobs, layer, mat->isExpanded() ? CTF_Expand : 0);
+	}
+}
+
+//==========================================================================
+//
+// Hands the job's buffers to the texture for the upload
+//
+//==========================================================================
+
+static void FinishPrecacheJob(FPrecacheJob *job)
+{
+	// If the job failed the upload will create the buffer itself and report the error on the main thread.
+	if (job->done.valid()) job->done.wait();
+	for (auto &line : job->output)
+	{
+		PrintString(line.first, line.second);
+	}
+	job->output.Clear();
+	for (int i = 0; i < job->numbuffers; i++)
+	{
+		auto &stats = PrecacheStats[job->format[i]];
+		stats.count++;
+		stats.time += job->time[i];
+		stats.bytes += uint64_t(job->buffers[i].mWidth) * job->buffers[i].mHeight * 4;
+		if (job->buffers[i].mBuffer != nullptr) job->tex->AddPrecachedBuffer(job->flags[i], std::move(job->buffers[i]));
+	}
+}
+
+
+//==========================================================================
+//
+// Owns the jobs of a precache run. Nothing may be left running on the
+// workers and the lump access must be back to normal when the run is
+// over, even if the upload throws.
+//
+//==========================================================================
+
+struct FPrecacheRun
+{
+	TArray<FPrecacheJob*> jobs;
+	bool threaded = false;
+
+	~FPrecacheRun()
+	{
+		Finish();
+	}
+
+	void Finish()
+	{
+		for (auto job : jobs)
+		{
+			if (job->done.valid()) job->done.wait();
+		}
+		if (threaded) Wads.SetThreadedAccess(false);
+		threaded = false;
+		for (auto job : jobs)
+		{
+			// Anything the upload did not ask for must not linger.
+			job->tex->ClearPrecachedBuffers();
+			delete job;
+		}
+		jobs.Clear();
+	}
+};
 
 //==========================================================================
 //
@@ -189,6 +396,22 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 
 	if (gl_precache)
 	{
+		cycle_t precacheclock;
+		precacheclock.Reset();
+		precacheclock.Clock();
+		memset(PrecacheStats, 0, sizeof(PrecacheStats));
+
+		int numworkers = gl_precache_threads > 0 ? gl_precache_threads - 1 : (int)std::thread::hardware_concurrency() - 1;
+		numworkers = clamp(numworkers, 0, 64);
+		PrecacheWorkers = numworkers;
+
+		// The texture buffers are created by jobs which run on worker threads, if there are any.
+		// Only the upload remains for the main thread.
+		FPrecacheRun run;
+		auto &jobs = run.jobs;
+		TMap<FTexture*, FPrecacheJob*> texjobs;
+		TArray<unsigned> jobend(cnt, true);
+
 		FImageSource::BeginPrecaching();
 
 		// cache all used textures
@@ -201,24 +424,63 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 				{
 					if (tex->GetImage() && tex->SystemTextures.GetHardwareTexture(0, false) == nullptr)
 					{
-						FImageSource::RegisterForPrecache(tex->GetImage());
+						// The image cache that lets textures share decoded images is not thread safe.
+						if (numworkers == 0) FImageSource::RegisterForPrecache(tex->GetImage());
+						FMaterial *gltex = FMaterial::ValidateTexture(tex, false);
+						if (gltex) AddPrecacheMaterial(jobs, texjobs, gltex);
 					}
 				}
 
 				// Only register untranslated sprites. Translated ones are very unlikely to require data that can be reused.
 				if (spritehitlist[i] != nullptr && (*spritehitlist[i]).CheckKey(0))
 				{
-					FImageSource::RegisterForPrecache(tex->GetImage());
+					if (numworkers == 0) FImageSource::RegisterForPrecache(tex->GetImage());
+					if (tex->SystemTextures.GetHardwareTexture(0, true) == nullptr)
+					{
+						FMaterial *gltex = FMaterial::ValidateTexture(tex, true);
+						if (gltex) AddPrecacheMaterial(jobs, texjobs, gltex);
+					}
 				}
 			}
+			jobend[i] = jobs.Size();
+		}
+
+		if (numworkers > 0)
+		{
+			if (precachePool.size() != numworkers) precachePool.resize(numworkers);
+			Wads.SetThreadedAccess(true);
+			run.threaded = true;
+			for (auto job : jobs)
+			{
+				job->done = precachePool.push([=](int id)
+				{
+					C_SetOutputCapture(job);
+					try
+					{
+						job->Run();
+					}
+					catch (...)
+					{
+						C_SetOutputCapture(nullptr);
+						throw;
+					}
+					C_SetOutputCapture(nullptr);
+				});
+			}
 		}
 
 		// cache all used textures
+		unsigned finished = 0;
 		for (int i = cnt - 1; i >= 0; i--)
 		{
 			FTexture *tex = TexMan.ByIndex(i);
 			if (tex != nullptr)
 			{
+				for (; finished < jobend[i]; finished++)
+				{
+					if (numworkers == 0) jobs[finished]->Run();
+					FinishPrecacheJob(jobs[finished]);
+				}
 				PrecacheTexture(tex, texhitlist[i]);
 				if (spritehitlist[i] != nullptr && (*spritehitlist[i]).CountUsed() > 0)
 				{
@@ -227,8 +489,10 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 			}
 		}
 
-
+		run.Finish();
 		FImageSource::EndPrecaching();
+		precacheclock.Unclock();
+		PrecacheTime = precacheclock.TimeMS();
 
 		// cache all used models
 		FModelRenderer *renderer = screen->CreateModelRenderer(-1);
@@ -245,3 +509,24 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 	delete[] modellist;
 }
 
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ADD_STAT(precache)
+{
+	FString out;
+	out.Format("Precache: %.1f ms, %d worker threads\n", PrecacheTime, PrecacheWorkers);
+	for (int i = 0; i < NUM_PRECACHE_FORMATS; i++)
+	{
+		auto &stats = PrecacheStats[i];
+		if (stats.count > 0)
+		{
+			out.AppendFormat("%s: %d textures, %.1f ms, %.1f MB\n", PrecacheFormatNames[i], stats.count, stats.time, stats.bytes / (1024. * 1024.));
+		}
+	}
+	return out;
+}
+
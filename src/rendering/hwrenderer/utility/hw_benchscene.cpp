@@ -0,0 +1,494 @@
+/*
+** hw_benchscene.cpp
+** Headless benchmark of the hardware renderer's scene processing
+**
+** -benchscene [file] replaces the video backend with a frame buffer that
+** has no window, no GL context and no render targets. Its vertex, light
+** and viewpoint buffers live in plain memory and its render state discards
+** all draw calls and state changes, so every frame runs only the CPU side
+** of the hardware renderer: BSP traversal, clipping, wall/flat/sprite
+** setup, portals and draw list processing. Played back with -timedemo this
+** replays the demo's camera path without any GPU or driver work in the
+** measurement. The per-phase times of the existing render clocks, the draw
+** item counts and the number of draw calls and material changes of every
+** frame are written as JSON when the demo ends or the engine exits
+** (default file: benchscene.json).
+**
+*/
+
+#include "doomstat.h"
+#include "d_player.h"
+#include "g_levellocals.h"
+#include "r_utility.h"
+#include "v_video.h"
+#include "i_video.h"
+#include "m_argv.h"
+#include "m_png.h"
+#include "i_time.h"
+#include "i_system.h"
+#include "a_dynlight.h"
+#include "hw_benchscene.h"
+#include "hwrenderer/utility/hw_clock.h"
+#include "hwrenderer/utility/hw_vrmodes.h"
+#include "hwrenderer/scene/hw_drawinfo.h"
+#include "hwrenderer/scene/hw_portal.h"
+#include "hwrenderer/scene/hw_fakeflat.h"
+#include "hwrenderer/scene/hw_renderstate.h"
+#include "hwrenderer/scene/hw_skydome.h"
+#include "hwrenderer/data/flatvertices.h"
+#include "hwrenderer/data/hw_viewpointbuffer.h"
+#include "hwrenderer/dynlights/hw_lightbuffer.h"
+#include "hwrenderer/models/hw_models.h"
+
+EXTERN_CVAR(Bool, cl_capfps)
+EXTERN_CVAR(Int, vid_defwidth)
+EXTERN_CVAR(Int, vid_defheight)
+EXTERN_CVAR(Bool, r_drawvoxels)
+
+//==========================================================================
+//
+// A buffer in system memory. It stays mapped all the time, just like
+// the persistently mapped buffers of the GL backend.
+//
+//==========================================================================
+
+class FBenchBuffer : public IVertexBuffer, public IIndexBuffer, public IDataBuffer
+{
+	TArray<uint8_t> mData;
+
+public:
+	void SetData(size_t size, const void *data, bool staticdata) override
+	{
+		Resize(size);
+		if (data != nullptr) memcpy(map, data, size);
+	}
+
+	void SetSubData(size_t offset, size_t size, const void *data) override
+	{
+		memcpy((uint8_t*)map + offset, data, size);
+	}
+
+	void *Lock(unsigned int size) override
+	{
+		if (size > buffersize) Resize(size);
+		return map;
+	}
+
+	void Unlock() override {}
+
+	void Resize(size_t newsize) override
+	{
+		mData.Resize((unsigned)newsize);
+		buffersize = newsize;
+		map = mData.Data();
+	}
+
+	void SetFormat(int numBindingPoints, int numAttributes, size_t stride, const FVertexBufferAttribute *attrs) override {}
+	void BindRange(size_t start, size_t length) override {}
+	void BindBase() override {}
+};
+
+//==========================================================================
+//
+// A render state that accepts everything and draws nothing
+//
+//==========================================================================
+
+class FBenchRenderState : public FRenderState
+{
+	bool mDepthClamp = true;
+	FMaterial *mLastMaterial;
+	int mLastClamp, mLastTranslation;
+
+	// Counts the material changes a backend that skips rebinding the same material would see.
+	void CountDraw()
+	{
+		Draws++;
+		if (mMaterial.mChanged)
+		{
+			if (mMaterial.mMaterial != mLastMaterial || mMaterial.mClampMode != mLastClamp || mMaterial.mTranslation != mLastTranslation)
+			{
+				mLastMaterial = mMaterial.mMaterial;
+				mLastClamp = mMaterial.mClampMode;
+				mLastTranslation = mMaterial.mTranslation;
+				MaterialChanges++;
+			}
+			mMaterial.mChanged = false;
+		}
+	}
+
+public:
+	int Draws, MaterialChanges;
+
+	void ResetCounters()
+	{
+		Draws = MaterialChanges = 0;
+		mLastMaterial = nullptr;
+		mLastClamp = mLastTranslation = -1;
+	}
+
+	void ClearScreen() override {}
+	void Draw(int dt, int index, int count, bool apply) override { CountDraw(); }
+	void DrawIndexed(int dt, int index, int count, bool apply) override { CountDraw(); }
+
+	bool SetDepthClamp(bool on) override
+	{
+		bool res = mDepthClamp;
+		mDepthClamp = on;
+		return res;
+	}
+	void SetDepthMask(bool on) override {}
+	void SetDepthFunc(int func) override {}
+	void SetDepthRange(float min, float max) override {}
+	void SetColorMask(bool r, bool g, bool b, bool a) override {}
+	void EnableDrawBufferAttachments(bool on) override {}
+	void SetStencil(int offs, int op, int flags) override {}
+	void SetCulling(int mode) override {}
+	void EnableClipDistance(int num, bool state) override {}
+	void Clear(int targets) override {}
+	void EnableStencil(bool on) override {}
+	void SetScissor(int x, int y, int w, int h) override {}
+	void SetViewport(int x, int y, int w, int h) override {}
+	void EnableDepthTest(bool on) override {}
+	void EnableMultisampling(bool on) override {}
+	void EnableLineSmooth(bool on) override {}
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+struct FBenchFrame
+{
+	FString MapName;
+	int Tic;
+	double Total, Bsp, ClipWall, SetupWall, SetupFlat, SetupSprite, Process, Render, Sort, Portals;
+	int Walls, Flats, Sprites, Decals, PortalCount, WallVertices, FlatVertices, Draws, MaterialChanges;
+};
+
+static int BenchState = -1;		// -1: not checked yet, 0: off, 1: on
+static FString BenchFile;
+static TArray<FBenchFrame> BenchFrames;
+
+bool BenchScene_Active()
+{
+	if (BenchState < 0)
+	{
+		int p = Args->CheckParm("-benchscene");
+		BenchState = p > 0;
+		if (BenchState)
+		{
+			if (p + 1 < Args->NumArgs() && Args->GetArg(p + 1)[0] != '-' && Args->GetArg(p + 1)[0] != '+')
+			{
+				BenchFile = Args->GetArg(p + 1);
+			}
+			else
+			{
+				BenchFile = "benchscene.json";
+			}
+			atterm(BenchScene_Finish);
+		}
+	}
+	return BenchState > 0;
+}
+
+//==========================================================================
+//
+// The headless frame buffer
+//
+//==========================================================================
+
+class FBenchFrameBuffer : public DFrameBuffer
+{
+	typedef DFrameBuffer Super;
+
+	FBenchRenderState mRenderState;
+
+	void DrawScene(HWDrawInfo *di, int drawmode);
+
+public:
+	FBenchFrameBuffer(int width, int height) : DFrameBuffer(width, height) {}
+	~FBenchFrameBuffer();
+
+	void InitializeState() override;
+	bool IsFullscreen() override { return false; }
+	int GetClientWidth() override { return GetWidth(); }
+	int GetClientHeight() override { return GetHeight(); }
+	void Update() override;
+
+	IVertexBuffer *CreateVertexBuffer() override { return new FBenchBuffer; }
+	IIndexBuffer *CreateIndexBuffer() override { return new FBenchBuffer; }
+	IDataBuffer *CreateDataBuffer(int bindingpoint, bool ssbo) override { return new FBenchBuffer; }
+	FModelRenderer *CreateModelRenderer(int mli) override { return new FGLModelRenderer(nullptr, mRenderState, mli); }
+
+	uint32_t GetCaps() override;
+	void WriteSavePic(player_t *player, FileWriter *file, int width, int height) override { M_CreateDummyPNG(file); }
+	sector_t *RenderView(player_t *player) override;
+};
+
+FBenchFrameBuffer::~FBenchFrameBuffer()
+{
+	delete mVertexData;
+	delete mSkyData;
+	delete mViewpoints;
+	delete mLights;
+}
+
+//==========================================================================
+//
+// Pretends to be a modern GL implementation so that the scene code takes
+// the same paths it takes on the hardware it is normally profiled on.
+//
+//==========================================================================
+
+void FBenchFrameBuffer::InitializeState()
+{
+	if (!V_IsHardwareRenderer())
+	{
+		I_FatalError("-benchscene measures the hardware renderer and needs vid_rendermode 4");
+	}
+
+	hwcaps = RFL_SHADER_STORAGE_BUFFER | RFL_BUFFER_STORAGE;
+	glslversion = 4.5f;
+	gl_vendorstring = "headless";
+
+	SetViewportRects(nullptr);
+
+	mVertexData = new FFlatVertexBuffer(GetWidth(), GetHeight());
+	mSkyData = new FSkyVertexBuffer;
+	mViewpoints = new GLViewpointBuffer;
+	mLights = new FLightBuffer();
+	mRenderState.Reset();
+}
+
+//==========================================================================
+//
+// Nothing gets presented, only the pending 2D draw lists are discarded
+//
+//==========================================================================
+
+void FBenchFrameBuffer::Update()
+{
+	Clear2D();
+	Super::Update();
+}
+
+uint32_t FBenchFrameBuffer::GetCaps()
+{
+	ActorRenderFeatureFlags FlagSet = RFF_FLATSPRITES | RFF_MODELS | RFF_SLOPE3DFLOORS |
+		RFF_TILTPITCH | RFF_ROLLSPRITES | RFF_POLYGONAL | RFF_MATSHADER | RFF_POSTSHADER | RFF_BRIGHTMAP | RFF_TRUECOLOR;
+	if (r_drawvoxels)
+		FlagSet |= RFF_VOXELS;
+	return (uint32_t)FlagSet;
+}
+
+//==========================================================================
+//
+// Same as the hardware renderer's DrawScene, minus everything that only
+// concerns the GPU.
+//
+//==========================================================================
+
+void FBenchFrameBuffer::DrawScene(HWDrawInfo *di, int drawmode)
+{
+	static int recursion = 0;
+	const auto &vp = di->Viewpoint;
+
+	if (vp.camera != nullptr)
+	{
+		ActorRenderFlags savedflags = vp.camera->renderflags;
+		di->CreateScene();
+		vp.camera->renderflags = savedflags;
+	}
+	else
+	{
+		di->CreateScene();
+	}
+
+	mPortalState->RenderFirstSkyPortal(recursion, di, mRenderState);
+	di->RenderScene(mRenderState);
+
+	recursion++;
+	mPortalState->EndFrame(di, mRenderState);
+	recursion--;
+	di->RenderTranslucent(mRenderState);
+}
+
+//==========================================================================
+//
+// The main view of the hardware renderer, run against the null render
+// state. Camera textures are left out because they only exist to be
+// drawn into render targets.
+//
+//==========================================================================
+
+sector_t *FBenchFrameBuffer::RenderView(player_t *player)
+{
+	auto &state = mRenderState;
+	state.ResetCounters();
+	state.SetVertexBuffer(mVertexData);
+	mVertexData->Reset();
+	hw_ClearFakeFlat();
+
+	bool savedactive = glcycle_t::active;
+	glcycle_t::active = true;
+	iter_dlightf = iter_dlight = draw_dlight = draw_dlightf = 0;
+	ResetProfilingData();
+
+	cycle_t total;
+	total.Reset();
+	total.Clock();
+
+	if (cl_capfps || r_NoInterpolate) r_viewpoint.TicFrac = 1.;
+	else r_viewpoint.TicFrac = I_GetTimeFrac();
+
+	mLights->Clear();
+	mViewpoints->Clear();
+
+	float ratio = r_viewwindow.WidescreenRatio;
+	float fovratio = ratio >= 1.3f ? 1.333333f : ratio;
+	float fov = r_viewpoint.FieldOfView.Degrees;
+
+	R_SetupFrame(r_viewpoint, r_viewwindow, player->camera);
+	FLightDefaults::SetAttenuationForLevel(!!(player->camera->Level->flags3 & LEVEL3_ATTENUATE));
+	SetViewportRects(nullptr);
+
+	auto di = HWDrawInfo::StartDrawInfo(r_viewpoint.ViewLevel, nullptr, r_viewpoint, nullptr);
+	auto &vp = di->Viewpoint;
+
+	di->Set3DViewport(state);
+	di->SetViewArea();
+	di->SetFullbrightFlags(vp.camera->player);
+	di->Viewpoint.FieldOfView = fov;
+	di->VPUniforms.mProjectionMatrix = VRMode::GetVRMode(false)->mEyes[0].GetProjection(fov, ratio, fovratio);
+	di->SetupView(state, vp.Pos.X, vp.Pos.Y, vp.Pos.Z, false, false);
+	di->ProcessScene(true, [&](HWDrawInfo *di, int mode) { DrawScene(di, mode); });
+	di->EndDrawScene(r_viewpoint.sector, state);
+	di->DrawEndScene2D(r_viewpoint.sector, state);
+	di->EndDrawInfo();
+
+	total.Unclock();
+	All.Unclock();
+	glcycle_t::active = savedactive;
+
+	auto &frame = BenchFrames[BenchFrames.Reserve(1)];
+	frame.MapName = player->camera->Level->MapName;
+	frame.Tic = gametic;
+	frame.Total = total.TimeMS();
+	frame.Bsp = Bsp.TimeMS() - ClipWall.TimeMS();
+	frame.ClipWall = ClipWall.TimeMS();
+	frame.SetupWall = SetupWall.TimeMS();
+	frame.SetupFlat = SetupFlat.TimeMS();
+	frame.SetupSprite = SetupSprite.TimeMS();
+	frame.Process = ProcessAll.TimeMS();
+	frame.Render = RenderAll.TimeMS();
+	frame.Sort = SortLists.TimeMS();
+	frame.Portals = PortalAll.TimeMS();
+	frame.Walls = rendered_lines;
+	frame.Flats = rendered_flats;
+	frame.Sprites = rendered_sprites;
+	frame.Decals = rendered_decals;
+	frame.PortalCount = rendered_portals;
+	frame.WallVertices = vertexcount;
+	frame.FlatVertices = flatvertices;
+	frame.Draws = state.Draws;
+	frame.MaterialChanges = state.MaterialChanges;
+
+	return r_viewpoint.sector;
+}
+
+//==========================================================================
+//
+// Video interface that creates the headless frame buffer. Used by the
+// platform's I_InitGraphics instead of the GL one when -benchscene is given.
+//
+//==========================================================================
+
+class FBenchVideo : public IVideo
+{
+public:
+	DFrameBuffer *CreateFrameBuffer() override
+	{
+		return new FBenchFrameBuffer(MAX<int>(vid_defwidth, 320), MAX<int>(vid_defheight, 200));
+	}
+};
+
+IVideo *BenchScene_CreateVideo()
+{
+	return new FBenchVideo;
+}
+
+//==========================================================================
+//
+// Writes the collected data. Called at the end of the demo and at exit,
+// whichever comes first.
+//
+//==========================================================================
+
+void BenchScene_Finish()
+{
+	if (BenchFrames.Size() == 0) return;
+
+	FBenchFrame sum = {};
+	double maxtotal = 0;
+	for (auto &frame : BenchFrames)
+	{
+		sum.Total += frame.Total;
+		sum.Bsp += frame.Bsp;
+		sum.ClipWall += frame.ClipWall;
+		sum.SetupWall += frame.SetupWall;
+		sum.SetupFlat += frame.SetupFlat;
+		sum.SetupSprite += frame.SetupSprite;
+		sum.Process += frame.Process;
+		sum.Render += frame.Render;
+		sum.Sort += frame.Sort;
+		sum.Portals += frame.Portals;
+		sum.Walls += frame.Walls;
+		sum.Flats += frame.Flats;
+		sum.Sprites += frame.Sprites;
+		sum.Decals += frame.Decals;
+		sum.PortalCount += frame.PortalCount;
+		sum.WallVertices += frame.WallVertices;
+		sum.FlatVertices += frame.FlatVertices;
+		sum.Draws += frame.Draws;
+		sum.MaterialChanges += frame.MaterialChanges;
+		maxtotal = MAX(maxtotal, frame.Total);
+	}
+	double n = BenchFrames.Size();
+
+	FString out;
+	out.Format("{\n\t\"frames\": %u,\n", BenchFrames.Size());
+	out.AppendFormat("\t\"average\": { \"total\": %.4f, \"bsp\": %.4f, \"clipwall\": %.4f, \"setupwall\": %.4f, \"setupflat\": %.4f, \"setupsprite\": %.4f, "
+		"\"process\": %.4f, \"render\": %.4f, \"sort\": %.4f, \"portals\": %.4f, \"walls\": %.1f, \"flats\": %.1f, \"sprites\": %.1f, \"decals\": %.1f, "
+		"\"portalcount\": %.1f, \"wallvertices\": %.1f, \"flatvertices\": %.1f, \"draws\": %.1f, \"materialchanges\": %.1f },\n",
+		sum.Total / n, sum.Bsp / n, sum.ClipWall / n, sum.SetupWall / n, sum.SetupFlat / n, sum.SetupSprite / n,
+		sum.Process / n, sum.Render / n, sum.Sort / n, sum.Portals / n, sum.Walls / n, sum.Flats / n, sum.Sprites / n, sum.Decals / n,
+		sum.PortalCount / n, sum.WallVertices / n, sum.FlatVertices / n, sum.Draws / n, sum.MaterialChanges / n);
+	out.AppendFormat("\t\"maxtotal\": %.4f,\n\t\"framedata\": [\n", maxtotal);
+	for (unsigned i = 0; i < BenchFrames.Size(); i++)
+	{
+		auto &frame = BenchFrames[i];
+		out.AppendFormat("\t\t{ \"map\": \"%s\", \"tic\": %d, \"total\": %.4f, \"bsp\": %.4f, \"clipwall\": %.4f, \"setupwall\": %.4f, \"setupflat\": %.4f, "
+			"\"setupsprite\": %.4f, \"process\": %.4f, \"render\": %.4f, \"sort\": %.4f, \"portals\": %.4f, \"walls\": %d, \"flats\": %d, \"sprites\": %d, "
+			"\"decals\": %d, \"portalcount\": %d, \"wallvertices\": %d, \"flatvertices\": %d, \"draws\": %d, \"materialchanges\": %d }%s\n",
+			frame.MapName.GetChars(), frame.Tic, frame.Total, frame.Bsp, frame.ClipWall, frame.SetupWall, frame.SetupFlat,
+			frame.SetupSprite, frame.Process, frame.Render, frame.Sort, frame.Portals, frame.Walls, frame.Flats, frame.Sprites,
+			frame.Decals, frame.PortalCount, frame.WallVertices, frame.FlatVertices, frame.Draws, frame.MaterialChanges, i + 1 < BenchFrames.Size() ? "," : "");
+	}
+	out += "\t]\n}\n";
+
+	FILE *f = fopen(BenchFile, "wt");
+	if (f != nullptr)
+	{
+		fputs(out.GetChars(), f);
+		fclose(f);
+		Printf("Scene benchmark of %u frames saved to %s\n", BenchFrames.Size(), BenchFile.GetChars());
+	}
+	else
+	{
+		Printf("Could not write scene benchmark to %s\n", BenchFile.GetChars());
+	}
+	BenchFrames.Clear();
+}
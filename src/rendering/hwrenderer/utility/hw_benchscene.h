@@ -0,0 +1,7 @@
+#pragma once
+
+class IVideo;
+
+bool BenchScene_Active();
+IVideo *BenchScene_CreateVideo();
+void BenchScene_Finish();
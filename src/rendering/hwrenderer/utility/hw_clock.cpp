@@ -47,15 +47,15 @@ glcycle_t RenderFlat,SetupFlat;
 glcycle_t RenderSprite,SetupSprite;
 glcycle_t All, Finish, PortalAll, Bsp;
 glcycle_t ProcessAll, PostProcess;
-glcycle_t RenderAll;
+glcycle_t RenderAll, SortLists;
 glcycle_t Dirty;
 glcycle_t drawcalls;
 glcycle_t twoD, Flush3D;
 glcycle_t MTWait, WTTotal;
-int vertexcount, flatvertices, flatprimitives;
+std::atomic<int> vertexcount, flatvertices, flatprimitives;
 
-int rendered_lines,rendered_flats,rendered_sprites,render_vertexsplit,render_texsplit,rendered_decals, rendered_portals;
-int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
+std::atomic<int> rendered_lines,rendered_flats,rendered_sprites,render_vertexsplit,render_texsplit,rendered_decals, rendered_portals;
+std::atomic<int> iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
 
 void ResetProfilingData()
 {
@@ -64,6 +64,7 @@ void ResetProfilingData()
 	Bsp.Reset();
 	PortalAll.Reset();
 	RenderAll.Reset();
+	SortLists.Reset();
 	ProcessAll.Reset();
 	PostProcess.Reset();
 	RenderWall.Reset();
@@ -93,14 +94,14 @@ static void AppendRenderTimes(FString &str)
 	double clipwall = ClipWall.TimeMS();
 	double bsp = Bsp.TimeMS() - ClipWall.TimeMS();
 
-	str.AppendFormat("BSP = %2.3f, Clip=%2.3f\n"
+	str.AppendFormat("BSP = %2.3f, Clip=%2.3f, Sort=%2.3f\n"
 		"W: Render=%2.3f, Setup=%2.3f\n"
 		"F: Render=%2.3f, Setup=%2.3f\n"
 		"S: Render=%2.3f, Setup=%2.3f\n"
 		"2D: %2.3f Finish3D: %2.3f\n"
 		"Main thread total=%2.3f, Main thread waiting=%2.3f Worker thread total=%2.3f, Worker thread waiting=%2.3f\n"
 		"All=%2.3f, Render=%2.3f, Setup=%2.3f, Portal=%2.3f, Drawcalls=%2.3f, Postprocess=%2.3f, Finish=%2.3f\n",
-		bsp, clipwall,
+		bsp, clipwall, SortLists.TimeMS(),
 		RenderWall.TimeMS(), setupwall, 
 		RenderFlat.TimeMS(), SetupFlat.TimeMS(),
 		RenderSprite.TimeMS(), SetupSprite.TimeMS(), 
@@ -114,13 +115,14 @@ static void AppendRenderStats(FString &out)
 	out.AppendFormat("Walls: %d (%d splits, %d t-splits, %d vertices)\n"
 		"Flats: %d (%d primitives, %d vertices)\n"
 		"Sprites: %d, Decals=%d, Portals: %d\n",
-		rendered_lines, render_vertexsplit, render_texsplit, vertexcount, rendered_flats, flatprimitives, flatvertices, rendered_sprites,rendered_decals, rendered_portals );
+		rendered_lines.load(), render_vertexsplit.load(), render_texsplit.load(), vertexcount.load(), rendered_flats.load(), flatprimitives.load(),
+		flatvertices.load(), rendered_sprites.load(), rendered_decals.load(), rendered_portals.load());
 }
 
 static void AppendLightStats(FString &out)
 {
 	out.AppendFormat("DLight - Walls: %d processed, %d rendered - Flats: %d processed, %d rendered\n", 
-		iter_dlight, draw_dlight, iter_dlightf, draw_dlightf );
+		iter_dlight.load(), draw_dlight.load(), iter_dlightf.load(), draw_dlightf.load());
 }
 
 ADD_STAT(rendertimes)
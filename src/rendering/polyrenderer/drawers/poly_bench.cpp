@@ -0,0 +1,153 @@
+/*
+** poly_bench.cpp
+** Benchmark for the softpoly triangle rasterizer
+**
+** benchpoly records the drawer commands of the next frame the poly renderer
+** draws, including copies of the frame data they point at. The recording is
+** then replayed on the drawer threads, with and without binning, into a
+** private buffer and from the same depth and stencil contents each time.
+** This measures only the drawers, without the scene traversal that fills
+** the command queues.
+**
+*/
+
+#include <stddef.h>
+#include "templates.h"
+#include "doomdef.h"
+
+#include "w_wad.h"
+#include "v_video.h"
+#include "doomstat.h"
+#include "r_data/r_translate.h"
+#include "v_palette.h"
+#include "r_data/colormaps.h"
+#include "poly_triangle.h"
+#include "c_dispatch.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "poly_bench.h"
+#include "swrenderer/r_memory.h"
+
+EXTERN_CVAR(Bool, r_poly_binning)
+
+static int BenchPasses;
+static std::unique_ptr<PolyCommandRecorder> Recording;
+static std::vector<float> SavedDepth;
+static std::vector<uint8_t> SavedStencil;
+
+//==========================================================================
+//
+// benchpoly [passes]
+//
+//==========================================================================
+
+CCMD(benchpoly)
+{
+	if (r_multithreaded == 0)
+	{
+		Printf("benchpoly needs r_multithreaded\n");
+		return;
+	}
+	BenchPasses = argv.argc() > 1 ? MAX(1, atoi(argv[1])) : 10;
+	Printf("Recording the next softpoly frame\n");
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void SaveBuffers()
+{
+	auto zbuffer = PolyZBuffer::Instance();
+	auto stencil = PolyStencilBuffer::Instance();
+	SavedDepth.assign(zbuffer->Values(), zbuffer->Values() + zbuffer->Width() * zbuffer->Height());
+	SavedStencil.assign(stencil->Values(), stencil->Values() + stencil->Width() * stencil->Height());
+}
+
+static void RestoreBuffers()
+{
+	auto zbuffer = PolyZBuffer::Instance();
+	auto stencil = PolyStencilBuffer::Instance();
+	if (SavedDepth.size() == (size_t)(zbuffer->Width() * zbuffer->Height()))
+		memcpy(zbuffer->Values(), SavedDepth.data(), SavedDepth.size() * sizeof(float));
+	if (SavedStencil.size() == (size_t)(stencil->Width() * stencil->Height()))
+		memcpy(stencil->Values(), SavedStencil.data(), SavedStencil.size());
+}
+
+void PolyDrawBenchmark::BeginFrame()
+{
+	if (BenchPasses == 0 || Recording)
+		return;
+
+	Recording.reset(new PolyCommandRecorder());
+	SaveBuffers();
+	DrawerThreads::SetCommandRecorder([](DrawerCommand *command)
+	{
+		auto polycommand = dynamic_cast<PolyDrawerCommand *>(command);
+		if (polycommand)
+			polycommand->Record(*Recording);
+	});
+}
+
+void PolyDrawBenchmark::EndFrame()
+{
+	if (!Recording)
+		return;
+
+	DrawerThreads::SetCommandRecorder({});
+	std::unique_ptr<PolyCommandRecorder> recording = std::move(Recording);
+	int passes = BenchPasses;
+	BenchPasses = 0;
+
+	if (recording->Triangles == 0 || recording->TargetSize == 0)
+	{
+		Printf("No triangles were drawn\n");
+		return;
+	}
+
+	Printf("Replaying %d draws with %d triangles %d times\n", recording->Draws, recording->Triangles, passes);
+
+	bool binning = r_poly_binning;
+	RenderMemory memory;
+	std::vector<uint8_t> targets[2];
+	double ms[2] = { 0.0, 0.0 };
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (int binned = 0; binned < 2; binned++)
+		{
+			r_poly_binning = !!binned;
+			targets[binned].assign(recording->TargetSize, 0);
+			RestoreBuffers();
+
+			auto queue = std::make_shared<DrawerCommandQueue>(&memory);
+			for (auto &command : recording->Commands)
+				command(queue, targets[binned].data());
+
+			cycle_t clock;
+			clock.Reset();
+			clock.Clock();
+			DrawerThreads::Execute(queue);
+			DrawerThreads::WaitForWorkers();
+			clock.Unclock();
+			ms[binned] += clock.TimeMS();
+
+			queue.reset();
+			memory.Clear();
+		}
+	}
+	r_poly_binning = binning;
+	RestoreBuffers();
+
+	size_t differences = 0;
+	for (size_t i = 0; i < recording->TargetSize; i++)
+	{
+		if (targets[0][i] != targets[1][i])
+			differences++;
+	}
+
+	Printf("Interleaved: %.2f ms per frame\n", ms[0] / passes);
+	Printf("Binned: %.2f ms per frame\n", ms[1] / passes);
+	Printf("%u of %u bytes differ between the two\n", (unsigned)differences, (unsigned)recording->TargetSize);
+}
@@ -0,0 +1,51 @@
+/*
+** poly_bench.h
+** Recording and replaying of softpoly drawer commands
+**
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <string.h>
+#include "swrenderer/drawers/r_thread.h"
+
+// Copies of the drawer commands of a frame, together with the data they point at
+class PolyCommandRecorder
+{
+public:
+	typedef std::function<void(const DrawerCommandQueuePtr &queue, uint8_t *dest)> ReplayFunc;
+
+	template<typename T>
+	const T *Copy(const T *data, size_t count)
+	{
+		Data.emplace_back(new uint8_t[sizeof(T) * count]);
+		memcpy(Data.back().get(), data, sizeof(T) * count);
+		return reinterpret_cast<const T *>(Data.back().get());
+	}
+
+	void Add(ReplayFunc func) { Commands.push_back(std::move(func)); }
+
+	// Replays draw into a private buffer that is large enough for every recorded viewport
+	void AddTarget(size_t size) { if (size > TargetSize) TargetSize = size; }
+
+	std::vector<ReplayFunc> Commands;
+	std::vector<std::unique_ptr<uint8_t[]>> Data;
+	size_t TargetSize = 0;
+
+	// Decides whether the vertices of a draw are TriVertex or FModelVertex
+	int ModelFrame1 = -1;
+
+	int Draws = 0;
+	int Triangles = 0;
+};
+
+class PolyDrawBenchmark
+{
+public:
+	// Called by the poly renderer around every frame it renders
+	static void BeginFrame();
+	static void EndFrame();
+};
@@ -0,0 +1,487 @@
+/*
+** poly_bin.cpp
+** Tiled triangle binning for the softpoly drawers
+**
+** Without binning every drawer thread clips, projects and sets up every
+** triangle of a draw and then only rasterizes the lines it owns. A binned
+** draw does that setup once: the threads that execute the command split the
+** vertex shading and triangle setup between them, in chunks, and every
+** chunk sorts its triangles into 64x64 screen tiles. Each thread then walks
+** the tiles of each chunk, in submission order, and rasterizes its own lines
+** of every triangle in them with SIMD edge stepping. A depth and stencil
+** summary per tile and thread lets it skip or simplify whole tiles.
+**
+*/
+
+#include <algorithm>
+#include <thread>
+#include <stddef.h>
+#include "templates.h"
+#include "doomdef.h"
+
+#include "w_wad.h"
+#include "v_video.h"
+#include "doomstat.h"
+#include "r_data/r_translate.h"
+#include "v_palette.h"
+#include "r_data/colormaps.h"
+#include "poly_triangle.h"
+#include "poly_bin.h"
+#include "swrenderer/drawers/r_draw_rgba.h"
+#include "screen_triangle.h"
+#include "x86.h"
+
+std::mutex PolyTriangleBins::poolMutex;
+std::vector<std::unique_ptr<PolyTriangleBins>> PolyTriangleBins::pool;
+
+PolyTriangleBins *PolyTriangleBins::Acquire()
+{
+	std::unique_lock<std::mutex> lock(poolMutex);
+	PolyTriangleBins *bins;
+	if (!pool.empty())
+	{
+		bins = pool.back().release();
+		pool.pop_back();
+	}
+	else
+	{
+		bins = new PolyTriangleBins();
+	}
+	bins->initialized = false;
+	return bins;
+}
+
+void PolyTriangleBins::Release(PolyTriangleBins *bins)
+{
+	std::unique_lock<std::mutex> lock(poolMutex);
+	pool.push_back(std::unique_ptr<PolyTriangleBins>(bins));
+}
+
+void PolyTriangleBins::Draw(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int count, PolyDrawMode mode)
+{
+	if (count < 3)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(initMutex);
+		if (!initialized)
+			Init(thread, elements, count, mode);
+	}
+
+	// The tile summaries of a thread are only valid within a single command
+	thread->binGeneration++;
+	if (thread->binTiles.size() < (size_t)(tilesX * tilesY))
+		thread->binTiles.resize(tilesX * tilesY);
+
+	// Help with the shared work until all of it has been claimed. A thread never waits
+	// for work that hasn't been claimed yet, so threads skipping the command are fine.
+	int totalWork = numVertexChunks + numTriangleChunks;
+	while (true)
+	{
+		int work = nextWork.fetch_add(1);
+		if (work >= totalWork)
+			break;
+
+		if (work < numVertexChunks)
+		{
+			ShadeChunk(thread, args, vertices, work);
+			vertexChunksDone.fetch_add(1, std::memory_order_release);
+		}
+		else
+		{
+			while (vertexChunksDone.load(std::memory_order_acquire) < numVertexChunks)
+				std::this_thread::yield();
+			SetupChunk(thread, args, vertices, elements, work - numVertexChunks);
+		}
+	}
+
+	for (int i = 0; i < numTriangleChunks; i++)
+	{
+		PolyBinChunk &chunk = *chunks[i];
+		while (!chunk.done.load(std::memory_order_acquire))
+			std::this_thread::yield();
+		DrawChunk(thread, args, chunk);
+	}
+}
+
+void PolyTriangleBins::Init(PolyTriangleThreadData *thread, const unsigned int *elements, int count, PolyDrawMode mode)
+{
+	drawmode = mode;
+	numTriangles = (mode == PolyDrawMode::Triangles) ? count / 3 : count - 2;
+
+	firstVertex = 0;
+	numVertices = count;
+	sparse = false;
+	if (elements)
+	{
+		unsigned int minindex = elements[0];
+		unsigned int maxindex = elements[0];
+		for (int i = 1; i < count; i++)
+		{
+			minindex = MIN(minindex, elements[i]);
+			maxindex = MAX(maxindex, elements[i]);
+		}
+
+		// Same rule as PolyTriangleThreadData::DrawElements
+		firstVertex = minindex;
+		numVertices = maxindex - minindex + 1;
+		if (numVertices > count * 2)
+		{
+			sparse = true;
+			numVertices = 0;
+		}
+	}
+
+	if (shaded.size() < (size_t)numVertices)
+		shaded.resize(numVertices);
+
+	numVertexChunks = (numVertices + VerticesPerChunk - 1) / VerticesPerChunk;
+	numTriangleChunks = (numTriangles + TrianglesPerChunk - 1) / TrianglesPerChunk;
+	while (chunks.size() < (size_t)numTriangleChunks)
+		chunks.push_back(std::make_unique<PolyBinChunk>());
+	for (int i = 0; i < numTriangleChunks; i++)
+		chunks[i]->done.store(false);
+
+	tilesX = (thread->dest_width + TileSize - 1) >> TileShift;
+	tilesY = (thread->dest_height + TileSize - 1) >> TileShift;
+
+	nextWork.store(0);
+	vertexChunksDone.store(0);
+	initialized = true;
+}
+
+void PolyTriangleBins::ShadeChunk(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, int chunk)
+{
+	int first = chunk * VerticesPerChunk;
+	int count = MIN((int)VerticesPerChunk, numVertices - first);
+	thread->ShadeVertices(args, vertices, firstVertex + first, count, shaded.data() + first);
+}
+
+ShadedTriVertex PolyTriangleBins::VertexAt(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int index)
+{
+	if (!elements)
+		return shaded[index];
+	else if (sparse)
+		return thread->ShadeVertex(args, vertices, elements[index]);
+	else
+		return shaded[elements[index] - firstVertex];
+}
+
+void PolyTriangleBins::SetupChunk(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int index)
+{
+	PolyBinChunk &chunk = *chunks[index];
+	chunk.triangles.clear();
+	chunk.entries.clear();
+
+	TriDrawTriangleArgs triargs;
+	triargs.uniforms = &args;
+
+	// The same triangles, in the same order, as PolyTriangleThreadData::DrawTriangles
+	int first = index * TrianglesPerChunk;
+	int last = MIN(first + (int)TrianglesPerChunk, numTriangles);
+	ShadedTriVertex vert[3];
+	for (int t = first; t < last; t++)
+	{
+		bool ccw = thread->ccw;
+		if (drawmode == PolyDrawMode::Triangles)
+		{
+			for (int j = 0; j < 3; j++)
+				vert[j] = VertexAt(thread, args, vertices, elements, t * 3 + j);
+		}
+		else if (drawmode == PolyDrawMode::TriangleFan)
+		{
+			vert[0] = VertexAt(thread, args, vertices, elements, 0);
+			vert[1] = VertexAt(thread, args, vertices, elements, t + 1);
+			vert[2] = VertexAt(thread, args, vertices, elements, t + 2);
+		}
+		else // TriangleDrawMode::TriangleStrip
+		{
+			for (int j = 0; j < 3; j++)
+				vert[j] = VertexAt(thread, args, vertices, elements, t + j);
+			if (t & 1)
+				ccw = !ccw;
+		}
+		thread->DrawShadedTriangle(vert, ccw, &triargs, &chunk);
+	}
+
+	std::sort(chunk.entries.begin(), chunk.entries.end());
+	chunk.done.store(true, std::memory_order_release);
+}
+
+void PolyBinChunk::Add(const TriDrawTriangleArgs *args, const PolyTriangleThreadData *thread)
+{
+	const ShadedTriVertex *sorted[3] = { args->v1, args->v2, args->v3 };
+	if (sorted[1]->y < sorted[0]->y)
+		std::swap(sorted[0], sorted[1]);
+	if (sorted[2]->y < sorted[0]->y)
+		std::swap(sorted[0], sorted[2]);
+	if (sorted[2]->y < sorted[1]->y)
+		std::swap(sorted[1], sorted[2]);
+
+	// Lines are rounded like ScreenTriangle::Draw does it
+	int firstLine = MAX((int)(sorted[0]->y + 0.5f), MAX(thread->viewport_y, 0));
+	int midLine = (int)(sorted[1]->y + 0.5f);
+	int endLine = MIN((int)(sorted[2]->y + 0.5f), thread->dest_height);
+	if (firstLine >= endLine || thread->dest_width <= 0)
+		return;
+
+	// Spans start and end at the truncated edge positions plus one half, which stay
+	// within the vertex bounds. Allow one extra pixel on each side for rounding.
+	float minX = MIN(MIN(args->v1->x, args->v2->x), args->v3->x);
+	float maxX = MAX(MAX(args->v1->x, args->v2->x), args->v3->x);
+	int left = (int)clamp(minX - 0.5f, 0.0f, (float)(thread->dest_width - 1));
+	int right = (int)clamp(maxX + 1.5f, 0.0f, (float)(thread->dest_width - 1));
+
+	uint32_t index = (uint32_t)triangles.size();
+	triangles.emplace_back();
+	PolyBinTriangle &tri = triangles.back();
+	tri.v[0] = *args->v1;
+	tri.v[1] = *args->v2;
+	tri.v[2] = *args->v3;
+	tri.gradientX = args->gradientX;
+	tri.gradientY = args->gradientY;
+	tri.topX = sorted[0]->x;
+	tri.topY = sorted[0]->y;
+	tri.midX = sorted[1]->x;
+	tri.midY = sorted[1]->y;
+	tri.longStep = (sorted[2]->x - sorted[0]->x) / (sorted[2]->y - sorted[0]->y);
+	tri.shortStep0 = (sorted[1]->x - sorted[0]->x) / (sorted[1]->y - sorted[0]->y);
+	tri.shortStep1 = (sorted[2]->x - sorted[1]->x) / (sorted[2]->y - sorted[1]->y);
+	tri.firstLine = firstLine;
+	tri.midLine = midLine;
+	tri.endLine = endLine;
+
+	int tilesX = (thread->dest_width + PolyTriangleBins::TileSize - 1) >> PolyTriangleBins::TileShift;
+	int tileLeft = left >> PolyTriangleBins::TileShift;
+	int tileRight = right >> PolyTriangleBins::TileShift;
+	int tileTop = firstLine >> PolyTriangleBins::TileShift;
+	int tileBottom = (endLine - 1) >> PolyTriangleBins::TileShift;
+	for (int ty = tileTop; ty <= tileBottom; ty++)
+	{
+		for (int tx = tileLeft; tx <= tileRight; tx++)
+			entries.push_back(((uint32_t)(ty * tilesX + tx) << 16) | index);
+	}
+}
+
+void PolyTriangleBins::DrawChunk(PolyTriangleThreadData *thread, const PolyDrawArgs &args, PolyBinChunk &chunk)
+{
+	using namespace TriScreenDrawerModes;
+
+	int opt = SWTRI_StencilTest;
+	if (args.DepthTest()) opt |= SWTRI_DepthTest;
+	if (args.WriteColor()) opt |= SWTRI_WriteColor;
+	if (args.WriteDepth()) opt |= SWTRI_WriteDepth;
+	if (args.WriteStencil()) opt |= SWTRI_WriteStencil;
+
+	size_t count = chunk.entries.size();
+	size_t i = 0;
+	while (i < count)
+	{
+		int tile = chunk.entries[i] >> 16;
+		size_t end = i + 1;
+		while (end < count && (int)(chunk.entries[end] >> 16) == tile)
+			end++;
+
+		// Skip tiles without any lines owned by this thread
+		int y0 = MAX((tile / tilesX) << TileShift, thread->numa_start_y);
+		int y1 = MIN(MIN(((tile / tilesX) << TileShift) + (int)TileSize, thread->dest_height), thread->numa_end_y);
+		if (y0 < y1 && y0 + thread->skipped_by_thread(y0) < y1)
+		{
+			PolyBinTileState &state = thread->binTiles[tile];
+			if (state.generation != thread->binGeneration)
+			{
+				state.generation = thread->binGeneration;
+				state.touches = 0;
+				state.known = false;
+			}
+
+			for (; i < end; i++)
+				DrawTriangle(thread, args, chunk.triangles[chunk.entries[i] & 0xffff], opt, tile, state);
+		}
+		i = end;
+	}
+}
+
+void PolyTriangleBins::FindTileState(PolyTriangleThreadData *thread, PolyBinTileState &state, int tile)
+{
+	int x0 = (tile % tilesX) << TileShift;
+	int x1 = MIN(x0 + (int)TileSize, thread->dest_width);
+	int y0 = (tile / tilesX) << TileShift;
+	int y1 = MIN(y0 + (int)TileSize, thread->dest_height);
+	y0 = MAX(y0, thread->numa_start_y);
+	y1 = MIN(y1, thread->numa_end_y);
+	y0 += thread->skipped_by_thread(y0);
+
+	const float *zbuffer = PolyZBuffer::Instance()->Values();
+	const uint8_t *stencilbuffer = PolyStencilBuffer::Instance()->Values();
+	int pitch = PolyStencilBuffer::Instance()->Width();
+
+	float minDepth = FLT_MAX;
+	float maxDepth = -FLT_MAX;
+	int stencil = stencilbuffer[y0 * pitch + x0];
+	for (int y = y0; y < y1; y += thread->num_cores)
+	{
+		const float *zbufferLine = zbuffer + y * pitch;
+		const uint8_t *stencilLine = stencilbuffer + y * pitch;
+		for (int x = x0; x < x1; x++)
+		{
+			minDepth = MIN(minDepth, zbufferLine[x]);
+			maxDepth = MAX(maxDepth, zbufferLine[x]);
+			if (stencilLine[x] != stencil)
+				stencil = -1;
+		}
+	}
+
+	state.known = true;
+	state.minDepth = minDepth;
+	state.maxDepth = maxDepth;
+	state.stencil = stencil;
+}
+
+void PolyTriangleBins::DrawTriangle(PolyTriangleThreadData *thread, const PolyDrawArgs &drawargs, PolyBinTriangle &tri, int opt, int tile, PolyBinTileState &state)
+{
+	using namespace TriScreenDrawerModes;
+
+	int clipleft = (tile % tilesX) << TileShift;
+	int clipright = MIN(clipleft + (int)TileSize, thread->dest_width);
+	int cliptop = (tile / tilesX) << TileShift;
+	int clipbottom = MIN(cliptop + (int)TileSize, thread->dest_height);
+
+	int topY = MAX(MAX(tri.firstLine, cliptop), thread->numa_start_y);
+	int bottomY = MIN(MIN(tri.endLine, clipbottom), thread->numa_end_y);
+	if (topY >= bottomY)
+		return;
+	topY += thread->skipped_by_thread(topY);
+	if (topY >= bottomY)
+		return;
+
+	TriDrawTriangleArgs args;
+	args.v1 = &tri.v[0];
+	args.v2 = &tri.v[1];
+	args.v3 = &tri.v[2];
+	args.uniforms = &drawargs;
+	args.gradientX = tri.gradientX;
+	args.gradientY = tri.gradientY;
+
+	// The first triangle in a tile is drawn without looking at the tile. From the
+	// second one on, the summary of the buffers can reject or simplify the triangle.
+	state.touches++;
+	if (!state.known && state.touches > 1)
+		FindTileState(thread, state, tile);
+
+	float minW = 0.0f, maxW = 0.0f;
+	if (state.known)
+	{
+		if (opt & (SWTRI_DepthTest | SWTRI_WriteDepth))
+		{
+			// Depth of the first and last pixel centers of the covered part of the tile
+			float weaponWOffset = thread->weaponScene ? 1.0f : 0.0f;
+			float posW = args.v1->w + weaponWOffset;
+			float left = args.gradientX.W * (clipleft + 0.5f - args.v1->x);
+			float right = args.gradientX.W * (clipright - 0.5f - args.v1->x);
+			float top = args.gradientY.W * (topY + 0.5f - args.v1->y);
+			float bottom = args.gradientY.W * (bottomY - 0.5f - args.v1->y);
+			minW = posW + MIN(left, right) + MIN(top, bottom);
+			maxW = posW + MAX(left, right) + MAX(top, bottom);
+
+			// The drawers step the depth incrementally
+			float epsilon = (fabs(minW) + fabs(maxW)) * (1.0f / 4096.0f);
+			minW -= epsilon;
+			maxW += epsilon;
+		}
+
+		if (opt & SWTRI_DepthTest)
+		{
+			if (maxW < state.minDepth)
+				return;
+			if (minW >= state.maxDepth)
+				opt &= ~SWTRI_DepthTest;
+		}
+
+		if (state.stencil != -1)
+		{
+			if (state.stencil != args.uniforms->StencilTestValue())
+				return;
+			opt &= ~SWTRI_StencilTest;
+		}
+	}
+
+	// Nothing to do if the remaining tests don't write anything
+	auto drawer = ScreenTriangle::TriangleDrawers[opt];
+	if (!drawer)
+		return;
+
+	int16_t *edges = thread->binEdges;
+	int num_cores = thread->num_cores;
+
+#ifndef NO_SSE
+	__m128 mtopX = _mm_set1_ps(tri.topX);
+	__m128 mtopY = _mm_set1_ps(tri.topY);
+	__m128 mmidX = _mm_set1_ps(tri.midX);
+	__m128 mmidY = _mm_set1_ps(tri.midY);
+	__m128 mlongStep = _mm_set1_ps(tri.longStep);
+	__m128 mshortStep0 = _mm_set1_ps(tri.shortStep0);
+	__m128 mshortStep1 = _mm_set1_ps(tri.shortStep1);
+	__m128 mmidLine = _mm_set1_ps((float)tri.midLine);
+	__m128 mclipleft = _mm_set1_ps((float)clipleft);
+	__m128 mclipright = _mm_set1_ps((float)clipright);
+	__m128 mhalf = _mm_set1_ps(0.5f);
+	__m128 mstepY = _mm_set1_ps((float)(num_cores * 4));
+	__m128 mposY = _mm_setr_ps(topY + 0.5f, topY + num_cores + 0.5f, topY + num_cores * 2 + 0.5f, topY + num_cores * 3 + 0.5f);
+	for (int y = topY; y < bottomY; y += num_cores * 4)
+	{
+		// Four of this thread's lines at a time
+		__m128 longPos = _mm_add_ps(_mm_add_ps(mtopX, _mm_mul_ps(mlongStep, _mm_sub_ps(mposY, mtopY))), mhalf);
+		__m128 shortPos0 = _mm_add_ps(_mm_add_ps(mtopX, _mm_mul_ps(mshortStep0, _mm_sub_ps(mposY, mtopY))), mhalf);
+		__m128 shortPos1 = _mm_add_ps(_mm_add_ps(mmidX, _mm_mul_ps(mshortStep1, _mm_sub_ps(mposY, mmidY))), mhalf);
+		__m128 upper = _mm_cmplt_ps(mposY, mmidLine);
+		__m128 shortPos = _mm_or_ps(_mm_and_ps(upper, shortPos0), _mm_andnot_ps(upper, shortPos1));
+
+		__m128 x0 = _mm_min_ps(_mm_max_ps(_mm_min_ps(shortPos, longPos), mclipleft), mclipright);
+		__m128 x1 = _mm_min_ps(_mm_max_ps(_mm_max_ps(shortPos, longPos), mclipleft), mclipright);
+
+		alignas(16) int32_t ix0[4], ix1[4];
+		_mm_store_si128((__m128i*)ix0, _mm_cvttps_epi32(x0));
+		_mm_store_si128((__m128i*)ix1, _mm_cvttps_epi32(x1));
+		for (int i = 0; i < 4; i++)
+		{
+			int line = y + i * num_cores;
+			if (line >= bottomY)
+				break;
+			edges[line << 1] = ix0[i];
+			edges[(line << 1) + 1] = ix1[i];
+		}
+
+		mposY = _mm_add_ps(mposY, mstepY);
+	}
+#else
+	for (int y = topY; y < bottomY; y += num_cores)
+	{
+		float posY = y + 0.5f;
+		float longPos = tri.topX + tri.longStep * (posY - tri.topY) + 0.5f;
+		float shortPos;
+		if (y < tri.midLine)
+			shortPos = tri.topX + tri.shortStep0 * (posY - tri.topY) + 0.5f;
+		else
+			shortPos = tri.midX + tri.shortStep1 * (posY - tri.midY) + 0.5f;
+
+		edges[y << 1] = (int)clamp(MIN(shortPos, longPos), (float)clipleft, (float)clipright);
+		edges[(y << 1) + 1] = (int)clamp(MAX(shortPos, longPos), (float)clipleft, (float)clipright);
+	}
+#endif
+
+	drawer(&args, thread, edges, topY, bottomY);
+
+	if (state.known)
+	{
+		if (opt & SWTRI_WriteDepth)
+		{
+			// With the depth test only closer values can be written
+			if (!args.uniforms->DepthTest())
+				state.minDepth = MIN(state.minDepth, minW);
+			state.maxDepth = MAX(state.maxDepth, maxW);
+		}
+		if ((opt & SWTRI_WriteStencil) && state.stencil != args.uniforms->StencilWriteValue())
+			state.stencil = -1;
+	}
+}
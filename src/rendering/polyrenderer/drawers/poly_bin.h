@@ -0,0 +1,107 @@
+/*
+** poly_bin.h
+** Tiled triangle binning for the softpoly drawers
+**
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "polyrenderer/drawers/poly_draw_args.h"
+
+class PolyTriangleThreadData;
+
+// Triangle that has been clipped, projected and set up once for all drawer threads
+struct PolyBinTriangle
+{
+	ShadedTriVertex v[3];
+	ScreenTriangleStepVariables gradientX;
+	ScreenTriangleStepVariables gradientY;
+
+	// Edges, from the vertices sorted by y the same way ScreenTriangle::Draw does it
+	float topX, topY, midX, midY;
+	float longStep, shortStep0, shortStep1;
+
+	// Lines covered by the triangle, clipped to the viewport
+	int firstLine, midLine, endLine;
+};
+
+// Triangles set up from a consecutive range of the draw's triangles
+struct PolyBinChunk
+{
+	std::vector<PolyBinTriangle> triangles;
+
+	// Tile index in the upper and triangle index in the lower 16 bits, sorted by tile
+	std::vector<uint32_t> entries;
+
+	std::atomic<bool> done;
+
+	void Add(const TriDrawTriangleArgs *args, const PolyTriangleThreadData *thread);
+};
+
+// What a drawer thread knows about the depth and stencil values of its lines in a tile
+struct PolyBinTileState
+{
+	uint32_t generation = 0;
+	int touches = 0;
+	bool known = false;
+	float minDepth = 0.0f;
+	float maxDepth = 0.0f;
+	int stencil = -1; // -1 when the tile holds different stencil values
+};
+
+// Shared state of a binned draw command. Every drawer thread that executes the
+// command helps shading vertices and setting up triangles until all that work has
+// been claimed, then rasterizes its own lines chunk by chunk in submission order.
+class PolyTriangleBins
+{
+public:
+	enum
+	{
+		TileSize = 64,
+		TileShift = 6,
+		VerticesPerChunk = 1024,
+		TrianglesPerChunk = 256,
+		MinTriangles = 64
+	};
+
+	static PolyTriangleBins *Acquire();
+	static void Release(PolyTriangleBins *bins);
+
+	void Draw(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int count, PolyDrawMode mode);
+
+private:
+	void Init(PolyTriangleThreadData *thread, const unsigned int *elements, int count, PolyDrawMode mode);
+	ShadedTriVertex VertexAt(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int index);
+	void ShadeChunk(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, int chunk);
+	void SetupChunk(PolyTriangleThreadData *thread, const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int chunk);
+	void DrawChunk(PolyTriangleThreadData *thread, const PolyDrawArgs &args, PolyBinChunk &chunk);
+	void DrawTriangle(PolyTriangleThreadData *thread, const PolyDrawArgs &args, PolyBinTriangle &tri, int opt, int tile, PolyBinTileState &state);
+	void FindTileState(PolyTriangleThreadData *thread, PolyBinTileState &state, int tile);
+
+	std::mutex initMutex;
+	bool initialized = false;
+
+	PolyDrawMode drawmode;
+	int numTriangles = 0;
+	int numVertexChunks = 0;
+	int numTriangleChunks = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+
+	// Vertices shaded by the vertex chunks, unless the elements only use a few of them
+	std::vector<ShadedTriVertex> shaded;
+	unsigned int firstVertex = 0;
+	int numVertices = 0;
+	bool sparse = false;
+
+	std::atomic<int> nextWork;
+	std::atomic<int> vertexChunksDone;
+	std::vector<std::unique_ptr<PolyBinChunk>> chunks;
+
+	static std::mutex poolMutex;
+	static std::vector<std::unique_ptr<PolyTriangleBins>> pool;
+};
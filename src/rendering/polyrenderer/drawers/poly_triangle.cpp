@@ -38,8 +38,12 @@
 #include "polyrenderer/poly_renderer.h"
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "screen_triangle.h"
+#include "poly_bench.h"
 #include "x86.h"
 
+CVAR(Bool, r_poly_threadcull, true, 0)
+CVAR(Bool, r_poly_binning, false, 0)
+
 static bool isBgraRenderTarget = false;
 
 void PolyTriangleDrawer::ResizeBuffers(DCanvas *canvas)
@@ -166,40 +170,27 @@ void PolyTriangleThreadData::DrawElements(const PolyDrawArgs &drawargs, const vo
 	TriDrawTriangleArgs args;
 	args.uniforms = &drawargs;
 
-	ShadedTriVertex vert[3];
-	if (drawmode == PolyDrawMode::Triangles)
+	unsigned int minindex = elements[0];
+	unsigned int maxindex = elements[0];
+	for (int i = 1; i < vcount; i++)
 	{
-		for (int i = 0; i < vcount / 3; i++)
-		{
-			for (int j = 0; j < 3; j++)
-				vert[j] = ShadeVertex(drawargs, vertices, *(elements++));
-			DrawShadedTriangle(vert, ccw, &args);
-		}
+		minindex = MIN(minindex, elements[i]);
+		maxindex = MAX(maxindex, elements[i]);
 	}
-	else if (drawmode == PolyDrawMode::TriangleFan)
+
+	// Shade every referenced vertex once, unless the elements only use a few of them
+	int numverts = maxindex - minindex + 1;
+	if (numverts <= vcount * 2)
 	{
-		vert[0] = ShadeVertex(drawargs, vertices, *(elements++));
-		vert[1] = ShadeVertex(drawargs, vertices, *(elements++));
-		for (int i = 2; i < vcount; i++)
-		{
-			vert[2] = ShadeVertex(drawargs, vertices, *(elements++));
-			DrawShadedTriangle(vert, ccw, &args);
-			vert[1] = vert[2];
-		}
+		if (shadedVertices.size() < (size_t)numverts)
+			shadedVertices.resize(numverts);
+		ShadedTriVertex *shaded = shadedVertices.data();
+		ShadeVertices(drawargs, vertices, minindex, numverts, shaded);
+		DrawTriangles([=](int i) -> const ShadedTriVertex & { return shaded[elements[i] - minindex]; }, vcount, drawmode, &args);
 	}
-	else // TriangleDrawMode::TriangleStrip
+	else
 	{
-		bool toggleccw = ccw;
-		vert[0] = ShadeVertex(drawargs, vertices, *(elements++));
-		vert[1] = ShadeVertex(drawargs, vertices, *(elements++));
-		for (int i = 2; i < vcount; i++)
-		{
-			vert[2] = ShadeVertex(drawargs, vertices, *(elements++));
-			DrawShadedTriangle(vert, toggleccw, &args);
-			vert[0] = vert[1];
-			vert[1] = vert[2];
-			toggleccw = !toggleccw;
-		}
+		DrawTriangles([&](int i) { return ShadeVertex(drawargs, vertices, elements[i]); }, vcount, drawmode, &args);
 	}
 }
 
@@ -211,6 +202,16 @@ void PolyTriangleThreadData::DrawArray(const PolyDrawArgs &drawargs, const void
 	TriDrawTriangleArgs args;
 	args.uniforms = &drawargs;
 
+	if (shadedVertices.size() < (size_t)vcount)
+		shadedVertices.resize(vcount);
+	ShadedTriVertex *shaded = shadedVertices.data();
+	ShadeVertices(drawargs, vertices, 0, vcount, shaded);
+	DrawTriangles([=](int i) -> const ShadedTriVertex & { return shaded[i]; }, vcount, drawmode, &args);
+}
+
+template<typename VertexSource>
+void PolyTriangleThreadData::DrawTriangles(VertexSource vertexAt, int vcount, PolyDrawMode drawmode, TriDrawTriangleArgs *args)
+{
 	int vinput = 0;
 
 	ShadedTriVertex vert[3];
@@ -219,30 +220,30 @@ void PolyTriangleThreadData::DrawArray(const PolyDrawArgs &drawargs, const void
 		for (int i = 0; i < vcount / 3; i++)
 		{
 			for (int j = 0; j < 3; j++)
-				vert[j] = ShadeVertex(drawargs, vertices, vinput++);
-			DrawShadedTriangle(vert, ccw, &args);
+				vert[j] = vertexAt(vinput++);
+			DrawShadedTriangle(vert, ccw, args);
 		}
 	}
 	else if (drawmode == PolyDrawMode::TriangleFan)
 	{
-		vert[0] = ShadeVertex(drawargs, vertices, vinput++);
-		vert[1] = ShadeVertex(drawargs, vertices, vinput++);
+		vert[0] = vertexAt(vinput++);
+		vert[1] = vertexAt(vinput++);
 		for (int i = 2; i < vcount; i++)
 		{
-			vert[2] = ShadeVertex(drawargs, vertices, vinput++);
-			DrawShadedTriangle(vert, ccw, &args);
+			vert[2] = vertexAt(vinput++);
+			DrawShadedTriangle(vert, ccw, args);
 			vert[1] = vert[2];
 		}
 	}
 	else // TriangleDrawMode::TriangleStrip
 	{
 		bool toggleccw = ccw;
-		vert[0] = ShadeVertex(drawargs, vertices, vinput++);
-		vert[1] = ShadeVertex(drawargs, vertices, vinput++);
+		vert[0] = vertexAt(vinput++);
+		vert[1] = vertexAt(vinput++);
 		for (int i = 2; i < vcount; i++)
 		{
-			vert[2] = ShadeVertex(drawargs, vertices, vinput++);
-			DrawShadedTriangle(vert, toggleccw, &args);
+			vert[2] = vertexAt(vinput++);
+			DrawShadedTriangle(vert, toggleccw, args);
 			vert[0] = vert[1];
 			vert[1] = vert[2];
 			toggleccw = !toggleccw;
@@ -250,24 +251,99 @@ void PolyTriangleThreadData::DrawArray(const PolyDrawArgs &drawargs, const void
 	}
 }
 
-ShadedTriVertex PolyTriangleThreadData::ShadeVertex(const PolyDrawArgs &drawargs, const void *vertices, int index)
+void PolyTriangleThreadData::ShadeVertices(const PolyDrawArgs &drawargs, const void *vertices, int first, int count, ShadedTriVertex *out)
 {
-	ShadedTriVertex sv;
-	Vec4f objpos;
+	int i = 0;
+#ifndef NO_SSE
+	// Four vertices at a time, with the same operations in the same order as Mat4f::operator* and ShadeVertex
+	const float *clip = objectToClip->Matrix;
+	const float *world = objectToWorld ? objectToWorld->Matrix : nullptr;
 
+	auto transform = [](const float *m, int row, __m128 x, __m128 y, __m128 z, __m128 w)
+	{
+		__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[row]), x), _mm_mul_ps(_mm_set1_ps(m[4 + row]), y));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m[8 + row]), z));
+		return _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m[12 + row]), w));
+	};
+
+	for (; i + 4 <= count; i += 4)
+	{
+		alignas(16) float objpos[4][4];
+		for (int j = 0; j < 4; j++)
+		{
+			Vec4f pos = FetchVertex(vertices, first + i + j, out[i + j]);
+			objpos[0][j] = pos.X;
+			objpos[1][j] = pos.Y;
+			objpos[2][j] = pos.Z;
+			objpos[3][j] = pos.W;
+		}
+		__m128 x = _mm_load_ps(objpos[0]);
+		__m128 y = _mm_load_ps(objpos[1]);
+		__m128 z = _mm_load_ps(objpos[2]);
+		__m128 w = _mm_load_ps(objpos[3]);
+
+		alignas(16) float result[10][4];
+		for (int row = 0; row < 4; row++)
+			_mm_store_ps(result[row], transform(clip, row, x, y, z, w));
+
+		if (!world) // Identity matrix
+		{
+			_mm_store_ps(result[4], x);
+			_mm_store_ps(result[5], y);
+			_mm_store_ps(result[6], z);
+		}
+		else
+		{
+			for (int row = 0; row < 3; row++)
+				_mm_store_ps(result[4 + row], transform(world, row, x, y, z, w));
+		}
+
+		// Calculate gl_ClipDistance[i]
+		for (int c = 0; c < 3; c++)
+		{
+			const auto &clipPlane = drawargs.ClipPlane(c);
+			__m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(clipPlane.A)), _mm_mul_ps(y, _mm_set1_ps(clipPlane.B)));
+			d = _mm_add_ps(d, _mm_mul_ps(z, _mm_set1_ps(clipPlane.C)));
+			d = _mm_add_ps(d, _mm_mul_ps(w, _mm_set1_ps(clipPlane.D)));
+			_mm_store_ps(result[7 + c], d);
+		}
+
+		for (int j = 0; j < 4; j++)
+		{
+			ShadedTriVertex &sv = out[i + j];
+			sv.x = result[0][j];
+			sv.y = result[1][j];
+			sv.z = result[2][j];
+			sv.w = result[3][j];
+			sv.worldX = result[4][j];
+			sv.worldY = result[5][j];
+			sv.worldZ = result[6][j];
+			sv.clipDistance[0] = result[7][j];
+			sv.clipDistance[1] = result[8][j];
+			sv.clipDistance[2] = result[9][j];
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = ShadeVertex(drawargs, vertices, first + i);
+}
+
+Vec4f PolyTriangleThreadData::FetchVertex(const void *vertices, int index, ShadedTriVertex &sv)
+{
 	if (modelFrame1 == -1)
 	{
 		const TriVertex &v = static_cast<const TriVertex*>(vertices)[index];
-		objpos = Vec4f(v.x, v.y, v.z, v.w);
 		sv.u = v.u;
 		sv.v = v.v;
+		return Vec4f(v.x, v.y, v.z, v.w);
 	}
 	else if (modelFrame1 == modelFrame2 || modelInterpolationFactor == 0.f)
 	{
 		const FModelVertex &v = static_cast<const FModelVertex*>(vertices)[modelFrame1 + index];
-		objpos = Vec4f(v.x, v.y, v.z, 1.0f);
 		sv.u = v.u;
 		sv.v = v.v;
+		return Vec4f(v.x, v.y, v.z, 1.0f);
 	}
 	else
 	{
@@ -277,10 +353,16 @@ ShadedTriVertex PolyTriangleThreadData::ShadeVertex(const PolyDrawArgs &drawargs
 		float frac = modelInterpolationFactor;
 		float inv_frac = 1.0f - frac;
 
-		objpos = Vec4f(v1.x * inv_frac + v2.x * frac, v1.y * inv_frac + v2.y * frac, v1.z * inv_frac + v2.z * frac, 1.0f);
 		sv.u = v1.u;
 		sv.v = v1.v;
+		return Vec4f(v1.x * inv_frac + v2.x * frac, v1.y * inv_frac + v2.y * frac, v1.z * inv_frac + v2.z * frac, 1.0f);
 	}
+}
+
+ShadedTriVertex PolyTriangleThreadData::ShadeVertex(const PolyDrawArgs &drawargs, const void *vertices, int index)
+{
+	ShadedTriVertex sv;
+	Vec4f objpos = FetchVertex(vertices, index, sv);
 
 	// Apply transform to get clip coordinates:
 	Vec4f clippos = (*objectToClip) * objpos;
@@ -339,12 +421,45 @@ bool PolyTriangleThreadData::IsFrontfacing(TriDrawTriangleArgs *args)
 	return a <= 0.0f;
 }
 
-void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, bool ccw, TriDrawTriangleArgs *args)
+bool PolyTriangleThreadData::IsVisibleToThread(const ShadedTriVertex *vert)
+{
+	// Clipping can only shrink the triangle, so if it is fully in front of the eye its
+	// projected vertices give conservative bounds for the lines it covers.
+	if (vert[0].w <= 0.0f || vert[1].w <= 0.0f || vert[2].w <= 0.0f)
+		return true;
+
+	float miny = FLT_MAX, maxy = -FLT_MAX;
+	for (int i = 0; i < 3; i++)
+	{
+		float y = viewport_y + viewport_height * (1.0f - vert[i].y / vert[i].w) * 0.5f;
+		miny = MIN(miny, y);
+		maxy = MAX(maxy, y);
+	}
+	return IsVisibleToThread(miny, maxy);
+}
+
+bool PolyTriangleThreadData::IsVisibleToThread(float miny, float maxy)
+{
+	// ScreenTriangle::Draw covers the lines from round(miny) to round(maxy), exclusive
+	miny = clamp(miny, 0.0f, (float)dest_height);
+	maxy = clamp(maxy, 0.0f, (float)dest_height);
+	int y0 = MAX((int)miny, numa_start_y);
+	int y1 = MIN((int)maxy + 1, numa_end_y);
+	return y0 < y1 && y0 + skipped_by_thread(y0) < y1;
+}
+
+void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, bool ccw, TriDrawTriangleArgs *args, PolyBinChunk *bin)
 {
 	// Reject triangle if degenerate
 	if (IsDegenerate(vert))
 		return;
 
+	// Every drawer thread sees every triangle. Skip clipping and setup if this one
+	// is not going to draw any of its lines anyway. Binned triangles are set up for all threads.
+	bool threadcull = !bin && r_poly_threadcull && num_cores > 1;
+	if (threadcull && !IsVisibleToThread(vert))
+		return;
+
 	// Cull, clip and generate additional vertices as needed
 	ShadedTriVertex clippedvert[max_additional_vertices];
 	int numclipvert = ClipEdge(vert, clippedvert);
@@ -399,6 +514,18 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, boo
 	}
 #endif
 
+	if (threadcull && numclipvert > 0)
+	{
+		float miny = clippedvert[0].y, maxy = clippedvert[0].y;
+		for (int i = 1; i < numclipvert; i++)
+		{
+			miny = MIN(miny, clippedvert[i].y);
+			maxy = MAX(maxy, clippedvert[i].y);
+		}
+		if (!IsVisibleToThread(miny, maxy))
+			return;
+	}
+
 	// Keep varyings in -128 to 128 range if possible
 	// But don't do this for the skycap mode since the V texture coordinate is used for blending
 	if (numclipvert > 0 && args->uniforms->BlendMode() != TriBlendMode::Skycap)
@@ -430,7 +557,10 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, boo
 			args->v3 = &clippedvert[i - 2];
 			if (IsFrontfacing(args) == ccw && args->CalculateGradients())
 			{
-				ScreenTriangle::Draw(args, this);
+				if (bin)
+					bin->Add(args, this);
+				else
+					ScreenTriangle::Draw(args, this);
 			}
 		}
 	}
@@ -443,7 +573,10 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, boo
 			args->v3 = &clippedvert[i];
 			if (IsFrontfacing(args) != ccw && args->CalculateGradients())
 			{
-				ScreenTriangle::Draw(args, this);
+				if (bin)
+					bin->Add(args, this);
+				else
+					ScreenTriangle::Draw(args, this);
 			}
 		}
 	}
@@ -641,6 +774,13 @@ void PolySetTransformCommand::Execute(DrawerThread *thread)
 	PolyTriangleThreadData::Get(thread)->SetTransform(objectToClip, objectToWorld);
 }
 
+void PolySetTransformCommand::Record(PolyCommandRecorder &recorder) const
+{
+	const Mat4f *clip = objectToClip ? recorder.Copy(objectToClip, 1) : nullptr;
+	const Mat4f *world = objectToWorld ? recorder.Copy(objectToWorld, 1) : nullptr;
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<PolySetTransformCommand>(clip, world); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolySetCullCCWCommand::PolySetCullCCWCommand(bool ccw) : ccw(ccw)
@@ -652,6 +792,12 @@ void PolySetCullCCWCommand::Execute(DrawerThread *thread)
 	PolyTriangleThreadData::Get(thread)->SetCullCCW(ccw);
 }
 
+void PolySetCullCCWCommand::Record(PolyCommandRecorder &recorder) const
+{
+	bool value = ccw;
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<PolySetCullCCWCommand>(value); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolySetTwoSidedCommand::PolySetTwoSidedCommand(bool twosided) : twosided(twosided)
@@ -663,6 +809,12 @@ void PolySetTwoSidedCommand::Execute(DrawerThread *thread)
 	PolyTriangleThreadData::Get(thread)->SetTwoSided(twosided);
 }
 
+void PolySetTwoSidedCommand::Record(PolyCommandRecorder &recorder) const
+{
+	bool value = twosided;
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<PolySetTwoSidedCommand>(value); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolySetWeaponSceneCommand::PolySetWeaponSceneCommand(bool value) : value(value)
@@ -674,6 +826,12 @@ void PolySetWeaponSceneCommand::Execute(DrawerThread *thread)
 	PolyTriangleThreadData::Get(thread)->SetWeaponScene(value);
 }
 
+void PolySetWeaponSceneCommand::Record(PolyCommandRecorder &recorder) const
+{
+	bool enable = value;
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<PolySetWeaponSceneCommand>(enable); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolySetModelVertexShaderCommand::PolySetModelVertexShaderCommand(int frame1, int frame2, float interpolationFactor) : frame1(frame1), frame2(frame2), interpolationFactor(interpolationFactor)
@@ -685,6 +843,14 @@ void PolySetModelVertexShaderCommand::Execute(DrawerThread *thread)
 	PolyTriangleThreadData::Get(thread)->SetModelVertexShader(frame1, frame2, interpolationFactor);
 }
 
+void PolySetModelVertexShaderCommand::Record(PolyCommandRecorder &recorder) const
+{
+	int f1 = frame1, f2 = frame2;
+	float factor = interpolationFactor;
+	recorder.ModelFrame1 = frame1;
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<PolySetModelVertexShaderCommand>(f1, f2, factor); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolyClearStencilCommand::PolyClearStencilCommand(uint8_t value) : value(value)
@@ -696,6 +862,12 @@ void PolyClearStencilCommand::Execute(DrawerThread *thread)
 	PolyTriangleThreadData::Get(thread)->ClearStencil(value);
 }
 
+void PolyClearStencilCommand::Record(PolyCommandRecorder &recorder) const
+{
+	uint8_t stencil = value;
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<PolyClearStencilCommand>(stencil); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolySetViewportCommand::PolySetViewportCommand(int x, int y, int width, int height, uint8_t *dest, int dest_width, int dest_height, int dest_pitch, bool dest_bgra)
@@ -708,20 +880,70 @@ void PolySetViewportCommand::Execute(DrawerThread *thread)
 	PolyTriangleThreadData::Get(thread)->SetViewport(x, y, width, height, dest, dest_width, dest_height, dest_pitch, dest_bgra);
 }
 
+void PolySetViewportCommand::Record(PolyCommandRecorder &recorder) const
+{
+	// dest points at most one canvas width into the canvas, so the viewport fits
+	// into pitch * height pixels when it is moved to the start of the buffer.
+	int vx = x, vy = y, vwidth = width, vheight = height, dwidth = dest_width, dheight = dest_height, dpitch = dest_pitch;
+	bool bgra = dest_bgra;
+	recorder.AddTarget((size_t)dest_pitch * dest_height * (dest_bgra ? 4 : 1));
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<PolySetViewportCommand>(vx, vy, vwidth, vheight, dest, dwidth, dheight, dpitch, bgra); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 DrawPolyTrianglesCommand::DrawPolyTrianglesCommand(const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int count, PolyDrawMode mode) : args(args), vertices(vertices), elements(elements), count(count), mode(mode)
 {
+	// Binning only pays off when there are enough triangles to share the setup of
+	int numTriangles = (mode == PolyDrawMode::Triangles) ? count / 3 : count - 2;
+	if (r_poly_binning && r_multithreaded != 0 && numTriangles >= PolyTriangleBins::MinTriangles)
+		bins = PolyTriangleBins::Acquire();
+}
+
+DrawPolyTrianglesCommand::~DrawPolyTrianglesCommand()
+{
+	if (bins)
+		PolyTriangleBins::Release(bins);
 }
 
 void DrawPolyTrianglesCommand::Execute(DrawerThread *thread)
 {
-	if (!elements)
+	if (bins && thread->num_cores > 1)
+		bins->Draw(PolyTriangleThreadData::Get(thread), args, vertices, elements, count, mode);
+	else if (!elements)
 		PolyTriangleThreadData::Get(thread)->DrawArray(args, vertices, count, mode);
 	else
 		PolyTriangleThreadData::Get(thread)->DrawElements(args, vertices, elements, count, mode);
 }
 
+void DrawPolyTrianglesCommand::Record(PolyCommandRecorder &recorder) const
+{
+	PolyDrawArgs drawargs = args;
+	if (args.NumLights() > 0)
+		drawargs.SetLights(const_cast<PolyLight *>(recorder.Copy(args.Lights(), args.NumLights())), args.NumLights());
+
+	int numvertices = count;
+	const unsigned int *drawelements = nullptr;
+	if (elements)
+	{
+		numvertices = 0;
+		for (int i = 0; i < count; i++)
+			numvertices = MAX(numvertices, (int)elements[i] + 1);
+		drawelements = recorder.Copy(elements, count);
+	}
+
+	// Model vertex buffers live as long as the model, so only frame vertices are copied
+	const void *drawvertices = vertices;
+	if (recorder.ModelFrame1 == -1)
+		drawvertices = recorder.Copy(static_cast<const TriVertex *>(vertices), numvertices);
+
+	PolyDrawMode drawmode = mode;
+	int drawcount = count;
+	recorder.Draws++;
+	recorder.Triangles += MAX((mode == PolyDrawMode::Triangles) ? count / 3 : count - 2, 0);
+	recorder.Add([=](const DrawerCommandQueuePtr &queue, uint8_t *dest) { queue->Push<DrawPolyTrianglesCommand>(drawargs, drawvertices, drawelements, drawcount, drawmode); });
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 void DrawRectCommand::Execute(DrawerThread *thread)
@@ -737,3 +959,8 @@ void DrawRectCommand::Execute(DrawerThread *thread)
 	else
 		ScreenTriangle::RectDrawers8[blendmode](destOrg, destWidth, destHeight, destPitch, &args, PolyTriangleThreadData::Get(thread));
 }
+
+void DrawRectCommand::Record(PolyCommandRecorder &recorder) const
+{
+	// Rects draw straight into the render target and don't use the triangle rasterizer
+}
@@ -28,8 +28,10 @@
 #include "polyrenderer/math/gpu_types.h"
 #include "polyrenderer/drawers/poly_buffer.h"
 #include "polyrenderer/drawers/poly_draw_args.h"
+#include "polyrenderer/drawers/poly_bin.h"
 
 class PolyDrawerCommand;
+class PolyCommandRecorder;
 
 class PolyTriangleDrawer
 {
@@ -110,9 +112,19 @@ public:
 
 	int viewport_y = 0;
 
+	// Lines of binned triangles and what this thread knows about its part of each tile
+	int16_t binEdges[MAXHEIGHT * 2];
+	std::vector<PolyBinTileState> binTiles;
+	uint32_t binGeneration = 0;
+
 private:
 	ShadedTriVertex ShadeVertex(const PolyDrawArgs &drawargs, const void *vertices, int index);
-	void DrawShadedTriangle(const ShadedTriVertex *vertices, bool ccw, TriDrawTriangleArgs *args);
+	void ShadeVertices(const PolyDrawArgs &drawargs, const void *vertices, int first, int count, ShadedTriVertex *out);
+	Vec4f FetchVertex(const void *vertices, int index, ShadedTriVertex &sv);
+	template<typename VertexSource> void DrawTriangles(VertexSource vertexAt, int vcount, PolyDrawMode mode, TriDrawTriangleArgs *args);
+	void DrawShadedTriangle(const ShadedTriVertex *vertices, bool ccw, TriDrawTriangleArgs *args, PolyBinChunk *bin = nullptr);
+	bool IsVisibleToThread(const ShadedTriVertex *vertices);
+	bool IsVisibleToThread(float miny, float maxy);
 	static bool IsDegenerate(const ShadedTriVertex *vertices);
 	static bool IsFrontfacing(TriDrawTriangleArgs *args);
 	static int ClipEdge(const ShadedTriVertex *verts, ShadedTriVertex *clippedvert);
@@ -129,11 +141,18 @@ private:
 	float modelInterpolationFactor = 0.0f;
 
 	enum { max_additional_vertices = 16 };
+
+	// Post-transform vertices of the current draw
+	std::vector<ShadedTriVertex> shadedVertices;
+
+	friend class PolyTriangleBins;
 };
 
 class PolyDrawerCommand : public DrawerCommand
 {
 public:
+	// Adds a copy of the command to a recording that outlives the frame
+	virtual void Record(PolyCommandRecorder &recorder) const = 0;
 };
 
 class PolySetTransformCommand : public PolyDrawerCommand
@@ -142,6 +161,7 @@ public:
 	PolySetTransformCommand(const Mat4f *objectToClip, const Mat4f *objectToWorld);
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	const Mat4f *objectToClip;
@@ -154,6 +174,7 @@ public:
 	PolySetCullCCWCommand(bool ccw);
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	bool ccw;
@@ -165,6 +186,7 @@ public:
 	PolySetTwoSidedCommand(bool twosided);
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	bool twosided;
@@ -176,6 +198,7 @@ public:
 	PolySetWeaponSceneCommand(bool value);
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	bool value;
@@ -187,6 +210,7 @@ public:
 	PolySetModelVertexShaderCommand(int frame1, int frame2, float interpolationFactor);
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	int frame1;
@@ -200,6 +224,7 @@ public:
 	PolyClearStencilCommand(uint8_t value);
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	uint8_t value;
@@ -211,6 +236,7 @@ public:
 	PolySetViewportCommand(int x, int y, int width, int height, uint8_t *dest, int dest_width, int dest_height, int dest_pitch, bool dest_bgra);
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	int x;
@@ -228,8 +254,10 @@ class DrawPolyTrianglesCommand : public PolyDrawerCommand
 {
 public:
 	DrawPolyTrianglesCommand(const PolyDrawArgs &args, const void *vertices, const unsigned int *elements, int count, PolyDrawMode mode);
+	~DrawPolyTrianglesCommand();
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	PolyDrawArgs args;
@@ -237,6 +265,7 @@ private:
 	const unsigned int *elements;
 	int count;
 	PolyDrawMode mode;
+	PolyTriangleBins *bins = nullptr;
 };
 
 class DrawRectCommand : public PolyDrawerCommand
@@ -245,6 +274,7 @@ public:
 	DrawRectCommand(const RectDrawArgs &args) : args(args) { }
 
 	void Execute(DrawerThread *thread) override;
+	void Record(PolyCommandRecorder &recorder) const override;
 
 private:
 	RectDrawArgs args;
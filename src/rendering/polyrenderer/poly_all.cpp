@@ -1,6 +1,8 @@
 #include "../swrenderer/textures/r_swtexture.h"
 #include "poly_renderer.cpp"
 #include "poly_renderthread.cpp"
+#include "drawers/poly_bench.cpp"
+#include "drawers/poly_bin.cpp"
 #include "drawers/poly_buffer.cpp"
 #include "drawers/poly_draw_args.cpp"
 #include "drawers/poly_triangle.cpp"
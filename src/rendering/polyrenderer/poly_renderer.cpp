@@ -36,6 +36,7 @@
 #include "p_effect.h"
 #include "actorinlines.h"
 #include "polyrenderer/scene/poly_light.h"
+#include "polyrenderer/drawers/poly_bench.h"
 #include "swrenderer/scene/r_scene.h"
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/viewport/r_viewport.h"
@@ -68,6 +69,8 @@ void PolyRenderer::RenderView(player_t *player, DCanvas *target, void *videobuff
 	RenderTarget = target;
 	RenderToCanvas = false;
 
+	PolyDrawBenchmark::BeginFrame();
+
 	RenderActorView(player->mo, false);
 
 	Threads.MainThread()->FlushDrawQueue();
@@ -79,6 +82,8 @@ void PolyRenderer::RenderView(player_t *player, DCanvas *target, void *videobuff
 	PolyDrawerWaitCycles.Clock();
 	DrawerThreads::WaitForWorkers();
 	PolyDrawerWaitCycles.Unclock();
+
+	PolyDrawBenchmark::EndFrame();
 }
 
 void PolyRenderer::RenderViewToCanvas(AActor *actor, DCanvas *canvas, int x, int y, int width, int height, bool dontmaplines)
@@ -66,6 +66,12 @@ void DrawerThreads::Execute(DrawerCommandQueuePtr commands)
 	
 	auto queue = Instance();
 
+	if (queue->command_recorder)
+	{
+		for (auto command : commands->commands)
+			queue->command_recorder(command);
+	}
+
 	queue->StartThreads();
 
 	// Add to queue and awaken worker threads
@@ -95,6 +101,11 @@ void DrawerThreads::ResetDebugDrawPos()
 		queue->debug_draw_end = 0;
 }
 
+void DrawerThreads::SetCommandRecorder(std::function<void(DrawerCommand *command)> recorder)
+{
+	Instance()->command_recorder = std::move(recorder);
+}
+
 void DrawerThreads::WaitForWorkers()
 {
 	using namespace std::chrono_literals;
@@ -25,6 +25,7 @@
 #include "r_draw.h"
 #include <vector>
 #include <memory>
+#include <functional>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -150,6 +151,9 @@ public:
 	static void WaitForWorkers();
 
 	static void ResetDebugDrawPos();
+
+	// Passes every command to the recorder as its queue is submitted, until cleared
+	static void SetCommandRecorder(std::function<void(DrawerCommand *command)> recorder);
 	
 private:
 	DrawerThreads();
@@ -175,6 +179,8 @@ private:
 
 	size_t debug_draw_end = 0;
 
+	std::function<void(DrawerCommand *command)> command_recorder;
+
 	DrawerThread single_core_thread;
 	
 	friend class DrawerCommandQueue;
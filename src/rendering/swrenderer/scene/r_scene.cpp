@@ -67,6 +67,7 @@ EXTERN_CVAR(Int, r_clearbuffer)
 EXTERN_CVAR(Int, r_debug_draw)
 
 CVAR(Int, r_scene_multithreaded, 0, 0);
+CVAR(Bool, r_scene_balance, true, 0);
 CVAR(Bool, r_models, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 bool r_modelscene = false;
@@ -74,6 +75,13 @@ bool r_modelscene = false;
 namespace swrenderer
 {
 	cycle_t WallCycles, PlaneCycles, MaskedCycles, DrawerWaitCycles;
+
+	struct SliceStat
+	{
+		int X1, X2;
+		double Time;
+	};
+	static std::vector<SliceStat> LastSlices;
 	
 	RenderScene::RenderScene()
 	{
@@ -214,14 +222,27 @@ namespace swrenderer
 			StartThreads(numThreads);
 		}
 
+		// Camera textures get an even split so that they do not disturb the balance of the main view
+		bool balance = r_scene_balance && numThreads > 1 && !MainThread()->Viewport->RenderingToCanvas;
+		if (balance)
+			UpdateSliceSplits(numThreads);
+
 		// Setup threads:
 		std::unique_lock<std::mutex> start_lock(start_mutex);
 		for (int i = 0; i < numThreads; i++)
 		{
 			*Threads[i]->Viewport = *MainThread()->Viewport;
 			*Threads[i]->Light = *MainThread()->Light;
-			Threads[i]->X1 = viewwidth * i / numThreads;
-			Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			if (balance)
+			{
+				Threads[i]->X1 = xs_RoundToInt(viewwidth * SliceSplits[i]);
+				Threads[i]->X2 = xs_RoundToInt(viewwidth * SliceSplits[i + 1]);
+			}
+			else
+			{
+				Threads[i]->X1 = viewwidth * i / numThreads;
+				Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			}
 		}
 		run_id++;
 		start_lock.unlock();
@@ -253,13 +274,77 @@ namespace swrenderer
 			finished_threads = 0;
 		}
 
+		if (!MainThread()->Viewport->RenderingToCanvas)
+		{
+			LastSlices.resize(numThreads);
+			for (int i = 0; i < numThreads; i++)
+				LastSlices[i] = { Threads[i]->X1, Threads[i]->X2, Threads[i]->SliceTime };
+		}
+
+		if (balance)
+		{
+			SliceTimes.resize(numThreads);
+			for (int i = 0; i < numThreads; i++)
+				SliceTimes[i] = Threads[i]->SliceTime;
+		}
+
 		// Change main thread back to covering the whole screen for player sprites
 		MainThread()->X1 = 0;
 		MainThread()->X2 = viewwidth;
 	}
 
+	void RenderScene::UpdateSliceSplits(int numThreads)
+	{
+		// Start out with equal widths
+		if (SliceSplits.size() != (size_t)numThreads + 1 || SliceTimes.size() != (size_t)numThreads)
+		{
+			SliceSplits.resize(numThreads + 1);
+			for (int i = 0; i <= numThreads; i++)
+				SliceSplits[i] = i / (double)numThreads;
+			SliceTimes.clear();
+			return;
+		}
+
+		double total = 0.0;
+		for (double time : SliceTimes)
+			total += time;
+		if (total <= 0.0)
+			return;
+
+		// Assume each slice's time was spread evenly over its columns and move the splits
+		// so that every slice gets the same share of the last frame's total
+		std::vector<double> splits(numThreads + 1);
+		splits[0] = 0.0;
+		splits[numThreads] = 1.0;
+		int slice = 0;
+		double sliceStart = 0.0;
+		for (int i = 1; i < numThreads; i++)
+		{
+			double target = total * i / numThreads;
+			while (slice < numThreads - 1 && sliceStart + SliceTimes[slice] < target)
+			{
+				sliceStart += SliceTimes[slice];
+				slice++;
+			}
+			double x1 = SliceSplits[slice];
+			double x2 = SliceSplits[slice + 1];
+			double t = SliceTimes[slice] > 0.0 ? clamp((target - sliceStart) / SliceTimes[slice], 0.0, 1.0) : 0.5;
+			splits[i] = x1 + (x2 - x1) * t;
+		}
+
+		// Only go halfway to avoid oscillating, and keep every slice at a minimum width
+		// so that its timing stays meaningful
+		double minWidth = 0.25 / numThreads;
+		for (int i = 1; i < numThreads; i++)
+			SliceSplits[i] = std::max((SliceSplits[i] + splits[i]) * 0.5, SliceSplits[i - 1] + minWidth);
+		for (int i = numThreads - 1; i > 0; i--)
+			SliceSplits[i] = std::min(SliceSplits[i], SliceSplits[i + 1] - minWidth);
+	}
+
 	void RenderScene::RenderThreadSlice(RenderThread *thread)
 	{
+		auto startTime = std::chrono::steady_clock::now();
+
 		thread->DrawQueue->Clear();
 		thread->FrameMemory->Clear();
 		thread->Clip3D->Cleanup();
@@ -308,6 +393,8 @@ namespace swrenderer
 		}
 
 		DrawerThreads::Execute(thread->DrawQueue);
+
+		thread->SliceTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 	}
 
 	void RenderScene::StartThreads(size_t numThreads)
@@ -418,6 +505,21 @@ namespace swrenderer
 		return out;
 	}
 
+	ADD_STAT(scenethreads)
+	{
+		FString out;
+		double total = 0.0, worst = 0.0;
+		for (const auto &slice : LastSlices)
+		{
+			out.AppendFormat("%d-%d=%04.1f ms  ", slice.X1, slice.X2, slice.Time);
+			total += slice.Time;
+			worst = std::max(worst, slice.Time);
+		}
+		if (total > 0.0)
+			out.AppendFormat("imbalance=%.0f%%", (worst * LastSlices.size() / total - 1.0) * 100.0);
+		return out;
+	}
+
 	static double f_acc, w_acc, p_acc, m_acc, drawer_acc;
 	static int acc_c;
 
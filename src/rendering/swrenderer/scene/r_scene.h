@@ -59,6 +59,7 @@ namespace swrenderer
 		void RenderActorView(AActor *actor, bool dontmaplines = false);
 		void RenderThreadSlices();
 		void RenderThreadSlice(RenderThread *thread);
+		void UpdateSliceSplits(int numThreads);
 		void RenderPSprites();
 
 		void StartThreads(size_t numThreads);
@@ -75,5 +76,8 @@ namespace swrenderer
 		std::mutex end_mutex;
 		std::condition_variable end_condition;
 		size_t finished_threads = 0;
+
+		std::vector<double> SliceSplits;	// slice boundaries as fractions of viewwidth
+		std::vector<double> SliceTimes;		// time each slice took in the last frame, in milliseconds
 	};
 }
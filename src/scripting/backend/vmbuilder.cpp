@@ -36,8 +36,18 @@
 #include "codegen.h"
 #include "m_argv.h"
 #include "c_cvars.h"
+#include "version.h"
 #include "scripting/vm/jit.h"
 
+CUSTOM_CVAR(Bool, vm_optimize, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
+{
+	Printf("You must restart " GAMENAME " for this change to take effect.\n");
+}
+
+static TMap<VMFunction *, bool> OverriddenVirtuals;
+static int DevirtualizedCalls;
+static int InlinedCalls;
+
 struct VMRemap
 {
 	uint8_t altOp, kReg, kType;
@@ -807,6 +817,7 @@ void FFunctionBuildList::Build()
 {
 	int codesize = 0;
 	int datasize = 0;
+	int unoptimizedsize = 0, optimizedsize = 0;
 	FILE *dump = nullptr;
 
 	if (Args->CheckParm("-dumpdisasm")) dump = fopen("disasm.txt", "w");
@@ -876,6 +887,10 @@ void FFunctionBuildList::Build()
 				buildit.BeginStatement(item.Code);
 				item.Code->Emit(&buildit);
 				buildit.EndStatement();
+				int unoptimized = (int)buildit.GetAddress();
+				if (vm_optimize) InlinedCalls += buildit.Optimize();
+				unoptimizedsize += unoptimized;
+				optimizedsize += (int)buildit.GetAddress();
 				buildit.MakeFunction(sfunc);
 				sfunc->NumArgs = 0;
 				// NumArgs for the VMFunction must be the amount of stack elements, which can differ from the amount of logical function arguments if vectors are in the list.
@@ -887,6 +902,7 @@ void FFunctionBuildList::Build()
 
 				if (dump != nullptr)
 				{
+					if (vm_optimize) fprintf(dump, "\n// %s: %d instructions, %d before optimization\n", item.PrintableName.GetChars(), sfunc->CodeSize, unoptimized);
 					DumpFunction(dump, sfunc, item.PrintableName.GetChars(), (int)item.PrintableName.Len());
 					codesize += sfunc->CodeSize;
 					datasize += sfunc->LineInfoCount * sizeof(FStatementInfo) + sfunc->ExtraSpace + sfunc->NumKonstD * sizeof(int) +
@@ -909,8 +925,16 @@ void FFunctionBuildList::Build()
 	if (dump != nullptr)
 	{
 		fprintf(dump, "\n*************************************************************************\n%i code bytes\n%i data bytes", codesize * 4, datasize);
+		if (vm_optimize) fprintf(dump, "\n%i code bytes before optimization\n%i calls devirtualized\n%i calls inlined", unoptimizedsize * 4, DevirtualizedCalls, InlinedCalls);
 		fclose(dump);
 	}
+	if (vm_optimize && unoptimizedsize > 0)
+	{
+		DPrintf(DMSG_NOTIFY, "VM optimizer: %d instructions reduced to %d, %d calls devirtualized, %d calls inlined\n", unoptimizedsize, optimizedsize, DevirtualizedCalls, InlinedCalls);
+	}
+	OverriddenVirtuals.Clear();
+	DevirtualizedCalls = 0;
+	InlinedCalls = 0;
 	VMFunction::CreateRegUseInfo();
 	FScriptPosition::StrictErrors = false;
 
@@ -1053,6 +1077,35 @@ void FunctionCallEmitter::AddParameterStringConst(const FString &konst)
 
 EXTERN_CVAR(Bool, vm_jit)
 
+//==========================================================================
+//
+// Checks if any class that inherits func from a parent has replaced it.
+// Code generation runs after all classes have been defined so this is
+// final, as long as nothing gets called on a class that does not have
+// func in its hierarchy at all.
+//
+//==========================================================================
+
+static bool IsOverridden(VMFunction *func)
+{
+	auto check = OverriddenVirtuals.CheckKey(func);
+	if (check != nullptr) return *check;
+
+	unsigned index = func->VirtualIndex;
+	bool overridden = false;
+	for (auto cls : PClass::AllClasses)
+	{
+		if (cls->Virtuals.Size() <= index || cls->Virtuals[index] == func) continue;
+		for (auto parent = cls->ParentClass; parent != nullptr && !overridden; parent = parent->ParentClass)
+		{
+			overridden = parent->Virtuals.Size() > index && parent->Virtuals[index] == func;
+		}
+		if (overridden) break;
+	}
+	OverriddenVirtuals[func] = overridden;
+	return overridden;
+}
+
 ExpEmit FunctionCallEmitter::EmitCall(VMFunctionBuilder *build, TArray<ExpEmit> *ReturnRegs)
 {
 	unsigned paramcount = 0;
@@ -1077,6 +1130,16 @@ ExpEmit FunctionCallEmitter::EmitCall(VMFunctionBuilder *build, TArray<ExpEmit>
 	{
 		build->Emit(OP_CALL_K, build->GetConstantAddress(target), paramcount, vm_jit ? target->Proto->ReturnTypes.Size() : returns.Size());
 	}
+	else if (vm_optimize && !IsOverridden(target))
+	{
+		// Nothing can override the function so it can be called directly.
+		// The load from self only keeps the null pointer check OP_VTBL would perform.
+		ExpEmit checkreg(build, REGT_POINTER);
+		build->Emit(OP_LP, checkreg.RegNum, virtualselfreg, build->GetConstantInt(0));
+		checkreg.Free(build);
+		build->Emit(OP_CALL_K, build->GetConstantAddress(target), paramcount, vm_jit ? target->Proto->ReturnTypes.Size() : returns.Size());
+		DevirtualizedCalls++;
+	}
 	else
 	{
 		ExpEmit funcreg(build, REGT_POINTER);
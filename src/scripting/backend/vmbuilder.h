@@ -49,6 +49,7 @@ public:
 
 	void BeginStatement(FxExpression *stmt);
 	void EndStatement();
+	int Optimize();				// Returns the number of inlined calls.
 	void MakeFunction(VMScriptFunction *func);
 
 	// Returns the constant register holding the value.
@@ -116,6 +117,8 @@ private:
 
 	TArray<VMOP> Code;
 
+	int InlineCalls();
+	bool InlineCall(unsigned pc, const TArray<uint8_t> &jumptarget, const int *base, TArray<VMOP> &body);
 };
 
 void DumpFunction(FILE *dump, VMScriptFunction *sfunc, const char *label, int labellen);
@@ -0,0 +1,1127 @@
+/*
+** vmoptimize.cpp
+** Bytecode level cleanup of freshly generated VM functions
+**
+** The code generator emits every statement on its own, which leaves jumps
+** to jumps, jumps to the next instruction, self moves, code after returns,
+** repeated field loads and values that are never read behind. These get
+** cleaned up here before the function is handed to the interpreter or the
+** JIT compiler. Before that, direct calls to small script functions that
+** have already been built get their code inlined, which saves the frame
+** setup of the call. Errors in inlined code get reported for the caller.
+**
+** Compare instructions and TEST skip the instruction following them, so
+** nothing directly after one may be removed. Compares also read the target
+** of the JMP following them, which is why those JMPs can be retargeted but
+** never be removed or replaced. Jump tables used by IJMP are addressed by
+** position, so functions containing one only get their jumps threaded.
+**
+** Which registers an instruction reads comes from the operand modes in
+** OpInfo. PARAM, RESULT and RET encode their register in the instruction
+** and get decoded like the interpreter does it. What an instruction writes
+** is only known for the opcodes listed in GetRegUse; everything else is
+** assumed to read all of its register operands and to write memory, and
+** never counts as a definition. Registers passed by reference to a call
+** can change behind the code's back, so stores to them are never removed.
+**
+*/
+
+#include "templates.h"
+#include "vmbuilder.h"
+#include "types.h"
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static bool IsConditionalSkip(int op)
+{
+	return op == OP_TEST || op == OP_TESTN || op == OP_CMPS || (OpInfo[op].Mode & MODE_ATYPE) == MODE_ACMP;
+}
+
+static bool IsNoOp(const VMOP &op)
+{
+	switch (op.op)
+	{
+	case OP_NOP:
+		return true;
+
+	case OP_JMP:
+		return op.i24 == 0;
+
+	case OP_MOVE:
+	case OP_MOVEF:
+	case OP_MOVES:
+	case OP_MOVEA:
+	case OP_MOVEV2:
+	case OP_MOVEV3:
+		return op.a == op.b;
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// Register def/use information
+//
+//==========================================================================
+
+enum
+{
+	USE_PURE = 1,		// Only writes its destination and cannot abort, so it can go if that is never read.
+	USE_CSE = 2,		// Gives the same result for the same operands until something writes memory.
+	USE_NOWRITE = 4,	// Writes neither registers nor memory.
+};
+
+struct FRegRange
+{
+	uint8_t Type;		// REGT_INT, REGT_FLOAT, REGT_STRING or REGT_POINTER
+	uint8_t Count;
+	uint16_t Num;
+
+	bool Overlaps(const FRegRange &other) const
+	{
+		return Type == other.Type && Num < other.Num + other.Count && other.Num < Num + Count;
+	}
+};
+
+struct FRegUse
+{
+	FRegRange Reads[8];
+	FRegRange Def;
+	int NumReads;
+	int Flags;
+	bool HasDef;
+
+	void Read(int type, int num, int count = 1)
+	{
+		assert(NumReads < (int)countof(Reads));
+		Reads[NumReads++] = { (uint8_t)type, (uint8_t)count, (uint16_t)num };
+	}
+
+	void ReadMode(int mode, int num)
+	{
+		switch (mode)
+		{
+		case MODE_I: Read(REGT_INT, num); break;
+		case MODE_F: Read(REGT_FLOAT, num); break;
+		case MODE_S: Read(REGT_STRING, num); break;
+		case MODE_P: Read(REGT_POINTER, num); break;
+		// Vector operands are read as three registers, even for 2D vectors.
+		case MODE_V: Read(REGT_FLOAT, num, 3); break;
+		// CAST and CMPS decide the register type at runtime.
+		case MODE_X:
+			Read(REGT_INT, num);
+			Read(REGT_FLOAT, num, 3);
+			Read(REGT_STRING, num);
+			Read(REGT_POINTER, num);
+			break;
+		default: break;
+		}
+	}
+
+	// PARAM and RET registers: type in the lower bits, vectors span several registers.
+	void ReadParam(int regtype, int num)
+	{
+		if (regtype != REGT_NIL && !(regtype & REGT_KONST))
+		{
+			Read(regtype & REGT_TYPE, num, (regtype & REGT_MULTIREG3) ? 3 : (regtype & REGT_MULTIREG2) ? 2 : 1);
+		}
+	}
+
+	bool Defines(int type, int count, int flags)
+	{
+		Def = { (uint8_t)type, (uint8_t)count, 0 };
+		Flags = flags;
+		HasDef = true;
+		return true;
+	}
+};
+
+static bool GetDef(int op, FRegUse &use)
+{
+	switch (op)
+	{
+	case OP_LI:
+	case OP_LK:
+	case OP_MOVE:
+		return use.Defines(REGT_INT, 1, USE_PURE);
+
+	case OP_LKF:
+	case OP_MOVEF:
+		return use.Defines(REGT_FLOAT, 1, USE_PURE);
+
+	case OP_LKS:
+	case OP_MOVES:
+		return use.Defines(REGT_STRING, 1, USE_PURE);
+
+	case OP_LKP:
+	case OP_LFP:
+	case OP_MOVEA:
+		return use.Defines(REGT_POINTER, 1, USE_PURE);
+
+	case OP_MOVEV2:
+		return use.Defines(REGT_FLOAT, 2, USE_PURE);
+
+	case OP_MOVEV3:
+		return use.Defines(REGT_FLOAT, 3, USE_PURE);
+
+	case OP_SLL_RR: case OP_SLL_RI: case OP_SLL_KR:
+	case OP_SRL_RR: case OP_SRL_RI: case OP_SRL_KR:
+	case OP_SRA_RR: case OP_SRA_RI: case OP_SRA_KR:
+	case OP_ADD_RR: case OP_ADD_RK: case OP_ADDI:
+	case OP_SUB_RR: case OP_SUB_RK: case OP_SUB_KR:
+	case OP_MUL_RR: case OP_MUL_RK:
+	case OP_AND_RR: case OP_AND_RK:
+	case OP_OR_RR: case OP_OR_RK:
+	case OP_XOR_RR: case OP_XOR_RK:
+	case OP_MIN_RR: case OP_MIN_RK:
+	case OP_MAX_RR: case OP_MAX_RK:
+	case OP_MINU_RR: case OP_MINU_RK:
+	case OP_MAXU_RR: case OP_MAXU_RK:
+	case OP_ABS: case OP_NEG: case OP_NOT:
+	case OP_LENS:
+	case OP_SUBA:
+		return use.Defines(REGT_INT, 1, USE_PURE | USE_CSE);
+
+	case OP_ADDF_RR: case OP_ADDF_RK:
+	case OP_SUBF_RR: case OP_SUBF_RK: case OP_SUBF_KR:
+	case OP_MULF_RR: case OP_MULF_RK:
+	case OP_POWF_RR: case OP_POWF_RK: case OP_POWF_KR:
+	case OP_MINF_RR: case OP_MINF_RK:
+	case OP_MAXF_RR: case OP_MAXF_RK:
+	case OP_ATAN2:
+	case OP_FLOP:
+	case OP_DOTV2_RR: case OP_LENV2:
+	case OP_DOTV3_RR: case OP_LENV3:
+		return use.Defines(REGT_FLOAT, 1, USE_PURE | USE_CSE);
+
+	case OP_NEGV2:
+	case OP_ADDV2_RR: case OP_SUBV2_RR:
+	case OP_MULVF2_RR: case OP_MULVF2_RK:
+	case OP_DIVVF2_RR: case OP_DIVVF2_RK:
+		return use.Defines(REGT_FLOAT, 2, USE_PURE | USE_CSE);
+
+	case OP_NEGV3:
+	case OP_ADDV3_RR: case OP_SUBV3_RR: case OP_CROSSV_RR:
+	case OP_MULVF3_RR: case OP_MULVF3_RK:
+	case OP_DIVVF3_RR: case OP_DIVVF3_RK:
+		return use.Defines(REGT_FLOAT, 3, USE_PURE | USE_CSE);
+
+	case OP_CONCAT:
+		return use.Defines(REGT_STRING, 1, USE_PURE | USE_CSE);
+
+	case OP_ADDA_RR: case OP_ADDA_RK:
+		return use.Defines(REGT_POINTER, 1, USE_PURE | USE_CSE);
+
+	// Division by zero and loads from null abort, so these must stay even when unused.
+	case OP_DIV_RR: case OP_DIV_RK: case OP_DIV_KR:
+	case OP_DIVU_RR: case OP_DIVU_RK: case OP_DIVU_KR:
+	case OP_MOD_RR: case OP_MOD_RK: case OP_MOD_KR:
+	case OP_MODU_RR: case OP_MODU_RK: case OP_MODU_KR:
+	case OP_LB: case OP_LB_R: case OP_LH: case OP_LH_R: case OP_LW: case OP_LW_R:
+	case OP_LBU: case OP_LBU_R: case OP_LHU: case OP_LHU_R:
+	case OP_LBIT:
+		return use.Defines(REGT_INT, 1, USE_CSE);
+
+	case OP_DIVF_RR: case OP_DIVF_RK: case OP_DIVF_KR:
+	case OP_MODF_RR: case OP_MODF_RK: case OP_MODF_KR:
+	case OP_LSP: case OP_LSP_R: case OP_LDP: case OP_LDP_R:
+		return use.Defines(REGT_FLOAT, 1, USE_CSE);
+
+	case OP_LV2: case OP_LV2_R:
+		return use.Defines(REGT_FLOAT, 2, USE_CSE);
+
+	case OP_LV3: case OP_LV3_R:
+		return use.Defines(REGT_FLOAT, 3, USE_CSE);
+
+	case OP_LS: case OP_LS_R: case OP_LCS: case OP_LCS_R:
+		return use.Defines(REGT_STRING, 1, USE_CSE);
+
+	case OP_LO: case OP_LO_R: case OP_LP: case OP_LP_R:
+		return use.Defines(REGT_POINTER, 1, USE_CSE);
+
+	default:
+		return false;
+	}
+}
+
+static void GetRegUse(const VMOP &op, FRegUse &use)
+{
+	use.NumReads = 0;
+	use.Flags = 0;
+	use.HasDef = false;
+
+	switch (op.op)
+	{
+	case OP_PARAM:
+		use.ReadParam(op.a, op.i16u);
+		use.Flags = USE_NOWRITE;
+		return;
+
+	case OP_RET:
+		use.ReadParam(op.b, op.c);
+		return;
+
+	case OP_RESULT:
+	case OP_RETI:
+		return;
+
+	case OP_THROW:
+		if (op.a == 0) use.Read(REGT_POINTER, op.b);
+		return;
+
+	case OP_MOVEV2:
+	case OP_MOVEV3:
+		use.Read(REGT_FLOAT, op.b, op.op == OP_MOVEV2 ? 2 : 3);
+		break;
+
+	case OP_NOP:
+	case OP_JMP:
+	case OP_PARAMI:
+	case OP_TEST:
+	case OP_TESTN:
+	case OP_BOUND:
+	case OP_BOUND_K:
+	case OP_BOUND_R:
+	case OP_CMPS:
+		use.Flags = USE_NOWRITE;
+		break;
+
+	default:
+		if ((OpInfo[op.op].Mode & MODE_ATYPE) == MODE_ACMP) use.Flags = USE_NOWRITE;
+		break;
+	}
+
+	int mode = OpInfo[op.op].Mode;
+	if (GetDef(op.op, use))
+	{
+		use.Def.Num = op.a;
+	}
+	else
+	{
+		// Without a known destination, register A is treated as an input.
+		use.ReadMode((mode & MODE_ATYPE) >> MODE_ASHIFT, op.a);
+	}
+	if (op.op != OP_MOVEV2 && op.op != OP_MOVEV3)
+	{
+		use.ReadMode((mode & MODE_BTYPE) >> MODE_BSHIFT, op.b);
+		use.ReadMode((mode & MODE_CTYPE) >> MODE_CSHIFT, op.c);
+	}
+}
+
+//==========================================================================
+//
+// Sets of registers, one bit per register of each type
+//
+//==========================================================================
+
+struct FRegSet
+{
+	uint64_t Bits[4][4];
+
+	void Clear()
+	{
+		memset(Bits, 0, sizeof(Bits));
+	}
+
+	void Set(const FRegRange &range, bool on)
+	{
+		for (int i = 0; i < range.Count; i++)
+		{
+			unsigned num = range.Num + i;
+			if (num >= 256) break;
+			if (on) Bits[range.Type][num >> 6] |= 1ull << (num & 63);
+			else Bits[range.Type][num >> 6] &= ~(1ull << (num & 63));
+		}
+	}
+
+	bool Any(const FRegRange &range) const
+	{
+		for (int i = 0; i < range.Count; i++)
+		{
+			unsigned num = range.Num + i;
+			if (num < 256 && (Bits[range.Type][num >> 6] & (1ull << (num & 63)))) return true;
+		}
+		return false;
+	}
+
+	void Add(const FRegSet &other)
+	{
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				Bits[i][j] |= other.Bits[i][j];
+	}
+
+	bool operator!=(const FRegSet &other) const
+	{
+		return memcmp(Bits, other.Bits, sizeof(Bits)) != 0;
+	}
+};
+
+//==========================================================================
+//
+// Where execution can continue after an instruction
+//
+//==========================================================================
+
+static int GetSuccessors(const TArray<VMOP> &code, unsigned pc, unsigned succ[2])
+{
+	const VMOP &op = code[pc];
+	int count = 0;
+	auto add = [&](unsigned target)
+	{
+		if (target < code.Size()) succ[count++] = target;
+	};
+
+	switch (op.op)
+	{
+	case OP_JMP:
+		add(pc + 1 + op.i24);
+		break;
+
+	case OP_RET:
+	case OP_RETI:
+		if (!(op.a & RET_FINAL)) add(pc + 1);
+		break;
+
+	case OP_THROW:
+		break;
+
+	default:
+		add(pc + 1);
+		if (IsConditionalSkip(op.op)) add(pc + 2);
+		break;
+	}
+	return count;
+}
+
+//==========================================================================
+//
+// Replaces an instruction with a move of a value that is already in a
+// register.
+//
+//==========================================================================
+
+static void MakeMove(VMOP &op, const FRegRange &dest, int source)
+{
+	switch (dest.Type)
+	{
+	case REGT_INT: op.op = OP_MOVE; break;
+	case REGT_FLOAT: op.op = dest.Count == 3 ? OP_MOVEV3 : dest.Count == 2 ? OP_MOVEV2 : OP_MOVEF; break;
+	case REGT_STRING: op.op = OP_MOVES; break;
+	default: op.op = OP_MOVEA; break;
+	}
+	op.a = dest.Num;
+	op.b = source;
+	op.c = 0;
+}
+
+//==========================================================================
+//
+// Local common subexpression elimination. Within a basic block, an
+// instruction that computes what an earlier one already left in a
+// register that hasn't changed since becomes a move. Loads count as
+// equal until the next instruction that may write memory.
+//
+//==========================================================================
+
+static void EliminateCommonSubexpressions(TArray<VMOP> &code, TArray<FRegUse> &uses)
+{
+	unsigned count = code.Size();
+	TArray<uint8_t> leader(count + 1, true);
+	memset(leader.Data(), 0, count + 1);
+	leader[0] = true;
+	for (unsigned i = 0; i < count; i++)
+	{
+		unsigned succ[2];
+		int n = GetSuccessors(code, i, succ);
+		if (code[i].op == OP_JMP || IsConditionalSkip(code[i].op) || n == 0)
+		{
+			for (int j = 0; j < n; j++) leader[succ[j]] = true;
+			leader[i + 1] = true;
+		}
+	}
+
+	TArray<unsigned> avail;
+	for (unsigned i = 0; i < count; i++)
+	{
+		if (leader[i]) avail.Clear();
+
+		VMOP &op = code[i];
+		FRegUse &use = uses[i];
+		if (use.Flags & USE_CSE)
+		{
+			for (unsigned j : avail)
+			{
+				const VMOP &prev = code[j];
+				const FRegRange &prevdef = uses[j].Def;
+				if (prev.op != op.op || prev.b != op.b || prev.c != op.c) continue;
+				// Moving a vector into a register range that overlaps its source would overwrite it while copying.
+				if (prevdef.Count > 1 && prevdef.Num != op.a && prevdef.Overlaps(use.Def)) continue;
+				MakeMove(op, use.Def, prevdef.Num);
+				GetRegUse(op, use);
+				break;
+			}
+		}
+
+		if (use.HasDef)
+		{
+			// Forget everything that depended on the old contents of the destination.
+			unsigned out = 0;
+			for (unsigned j : avail)
+			{
+				const FRegUse &prev = uses[j];
+				bool clobbered = prev.Def.Overlaps(use.Def);
+				for (int k = 0; k < prev.NumReads && !clobbered; k++)
+				{
+					clobbered = prev.Reads[k].Overlaps(use.Def);
+				}
+				if (!clobbered) avail[out++] = j;
+			}
+			avail.Resize(out);
+
+			bool selfref = false;
+			for (int k = 0; k < use.NumReads; k++)
+			{
+				if (use.Reads[k].Overlaps(use.Def)) selfref = true;
+			}
+			if ((use.Flags & USE_CSE) && !selfref) avail.Push(i);
+		}
+		else if (!(use.Flags & USE_NOWRITE))
+		{
+			avail.Clear();
+		}
+	}
+}
+
+//==========================================================================
+//
+// Register liveness at the start of each instruction, computed over the
+// whole function.
+//
+//==========================================================================
+
+static void ComputeLiveness(const TArray<VMOP> &code, const TArray<FRegUse> &uses, TArray<FRegSet> &livein)
+{
+	unsigned count = code.Size();
+	livein.Resize(count);
+	memset(livein.Data(), 0, count * sizeof(FRegSet));
+
+	bool changed;
+	do
+	{
+		changed = false;
+		for (unsigned i = count; i-- > 0; )
+		{
+			FRegSet live;
+			unsigned succ[2];
+			int n = GetSuccessors(code, i, succ);
+			live.Clear();
+			for (int j = 0; j < n; j++) live.Add(livein[succ[j]]);
+
+			const FRegUse &use = uses[i];
+			if (use.HasDef) live.Set(use.Def, false);
+			for (int k = 0; k < use.NumReads; k++) live.Set(use.Reads[k], true);
+			if (live != livein[i])
+			{
+				livein[i] = live;
+				changed = true;
+			}
+		}
+	} while (changed);
+}
+
+//==========================================================================
+//
+// Dead store elimination. Pure instructions whose result is never read
+// become NOPs, which get removed along with the other no-ops afterwards.
+//
+//==========================================================================
+
+static void EliminateDeadStores(TArray<VMOP> &code, const TArray<FRegUse> &uses)
+{
+	unsigned count = code.Size();
+
+	// Registers whose address is passed to a call. String parameters are always passed that way.
+	FRegSet pinned;
+	pinned.Clear();
+	for (unsigned i = 0; i < count; i++)
+	{
+		const VMOP &op = code[i];
+		if (op.op == OP_PARAM && op.a != REGT_NIL && !(op.a & REGT_KONST) && ((op.a & REGT_ADDROF) || (op.a & REGT_TYPE) == REGT_STRING))
+		{
+			pinned.Set(uses[i].Reads[0], true);
+		}
+	}
+
+	TArray<FRegSet> livein;
+	ComputeLiveness(code, uses, livein);
+	auto liveout = [&](unsigned pc, FRegSet &out)
+	{
+		unsigned succ[2];
+		int n = GetSuccessors(code, pc, succ);
+		out.Clear();
+		for (int j = 0; j < n; j++) out.Add(livein[succ[j]]);
+	};
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		const FRegUse &use = uses[i];
+		if (!use.HasDef || !(use.Flags & USE_PURE) || pinned.Any(use.Def)) continue;
+
+		FRegSet live;
+		liveout(i, live);
+		if (!live.Any(use.Def))
+		{
+			code[i].word = 0;
+			code[i].op = OP_NOP;
+		}
+	}
+}
+
+//==========================================================================
+//
+// Inlining of small script functions
+//
+// A direct call to a script function that has already been built and is
+// only a few instructions long gets replaced by the function's code. Its
+// registers are placed above the caller's, its PARAMs become moves into
+// them and its returns become moves into the RESULT registers followed by
+// a jump behind the call. All functions inlined into the same caller share
+// this register window, since none of them can be active at the same time.
+//
+//==========================================================================
+
+enum
+{
+	MAX_INLINE_SIZE = 16,
+};
+
+static bool CanInline(VMScriptFunction *func)
+{
+	// Functions that haven't been built yet have no code.
+	if (func->CodeSize == 0 || func->CodeSize > MAX_INLINE_SIZE) return false;
+	if (func->ExtraSpace > 0 || func->SpecialInits.Size() > 0 || func->Proto == nullptr) return false;
+	if (func->VarFlags & VARF_VarArg) return false;
+	for (auto arg : func->Proto->ArgumentTypes)
+	{
+		if (arg == nullptr) return false;
+	}
+	for (auto flags : func->ArgFlags)
+	{
+		if (flags & VARF_Out) return false;
+	}
+
+	for (int i = 0; i < func->CodeSize; i++)
+	{
+		const VMOP &op = func->Code[i];
+		switch (op.op)
+		{
+		// These index the callee's constant table at runtime.
+		case OP_LK_R: case OP_LKF_R: case OP_LKS_R: case OP_LKP_R:
+		case OP_LFP:
+		case OP_IJMP:
+		case OP_PARAM: case OP_PARAMI: case OP_RESULT:
+		case OP_CALL: case OP_CALL_K: case OP_VTBL: case OP_SCOPE:
+		case OP_THROW:
+			return false;
+
+		case OP_RET:
+		case OP_RETI:
+			// Returns get replaced by more than one instruction.
+			if (i > 0 && IsConditionalSkip(func->Code[i - 1].op)) return false;
+			break;
+
+		default:
+		{
+			int mode = OpInfo[op.op].Mode;
+			int modes[] = { (mode & MODE_ATYPE) >> MODE_ASHIFT, (mode & MODE_BTYPE) >> MODE_BSHIFT, (mode & MODE_CTYPE) >> MODE_CSHIFT };
+			for (int m : modes)
+			{
+				if (m == MODE_X || m == MODE_KV) return false;
+			}
+			break;
+		}
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// VMFunctionBuilder :: InlineCall
+//
+// Creates the replacement for the call at pc in body and changes its
+// PARAMs into moves. The code is left alone if the call cannot be inlined.
+//
+//==========================================================================
+
+bool VMFunctionBuilder::InlineCall(unsigned pc, const TArray<uint8_t> &jumptarget, const int *base, TArray<VMOP> &body)
+{
+	const VMOP &call = Code[pc];
+	auto target = (VMFunction *)AddressConstantList[call.a];
+	if (target == nullptr || (target->VarFlags & VARF_Native)) return false;
+	auto callee = static_cast<VMScriptFunction *>(target);
+	if (!CanInline(callee) || call.b != callee->NumArgs) return false;
+
+	// A preceding skip would only skip the first instruction of the replacement.
+	if (pc > 0 && IsConditionalSkip(Code[pc - 1].op)) return false;
+	if (pc + call.c >= Code.Size()) return false;
+	for (unsigned i = 1; i <= call.c; i++)
+	{
+		if (Code[pc + i].op != OP_RESULT || jumptarget[pc + i]) return false;
+	}
+
+	int numregs[] = { callee->NumRegD, callee->NumRegF, callee->NumRegS, callee->NumRegA };
+	for (int t = 0; t < 4; t++)
+	{
+		if (base[t] + numregs[t] > 256) return false;
+	}
+
+	// The parameters are stored in the callee's first registers of each type, in order.
+	TArray<uint8_t> slottype;
+	TArray<uint8_t> slotreg;
+	int nextreg[4] = {};
+	for (auto arg : callee->Proto->ArgumentTypes)
+	{
+		int type = arg->GetRegType();
+		for (int j = 0; j < arg->GetRegCount(); j++)
+		{
+			slottype.Push(type);
+			slotreg.Push(nextreg[type]++);
+		}
+	}
+	if (slottype.Size() != call.b) return false;
+
+	// Registers the callee reads before writing them rely on the frame being cleared.
+	TArray<VMOP> code(callee->CodeSize, true);
+	TArray<FRegUse> uses(callee->CodeSize, true);
+	TArray<FRegSet> livein;
+	memcpy(code.Data(), callee->Code, callee->CodeSize * sizeof(VMOP));
+	for (unsigned i = 0; i < code.Size(); i++)
+	{
+		GetRegUse(code[i], uses[i]);
+	}
+	ComputeLiveness(code, uses, livein);
+	FRegSet params;
+	params.Clear();
+	for (unsigned i = 0; i < slottype.Size(); i++)
+	{
+		params.Set({ slottype[i], 1, slotreg[i] }, true);
+	}
+	for (int t = 0; t < 4; t++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			if (livein[0].Bits[t][j] & ~params.Bits[t][j]) return false;
+		}
+	}
+
+	// Find the PARAMs belonging to this call. Nested calls and branches end the search.
+	TArray<unsigned> paramops;
+	unsigned slots = 0;
+	for (unsigned i = pc; slots < call.b; )
+	{
+		if (i-- == 0) return false;
+		const VMOP &op = Code[i];
+		if (op.op == OP_PARAMI)
+		{
+			slots++;
+		}
+		else if (op.op == OP_PARAM)
+		{
+			slots += (op.a & REGT_MULTIREG3) ? 3 : (op.a & REGT_MULTIREG2) ? 2 : 1;
+		}
+		else
+		{
+			if (op.op == OP_CALL || op.op == OP_CALL_K || op.op == OP_RESULT || op.op == OP_JMP || op.op == OP_IJMP ||
+				op.op == OP_RET || op.op == OP_RETI || op.op == OP_THROW) return false;
+			continue;
+		}
+		paramops.Insert(0, i);
+	}
+	if (slots != call.b) return false;
+
+	TArray<VMOP> moves(paramops.Size(), true);
+	unsigned slot = 0;
+	for (unsigned i = 0; i < paramops.Size(); i++)
+	{
+		const VMOP &param = Code[paramops[i]];
+		VMOP &move = moves[i];
+		move.word = 0;
+		if (param.op == OP_PARAMI)
+		{
+			if (slottype[slot] != REGT_INT) return false;
+			move.a = base[REGT_INT] + slotreg[slot];
+			if (param.i24 == (int16_t)param.i24)
+			{
+				move.op = OP_LI;
+				move.i16 = param.i24;
+			}
+			else
+			{
+				unsigned k = GetConstantInt(param.i24);
+				if (k > 0xffff) return false;
+				move.op = OP_LK;
+				move.i16u = k;
+			}
+			slot++;
+			continue;
+		}
+
+		// Strings are passed by address and read by the callee when the call happens.
+		int type = param.a & REGT_TYPE;
+		int count = (param.a & REGT_MULTIREG3) ? 3 : (param.a & REGT_MULTIREG2) ? 2 : 1;
+		if (param.a == REGT_NIL || (param.a & REGT_ADDROF) || param.a == REGT_STRING) return false;
+		for (int j = 0; j < count; j++)
+		{
+			if (slottype[slot + j] != type) return false;
+		}
+		int dest = base[type] + slotreg[slot];
+		slot += count;
+		if (param.a & REGT_KONST)
+		{
+			static const uint8_t loadops[] = { OP_LK, OP_LKF, OP_LKS, OP_LKP };
+			if (count > 1) return false;
+			move.op = loadops[type];
+			move.a = dest;
+			move.i16u = param.i16u;
+		}
+		else
+		{
+			MakeMove(move, { (uint8_t)type, (uint8_t)count, (uint16_t)dest }, param.i16u);
+		}
+	}
+
+	// Copy the callee's code over, with its registers and constants moved to where they are in the caller.
+	auto remap = [&](int mode, int value, int limit, int &result)
+	{
+		switch (mode)
+		{
+		case MODE_I: result = base[REGT_INT] + value; break;
+		case MODE_F:
+		case MODE_V: result = base[REGT_FLOAT] + value; break;
+		case MODE_S: result = base[REGT_STRING] + value; break;
+		case MODE_P: result = base[REGT_POINTER] + value; break;
+		case MODE_KI: result = GetConstantInt(callee->KonstD[value]); break;
+		case MODE_KF: result = GetConstantFloat(callee->KonstF[value]); break;
+		case MODE_KS: result = GetConstantString(callee->KonstS[value]); break;
+		case MODE_KP: result = GetConstantAddress(callee->KonstA[value].v); break;
+		default: result = value; break;
+		}
+		return result <= limit;
+	};
+
+	TArray<unsigned> bodyindex(code.Size() + 1, true);
+	TArray<unsigned> jumps;
+	TArray<unsigned> exits;
+	body.Clear();
+	for (unsigned i = 0; i < code.Size(); i++)
+	{
+		VMOP op = code[i];
+		bodyindex[i] = body.Size();
+		if (op.op == OP_RET || op.op == OP_RETI)
+		{
+			unsigned retnum = op.a & ~RET_FINAL;
+			bool last = (op.a & RET_FINAL) || (op.op == OP_RET && op.b == REGT_NIL);
+			if (retnum < call.c && !(op.op == OP_RET && op.b == REGT_NIL))
+			{
+				const VMOP &result = Code[pc + 1 + retnum];
+				VMOP move;
+				move.word = 0;
+				if (op.op == OP_RETI)
+				{
+					if (result.b != REGT_INT) return false;
+					move.op = OP_LI;
+					move.a = result.c;
+					move.i16 = op.i16;
+				}
+				else
+				{
+					int type = op.b & REGT_TYPE;
+					if ((op.b & ~REGT_KONST) != result.b) return false;
+					if (op.b & REGT_KONST)
+					{
+						static const uint8_t loadops[] = { OP_LK, OP_LKF, OP_LKS, OP_LKP };
+						static const uint8_t konstmodes[] = { MODE_KI, MODE_KF, MODE_KS, MODE_KP };
+						int k;
+						if ((op.b & REGT_MULTIREG) || !remap(konstmodes[type], op.c, 0xffff, k)) return false;
+						move.op = loadops[type];
+						move.a = result.c;
+						move.i16u = k;
+					}
+					else
+					{
+						int count = (op.b & REGT_MULTIREG3) ? 3 : (op.b & REGT_MULTIREG2) ? 2 : 1;
+						MakeMove(move, { (uint8_t)type, (uint8_t)count, result.c }, base[type] + op.c);
+					}
+				}
+				body.Push(move);
+			}
+			if (last)
+			{
+				exits.Push(body.Size());
+				op.word = 0;
+				op.op = OP_JMP;
+				body.Push(op);
+			}
+			continue;
+		}
+		if (op.op == OP_JMP)
+		{
+			// Points at the callee instruction until all positions are known.
+			jumps.Push(body.Size());
+			op.i24 = MIN<int>(i + 1 + op.i24, code.Size());
+			body.Push(op);
+			continue;
+		}
+
+		int mode = OpInfo[op.op].Mode;
+		int a, b, c;
+		if (!remap((mode & MODE_ATYPE) >> MODE_ASHIFT, op.a, 255, a)) return false;
+		op.a = a;
+		if (((mode & MODE_BTYPE) >> MODE_BSHIFT) == MODE_JOINT)
+		{
+			if (!remap((mode & MODE_BCTYPE) >> MODE_BCSHIFT, op.i16u, 0xffff, b)) return false;
+			op.i16u = b;
+		}
+		else
+		{
+			if (!remap((mode & MODE_BTYPE) >> MODE_BSHIFT, op.b, 255, b)) return false;
+			if (!remap((mode & MODE_CTYPE) >> MODE_CSHIFT, op.c, 255, c)) return false;
+			op.b = b;
+			op.c = c;
+		}
+		body.Push(op);
+	}
+	bodyindex[code.Size()] = body.Size();
+	for (unsigned j : jumps)
+	{
+		body[j].i24 = int(bodyindex[body[j].i24] - j - 1);
+	}
+	for (unsigned j : exits)
+	{
+		body[j].i24 = int(body.Size() - j - 1);
+	}
+
+	for (unsigned i = 0; i < paramops.Size(); i++)
+	{
+		Code[paramops[i]] = moves[i];
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// VMFunctionBuilder :: InlineCalls
+//
+//==========================================================================
+
+int VMFunctionBuilder::InlineCalls()
+{
+	unsigned count = Code.Size();
+	TArray<uint8_t> jumptarget(count + 1, true);
+	memset(jumptarget.Data(), 0, count + 1);
+	for (unsigned i = 0; i < count; i++)
+	{
+		if (Code[i].op == OP_IJMP) return 0;
+		if (Code[i].op == OP_JMP) jumptarget[MIN<unsigned>(i + 1 + Code[i].i24, count)] = true;
+	}
+
+	int base[4], window[4] = {};
+	for (int t = 0; t < 4; t++)
+	{
+		base[t] = Registers[t].MostUsed;
+	}
+
+	// Replacement code for each inlined call, stored one after the other.
+	TArray<unsigned> calls;
+	TArray<unsigned> bodystart;
+	TArray<VMOP> bodies;
+	TArray<VMOP> body;
+	unsigned newcount = count;
+	for (unsigned i = 0; i < count; i++)
+	{
+		// Line numbers are stored as 16 bit instruction indices. A return becomes at most two instructions.
+		if (newcount + 2 * MAX_INLINE_SIZE > 0xffff) break;
+		if (Code[i].op != OP_CALL_K || !InlineCall(i, jumptarget, base, body)) continue;
+
+		newcount += body.Size() - 1 - Code[i].c;
+		auto callee = static_cast<VMScriptFunction *>((VMFunction *)AddressConstantList[Code[i].a]);
+		window[REGT_INT] = MAX(window[REGT_INT], (int)callee->NumRegD);
+		window[REGT_FLOAT] = MAX(window[REGT_FLOAT], (int)callee->NumRegF);
+		window[REGT_STRING] = MAX(window[REGT_STRING], (int)callee->NumRegS);
+		window[REGT_POINTER] = MAX(window[REGT_POINTER], (int)callee->NumRegA);
+		calls.Push(i);
+		bodystart.Push(bodies.Size());
+		bodies.Append(body);
+	}
+	if (calls.Size() == 0) return 0;
+	bodystart.Push(bodies.Size());
+
+	TArray<VMOP> code;
+	TArray<unsigned> newindex(count + 1, true);
+	TArray<unsigned> jumps;
+	unsigned next = 0;
+	for (unsigned i = 0; i < count; i++)
+	{
+		newindex[i] = code.Size();
+		if (next < calls.Size() && calls[next] == i)
+		{
+			for (unsigned j = bodystart[next]; j < bodystart[next + 1]; j++)
+			{
+				code.Push(bodies[j]);
+			}
+			// The RESULTs are never jumped to.
+			for (unsigned j = 0; j < Code[i].c; j++)
+			{
+				newindex[++i] = code.Size();
+			}
+			next++;
+			continue;
+		}
+		if (Code[i].op == OP_JMP) jumps.Push(code.Size());
+		code.Push(Code[i]);
+		// Until all positions are known, caller jumps point at their old target.
+		if (Code[i].op == OP_JMP) code.Last().i24 = MIN<unsigned>(i + 1 + Code[i].i24, count);
+	}
+	newindex[count] = code.Size();
+	for (unsigned j : jumps)
+	{
+		code[j].i24 = int(newindex[code[j].i24] - j - 1);
+	}
+	Code = std::move(code);
+
+	for (auto &line : LineNumbers)
+	{
+		line.InstructionIndex = (uint16_t)newindex[MIN<unsigned>(line.InstructionIndex, count)];
+	}
+	for (int t = 0; t < 4; t++)
+	{
+		Registers[t].MostUsed = MAX(Registers[t].MostUsed, base[t] + window[t]);
+	}
+	return calls.Size();
+}
+
+//==========================================================================
+//
+// VMFunctionBuilder :: Optimize
+//
+//==========================================================================
+
+int VMFunctionBuilder::Optimize()
+{
+	int inlined = InlineCalls();
+	bool changed;
+	int passes = 0;
+	do
+	{
+		changed = false;
+		unsigned count = Code.Size();
+		bool hasijmp = false;
+
+		// Let jumps that land on another jump go straight to the final target.
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (Code[i].op == OP_IJMP) hasijmp = true;
+			if (Code[i].op != OP_JMP) continue;
+
+			unsigned target = i + 1 + Code[i].i24;
+			for (int hops = 0; hops < 8 && target < count && Code[target].op == OP_JMP; hops++)
+			{
+				unsigned next = target + 1 + Code[target].i24;
+				if (next == target) break;
+				target = next;
+			}
+			int offset = int(target - i - 1);
+			if (offset != Code[i].i24 && ((offset << 8) >> 8) == offset)
+			{
+				Code[i].i24 = offset;
+				changed = true;
+			}
+		}
+		if (hasijmp) break;
+
+		TArray<FRegUse> uses(count, true);
+		for (unsigned i = 0; i < count; i++)
+		{
+			GetRegUse(Code[i], uses[i]);
+		}
+		EliminateCommonSubexpressions(Code, uses);
+		EliminateDeadStores(Code, uses);
+
+		// Find everything that can be reached from the entry point.
+		TArray<uint8_t> keep(count, true);
+		memset(keep.Data(), 0, count);
+		TArray<unsigned> work;
+		auto visit = [&](unsigned pc)
+		{
+			if (pc < count && !keep[pc])
+			{
+				keep[pc] = true;
+				work.Push(pc);
+			}
+		};
+		visit(0);
+		while (work.Size() > 0)
+		{
+			unsigned pc, succ[2];
+			work.Pop(pc);
+			int n = GetSuccessors(Code, pc, succ);
+			for (int j = 0; j < n; j++) visit(succ[j]);
+		}
+
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (keep[i] && IsNoOp(Code[i]) && (i == 0 || !IsConditionalSkip(Code[i - 1].op)))
+			{
+				keep[i] = false;
+			}
+		}
+
+		// Removed instructions map to whatever follows them.
+		TArray<unsigned> newindex(count + 1, true);
+		unsigned newcount = 0;
+		for (unsigned i = 0; i < count; i++)
+		{
+			newindex[i] = newcount;
+			if (keep[i]) newcount++;
+		}
+		newindex[count] = newcount;
+		if (newcount == count) break;
+
+		unsigned out = 0;
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (!keep[i]) continue;
+			VMOP op = Code[i];
+			if (op.op == OP_JMP)
+			{
+				unsigned target = MIN<unsigned>(i + 1 + op.i24, count);
+				op.i24 = int(newindex[target] - out - 1);
+			}
+			Code[out++] = op;
+		}
+		Code.Resize(newcount);
+
+		for (auto &line : LineNumbers)
+		{
+			line.InstructionIndex = (uint16_t)newindex[MIN<unsigned>(line.InstructionIndex, count)];
+		}
+		// An entry whose code has been removed completely is superseded by the next one.
+		for (unsigned i = LineNumbers.Size(); i-- > 1; )
+		{
+			if (LineNumbers[i - 1].InstructionIndex == LineNumbers[i].InstructionIndex)
+			{
+				LineNumbers.Delete(i - 1);
+			}
+		}
+		changed = true;
+	} while (changed && ++passes < 4);
+	return inlined;
+}
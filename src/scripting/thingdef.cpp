@@ -53,6 +53,7 @@
 #include "stats.h"
 #include "info.h"
 #include "thingdef.h"
+#include "startupprofile.h"
 
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 void InitThingdef();
@@ -432,20 +433,33 @@ void SynthesizeFlagFields();
 
 void LoadActors()
 {
-	cycle_t timer;
+	cycle_t timer, decoratetimer, codegentimer;
 
 	timer.Reset(); timer.Clock();
 	FScriptPosition::ResetErrorCounter();
 
 	InitThingdef();
 	FScriptPosition::StrictErrors = true;
-	ParseScripts();
+	{
+		FStartupProfileScope profile("ZScript");
+		ParseScripts();
+	}
 
 	FScriptPosition::StrictErrors = false;
-	ParseAllDecorate();
-	SynthesizeFlagFields();
+	{
+		FStartupProfileScope profile("DECORATE");
+		decoratetimer.Reset(); decoratetimer.Clock();
+		ParseAllDecorate();
+		decoratetimer.Unclock();
+		SynthesizeFlagFields();
+	}
 
-	FunctionBuildList.Build();
+	{
+		FStartupProfileScope profile("Code generation");
+		codegentimer.Reset(); codegentimer.Clock();
+		FunctionBuildList.Build();
+		codegentimer.Unclock();
+	}
 
 	if (FScriptPosition::ErrorCounter > 0)
 	{
@@ -507,7 +521,7 @@ void LoadActors()
 	}
 
 	timer.Unclock();
-	if (!batchrun) Printf("script parsing took %.2f ms\n", timer.TimeMS());
+	if (!batchrun) Printf("script parsing took %.2f ms (DECORATE %.2f ms, code generation %.2f ms)\n", timer.TimeMS(), decoratetimer.TimeMS(), codegentimer.TimeMS());
 
 	// Now we may call the scripted OnDestroy method.
 	PClass::bVMOperational = true;
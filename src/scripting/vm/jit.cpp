@@ -1,20 +1,24 @@
 
 #include "jit.h"
 #include "jitintern.h"
+#include "startupprofile.h"
 
 extern PString *TypeString;
 extern PStruct *TypeVector2;
 extern PStruct *TypeVector3;
 
 static void OutputJitLog(const asmjit::StringLogger &logger);
+static JitFuncPtr CompileDirectCallEntry(VMScriptFunction *sfunc, void *directcode, const asmjit::FuncSignature &signature);
 
-JitFuncPtr JitCompile(VMScriptFunction *sfunc)
+JitFuncPtr JitCompile(VMScriptFunction *sfunc, void **directcode)
 {
 #if 0
 	if (strcmp(sfunc->PrintableName.GetChars(), "StatusScreen.drawNum") != 0)
 		return nullptr;
 #endif
 
+	FStartupProfileScope profile("JitCompile", sfunc->PrintableName);
+
 	using namespace asmjit;
 	StringLogger logger;
 	try
@@ -26,7 +30,16 @@ JitFuncPtr JitCompile(VMScriptFunction *sfunc)
 		code.setLogger(&logger);
 
 		JitCompiler compiler(&code, sfunc);
-		return reinterpret_cast<JitFuncPtr>(AddJitFunction(&code, &compiler));
+		void *p = AddJitFunction(&code, &compiler);
+
+		FuncSignature signature;
+		if (p == nullptr || !GetDirectCallSignature(sfunc, signature))
+			return reinterpret_cast<JitFuncPtr>(p);
+
+		JitFuncPtr entry = CompileDirectCallEntry(sfunc, p, signature);
+		if (entry && directcode)
+			*directcode = p;
+		return entry;
 	}
 	catch (const CRecoverableError &e)
 	{
@@ -66,6 +79,78 @@ void JitDumpLog(FILE *file, VMScriptFunction *sfunc)
 	}
 }
 
+//==========================================================================
+//
+// The interpreter, natives and indirect calls need the ScriptCall signature
+// to call a function that takes its arguments in registers. This entry
+// point takes them out of the VMValue array and passes them on.
+//
+//==========================================================================
+
+static JitFuncPtr CompileDirectCallEntry(VMScriptFunction *sfunc, void *directcode, const asmjit::FuncSignature &signature)
+{
+	using namespace asmjit;
+
+	ThrowingErrorHandler errorHandler;
+	CodeHolder code;
+	code.init(GetHostCodeInfo());
+	code.setErrorHandler(&errorHandler);
+
+	X86Compiler cc(&code);
+	auto unusedFunc = cc.newIntPtr("func"); // VMFunction*
+	auto args = cc.newIntPtr("args"); // VMValue *params
+	auto numargs = cc.newInt32("numargs"); // int numargs
+	auto ret = cc.newIntPtr("ret"); // VMReturn *ret
+	auto numret = cc.newInt32("numret"); // int numret
+
+	CCFunc *func = cc.addFunc(FuncSignature5<int, VMFunction *, void *, int, void *, int>());
+	cc.setArg(0, unusedFunc);
+	cc.setArg(1, args);
+	cc.setArg(2, numargs);
+	cc.setArg(3, ret);
+	cc.setArg(4, numret);
+
+	unsigned int numparams = signature.getArgCount() - 2;
+	std::vector<X86Reg> params;
+	for (unsigned int i = 0; i < numparams; i++)
+	{
+		int offset = (int)(i * sizeof(VMValue));
+		if (signature.getArg(i) == TypeIdOf<double>::kTypeId)
+		{
+			X86Xmm reg = cc.newXmmSd();
+			cc.movsd(reg, x86::qword_ptr(args, offset + offsetof(VMValue, f)));
+			params.push_back(reg);
+		}
+		else if (signature.getArg(i) == TypeIdOf<int>::kTypeId)
+		{
+			X86Gp reg = cc.newInt32();
+			cc.mov(reg, x86::dword_ptr(args, offset + offsetof(VMValue, i)));
+			params.push_back(reg);
+		}
+		else
+		{
+			X86Gp reg = cc.newIntPtr();
+			cc.mov(reg, x86::ptr(args, offset + offsetof(VMValue, a)));
+			params.push_back(reg);
+		}
+	}
+
+	auto result = cc.newInt32("result");
+	auto call = cc.call(imm_ptr(directcode), signature);
+	for (unsigned int i = 0; i < numparams; i++)
+		call->setArg(i, params[i]);
+	call->setArg(numparams, ret);
+	call->setArg(numparams + 1, numret);
+	call->setRet(0, result);
+	cc.ret(result);
+
+	cc.endFunc();
+	cc.finalize();
+
+	// Without a name it doesn't show up in stack traces next to the function itself.
+	return reinterpret_cast<JitFuncPtr>(AddJitFunction(&code, func, FString(), sfunc->SourceFileName, TArray<JitLineInfo>()));
+}
+
 static void OutputJitLog(const asmjit::StringLogger &logger)
 {
 	// Write line by line since I_FatalError seems to cut off long strings
@@ -239,18 +324,27 @@ void JitCompiler::Setup()
 	cc.comment(marks, 56);
 	cc.comment("", 0);
 
-	auto unusedFunc = cc.newIntPtr("func"); // VMFunction*
-	args = cc.newIntPtr("args"); // VMValue *params
-	numargs = cc.newInt32("numargs"); // int numargs
 	ret = cc.newIntPtr("ret"); // VMReturn *ret
 	numret = cc.newInt32("numret"); // int numret
 
-	func = cc.addFunc(FuncSignature5<int, VMFunction *, void *, int, void *, int>());
-	cc.setArg(0, unusedFunc);
-	cc.setArg(1, args);
-	cc.setArg(2, numargs);
-	cc.setArg(3, ret);
-	cc.setArg(4, numret);
+	if (directCall)
+	{
+		// The arguments go straight into the VM registers in SetupSimpleFrame.
+		func = cc.addFunc(directSignature);
+	}
+	else
+	{
+		auto unusedFunc = cc.newIntPtr("func"); // VMFunction*
+		args = cc.newIntPtr("args"); // VMValue *params
+		numargs = cc.newInt32("numargs"); // int numargs
+
+		func = cc.addFunc(FuncSignature5<int, VMFunction *, void *, int, void *, int>());
+		cc.setArg(0, unusedFunc);
+		cc.setArg(1, args);
+		cc.setArg(2, numargs);
+		cc.setArg(3, ret);
+		cc.setArg(4, numret);
+	}
 
 	callReturnsCursor = cc.getCursor();
 
@@ -294,29 +388,49 @@ void JitCompiler::SetupSimpleFrame()
 
 	vmframeCursor = cc.getCursor();
 
+	// Direct calls pass the arguments in registers, everything else in a VMValue array.
 	int argsPos = 0;
+	auto loadInt = [&](const X86Gp &reg)
+	{
+		if (directCall) cc.setArg(argsPos, reg);
+		else cc.mov(reg, x86::dword_ptr(args, argsPos * sizeof(VMValue) + offsetof(VMValue, i)));
+		argsPos++;
+	};
+	auto loadFloat = [&](const X86Xmm &reg)
+	{
+		if (directCall) cc.setArg(argsPos, reg);
+		else cc.movsd(reg, x86::qword_ptr(args, argsPos * sizeof(VMValue) + offsetof(VMValue, f)));
+		argsPos++;
+	};
+	auto loadPointer = [&](const X86Gp &reg)
+	{
+		if (directCall) cc.setArg(argsPos, reg);
+		else cc.mov(reg, x86::ptr(args, argsPos * sizeof(VMValue) + offsetof(VMValue, a)));
+		argsPos++;
+	};
+
 	int regd = 0, regf = 0, rega = 0;
 	for (unsigned int i = 0; i < sfunc->Proto->ArgumentTypes.Size(); i++)
 	{
 		const PType *type = sfunc->Proto->ArgumentTypes[i];
 		if (sfunc->ArgFlags.Size() && sfunc->ArgFlags[i] & (VARF_Out | VARF_Ref))
 		{
-			cc.mov(regA[rega++], x86::ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, a)));
+			loadPointer(regA[rega++]);
 		}
 		else if (type == TypeVector2)
 		{
-			cc.movsd(regF[regf++], x86::qword_ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, f)));
-			cc.movsd(regF[regf++], x86::qword_ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, f)));
+			loadFloat(regF[regf++]);
+			loadFloat(regF[regf++]);
 		}
 		else if (type == TypeVector3)
 		{
-			cc.movsd(regF[regf++], x86::qword_ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, f)));
-			cc.movsd(regF[regf++], x86::qword_ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, f)));
-			cc.movsd(regF[regf++], x86::qword_ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, f)));
+			loadFloat(regF[regf++]);
+			loadFloat(regF[regf++]);
+			loadFloat(regF[regf++]);
 		}
 		else if (type == TypeFloat64)
 		{
-			cc.movsd(regF[regf++], x86::qword_ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, f)));
+			loadFloat(regF[regf++]);
 		}
 		else if (type == TypeString)
 		{
@@ -324,17 +438,23 @@ void JitCompiler::SetupSimpleFrame()
 		}
 		else if (type->isIntCompatible())
 		{
-			cc.mov(regD[regd++], x86::dword_ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, i)));
+			loadInt(regD[regd++]);
 		}
 		else
 		{
-			cc.mov(regA[rega++], x86::ptr(args, argsPos++ * sizeof(VMValue) + offsetof(VMValue, a)));
+			loadPointer(regA[rega++]);
 		}
 	}
 
 	if (sfunc->NumArgs != argsPos || regd > sfunc->NumRegD || regf > sfunc->NumRegF || rega > sfunc->NumRegA)
 		I_FatalError("JIT: sfunc->NumArgs != argsPos || regd > sfunc->NumRegD || regf > sfunc->NumRegF || rega > sfunc->NumRegA");
 
+	if (directCall)
+	{
+		cc.setArg(argsPos, ret);
+		cc.setArg(argsPos + 1, numret);
+	}
+
 	for (int i = regd; i < sfunc->NumRegD; i++)
 		cc.xor_(regD[i], regD[i]);
 
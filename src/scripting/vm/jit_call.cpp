@@ -3,6 +3,9 @@
 #include <map>
 #include <memory>
 
+extern PStruct *TypeVector2;
+extern PStruct *TypeVector3;
+
 void JitCompiler::EmitPARAM()
 {
 	ParamOpcodes.Push(pc);
@@ -60,9 +63,22 @@ void JitCompiler::EmitCALL_K()
 	}
 	else
 	{
-		auto ptr = newTempIntPtr();
-		cc.mov(ptr, asmjit::imm_ptr(target));
-		EmitVMCall(ptr, target);
+		// Script functions that run as native code get their arguments in registers, without VMValues or ScriptCall.
+		void *directcode = nullptr;
+		asmjit::FuncSignature signature;
+		if (target && !ntarget)
+			directcode = static_cast<VMScriptFunction *>(target)->PrepareDirectCall();
+
+		if (directcode && GetDirectCallSignature(static_cast<VMScriptFunction *>(target), signature) && CanCallDirect(signature))
+		{
+			EmitDirectCall(static_cast<VMScriptFunction *>(target), directcode, signature);
+		}
+		else
+		{
+			auto ptr = newTempIntPtr();
+			cc.mov(ptr, asmjit::imm_ptr(target));
+			EmitVMCall(ptr, target);
+		}
 	}
 
 	pc += C; // Skip RESULTs
@@ -105,6 +121,160 @@ void JitCompiler::EmitVMCall(asmjit::X86Gp vmfunc, VMFunction *target)
 	ParamOpcodes.Clear();
 }
 
+bool JitCompiler::CanCallDirect(const asmjit::FuncSignature &signature)
+{
+	using namespace asmjit;
+
+	// The PARAMs have to produce exactly the arguments of the callee's register entry point.
+	unsigned int numargs = signature.getArgCount() - 2;
+	unsigned int slot = 0;
+	auto expect = [&](uint32_t typeId) { return slot < numargs && signature.getArg(slot++) == typeId; };
+
+	for (unsigned int i = 0; i < ParamOpcodes.Size(); i++)
+	{
+		bool match;
+		if (ParamOpcodes[i]->op == OP_PARAMI)
+		{
+			match = expect(TypeIdOf<int>::kTypeId);
+		}
+		else switch (ParamOpcodes[i]->a)
+		{
+		case REGT_INT:
+		case REGT_INT | REGT_KONST:
+			match = expect(TypeIdOf<int>::kTypeId);
+			break;
+		case REGT_FLOAT:
+		case REGT_FLOAT | REGT_KONST:
+			match = expect(TypeIdOf<double>::kTypeId);
+			break;
+		case REGT_FLOAT | REGT_MULTIREG2:
+			match = expect(TypeIdOf<double>::kTypeId) && expect(TypeIdOf<double>::kTypeId);
+			break;
+		case REGT_FLOAT | REGT_MULTIREG3:
+			match = expect(TypeIdOf<double>::kTypeId) && expect(TypeIdOf<double>::kTypeId) && expect(TypeIdOf<double>::kTypeId);
+			break;
+		case REGT_POINTER:
+		case REGT_POINTER | REGT_KONST:
+		case REGT_INT | REGT_ADDROF:
+		case REGT_POINTER | REGT_ADDROF:
+		case REGT_FLOAT | REGT_ADDROF:
+			match = expect(TypeIdOf<void*>::kTypeId);
+			break;
+		default:
+			// Strings and omitted arguments only exist as VMValues.
+			match = false;
+			break;
+		}
+		if (!match) return false;
+	}
+	return slot == numargs;
+}
+
+void JitCompiler::EmitDirectCall(VMScriptFunction *target, void *code, const asmjit::FuncSignature &signature)
+{
+	using namespace asmjit;
+
+	CheckVMFrame();
+	FillReturns(pc + 1, C);
+
+	asmjit::CBNode *cursorBefore = cc.getCursor();
+	auto call = cc.call(imm_ptr(code), signature);
+	call->setInlineComment(target->PrintableName.GetChars());
+	asmjit::CBNode *cursorAfter = cc.getCursor();
+	cc.setCursor(cursorBefore);
+
+	X86Gp tmp;
+	X86Xmm tmp2;
+
+	int slot = 0;
+	for (unsigned int i = 0; i < ParamOpcodes.Size(); i++)
+	{
+		if (ParamOpcodes[i]->op == OP_PARAMI)
+		{
+			call->setArg(slot++, imm(ParamOpcodes[i]->i24));
+			continue;
+		}
+
+		int bc = ParamOpcodes[i]->i16u;
+		switch (ParamOpcodes[i]->a)
+		{
+		case REGT_INT:
+			call->setArg(slot++, regD[bc]);
+			break;
+		case REGT_INT | REGT_KONST:
+			call->setArg(slot++, imm(konstd[bc]));
+			break;
+		case REGT_INT | REGT_ADDROF:
+			tmp = newTempIntPtr();
+			cc.lea(tmp, x86::ptr(vmframe, offsetD + (int)(bc * sizeof(int32_t))));
+			cc.mov(x86::dword_ptr(tmp), regD[bc]);
+			call->setArg(slot++, tmp);
+			break;
+		case REGT_POINTER:
+			call->setArg(slot++, regA[bc]);
+			break;
+		case REGT_POINTER | REGT_KONST:
+			tmp = newTempIntPtr();
+			cc.mov(tmp, imm_ptr(konsta[bc].v));
+			call->setArg(slot++, tmp);
+			break;
+		case REGT_POINTER | REGT_ADDROF:
+			tmp = newTempIntPtr();
+			cc.lea(tmp, x86::ptr(vmframe, offsetA + (int)(bc * sizeof(void*))));
+			cc.mov(x86::ptr(tmp), regA[bc]);
+			call->setArg(slot++, tmp);
+			break;
+		case REGT_FLOAT:
+			call->setArg(slot++, regF[bc]);
+			break;
+		case REGT_FLOAT | REGT_MULTIREG2:
+			for (int j = 0; j < 2; j++)
+				call->setArg(slot++, regF[bc + j]);
+			break;
+		case REGT_FLOAT | REGT_MULTIREG3:
+			for (int j = 0; j < 3; j++)
+				call->setArg(slot++, regF[bc + j]);
+			break;
+		case REGT_FLOAT | REGT_KONST:
+			tmp = newTempIntPtr();
+			tmp2 = newTempXmmSd();
+			cc.mov(tmp, imm_ptr(konstf + bc));
+			cc.movsd(tmp2, x86::qword_ptr(tmp));
+			call->setArg(slot++, tmp2);
+			break;
+		case REGT_FLOAT | REGT_ADDROF:
+			tmp = newTempIntPtr();
+			cc.lea(tmp, x86::ptr(vmframe, offsetF + (int)(bc * sizeof(double))));
+			// When passing the address to a float we don't know if the receiving function will treat it as float, vec2 or vec3.
+			for (int j = 0; j < 3; j++)
+			{
+				if ((unsigned int)(bc + j) < regF.Size())
+					cc.movsd(x86::qword_ptr(tmp, j * sizeof(double)), regF[bc + j]);
+			}
+			call->setArg(slot++, tmp);
+			break;
+		default:
+			I_Error("Unknown REGT value passed to EmitPARAM\n");
+			break;
+		}
+	}
+
+	if (slot != B)
+		I_Error("OP_CALL parameter count does not match the number of preceding OP_PARAM instructions\n");
+
+	call->setArg(slot, GetCallReturns());
+	call->setArg(slot + 1, imm(C));
+	cc.setCursor(cursorAfter);
+
+	auto result = newResultInt32();
+	call->setRet(0, result);
+
+	LoadInOuts();
+	LoadReturns(pc + 1, C);
+
+	ParamOpcodes.Clear();
+}
+
 int JitCompiler::StoreCallParams()
 {
 	using namespace asmjit;
@@ -666,3 +836,81 @@ asmjit::FuncSignature JitCompiler::CreateFuncSignature()
 	signature.init(CallConv::kIdHost, rettype, cachedArgs->Data(), cachedArgs->Size());
 	return signature;
 }
+
+//==========================================================================
+//
+// Script functions with a simple frame also get compiled with their
+// arguments in native registers, one per VM register, followed by the
+// VMReturn array and its size. JIT compiled callers call them that way
+// and everything else goes through an entry point that unpacks the
+// VMValue array. Returns false if the function can't take its arguments
+// in registers.
+//
+//==========================================================================
+
+bool GetDirectCallSignature(VMScriptFunction *sfunc, asmjit::FuncSignature &signature)
+{
+	using namespace asmjit;
+
+	if (sfunc->SpecialInits.Size() != 0 || sfunc->NumRegS != 0 || (sfunc->VarFlags & VARF_VarArg))
+		return false;
+
+	TArray<uint8_t> args;
+	FString key;
+
+	// Same order as SetupSimpleFrame loads them from the VMValue array.
+	for (unsigned int i = 0; i < sfunc->Proto->ArgumentTypes.Size(); i++)
+	{
+		const PType *type = sfunc->Proto->ArgumentTypes[i];
+		if (sfunc->ArgFlags.Size() && sfunc->ArgFlags[i] & (VARF_Out | VARF_Ref))
+		{
+			args.Push(TypeIdOf<void*>::kTypeId);
+			key += "v";
+		}
+		else if (type == TypeVector2)
+		{
+			args.Push(TypeIdOf<double>::kTypeId);
+			args.Push(TypeIdOf<double>::kTypeId);
+			key += "ff";
+		}
+		else if (type == TypeVector3)
+		{
+			args.Push(TypeIdOf<double>::kTypeId);
+			args.Push(TypeIdOf<double>::kTypeId);
+			args.Push(TypeIdOf<double>::kTypeId);
+			key += "fff";
+		}
+		else if (type == TypeFloat64)
+		{
+			args.Push(TypeIdOf<double>::kTypeId);
+			key += "f";
+		}
+		else if (type == TypeString)
+		{
+			return false;
+		}
+		else if (type->isIntCompatible())
+		{
+			args.Push(TypeIdOf<int>::kTypeId);
+			key += "i";
+		}
+		else
+		{
+			args.Push(TypeIdOf<void*>::kTypeId);
+			key += "v";
+		}
+	}
+
+	if (args.Size() != sfunc->NumArgs || args.Size() + 2 > kFuncArgCount)
+		return false;
+
+	args.Push(TypeIdOf<void*>::kTypeId);
+	args.Push(TypeIdOf<int>::kTypeId);
+	key += "vi";
+
+	std::unique_ptr<TArray<uint8_t>> &cachedArgs = argsCache[key];
+	if (!cachedArgs) cachedArgs.reset(new TArray<uint8_t>(args));
+
+	signature.init(CallConv::kIdHost, TypeIdOf<int>::kTypeId, cachedArgs->Data(), cachedArgs->Size());
+	return true;
+}
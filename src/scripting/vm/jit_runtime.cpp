@@ -250,12 +250,10 @@ static TArray<uint16_t> CreateUnwindInfoWindows(asmjit::CCFunc *func)
 	return info;
 }
 
-void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
+void *AddJitFunction(asmjit::CodeHolder* code, asmjit::CCFunc *func, const FString &name, const FString &filename, const TArray<JitLineInfo> &lineinfo)
 {
 	using namespace asmjit;
 
-	CCFunc *func = compiler->Codegen();
-
 	size_t codeSize = code->getCodeSize();
 	if (codeSize == 0)
 		return nullptr;
@@ -303,7 +301,7 @@ void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
 	if (result == 0)
 		I_Error("RtlAddFunctionTable failed");
 
-	JitDebugInfo.Push({ compiler->GetScriptFunction()->PrintableName, compiler->GetScriptFunction()->SourceFileName, compiler->LineInfo, startaddr, endaddr });
+	JitDebugInfo.Push({ name, filename, lineinfo, startaddr, endaddr });
 #endif
 
 	return p;
@@ -646,12 +644,10 @@ static TArray<uint8_t> CreateUnwindInfoUnix(asmjit::CCFunc *func, unsigned int &
 	return stream;
 }
 
-void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
+void *AddJitFunction(asmjit::CodeHolder* code, asmjit::CCFunc *func, const FString &name, const FString &filename, const TArray<JitLineInfo> &lineinfo)
 {
 	using namespace asmjit;
 
-	CCFunc *func = compiler->Codegen();
-
 	size_t codeSize = code->getCodeSize();
 	if (codeSize == 0)
 		return nullptr;
@@ -727,12 +723,19 @@ void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
 #endif
 	}
 
-	JitDebugInfo.Push({ compiler->GetScriptFunction()->PrintableName, compiler->GetScriptFunction()->SourceFileName, compiler->LineInfo, startaddr, endaddr });
+	JitDebugInfo.Push({ name, filename, lineinfo, startaddr, endaddr });
 
 	return p;
 }
 #endif
 
+void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
+{
+	asmjit::CCFunc *func = compiler->Codegen();
+	VMScriptFunction *sfunc = compiler->GetScriptFunction();
+	return AddJitFunction(code, func, sfunc->PrintableName, sfunc->SourceFileName, compiler->LineInfo);
+}
+
 void JitRelease()
 {
 #ifdef _WIN64
@@ -934,6 +937,10 @@ FString JitGetStackFrameName(NativeSymbolResolver *nativeSymbols, void *pc)
 		const auto &info = JitDebugInfo[i];
 		if (pc >= info.start && pc < info.end)
 		{
+			// Entry points of functions that take their arguments in registers.
+			if (info.name.IsEmpty())
+				return FString();
+
 			int line = JITPCToLine ((uint8_t *)pc, &info);
 
 			FString s;
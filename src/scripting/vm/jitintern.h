@@ -25,6 +25,8 @@ extern int VMCalls[10];
 #define ABCs			(pc[0].i24)
 #define JMPOFS(x)		((x)->i24)
 
+bool GetDirectCallSignature(VMScriptFunction *sfunc, asmjit::FuncSignature &signature);
+
 struct JitLineInfo
 {
 	ptrdiff_t InstructionIndex = 0;
@@ -35,7 +37,7 @@ struct JitLineInfo
 class JitCompiler
 {
 public:
-	JitCompiler(asmjit::CodeHolder *code, VMScriptFunction *sfunc) : cc(code), sfunc(sfunc) { }
+	JitCompiler(asmjit::CodeHolder *code, VMScriptFunction *sfunc) : cc(code), sfunc(sfunc) { directCall = GetDirectCallSignature(sfunc, directSignature); }
 
 	asmjit::CCFunc *Codegen();
 	VMScriptFunction *GetScriptFunction() { return sfunc; }
@@ -62,6 +64,8 @@ private:
 
 	void EmitNativeCall(VMNativeFunction *target);
 	void EmitVMCall(asmjit::X86Gp ptr, VMFunction *target);
+	bool CanCallDirect(const asmjit::FuncSignature &signature);
+	void EmitDirectCall(VMScriptFunction *target, void *code, const asmjit::FuncSignature &signature);
 	void EmitVtbl(const VMOP *op);
 
 	int StoreCallParams();
@@ -233,6 +237,8 @@ private:
 	VMScriptFunction *sfunc;
 
 	asmjit::CCFunc *func = nullptr;
+	bool directCall;	// arguments are passed in registers, see GetDirectCallSignature
+	asmjit::FuncSignature directSignature;
 	asmjit::X86Gp args;
 	asmjit::X86Gp numargs;
 	asmjit::X86Gp ret;
@@ -319,4 +325,5 @@ public:
 };
 
 void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler);
+void *AddJitFunction(asmjit::CodeHolder* code, asmjit::CCFunc *func, const FString &name, const FString &filename, const TArray<JitLineInfo> &lineinfo);
 asmjit::CodeInfo GetHostCodeInfo();
@@ -43,6 +43,9 @@
 #include "jit.h"
 #include "c_cvars.h"
 #include "version.h"
+#include "d_player.h"
+#include "doomstat.h"
+#include "g_game.h"
 
 #ifdef HAVE_VM_JIT
 CUSTOM_CVAR(Bool, vm_jit, true, CVAR_NOINITCALL)
@@ -278,24 +281,49 @@ static bool CanJit(VMScriptFunction *func)
 	return false;
 }
 
-int VMScriptFunction::FirstScriptCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret)
+void VMScriptFunction::SetupScriptCall()
 {
 #ifdef HAVE_VM_JIT
-	if (vm_jit && CanJit(static_cast<VMScriptFunction*>(func)))
+	if (vm_jit && CanJit(this))
 	{
-		func->ScriptCall = JitCompile(static_cast<VMScriptFunction*>(func));
-		if (!func->ScriptCall)
-			func->ScriptCall = VMExec;
+		JitCode = JitCompile(this, &DirectCode);
 	}
-	else
 #endif // HAVE_VM_JIT
-	{
-		func->ScriptCall = VMExec;
-	}
+	ScriptCall = JitCode ? JitCode : VMExec;
+}
 
+int VMScriptFunction::FirstScriptCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret)
+{
+	static_cast<VMScriptFunction*>(func)->SetupScriptCall();
 	return func->ScriptCall(func, params, numparams, ret, numret);
 }
 
+//===========================================================================
+//
+// VMScriptFunction :: PrepareDirectCall
+//
+// Returns the native entry point a JIT compiled caller can call with the
+// arguments in registers, compiling the function first if it has not run
+// yet. Returns nullptr if the function runs in the interpreter, cannot take
+// its arguments that way or is still being compiled further up, which is
+// what happens with recursion.
+//
+//===========================================================================
+
+void *VMScriptFunction::PrepareDirectCall()
+{
+	static TArray<VMScriptFunction *> Compiling;
+
+	// The depth limit keeps long chains of not yet compiled callees from using up the native stack.
+	if (ScriptCall == &VMScriptFunction::FirstScriptCall && Compiling.Size() < 16 && Compiling.Find(this) == Compiling.Size())
+	{
+		Compiling.Push(this);
+		SetupScriptCall();
+		Compiling.Pop();
+	}
+	return DirectCode;
+}
+
 int VMNativeFunction::NativeScriptCall(VMFunction *func, VMValue *params, int numparams, VMReturn *returns, int numret)
 {
 	try
@@ -393,8 +421,15 @@ VMFrame *VMFrameStack::AllocFrame(VMScriptFunction *func)
 	frame->NumRegS = func->NumRegS;
 	frame->NumRegA = func->NumRegA;
 	frame->MaxParam = func->MaxParam;
+	frame->NumParam = 0;
 	frame->Func = func;
+
+	// Parameters are always written before they are read and the string registers
+	// get constructed, so only the other registers and the extra space are cleared.
+	memset(frame->GetRegF(), 0, func->NumRegF * sizeof(double));
 	frame->InitRegS();
+	VM_UBYTE *rest = (VM_UBYTE *)frame->GetRegA();
+	memset(rest, 0, (VM_UBYTE *)frame + func->StackSize - rest);
 	if (func->SpecialInits.Size())
 	{
 		func->InitExtra(frame->GetExtra());
@@ -407,7 +442,7 @@ VMFrame *VMFrameStack::AllocFrame(VMScriptFunction *func)
 // VMFrameStack :: Alloc
 //
 // Allocates space for a frame. Its size will be rounded up to a multiple
-// of 16 bytes.
+// of 16 bytes. The contents are left uninitialized.
 //
 //===========================================================================
 
@@ -456,7 +491,6 @@ VMFrame *VMFrameStack::Alloc(int size)
 		Blocks = block;
 	}
 	frame = (VMFrame *)block->FreeSpace;
-	memset(frame, 0, size);
 	frame->ParentFrame = parent;
 	block->FreeSpace += size;
 	block->LastFrame = frame;
@@ -761,3 +795,113 @@ CCMD(vmengine)
 	Printf("Usage: vmengine <default|checked|unchecked>\n");
 }
 
+
+//-----------------------------------------------------------------------------
+//
+// benchvm <function> [iterations]
+//
+// Runs a method of the player's pawn that takes no arguments, once with
+// everything running in the interpreter and once with the JIT compiler.
+// The function really gets executed so it should be one that does not
+// change anything important. For functions that call other script functions
+// the time per call is also reported, which measures the call overhead.
+//
+//-----------------------------------------------------------------------------
+
+CCMD(benchvm)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: benchvm <function> [iterations]\n");
+		return;
+	}
+	if (netgame)
+	{
+		Printf("benchvm cannot be used in a network game\n");
+		return;
+	}
+	// Running arbitrary methods on the pawn can change the game like a cheat.
+	if (CheckCheatmode()) return;
+	if (gamestate != GS_LEVEL || players[consoleplayer].mo == nullptr)
+	{
+		Printf("benchvm can only be used inside a level\n");
+		return;
+	}
+	AActor *mo = players[consoleplayer].mo;
+	auto sym = dyn_cast<PFunction>(mo->GetClass()->FindSymbol(argv[1], true));
+	if (sym == nullptr || !(sym->Variants[0].Flags & VARF_Method))
+	{
+		Printf("%s is not a method of %s\n", argv[1], mo->GetClass()->TypeName.GetChars());
+		return;
+	}
+	VMFunction *func = sym->Variants[0].Implementation;
+	if (func->VarFlags & VARF_Native)
+	{
+		Printf("%s is a native function\n", argv[1]);
+		return;
+	}
+	if (func->Proto->ArgumentTypes.Size() != func->ImplicitArgs)
+	{
+		Printf("%s takes arguments\n", argv[1]);
+		return;
+	}
+	int iterations = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 100000;
+
+	VMValue params[3] = { mo, mo, (void*)nullptr };
+	int scriptcalls = 0;
+	auto run = [&]() -> double
+	{
+		cycle_t clock;
+		VMCall(func, params, func->ImplicitArgs, nullptr, 0);	// warm up, this also runs the JIT compiler
+		int startcalls = VMCalls[0];
+		clock.Reset();
+		clock.Clock();
+		for (int i = 0; i < iterations; i++)
+		{
+			VMCall(func, params, func->ImplicitArgs, nullptr, 0);
+		}
+		clock.Unclock();
+		scriptcalls = (VMCalls[0] - startcalls) / iterations;
+		return clock.TimeMS() * 1000000. / iterations;
+	};
+
+	// Send every script function to the interpreter, including the ones called from here.
+	TArray<decltype(func->ScriptCall)> savedcalls(VMFunction::AllFunctions.Size(), true);
+	for (unsigned i = 0; i < VMFunction::AllFunctions.Size(); i++)
+	{
+		auto f = VMFunction::AllFunctions[i];
+		savedcalls[i] = f->ScriptCall;
+		if (!(f->VarFlags & VARF_Native)) f->ScriptCall = VMExec;
+	}
+	auto restore = [&]()
+	{
+		for (unsigned i = 0; i < VMFunction::AllFunctions.Size(); i++)
+		{
+			VMFunction::AllFunctions[i]->ScriptCall = savedcalls[i];
+		}
+	};
+
+	double interpreted, jitted = 0;
+	try
+	{
+		interpreted = run();
+		restore();
+		if (vm_jit) jitted = run();
+	}
+	catch (...)
+	{
+		restore();
+		throw;
+	}
+
+	Printf("%s: %d instructions, %d calls\n", func->PrintableName.GetChars(), static_cast<VMScriptFunction *>(func)->CodeSize, iterations);
+	Printf("  interpreter: %.1f ns per call\n", interpreted);
+	if (vm_jit) Printf("  JIT: %.1f ns per call (%.2fx)\n", jitted, interpreted / jitted);
+	else Printf("  JIT: not available\n");
+	if (scriptcalls > 1)
+	{
+		Printf("  %d script calls per run, %.1f ns each in the interpreter", scriptcalls, interpreted / scriptcalls);
+		if (vm_jit) Printf(", %.1f ns each with the JIT", jitted / scriptcalls);
+		Printf("\n");
+	}
+}
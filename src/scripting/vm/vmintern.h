@@ -475,7 +475,12 @@ public:
 	void DestroyExtra(void *addr);
 	int AllocExtraStack(PType *type);
 	int PCToLine(const VMOP *pc);
+	void *PrepareDirectCall();
 
 private:
+	JitFuncPtr JitCode = nullptr;	// native code of this function, if it has been compiled
+	void *DirectCode = nullptr;		// entry point of the native code that takes its arguments in registers
+
+	void SetupScriptCall();
 	static int FirstScriptCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
 };
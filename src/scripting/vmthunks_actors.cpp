@@ -1107,6 +1107,35 @@ DEFINE_ACTION_FUNCTION_NATIVE(AActor, LineAttack, ZS_LineAttack)
 	return numret;
 }
 
+DEFINE_ACTION_FUNCTION(AActor, LineAttackBatch)
+{
+	PARAM_SELF_PROLOGUE(AActor);
+	PARAM_POINTER(angles, TArray<double>);
+	PARAM_POINTER(pitches, TArray<double>);
+	PARAM_POINTER(damages, TArray<int>);
+	PARAM_FLOAT(distance);
+	PARAM_INT(damageType);
+	PARAM_CLASS(puffType, AActor);
+	PARAM_INT(flags);
+	PARAM_FLOAT(offsetz);
+	PARAM_FLOAT(offsetforward);
+	PARAM_FLOAT(offsetside);
+
+	unsigned numshots = MIN(angles->Size(), MIN(pitches->Size(), damages->Size()));
+	TArray<DAngle> shotangles(numshots, true);
+	TArray<DAngle> shotpitches(numshots, true);
+
+	for (unsigned i = 0; i < numshots; i++)
+	{
+		shotangles[i] = (*angles)[i];
+		shotpitches[i] = (*pitches)[i];
+	}
+	if (puffType == nullptr) puffType = PClass::FindActor(NAME_BulletPuff);	// P_LineAttack does not work without a puff to take info from.
+	P_LineAttackBatch(self, numshots, shotangles.Data(), shotpitches.Data(), damages->Data(), distance, ENamedName(damageType), puffType, flags,
+		nullptr, nullptr, nullptr, offsetz, offsetforward, offsetside);
+	return 0;
+}
+
 static int LineTrace(AActor *self, double angle, double distance, double pitch, int flags, double offsetz, double offsetforward, double offsetside, FLineTraceData *data)
 {
 	return P_LineTrace(self,angle,distance,pitch,flags,offsetz,offsetforward,offsetside,data);
@@ -0,0 +1,986 @@
+/*
+** zcc_cache.cpp
+**
+** Caches the syntax trees of ZScript translation units on disk
+**
+** Only the parser's output gets cached. Everything the compiler produces
+** (types, symbols, defaults and VM code) is full of pointers into the
+** current session and therefore gets rebuilt from the tree on every start.
+**
+** A cache file is found by a hash of the engine version and the unit's
+** base lump. It lists every lump that went into the tree, each with a hash
+** of its path and content, so changing an included file invalidates it.
+**
+** The cache never leaves the machine that wrote it, so everything is
+** stored in native byte order.
+**
+*/
+
+#include <stdexcept>
+#include "dobject.h"
+#include "w_wad.h"
+#include "cmdlib.h"
+#include "m_misc.h"
+#include "files.h"
+#include "md5.h"
+#include "c_cvars.h"
+#include "version.h"
+#include "zcc_parser.h"
+
+CVAR(Bool, zscript_cache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+static const char ZCCCacheMagic[4] = { 'Z', 'S', 'A', 'C' };
+static const uint32_t ZCCCacheVersion = 1;
+static const unsigned ZCCCacheMaxFiles = 32;
+
+// Indexed by EZCCTreeNodeType
+static const size_t ZCCNodeSizes[] =
+{
+	sizeof(ZCC_Identifier),
+	sizeof(ZCC_Class),
+	sizeof(ZCC_Struct),
+	sizeof(ZCC_Enum),
+	sizeof(ZCC_EnumTerminator),
+	sizeof(ZCC_States),
+	sizeof(ZCC_StatePart),
+	sizeof(ZCC_StateLabel),
+	sizeof(ZCC_StateStop),
+	sizeof(ZCC_StateWait),
+	sizeof(ZCC_StateFail),
+	sizeof(ZCC_StateLoop),
+	sizeof(ZCC_StateGoto),
+	sizeof(ZCC_StateLine),
+	sizeof(ZCC_VarName),
+	sizeof(ZCC_VarInit),
+	sizeof(ZCC_Type),
+	sizeof(ZCC_BasicType),
+	sizeof(ZCC_MapType),
+	sizeof(ZCC_DynArrayType),
+	sizeof(ZCC_ClassType),
+	sizeof(ZCC_Expression),
+	sizeof(ZCC_ExprID),
+	sizeof(ZCC_ExprTypeRef),
+	sizeof(ZCC_ExprConstant),
+	sizeof(ZCC_ExprFuncCall),
+	sizeof(ZCC_ExprMemberAccess),
+	sizeof(ZCC_ExprUnary),
+	sizeof(ZCC_ExprBinary),
+	sizeof(ZCC_ExprTrinary),
+	sizeof(ZCC_FuncParm),
+	sizeof(ZCC_Statement),
+	sizeof(ZCC_CompoundStmt),
+	sizeof(ZCC_ContinueStmt),
+	sizeof(ZCC_BreakStmt),
+	sizeof(ZCC_ReturnStmt),
+	sizeof(ZCC_ExpressionStmt),
+	sizeof(ZCC_IterationStmt),
+	sizeof(ZCC_IfStmt),
+	sizeof(ZCC_SwitchStmt),
+	sizeof(ZCC_CaseStmt),
+	sizeof(ZCC_AssignStmt),
+	sizeof(ZCC_LocalVarStmt),
+	sizeof(ZCC_FuncParamDecl),
+	sizeof(ZCC_ConstantDef),
+	sizeof(ZCC_Declarator),
+	sizeof(ZCC_VarDeclarator),
+	sizeof(ZCC_FuncDeclarator),
+	sizeof(ZCC_Default),
+	sizeof(ZCC_FlagStmt),
+	sizeof(ZCC_PropertyStmt),
+	sizeof(ZCC_VectorValue),
+	sizeof(ZCC_DeclFlags),
+	sizeof(ZCC_ClassCast),
+	sizeof(ZCC_StaticArrayStatement),
+	sizeof(ZCC_Property),
+	sizeof(ZCC_FlagDef),
+};
+static_assert(countof(ZCCNodeSizes) == NUM_AST_NODE_TYPES, "ZCCNodeSizes does not match EZCCTreeNodeType");
+
+//==========================================================================
+//
+// The parser only ever assigns these types to expressions.
+//
+//==========================================================================
+
+static PType *GetCacheType(unsigned index)
+{
+	switch (index)
+	{
+	case 0: return nullptr;
+	case 1: return TypeError;
+	case 2: return TypeString;
+	case 3: return TypeSInt32;
+	case 4: return TypeUInt32;
+	case 5: return TypeFloat64;
+	case 6: return TypeName;
+	case 7: return TypeBool;
+	case 8: return TypeNullPtr;
+	default: throw std::runtime_error("Bad type in script cache");
+	}
+}
+
+static unsigned GetCacheTypeIndex(PType *type)
+{
+	for (unsigned i = 0; i < 9; i++)
+	{
+		if (GetCacheType(i) == type) return i;
+	}
+	throw std::runtime_error("Unexpected type in syntax tree");
+}
+
+//==========================================================================
+//
+// One function describes the layout of all node types. It gets called
+// with an archive that either collects the nodes, writes them or reads
+// them back.
+//
+//==========================================================================
+
+template<class Arc> static void SerializeNamedNode(Arc &arc, ZCC_NamedNode *node)
+{
+	arc.Name(node->NodeName);
+}
+
+template<class Arc> static void SerializeStruct(Arc &arc, ZCC_Struct *node)
+{
+	SerializeNamedNode(arc, node);
+	arc.Int(node->Flags);
+	arc.Node(node->Body);
+	arc.Int(node->Version.major);
+	arc.Int(node->Version.minor);
+	arc.Int(node->Version.revision);
+}
+
+template<class Arc> static void SerializeExpression(Arc &arc, ZCC_Expression *node)
+{
+	arc.Int(node->Operation);
+	arc.Type(node->Type);
+}
+
+template<class Arc> static void SerializeDeclarator(Arc &arc, ZCC_Declarator *node)
+{
+	arc.Node(node->Type);
+	arc.Int(node->Flags);
+	arc.Int(node->Version.major);
+	arc.Int(node->Version.minor);
+	arc.Int(node->Version.revision);
+}
+
+template<class Arc> static void SerializeNode(Arc &arc, ZCC_TreeNode *node)
+{
+	arc.Node(node->SiblingNext);
+	arc.Node(node->SiblingPrev);
+	arc.String(node->SourceName);
+	arc.Lump(node->SourceLump);
+	arc.Int(node->SourceLoc);
+
+	switch (node->NodeType)
+	{
+	case AST_Identifier:
+		arc.Name(static_cast<ZCC_Identifier *>(node)->Id);
+		break;
+
+	case AST_Class:
+	{
+		auto n = static_cast<ZCC_Class *>(node);
+		SerializeStruct(arc, n);
+		arc.Node(n->ParentName);
+		arc.Node(n->Replaces);
+		break;
+	}
+
+	case AST_Struct:
+		SerializeStruct(arc, static_cast<ZCC_Struct *>(node));
+		break;
+
+	case AST_Enum:
+	{
+		auto n = static_cast<ZCC_Enum *>(node);
+		SerializeNamedNode(arc, n);
+		arc.Int(n->EnumType);
+		arc.Node(n->Elements);
+		break;
+	}
+
+	case AST_States:
+	{
+		auto n = static_cast<ZCC_States *>(node);
+		arc.Node(n->Body);
+		arc.Node(n->Flags);
+		break;
+	}
+
+	case AST_StateLabel:
+		arc.Name(static_cast<ZCC_StateLabel *>(node)->Label);
+		break;
+
+	case AST_StateGoto:
+	{
+		auto n = static_cast<ZCC_StateGoto *>(node);
+		arc.Node(n->Qualifier);
+		arc.Node(n->Label);
+		arc.Node(n->Offset);
+		break;
+	}
+
+	case AST_StateLine:
+	{
+		auto n = static_cast<ZCC_StateLine *>(node);
+		int bits = n->bBright | (n->bFast << 1) | (n->bSlow << 2) | (n->bNoDelay << 3) | (n->bCanRaise << 4);
+		arc.Int(bits);
+		n->bBright = !!(bits & 1);
+		n->bFast = !!(bits & 2);
+		n->bSlow = !!(bits & 4);
+		n->bNoDelay = !!(bits & 8);
+		n->bCanRaise = !!(bits & 16);
+		arc.String(n->Sprite);
+		arc.String(n->Frames);
+		arc.Node(n->Duration);
+		arc.Node(n->Offset);
+		arc.Node(n->Lights);
+		arc.Node(n->Action);
+		break;
+	}
+
+	case AST_VarName:
+	case AST_VarInit:
+	{
+		auto n = static_cast<ZCC_VarName *>(node);
+		arc.Name(n->Name);
+		arc.Node(n->ArraySize);
+		if (node->NodeType == AST_VarInit)
+		{
+			auto i = static_cast<ZCC_VarInit *>(node);
+			arc.Node(i->Init);
+			arc.Int(i->InitIsArray);
+		}
+		break;
+	}
+
+	case AST_Type:
+		arc.Node(static_cast<ZCC_Type *>(node)->ArraySize);
+		break;
+
+	case AST_BasicType:
+	{
+		auto n = static_cast<ZCC_BasicType *>(node);
+		arc.Node(n->ArraySize);
+		arc.Int(n->Type);
+		arc.Node(n->UserType);
+		arc.Int(n->isconst);
+		break;
+	}
+
+	case AST_MapType:
+	{
+		auto n = static_cast<ZCC_MapType *>(node);
+		arc.Node(n->ArraySize);
+		arc.Node(n->KeyType);
+		arc.Node(n->ValueType);
+		break;
+	}
+
+	case AST_DynArrayType:
+	{
+		auto n = static_cast<ZCC_DynArrayType *>(node);
+		arc.Node(n->ArraySize);
+		arc.Node(n->ElementType);
+		break;
+	}
+
+	case AST_ClassType:
+	{
+		auto n = static_cast<ZCC_ClassType *>(node);
+		arc.Node(n->ArraySize);
+		arc.Node(n->Restriction);
+		break;
+	}
+
+	case AST_Expression:
+		SerializeExpression(arc, static_cast<ZCC_Expression *>(node));
+		break;
+
+	case AST_ExprID:
+	{
+		auto n = static_cast<ZCC_ExprID *>(node);
+		SerializeExpression(arc, n);
+		arc.Name(n->Identifier);
+		break;
+	}
+
+	case AST_ExprTypeRef:
+	{
+		auto n = static_cast<ZCC_ExprTypeRef *>(node);
+		SerializeExpression(arc, n);
+		arc.Type(n->RefType);
+		break;
+	}
+
+	case AST_ExprConstant:
+	{
+		auto n = static_cast<ZCC_ExprConstant *>(node);
+		SerializeExpression(arc, n);
+		if (n->Type == TypeString || n->Type == TypeNullPtr) arc.String(n->StringVal);
+		else if (n->Type == TypeName) arc.Name(reinterpret_cast<ENamedName &>(n->IntVal));
+		else if (n->Type == TypeFloat64) arc.Float(n->DoubleVal);
+		else arc.Int(n->IntVal);
+		break;
+	}
+
+	case AST_ExprFuncCall:
+	{
+		auto n = static_cast<ZCC_ExprFuncCall *>(node);
+		SerializeExpression(arc, n);
+		arc.Node(n->Function);
+		arc.Node(n->Parameters);
+		break;
+	}
+
+	case AST_ExprMemberAccess:
+	{
+		auto n = static_cast<ZCC_ExprMemberAccess *>(node);
+		SerializeExpression(arc, n);
+		arc.Node(n->Left);
+		arc.Name(n->Right);
+		break;
+	}
+
+	case AST_ExprUnary:
+	{
+		auto n = static_cast<ZCC_ExprUnary *>(node);
+		SerializeExpression(arc, n);
+		arc.Node(n->Operand);
+		break;
+	}
+
+	case AST_ExprBinary:
+	{
+		auto n = static_cast<ZCC_ExprBinary *>(node);
+		SerializeExpression(arc, n);
+		arc.Node(n->Left);
+		arc.Node(n->Right);
+		break;
+	}
+
+	case AST_ExprTrinary:
+	{
+		auto n = static_cast<ZCC_ExprTrinary *>(node);
+		SerializeExpression(arc, n);
+		arc.Node(n->Test);
+		arc.Node(n->Left);
+		arc.Node(n->Right);
+		break;
+	}
+
+	case AST_VectorValue:
+	{
+		auto n = static_cast<ZCC_VectorValue *>(node);
+		SerializeExpression(arc, n);
+		arc.Node(n->X);
+		arc.Node(n->Y);
+		arc.Node(n->Z);
+		break;
+	}
+
+	case AST_ClassCast:
+	{
+		auto n = static_cast<ZCC_ClassCast *>(node);
+		SerializeExpression(arc, n);
+		arc.Name(n->ClassName);
+		arc.Node(n->Parameters);
+		break;
+	}
+
+	case AST_FuncParm:
+	{
+		auto n = static_cast<ZCC_FuncParm *>(node);
+		arc.Node(n->Value);
+		arc.Name(n->Label);
+		break;
+	}
+
+	case AST_CompoundStmt:
+	case AST_Default:
+		arc.Node(static_cast<ZCC_CompoundStmt *>(node)->Content);
+		break;
+
+	case AST_ReturnStmt:
+		arc.Node(static_cast<ZCC_ReturnStmt *>(node)->Values);
+		break;
+
+	case AST_ExpressionStmt:
+		arc.Node(static_cast<ZCC_ExpressionStmt *>(node)->Expression);
+		break;
+
+	case AST_IterationStmt:
+	{
+		auto n = static_cast<ZCC_IterationStmt *>(node);
+		arc.Node(n->LoopCondition);
+		arc.Node(n->LoopStatement);
+		arc.Node(n->LoopBumper);
+		arc.Int(n->CheckAt);
+		break;
+	}
+
+	case AST_IfStmt:
+	{
+		auto n = static_cast<ZCC_IfStmt *>(node);
+		arc.Node(n->Condition);
+		arc.Node(n->TruePath);
+		arc.Node(n->FalsePath);
+		break;
+	}
+
+	case AST_SwitchStmt:
+	{
+		auto n = static_cast<ZCC_SwitchStmt *>(node);
+		arc.Node(n->Condition);
+		arc.Node(n->Content);
+		break;
+	}
+
+	case AST_CaseStmt:
+		arc.Node(static_cast<ZCC_CaseStmt *>(node)->Condition);
+		break;
+
+	case AST_AssignStmt:
+	{
+		auto n = static_cast<ZCC_AssignStmt *>(node);
+		arc.Node(n->Dests);
+		arc.Node(n->Sources);
+		arc.Int(n->AssignOp);
+		break;
+	}
+
+	case AST_LocalVarStmt:
+	{
+		auto n = static_cast<ZCC_LocalVarStmt *>(node);
+		arc.Node(n->Type);
+		arc.Node(n->Vars);
+		break;
+	}
+
+	case AST_StaticArrayStatement:
+	{
+		auto n = static_cast<ZCC_StaticArrayStatement *>(node);
+		arc.Node(n->Type);
+		arc.Name(n->Id);
+		arc.Node(n->Values);
+		break;
+	}
+
+	case AST_FuncParamDecl:
+	{
+		auto n = static_cast<ZCC_FuncParamDecl *>(node);
+		arc.Node(n->Type);
+		arc.Node(n->Default);
+		arc.Name(n->Name);
+		arc.Int(n->Flags);
+		break;
+	}
+
+	case AST_ConstantDef:
+	{
+		auto n = static_cast<ZCC_ConstantDef *>(node);
+		SerializeNamedNode(arc, n);
+		arc.Node(n->Value);
+		arc.Node(n->Type);
+		break;
+	}
+
+	case AST_Declarator:
+		SerializeDeclarator(arc, static_cast<ZCC_Declarator *>(node));
+		break;
+
+	case AST_VarDeclarator:
+	{
+		auto n = static_cast<ZCC_VarDeclarator *>(node);
+		SerializeDeclarator(arc, n);
+		arc.Node(n->Names);
+		break;
+	}
+
+	case AST_FuncDeclarator:
+	{
+		auto n = static_cast<ZCC_FuncDeclarator *>(node);
+		SerializeDeclarator(arc, n);
+		arc.Node(n->Params);
+		arc.Name(n->Name);
+		arc.Node(n->Body);
+		arc.Node(n->UseFlags);
+		break;
+	}
+
+	case AST_FlagStmt:
+	{
+		auto n = static_cast<ZCC_FlagStmt *>(node);
+		arc.Node(n->name);
+		arc.Int(n->set);
+		break;
+	}
+
+	case AST_PropertyStmt:
+	{
+		auto n = static_cast<ZCC_PropertyStmt *>(node);
+		arc.Node(n->Prop);
+		arc.Node(n->Values);
+		break;
+	}
+
+	case AST_DeclFlags:
+	{
+		auto n = static_cast<ZCC_DeclFlags *>(node);
+		arc.Node(n->Id);
+		arc.Int(n->Version.major);
+		arc.Int(n->Version.minor);
+		arc.Int(n->Version.revision);
+		arc.Int(n->Flags);
+		break;
+	}
+
+	case AST_Property:
+	{
+		auto n = static_cast<ZCC_Property *>(node);
+		SerializeNamedNode(arc, n);
+		arc.Node(n->Body);
+		break;
+	}
+
+	case AST_FlagDef:
+	{
+		auto n = static_cast<ZCC_FlagDef *>(node);
+		SerializeNamedNode(arc, n);
+		arc.Name(n->RefName);
+		arc.Int(n->BitValue);
+		break;
+	}
+
+	default:
+		// Nodes without any data of their own.
+		break;
+	}
+}
+
+//==========================================================================
+//
+// Gives every node reachable from the top node an index.
+//
+//==========================================================================
+
+struct FZCCNodeCollector
+{
+	TArray<ZCC_TreeNode *> Nodes;
+	TMap<ZCC_TreeNode *, unsigned> Indices;
+
+	void Add(ZCC_TreeNode *node)
+	{
+		if (node != nullptr && Indices.CheckKey(node) == nullptr)
+		{
+			if ((unsigned)node->NodeType >= NUM_AST_NODE_TYPES) throw std::runtime_error("Bad node in syntax tree");
+			Indices[node] = Nodes.Push(node) + 1;
+		}
+	}
+
+	template<class T> void Node(T *&node) { Add(node); }
+	template<class T> void Int(T &) {}
+	void Name(ENamedName &) {}
+	void String(FString *&) {}
+	void Float(double &) {}
+	void Type(PType *&) {}
+	void Lump(int &) {}
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+struct FZCCCacheWriter
+{
+	FZCCNodeCollector &Collector;
+	TArray<FString> Strings;
+	TMap<FString, unsigned> StringIndices;
+	TMap<int, unsigned> LumpIndices;
+	TArray<uint8_t> Data;
+
+	FZCCCacheWriter(FZCCNodeCollector &collector) : Collector(collector) {}
+
+	void Write(const void *data, size_t len)
+	{
+		auto pos = Data.Reserve((unsigned)len);
+		memcpy(&Data[pos], data, len);
+	}
+
+	void WriteUInt(uint32_t v)
+	{
+		Write(&v, 4);
+	}
+
+	unsigned AddString(const FString &str)
+	{
+		auto check = StringIndices.CheckKey(str);
+		if (check != nullptr) return *check;
+		unsigned index = Strings.Push(str);
+		StringIndices[str] = index;
+		return index;
+	}
+
+	template<class T> void Node(T *&node)
+	{
+		WriteUInt(node == nullptr ? 0 : Collector.Indices[node]);
+	}
+
+	template<class T> void Int(T &v)
+	{
+		WriteUInt((uint32_t)v);
+	}
+
+	void Name(ENamedName &name)
+	{
+		WriteUInt(AddString(FName(name).GetChars()));
+	}
+
+	void String(FString *&str)
+	{
+		WriteUInt(str == nullptr ? 0 : AddString(*str) + 1);
+	}
+
+	void Float(double &v)
+	{
+		Write(&v, sizeof(v));
+	}
+
+	void Type(PType *&type)
+	{
+		WriteUInt(GetCacheTypeIndex(type));
+	}
+
+	void Lump(int &lump)
+	{
+		auto check = LumpIndices.CheckKey(lump);
+		if (check == nullptr) throw std::runtime_error("Syntax tree refers to an unknown lump");
+		WriteUInt(*check);
+	}
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+struct FZCCCacheReader
+{
+	ZCC_AST &Ast;
+	const uint8_t *Pos, *End;
+	TArray<FString> Strings;
+	TArray<int> Names;
+	TArray<FString *> ArenaStrings;
+	TArray<ZCC_TreeNode *> Nodes;
+	TArray<int> Lumps;
+
+	FZCCCacheReader(ZCC_AST &ast, const TArray<uint8_t> &data) : Ast(ast)
+	{
+		Pos = data.Data();
+		End = Pos + data.Size();
+	}
+
+	void Read(void *data, size_t len)
+	{
+		if ((size_t)(End - Pos) < len) throw std::runtime_error("Script cache file is truncated");
+		memcpy(data, Pos, len);
+		Pos += len;
+	}
+
+	uint32_t ReadUInt()
+	{
+		uint32_t v;
+		Read(&v, 4);
+		return v;
+	}
+
+	FString ReadString()
+	{
+		uint32_t len = ReadUInt();
+		if ((size_t)(End - Pos) < len) throw std::runtime_error("Script cache file is truncated");
+		FString str((const char *)Pos, len);
+		Pos += len;
+		return str;
+	}
+
+	unsigned ReadStringIndex()
+	{
+		uint32_t index = ReadUInt();
+		if (index >= Strings.Size()) throw std::runtime_error("Bad string in script cache");
+		return index;
+	}
+
+	template<class T> void Node(T *&node)
+	{
+		uint32_t index = ReadUInt();
+		if (index > Nodes.Size()) throw std::runtime_error("Bad node in script cache");
+		node = index == 0 ? nullptr : static_cast<T *>(Nodes[index - 1]);
+	}
+
+	template<class T> void Int(T &v)
+	{
+		v = (T)ReadUInt();
+	}
+
+	void Name(ENamedName &name)
+	{
+		unsigned index = ReadStringIndex();
+		if (Names[index] == -1) Names[index] = FName(Strings[index]).GetIndex();
+		name = ENamedName(Names[index]);
+	}
+
+	void String(FString *&str)
+	{
+		uint32_t index = ReadUInt();
+		if (index > Strings.Size()) throw std::runtime_error("Bad string in script cache");
+		if (index == 0)
+		{
+			str = nullptr;
+			return;
+		}
+		if (ArenaStrings[index - 1] == nullptr) ArenaStrings[index - 1] = Ast.Strings.Alloc(Strings[index - 1]);
+		str = ArenaStrings[index - 1];
+	}
+
+	void Float(double &v)
+	{
+		Read(&v, sizeof(v));
+	}
+
+	void Type(PType *&type)
+	{
+		type = GetCacheType(ReadUInt());
+	}
+
+	void Lump(int &lump)
+	{
+		uint32_t index = ReadUInt();
+		if (index >= Lumps.Size()) throw std::runtime_error("Bad lump in script cache");
+		lump = Lumps[index];
+	}
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void HashLump(int lump, uint8_t digest[16])
+{
+	FString path = Wads.GetLumpFullPath(lump);
+	FMemLump data = Wads.ReadLump(lump);
+	MD5Context md5;
+	md5.Update((const uint8_t *)path.GetChars(), (unsigned)path.Len());
+	md5.Update((const uint8_t *)data.GetMem(), Wads.LumpLength(lump));
+	md5.Final(digest);
+}
+
+static FString GetCachePath(int baselump)
+{
+	FString version;
+	version.Format("%u %s %s", ZCCCacheVersion, GetVersionString(), GetGitHash());
+	uint8_t lumpdigest[16], digest[16];
+	HashLump(baselump, lumpdigest);
+	MD5Context md5;
+	md5.Update((const uint8_t *)version.GetChars(), (unsigned)version.Len());
+	md5.Update(lumpdigest, 16);
+	md5.Final(digest);
+
+	FString path = M_GetCachePath(true);
+	path << "/zscript/";
+	for (int i = 0; i < 16; i++)
+	{
+		path.AppendFormat("%02x", digest[i]);
+	}
+	path << ".zsc";
+	return path;
+}
+
+//==========================================================================
+//
+// Restores the syntax tree of the translation unit starting at baselump.
+// Returns false if there is no valid cache entry, in which case the
+// unit has to be parsed normally.
+//
+//==========================================================================
+
+bool ZCC_LoadASTCache(int baselump, ZCC_AST &ast, double &parsetime)
+{
+	if (!zscript_cache) return false;
+
+	FString path = GetCachePath(baselump);
+	TArray<uint8_t> data;
+	{
+		FileReader fr;
+		if (!fr.OpenFile(path)) return false;
+		auto len = fr.GetLength();
+		data.Resize((unsigned)len);
+		if (fr.Read(data.Data(), len) != len) return false;
+	}
+
+	try
+	{
+		FZCCCacheReader arc(ast, data);
+
+		char magic[4];
+		arc.Read(magic, 4);
+		if (memcmp(magic, ZCCCacheMagic, 4) != 0 || arc.ReadUInt() != ZCCCacheVersion)
+			throw std::runtime_error("Not a script cache file");
+
+		parsetime = arc.ReadUInt() / 1000.;
+		VersionInfo version;
+		arc.Int(version.major);
+		arc.Int(version.minor);
+		arc.Int(version.revision);
+
+		unsigned numstrings = arc.ReadUInt();
+		for (unsigned i = 0; i < numstrings; i++)
+		{
+			arc.Strings.Push(arc.ReadString());
+		}
+		arc.Names.Resize(numstrings);
+		for (auto &n : arc.Names) n = -1;
+		arc.ArenaStrings.Resize(numstrings);
+		for (auto &s : arc.ArenaStrings) s = nullptr;
+
+		// Check that every lump this tree was built from is still the same.
+		// The includes are resolved the same way as in DoParse.
+		unsigned numlumps = arc.ReadUInt();
+		auto fileno = Wads.GetLumpFile(baselump);
+		for (unsigned i = 0; i < numlumps; i++)
+		{
+			const FString &name = arc.Strings[arc.ReadStringIndex()];
+			int lump = i == 0 ? baselump : Wads.CheckNumForFullName(name, true);
+			if (lump == -1) return false;
+			if (fileno == 0 && Wads.GetLumpFile(lump) != 0) return false;
+
+			uint8_t digest[16], stored[16];
+			arc.Read(stored, 16);
+			HashLump(lump, digest);
+			if (memcmp(digest, stored, 16) != 0) return false;
+			arc.Lumps.Push(lump);
+		}
+		if (numlumps == 0) throw std::runtime_error("Script cache file has no lumps");
+
+		unsigned numnodes = arc.ReadUInt();
+		if (numnodes == 0 || numnodes > (unsigned)(data.Size() / 4)) throw std::runtime_error("Bad node count in script cache");
+		arc.Nodes.Resize(numnodes);
+		for (auto &node : arc.Nodes)
+		{
+			unsigned type = arc.ReadUInt();
+			if (type >= NUM_AST_NODE_TYPES) throw std::runtime_error("Bad node type in script cache");
+			node = (ZCC_TreeNode *)ast.SyntaxArena.Alloc(ZCCNodeSizes[type]);
+			memset(node, 0, ZCCNodeSizes[type]);
+			node->NodeType = (EZCCTreeNodeType)type;
+		}
+		for (auto node : arc.Nodes)
+		{
+			SerializeNode(arc, node);
+			if (node->SiblingNext == nullptr || node->SiblingPrev == nullptr) throw std::runtime_error("Broken sibling list in script cache");
+		}
+		if (arc.Pos != arc.End) throw std::runtime_error("Script cache file has trailing data");
+
+		ast.TopNode = arc.Nodes[0];
+		ast.ParseVersion = version;
+		return true;
+	}
+	catch (std::runtime_error &err)
+	{
+		DPrintf(DMSG_WARNING, "Discarding script cache %s: %s\n", path.GetChars(), err.what());
+		remove(path);
+		ast.TopNode = nullptr;
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// lumps contains the base lump followed by all includes, in the order
+// they were parsed.
+//
+//==========================================================================
+
+void ZCC_StoreASTCache(int baselump, const TArray<int> &lumps, const TArray<FString> &names, ZCC_AST &ast, double parsetime)
+{
+	if (!zscript_cache || ast.TopNode == nullptr) return;
+
+	TArray<uint8_t> file;
+	try
+	{
+		FZCCNodeCollector collector;
+		collector.Add(ast.TopNode);
+		for (unsigned i = 0; i < collector.Nodes.Size(); i++)
+		{
+			SerializeNode(collector, collector.Nodes[i]);
+		}
+
+		FZCCCacheWriter arc(collector);
+		for (unsigned i = 0; i < lumps.Size(); i++)
+		{
+			arc.LumpIndices[lumps[i]] = i;
+		}
+		for (auto node : collector.Nodes)
+		{
+			arc.WriteUInt(node->NodeType);
+		}
+		for (auto node : collector.Nodes)
+		{
+			SerializeNode(arc, node);
+		}
+		TArray<unsigned> lumpnames;
+		for (auto &name : names)
+		{
+			lumpnames.Push(arc.AddString(name));
+		}
+
+		FZCCCacheWriter header(collector);
+		header.Write(ZCCCacheMagic, 4);
+		header.WriteUInt(ZCCCacheVersion);
+		header.WriteUInt((uint32_t)(parsetime * 1000));
+		header.Int(ast.ParseVersion.major);
+		header.Int(ast.ParseVersion.minor);
+		header.Int(ast.ParseVersion.revision);
+		header.WriteUInt(arc.Strings.Size());
+		for (auto &str : arc.Strings)
+		{
+			header.WriteUInt((uint32_t)str.Len());
+			header.Write(str.GetChars(), str.Len());
+		}
+		header.WriteUInt(lumps.Size());
+		for (unsigned i = 0; i < lumps.Size(); i++)
+		{
+			uint8_t digest[16];
+			HashLump(lumps[i], digest);
+			header.WriteUInt(lumpnames[i]);
+			header.Write(digest, 16);
+		}
+		header.WriteUInt(collector.Nodes.Size());
+		file = std::move(header.Data);
+		auto pos = file.Reserve(arc.Data.Size());
+		memcpy(&file[pos], arc.Data.Data(), arc.Data.Size());
+	}
+	catch (std::runtime_error &err)
+	{
+		DPrintf(DMSG_WARNING, "Unable to cache %s: %s\n", Wads.GetLumpFullPath(baselump).GetChars(), err.what());
+		return;
+	}
+
+	FString path = GetCachePath(baselump);
+	FString dir = M_GetCachePath(true);
+	dir << "/zscript/";
+	CreatePath(dir);
+
+	FileWriter *fw = FileWriter::Open(path);
+	if (fw == nullptr) return;
+	bool ok = fw->Write(file.Data(), file.Size()) == file.Size();
+	delete fw;
+	if (!ok) remove(path);
+	else M_PruneCache(dir, ZCCCacheMaxFiles);	// Every mod combination leaves its own files behind.
+}
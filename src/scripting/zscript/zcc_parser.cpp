@@ -38,6 +38,7 @@
 #include "m_argv.h"
 #include "v_text.h"
 #include "version.h"
+#include "stats.h"
 #include "zcc_parser.h"
 #include "zcc_compile.h"
 
@@ -231,6 +232,12 @@ static void InitTokenMap()
 #undef TOKENDEF
 #undef TOKENDEF2
 
+static struct
+{
+	int Units, CacheHits;
+	double ParseTime, UncachedParseTime, CompileTime;
+} ZCCStartupStats;
+
 //**--------------------------------------------------------------------------
 
 static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void *parser, ZCCParseState &state)
@@ -334,6 +341,7 @@ static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void
 			else
 			{
 				sc.ScriptMessage("Unexpected token %s.\n", sc.TokenName(sc.TokenType).GetChars());
+				state.Truncated = true;
 				goto parse_end;
 			}
 			break;
@@ -348,7 +356,10 @@ parse_end:
 
 //**--------------------------------------------------------------------------
 
-static void DoParse(int lumpnum)
+// Parses the translation unit starting at lumpnum. lumps and names receive
+// all lumps that went into it for the AST cache.
+
+static void ParseTranslationUnit(int lumpnum, ZCCParseState &state, TArray<int> &lumps, TArray<FString> &names)
 {
 	FScanner sc;
 	void *parser;
@@ -357,7 +368,6 @@ static void DoParse(int lumpnum)
 	auto fileno = Wads.GetLumpFile(lumpnum);
 
 	parser = ZCCParseAlloc(malloc);
-	ZCCParseState state;
 
 #ifndef NDEBUG
 	FILE *f = nullptr;
@@ -412,6 +422,8 @@ static void DoParse(int lumpnum)
 	}
 
 	ParseSingleFile(&sc, nullptr, lumpnum, parser, state);
+	lumps.Push(lumpnum);
+	names.Push(Wads.GetLumpFullName(lumpnum));
 	for (unsigned i = 0; i < Includes.Size(); i++)
 	{
 		lumpnum = Wads.CheckNumForFullName(Includes[i], true);
@@ -429,6 +441,8 @@ static void DoParse(int lumpnum)
 			}
 
 			ParseSingleFile(nullptr, nullptr, lumpnum, parser, state);
+			lumps.Push(lumpnum);
+			names.Push(Includes[i]);
 		}
 	}
 	Includes.Clear();
@@ -453,6 +467,44 @@ static void DoParse(int lumpnum)
 		fclose(f);
 	}
 #endif
+}
+
+//**--------------------------------------------------------------------------
+
+static void DoParse(int lumpnum)
+{
+	auto baselump = lumpnum;
+	ZCCParseState state;
+	cycle_t parsetime;
+	double uncachedtime;
+
+	parsetime.Reset();
+	parsetime.Clock();
+	ZCCStartupStats.Units++;
+	if (ZCC_LoadASTCache(baselump, state, uncachedtime))
+	{
+		parsetime.Unclock();
+		ZCCStartupStats.CacheHits++;
+	}
+	else
+	{
+		TArray<int> lumps;
+		TArray<FString> names;
+		int warnings = FScriptPosition::WarnCounter;
+		int errors = FScriptPosition::ErrorCounter;
+		ParseTranslationUnit(baselump, state, lumps, names);
+		parsetime.Unclock();
+		uncachedtime = parsetime.TimeMS();
+
+		// Units with warnings are not cached so that the warnings keep showing up,
+		// and an AST that had errors or is incomplete must never be reused.
+		if (FScriptPosition::WarnCounter == warnings && FScriptPosition::ErrorCounter == errors && !state.Truncated)
+		{
+			ZCC_StoreASTCache(baselump, lumps, names, state, uncachedtime);
+		}
+	}
+	ZCCStartupStats.ParseTime += parsetime.TimeMS();
+	ZCCStartupStats.UncachedParseTime += uncachedtime;
 
 	// Make a dump of the AST before running the compiler for diagnostic purposes.
 	if (Args->CheckParm("-dumpast"))
@@ -472,7 +524,12 @@ static void DoParse(int lumpnum)
 	PSymbolTable symtable;
 	auto newns = Wads.GetLumpFile(baselump) == 0 ? Namespaces.GlobalNamespace : Namespaces.NewNamespace(Wads.GetLumpFile(baselump));
 	ZCCCompiler cc(state, NULL, symtable, newns, baselump, state.ParseVersion);
+	cycle_t compiletime;
+	compiletime.Reset();
+	compiletime.Clock();
 	cc.Compile();
+	compiletime.Unclock();
+	ZCCStartupStats.CompileTime += compiletime.TimeMS();
 
 	if (FScriptPosition::ErrorCounter > 0)
 	{
@@ -500,6 +557,12 @@ void ParseScripts()
 	{
 		DoParse(lump);
 	}
+
+	if (!batchrun)
+	{
+		Printf("ZScript: %d of %d units from cache, parsing took %.2f ms (%.2f ms without cache), compiling %.2f ms\n",
+			ZCCStartupStats.CacheHits, ZCCStartupStats.Units, ZCCStartupStats.ParseTime, ZCCStartupStats.UncachedParseTime, ZCCStartupStats.CompileTime);
+	}
 }
 
 static FString ZCCTokenName(int terminal)
@@ -527,6 +590,8 @@ static FString ZCCTokenName(int terminal)
 ZCC_TreeNode *ZCC_AST::InitNode(size_t size, EZCCTreeNodeType type, ZCC_TreeNode *basis)
 {
 	ZCC_TreeNode *node = (ZCC_TreeNode *)SyntaxArena.Alloc(size);
+	// Fields the parser does not set must be null, the AST cache follows every pointer.
+	memset(node, 0, size);
 	node->SiblingNext = node;
 	node->SiblingPrev = node;
 	node->NodeType = type;
@@ -585,6 +585,10 @@ struct ZCCParseState : public ZCC_AST
 	ZCC_TreeNode *InitNode(size_t size, EZCCTreeNodeType type);
 
 	FScanner *sc;
+	bool Truncated = false;	// a file was only parsed up to an unexpected token, so this AST must not be cached
 };
 
+bool ZCC_LoadASTCache(int baselump, ZCC_AST &ast, double &parsetime);
+void ZCC_StoreASTCache(int baselump, const TArray<int> &lumps, const TArray<FString> &names, ZCC_AST &ast, double parsetime);
+
 #endif
@@ -50,6 +50,9 @@ enum
 	METHOD_DEFLATE = 8,
 	METHOD_BZIP2 = 12,
 	METHOD_LZMA = 14,
+	METHOD_ZSTD_OLD = 20,	// Zstandard under the number used before 93 was assigned
+	METHOD_LZ4 = 76,	// not in the zip specification - LZ4 frames, 'L' as in LZ4
+	METHOD_ZSTD = 93,
 	METHOD_PPMD = 98,
 	METHOD_LZSS = 1337,	// not used in Zips - this is for Console Doom compression
 	METHOD_ZLIB = 1338,	// Zlib stream with header, used by compressed nodes.
@@ -37,6 +37,12 @@
 #include "LzmaDec.h"
 #include <zlib.h>
 #include <bzlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
 
 #include "files.h"
 #include "doomerrors.h"
@@ -372,6 +378,177 @@ public:
 
 };
 
+#ifdef HAVE_ZSTD
+//==========================================================================
+//
+// DecompressorZstd
+//
+// The Zstandard wrapper
+// reads data from a zstd frame
+//
+//==========================================================================
+
+class DecompressorZstd : public DecompressorBase
+{
+	enum { BUFF_SIZE = 4096 };
+
+	FileReader &File;
+	bool SawEOF;
+	ZSTD_DStream *Stream;
+	ZSTD_inBuffer InBuffer;
+	uint8_t InBuff[BUFF_SIZE];
+
+public:
+	DecompressorZstd (FileReader &file)
+	: File(file), SawEOF(false)
+	{
+		Stream = ZSTD_createDStream();
+		if (Stream == nullptr)
+		{
+			I_Error ("DecompressorZstd: ZSTD_createDStream failed\n");
+		}
+		ZSTD_initDStream(Stream);
+		FillBuffer ();
+	}
+
+	~DecompressorZstd ()
+	{
+		ZSTD_freeDStream(Stream);
+	}
+
+	long Read (void *buffer, long len) override
+	{
+		ZSTD_outBuffer out = { buffer, (size_t)len, 0 };
+
+		while (out.pos < out.size)
+		{
+			if (InBuffer.pos == InBuffer.size && !SawEOF)
+			{
+				FillBuffer ();
+			}
+			size_t inpos = InBuffer.pos, outpos = out.pos;
+			size_t err = ZSTD_decompressStream(Stream, &out, &InBuffer);
+			if (ZSTD_isError(err))
+			{
+				I_Error ("Corrupt zstd stream: %s", ZSTD_getErrorName(err));
+			}
+			if (InBuffer.pos == inpos && out.pos == outpos)
+			{
+				break;
+			}
+		}
+
+		if (out.pos < out.size)
+		{
+			I_Error ("Ran out of data in zstd stream");
+		}
+
+		return (long)out.pos;
+	}
+
+	void FillBuffer ()
+	{
+		auto numread = File.Read(InBuff, BUFF_SIZE);
+
+		if (numread < BUFF_SIZE)
+		{
+			SawEOF = true;
+		}
+		InBuffer.src = InBuff;
+		InBuffer.size = (size_t)numread;
+		InBuffer.pos = 0;
+	}
+
+};
+#endif
+
+#ifdef HAVE_LZ4
+//==========================================================================
+//
+// DecompressorLZ4
+//
+// The LZ4 wrapper
+// reads data from an LZ4 frame
+//
+//==========================================================================
+
+class DecompressorLZ4 : public DecompressorBase
+{
+	enum { BUFF_SIZE = 4096 };
+
+	FileReader &File;
+	bool SawEOF;
+	LZ4F_dctx *Stream;
+	size_t InPos, InSize;
+	uint8_t InBuff[BUFF_SIZE];
+
+public:
+	DecompressorLZ4 (FileReader &file)
+	: File(file), SawEOF(false)
+	{
+		size_t err = LZ4F_createDecompressionContext(&Stream, LZ4F_VERSION);
+		if (LZ4F_isError(err))
+		{
+			I_Error ("DecompressorLZ4: LZ4F_createDecompressionContext failed: %s\n", LZ4F_getErrorName(err));
+		}
+		FillBuffer ();
+	}
+
+	~DecompressorLZ4 ()
+	{
+		LZ4F_freeDecompressionContext(Stream);
+	}
+
+	long Read (void *buffer, long len) override
+	{
+		uint8_t *next_out = (uint8_t *)buffer;
+		size_t left = len;
+
+		while (left > 0)
+		{
+			if (InPos == InSize && !SawEOF)
+			{
+				FillBuffer ();
+			}
+			size_t out_processed = left;
+			size_t in_processed = InSize - InPos;
+			size_t err = LZ4F_decompress(Stream, next_out, &out_processed, InBuff + InPos, &in_processed, nullptr);
+			if (LZ4F_isError(err))
+			{
+				I_Error ("Corrupt LZ4 stream: %s", LZ4F_getErrorName(err));
+			}
+			InPos += in_processed;
+			next_out += out_processed;
+			left -= out_processed;
+			if (in_processed == 0 && out_processed == 0)
+			{
+				break;
+			}
+		}
+
+		if (left != 0)
+		{
+			I_Error ("Ran out of data in LZ4 stream");
+		}
+
+		return len;
+	}
+
+	void FillBuffer ()
+	{
+		auto numread = File.Read(InBuff, BUFF_SIZE);
+
+		if (numread < BUFF_SIZE)
+		{
+			SawEOF = true;
+		}
+		InPos = 0;
+		InSize = numread;
+	}
+
+};
+#endif
+
 //==========================================================================
 //
 // Console Doom LZSS wrapper.
@@ -583,6 +760,19 @@ bool FileReader::OpenDecompressor(FileReader &parent, Size length, int method, b
 		case METHOD_LZSS:
 			dec = new DecompressorLZSS(parent);
 			break;
+
+#ifdef HAVE_ZSTD
+		case METHOD_ZSTD:
+		case METHOD_ZSTD_OLD:
+			dec = new DecompressorZstd(parent);
+			break;
+#endif
+
+#ifdef HAVE_LZ4
+		case METHOD_LZ4:
+			dec = new DecompressorLZ4(parent);
+			break;
+#endif
 			
 		// todo: METHOD_IMPLODE, METHOD_SHRINK
 		default:
@@ -39,6 +39,9 @@
 #ifdef _MSC_VER
 #include <malloc.h>		// for alloca()
 #endif
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 
 #include "m_crc32.h"
 #include "m_swap.h"
@@ -108,6 +111,8 @@ CUSTOM_CVAR(Int, png_level, 5, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 		self = 9;
 }
 CVAR(Float, png_gamma, 0.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+// Only meant to be switched off for comparing against the reference decoder.
+CVAR(Bool, png_fastdecode, true, 0)
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
@@ -685,6 +690,116 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 	return true;
 }
 
+//==========================================================================
+//
+// ReadIDAT
+//
+// Same as above but instead of filling an image buffer, every decoded row
+// is passed to rowfunc as soon as it is complete, so callers can convert
+// it straight into their destination. Only two rows are kept around for
+// noninterlaced 8 bit images, everything else goes through M_ReadIDAT and
+// an intermediate image. Rows have one byte per pixel channel.
+//
+//==========================================================================
+
+bool M_ReadIDAT (FileReader &file, int width, int height, uint8_t bitdepth, uint8_t colortype, uint8_t interlace,
+				 unsigned int chunklen, const std::function<void(int y, const uint8_t *row)> &rowfunc)
+{
+	int bytesPerPixel;
+
+	switch (colortype)
+	{
+	case 2:		bytesPerPixel = 3;		break;		// RGB
+	case 4:		bytesPerPixel = 2;		break;		// LA
+	case 6:		bytesPerPixel = 4;		break;		// RGBA
+	default:	bytesPerPixel = 1;		break;
+	}
+
+	int bytesPerRow = width * bytesPerPixel;
+
+	if (interlace || bitdepth != 8 || !png_fastdecode)
+	{
+		TArray<uint8_t> buffer(bytesPerRow * height, true);
+		bool res = M_ReadIDAT(file, buffer.Data(), width, height, bytesPerRow, bitdepth, colortype, interlace, chunklen);
+		for (int y = 0; y < height; y++)
+		{
+			rowfunc(y, &buffer[y * bytesPerRow]);
+		}
+		return res;
+	}
+
+	TArray<uint8_t> rowbuffer(bytesPerRow * 3 + 1, true);
+	Byte *inputLine = rowbuffer.Data();
+	Byte *rows[2] = { inputLine + bytesPerRow + 1, inputLine + bytesPerRow * 2 + 1 };
+	Byte chunkbuffer[4096];
+	z_stream stream;
+	int err;
+	int y = 0;
+	bool lastIDAT = false;
+
+	memset(rows[1], 0, bytesPerRow);
+
+	stream.next_in = Z_NULL;
+	stream.avail_in = 0;
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	err = inflateInit (&stream);
+	if (err != Z_OK)
+	{
+		return false;
+	}
+	stream.next_out = inputLine;
+	stream.avail_out = bytesPerRow + 1;
+
+	while (err != Z_STREAM_END && y < height)
+	{
+		if (stream.avail_in == 0 && chunklen > 0)
+		{
+			stream.next_in = chunkbuffer;
+			stream.avail_in = (uInt)file.Read (chunkbuffer, MIN<uint32_t>(chunklen,sizeof(chunkbuffer)));
+			chunklen -= stream.avail_in;
+		}
+
+		err = inflate (&stream, Z_SYNC_FLUSH);
+		if (err != Z_OK && err != Z_STREAM_END)
+		{ // something unexpected happened
+			inflateEnd (&stream);
+			return false;
+		}
+
+		if (stream.avail_out == 0)
+		{
+			Byte *curr = rows[y & 1];
+			UnfilterRow (bytesPerRow, curr, inputLine, rows[(y & 1) ^ 1], bytesPerPixel);
+			rowfunc(y, curr);
+			y++;
+			stream.next_out = inputLine;
+			stream.avail_out = bytesPerRow + 1;
+		}
+
+		if (chunklen == 0 && !lastIDAT)
+		{
+			uint32_t x[3];
+
+			if (file.Read (x, 12) != 12)
+			{
+				lastIDAT = true;
+			}
+			else if (x[2] != MAKE_ID('I','D','A','T'))
+			{
+				lastIDAT = true;
+			}
+			else
+			{
+				chunklen = BigLong((unsigned int)x[1]);
+			}
+		}
+	}
+
+	inflateEnd (&stream);
+	return true;
+}
+
 // PRIVATE CODE ------------------------------------------------------------
 
 
@@ -1049,6 +1164,100 @@ static bool WriteIDAT (FileWriter *file, const uint8_t *data, int len)
 	return true;
 }
 
+#ifndef NO_SSE
+
+//==========================================================================
+//
+// UnfilterRowSSE
+//
+// SSE2 versions of the filters that depend on the pixel to the left.
+// These can only work on one pixel at a time but process all of its
+// channels at once, which is where the scalar loops spend their time.
+// Width must be a multiple of the pixel size, which is always the case
+// for the 3 and 4 byte formats because they only exist with 8 bit depth.
+//
+//==========================================================================
+
+template<int bpp> static inline __m128i LoadPixel(const uint8_t *p)
+{
+	uint32_t v = 0;
+	memcpy(&v, p, bpp);
+	return _mm_cvtsi32_si128(v);
+}
+
+template<int bpp> static inline void StorePixel(uint8_t *p, __m128i v)
+{
+	uint32_t x = _mm_cvtsi128_si32(v);
+	memcpy(p, &x, bpp);
+}
+
+static inline __m128i AbsEpi16(__m128i v)
+{
+	return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+static inline __m128i Select(__m128i cond, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(cond, a), _mm_andnot_si128(cond, b));
+}
+
+template<int bpp> static void UnfilterRowSSE (int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev, int filter)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero;
+
+	switch (filter)
+	{
+	case 1:		// Sub
+		for (int x = 0; x < width; x += bpp)
+		{
+			a = _mm_add_epi8(a, LoadPixel<bpp>(row + x));
+			StorePixel<bpp>(dest + x, a);
+		}
+		break;
+
+	case 3:		// Average
+	{
+		// _mm_avg_epu8 rounds up, the PNG average rounds down.
+		const __m128i one = _mm_set1_epi8(1);
+		for (int x = 0; x < width; x += bpp)
+		{
+			__m128i b = LoadPixel<bpp>(prev + x);
+			__m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			a = _mm_add_epi8(avg, LoadPixel<bpp>(row + x));
+			StorePixel<bpp>(dest + x, a);
+		}
+		break;
+	}
+
+	case 4:		// Paeth
+	{
+		// a, b and c are kept as 16 bit values so that the predictor does not overflow.
+		__m128i c = zero;
+		for (int x = 0; x < width; x += bpp)
+		{
+			__m128i b = _mm_unpacklo_epi8(LoadPixel<bpp>(prev + x), zero);
+			__m128i pa = _mm_sub_epi16(b, c);
+			__m128i pb = _mm_sub_epi16(a, c);
+			__m128i pc = AbsEpi16(_mm_add_epi16(pa, pb));
+			pa = AbsEpi16(pa);
+			pb = AbsEpi16(pb);
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+			// Ties are broken in favor of a, then b.
+			__m128i nearest = Select(_mm_cmpeq_epi16(smallest, pa), a, Select(_mm_cmpeq_epi16(smallest, pb), b, c));
+			__m128i d = _mm_add_epi8(_mm_packus_epi16(nearest, nearest), LoadPixel<bpp>(row + x));
+			StorePixel<bpp>(dest + x, d);
+			a = _mm_unpacklo_epi8(d, zero);
+			c = b;
+		}
+		break;
+	}
+	}
+}
+
+#endif
+
 //==========================================================================
 //
 // UnfilterRow
@@ -1063,6 +1272,40 @@ void UnfilterRow (int width, uint8_t *dest, uint8_t *row, uint8_t *prev, int bpp
 {
 	int x;
 
+#ifndef NO_SSE
+	if (png_fastdecode)
+	{
+		int filter = *row;
+		if (filter == 2)		// Up
+		{
+			row++;
+			for (x = 0; x + 16 <= width; x += 16)
+			{
+				__m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(row + x)), _mm_loadu_si128((const __m128i *)(prev + x)));
+				_mm_storeu_si128((__m128i *)(dest + x), sum);
+			}
+			for (; x < width; x++)
+			{
+				dest[x] = row[x] + prev[x];
+			}
+			return;
+		}
+		else if (filter == 1 || filter == 3 || filter == 4)
+		{
+			if (bpp == 4)
+			{
+				UnfilterRowSSE<4>(width, dest, row + 1, prev, filter);
+				return;
+			}
+			else if (bpp == 3)
+			{
+				UnfilterRowSSE<3>(width, dest, row + 1, prev, filter);
+				return;
+			}
+		}
+	}
+#endif
+
 	switch (*row++)
 	{
 	case 1:		// Sub
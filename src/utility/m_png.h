@@ -109,6 +109,10 @@ bool M_GetPNGText (PNGHandle *png, const char *keyword, char *buffer, size_t buf
 bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int pitch,
 				 uint8_t bitdepth, uint8_t colortype, uint8_t interlace, unsigned int idatlen);
 
+// Same, but passes each row to rowfunc as soon as it has been decoded.
+bool M_ReadIDAT (FileReader &file, int width, int height, uint8_t bitdepth, uint8_t colortype, uint8_t interlace,
+				 unsigned int idatlen, const std::function<void(int y, const uint8_t *row)> &rowfunc);
+
 
 class FTexture;
 
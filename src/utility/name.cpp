@@ -33,9 +33,12 @@
 */
 
 #include <string.h>
+#include <mutex>
 #include "name.h"
 #include "c_dispatch.h"
 #include "c_console.h"
+#include "stats.h"
+#include "doomerrors.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -44,8 +47,9 @@
 // that is just large enough to hold it.
 #define BLOCK_SIZE			4096
 
-// How many entries to grow the NameArray by when it needs to grow.
-#define NAME_GROW_AMOUNT	256
+// Initial number of hash table slots. The table doubles whenever it gets
+// half full.
+#define INITIAL_TABLE_SIZE	4096
 
 // TYPES -------------------------------------------------------------------
 
@@ -59,6 +63,19 @@ struct FName::NameManager::NameBlock
 	NameBlock *NextBlock;
 };
 
+// Open addressing hash table. Each slot holds the name's hash in the upper
+// 32 bits and its index + 1 in the lower ones, 0 means empty. A table that
+// has been replaced by a larger one is kept around until shutdown, because
+// other threads may still be looking up names in it.
+
+struct FName::NameManager::NameTable
+{
+	NameTable *Previous;
+	unsigned int Mask;
+	unsigned int Count;
+	std::atomic<uint64_t> *Slots;
+};
+
 // PRIVATE FUNCTION PROTOTYPES ---------------------------------------------
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
@@ -68,6 +85,9 @@ struct FName::NameManager::NameBlock
 FName::NameManager FName::NameData;
 bool FName::NameManager::Inited;
 
+// Only needed for adding names. Lookups of existing names do not lock.
+static std::mutex NameMutex;
+
 // Define the predefined names.
 static const char *PredefinedNames[] =
 {
@@ -90,37 +110,11 @@ static const char *PredefinedNames[] =
 
 int FName::NameManager::FindName (const char *text, bool noCreate)
 {
-	if (!Inited)
-	{
-		InitBuckets ();
-	}
-
 	if (text == NULL)
 	{
 		return 0;
 	}
-
-	unsigned int hash = MakeKey (text);
-	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
-
-	// See if the name already exists.
-	while (scanner >= 0)
-	{
-		if (NameArray[scanner].Hash == hash && stricmp (NameArray[scanner].Text, text) == 0)
-		{
-			return scanner;
-		}
-		scanner = NameArray[scanner].NextHash;
-	}
-
-	// If we get here, then the name does not exist.
-	if (noCreate)
-	{
-		return 0;
-	}
-
-	return AddName (text, hash, bucket);
+	return FindName (text, strlen (text), noCreate);
 }
 
 //==========================================================================
@@ -134,7 +128,7 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 {
 	if (!Inited)
 	{
-		InitBuckets ();
+		InitTable ();
 	}
 
 	if (text == NULL)
@@ -143,42 +137,80 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 	}
 
 	unsigned int hash = MakeKey (text, textLen);
-	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
+	int index = LookupName (text, textLen, hash);
 
-	// See if the name already exists.
-	while (scanner >= 0)
+	if (index >= 0)
 	{
-		if (NameArray[scanner].Hash == hash &&
-			strnicmp (NameArray[scanner].Text, text, textLen) == 0 &&
-			NameArray[scanner].Text[textLen] == '\0')
-		{
-			return scanner;
-		}
-		scanner = NameArray[scanner].NextHash;
+		return index;
 	}
-
 	// If we get here, then the name does not exist.
 	if (noCreate)
 	{
 		return 0;
 	}
 
-	return AddName (text, hash, bucket);
+	// Another thread may have added it in the meantime.
+	std::lock_guard<std::mutex> lock(NameMutex);
+	index = LookupName (text, textLen, hash);
+	if (index >= 0)
+	{
+		return index;
+	}
+	return AddName (text, textLen, hash);
+}
+
+//==========================================================================
+//
+// FName :: NameManager :: LookupName
+//
+// Returns the index of an existing name or -1. This is safe to call while
+// other threads add names.
+//
+//==========================================================================
+
+int FName::NameManager::LookupName (const char *text, size_t textLen, unsigned int hash)
+{
+	NameTable *table = Table.load(std::memory_order_acquire);
+	unsigned int slot = hash & table->Mask;
+
+	for (;;)
+	{
+		uint64_t value = table->Slots[slot].load(std::memory_order_acquire);
+		if (value == 0)
+		{
+			return -1;
+		}
+		if ((unsigned int)(value >> 32) == hash)
+		{
+			int index = (int)(uint32_t)value - 1;
+			const NameEntry &entry = GetEntry (index);
+			if (strnicmp (entry.Text, text, textLen) == 0 && entry.Text[textLen] == '\0')
+			{
+				return index;
+			}
+		}
+		slot = (slot + 1) & table->Mask;
+	}
 }
 
 //==========================================================================
 //
-// FName :: NameManager :: InitBuckets
+// FName :: NameManager :: InitTable
 //
 // Sets up the hash table and inserts all the default names into the table.
 //
 //==========================================================================
 
-void FName::NameManager::InitBuckets ()
+void FName::NameManager::InitTable ()
 {
 	Inited = true;
-	memset (Buckets, -1, sizeof(Buckets));
+
+	NameTable *table = new NameTable;
+	table->Previous = nullptr;
+	table->Mask = INITIAL_TABLE_SIZE - 1;
+	table->Count = 0;
+	table->Slots = new std::atomic<uint64_t>[INITIAL_TABLE_SIZE]();
+	Table.store(table, std::memory_order_release);
 
 	// Register built-in names. 'None' must be name 0.
 	for (size_t i = 0; i < countof(PredefinedNames); ++i)
@@ -188,19 +220,45 @@ void FName::NameManager::InitBuckets ()
 	}
 }
 
+//==========================================================================
+//
+// FName :: NameManager :: InsertName
+//
+// Puts an index into the first free slot for its hash. The caller must
+// hold the lock.
+//
+//==========================================================================
+
+void FName::NameManager::InsertName (NameTable *table, unsigned int hash, int index)
+{
+	unsigned int slot = hash & table->Mask;
+	while (table->Slots[slot].load(std::memory_order_relaxed) != 0)
+	{
+		slot = (slot + 1) & table->Mask;
+	}
+	table->Slots[slot].store(((uint64_t)hash << 32) | (uint32_t)(index + 1), std::memory_order_release);
+	table->Count++;
+}
+
 //==========================================================================
 //
 // FName :: NameManager :: AddName
 //
-// Adds a new name to the name table.
+// Adds a new name to the name table. The caller must hold the lock.
 //
 //==========================================================================
 
-int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned int bucket)
+int FName::NameManager::AddName (const char *text, size_t textLen, unsigned int hash)
 {
 	char *textstore;
 	NameBlock *block = Blocks;
-	size_t len = strlen (text) + 1;
+	size_t len = textLen + 1;
+	int index = NumNames.load(std::memory_order_relaxed);
+
+	if ((index >> CHUNK_BITS) >= MAX_CHUNKS)
+	{
+		I_FatalError ("Too many names");
+	}
 
 	// Get a block large enough for the name. Only the first block in the
 	// list is ever considered for name storage.
@@ -211,25 +269,41 @@ int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned i
 
 	// Copy the string into the block.
 	textstore = (char *)block + block->NextAlloc;
-	strcpy (textstore, text);
+	memcpy (textstore, text, textLen);
+	textstore[textLen] = 0;
 	block->NextAlloc += len;
 
-	// Add an entry for the name to the NameArray
-	if (NumNames >= MaxNames)
+	// Add an entry for the name. It must be complete before the hash table
+	// makes it visible to other threads.
+	NameEntry *&chunk = Chunks[index >> CHUNK_BITS];
+	if (chunk == nullptr)
 	{
-		// If no names have been defined yet, make the first allocation
-		// large enough to hold all the predefined names.
-		MaxNames += MaxNames == 0 ? countof(PredefinedNames) + NAME_GROW_AMOUNT : NAME_GROW_AMOUNT;
-
-		NameArray = (NameEntry *)M_Realloc (NameArray, MaxNames * sizeof(NameEntry));
+		chunk = (NameEntry *)M_Malloc (CHUNK_SIZE * sizeof(NameEntry));
 	}
+	chunk[index & (CHUNK_SIZE - 1)].Text = textstore;
+	chunk[index & (CHUNK_SIZE - 1)].Hash = hash;
 
-	NameArray[NumNames].Text = textstore;
-	NameArray[NumNames].Hash = hash;
-	NameArray[NumNames].NextHash = Buckets[bucket];
-	Buckets[bucket] = NumNames;
-
-	return NumNames++;
+	// Grow the hash table when it gets half full. Since the old table can
+	// still be in use by other threads it is only unlinked, not freed.
+	NameTable *table = Table.load(std::memory_order_relaxed);
+	if ((table->Count + 1) * 2 > table->Mask + 1)
+	{
+		unsigned int size = (table->Mask + 1) * 2;
+		NameTable *newtable = new NameTable;
+		newtable->Previous = table;
+		newtable->Mask = size - 1;
+		newtable->Count = 0;
+		newtable->Slots = new std::atomic<uint64_t>[size]();
+		for (int i = 0; i < index; i++)
+		{
+			InsertName (newtable, GetEntry(i).Hash, i);
+		}
+		Table.store(newtable, std::memory_order_release);
+		table = newtable;
+	}
+	InsertName (table, hash, index);
+	NumNames.store(index + 1, std::memory_order_release);
+	return index;
 }
 
 //==========================================================================
@@ -278,11 +352,64 @@ FName::NameManager::~NameManager()
 	}
 	Blocks = NULL;
 
-	if (NameArray != NULL)
+	for (auto &chunk : Chunks)
 	{
-		M_Free (NameArray);
-		NameArray = NULL;
+		if (chunk != nullptr)
+		{
+			M_Free (chunk);
+			chunk = nullptr;
+		}
+	}
+
+	NameTable *table = Table.load();
+	while (table != nullptr)
+	{
+		NameTable *previous = table->Previous;
+		delete[] table->Slots;
+		delete table;
+		table = previous;
 	}
-	NumNames = MaxNames = 0;
-	memset (Buckets, -1, sizeof(Buckets));
+	Table = nullptr;
+	NumNames = 0;
+	Inited = false;
+}
+
+//==========================================================================
+//
+// FName :: GetTableStats
+//
+// Reports how full the hash table is and how many slots an average
+// successful lookup has to look at.
+//
+//==========================================================================
+
+void FName::GetTableStats (int &numnames, unsigned int &tablesize, double &probes)
+{
+	std::lock_guard<std::mutex> lock(NameMutex);
+	NameManager::NameTable *table = NameData.Table.load();
+	numnames = NameData.NumNames;
+	tablesize = table != nullptr ? table->Mask + 1 : 0;
+	probes = 0;
+	if (numnames == 0) return;
+
+	for (unsigned int slot = 0; slot < tablesize; slot++)
+	{
+		uint64_t value = table->Slots[slot].load(std::memory_order_relaxed);
+		if (value != 0)
+		{
+			probes += ((slot - (unsigned int)(value >> 32)) & table->Mask) + 1;
+		}
+	}
+	probes /= numnames;
+}
+
+ADD_STAT(names)
+{
+	int numnames;
+	unsigned int tablesize;
+	double probes;
+	FName::GetTableStats(numnames, tablesize, probes);
+	FString out;
+	out.Format("%d names, %u slots, %.2f average probes", numnames, tablesize, probes);
+	return out;
 }
@@ -34,6 +34,8 @@
 #ifndef NAME_H
 #define NAME_H
 
+#include <atomic>
+
 enum ENamedName
 {
 #define xx(n) NAME_##n,
@@ -58,8 +60,8 @@ public:
 
 	int GetIndex() const { return Index; }
 	operator int() const { return Index; }
-	const char *GetChars() const { return NameData.NameArray[Index].Text; }
-	operator const char *() const { return NameData.NameArray[Index].Text; }
+	const char *GetChars() const { return NameData.GetEntry(Index).Text; }
+	operator const char *() const { return NameData.GetEntry(Index).Text; }
 
 	FName &operator = (const char *text) { Index = NameData.FindName (text, false); return *this; }
 	FName &operator = (const FString &text);
@@ -70,6 +72,8 @@ public:
 
 	bool IsValidName() const { return (unsigned)Index < (unsigned)NameData.NumNames; }
 
+	static void GetTableStats (int &numnames, unsigned int &tablesize, double &probes);
+
 	// Note that the comparison operators compare the names' indices, not
 	// their text, so they cannot be used to do a lexicographical sort.
 	bool operator == (const FName &other) const { return Index == other.Index; }
@@ -93,7 +97,6 @@ protected:
 	{
 		char *Text;
 		unsigned int Hash;
-		int NextHash;
 	};
 
 	struct NameManager
@@ -103,19 +106,26 @@ protected:
 		// means this struct must only exist in the program's BSS section.
 		~NameManager();
 
-		enum { HASH_SIZE = 1024 };
+		// Entries are allocated in chunks that never move, so that names can
+		// be read while other threads are adding new ones.
+		enum { CHUNK_BITS = 12, CHUNK_SIZE = 1 << CHUNK_BITS, MAX_CHUNKS = 4096 };
 		struct NameBlock;
+		struct NameTable;
 
 		NameBlock *Blocks;
-		NameEntry *NameArray;
-		int NumNames, MaxNames;
-		int Buckets[HASH_SIZE];
+		NameEntry *Chunks[MAX_CHUNKS];
+		std::atomic<int> NumNames;
+		std::atomic<NameTable *> Table;
+
+		const NameEntry &GetEntry (int index) const { return Chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)]; }
 
 		int FindName (const char *text, bool noCreate);
 		int FindName (const char *text, size_t textlen, bool noCreate);
-		int AddName (const char *text, unsigned int hash, unsigned int bucket);
+		int LookupName (const char *text, size_t textlen, unsigned int hash);
+		int AddName (const char *text, size_t textlen, unsigned int hash);
+		void InsertName (NameTable *table, unsigned int hash, int index);
 		NameBlock *AddBlock (size_t len);
-		void InitBuckets ();
+		void InitTable ();
 		static bool Inited;
 	};
 
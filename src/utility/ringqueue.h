@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+//==========================================================================
+//
+// Bounded queue that any number of threads can push to without locking,
+// while only one thread at a time may pop from it. Each slot carries a
+// sequence number which tells producers whether it is free and the
+// consumer whether it has been filled. A full queue refuses new items
+// instead of waiting for the consumer.
+//
+//==========================================================================
+
+template<class T, unsigned SIZE>
+class TRingQueue
+{
+	static_assert((SIZE & (SIZE - 1)) == 0, "Ring queue size must be a power of 2");
+
+	struct FSlot
+	{
+		std::atomic<size_t> Sequence;
+		T Item;
+	};
+
+	FSlot Slots[SIZE];
+	std::atomic<size_t> Head;	// next position to be claimed by a producer
+	size_t Tail = 0;			// next position to be popped, only used by the consumer
+
+public:
+	TRingQueue() : Head(0)
+	{
+		for (unsigned i = 0; i < SIZE; i++)
+		{
+			Slots[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	bool Push(const T &item)
+	{
+		size_t pos = Head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			FSlot &slot = Slots[pos & (SIZE - 1)];
+			ptrdiff_t diff = (ptrdiff_t)slot.Sequence.load(std::memory_order_acquire) - (ptrdiff_t)pos;
+			if (diff == 0)
+			{
+				if (Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					slot.Item = item;
+					slot.Sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;	// the consumer hasn't gotten to this slot yet.
+			}
+			else
+			{
+				pos = Head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Stops at a slot that has been claimed but not filled yet, even if later ones are.
+	bool Pop(T &item)
+	{
+		FSlot &slot = Slots[Tail & (SIZE - 1)];
+		if (slot.Sequence.load(std::memory_order_acquire) != Tail + 1)
+		{
+			return false;
+		}
+		item = slot.Item;
+		slot.Sequence.store(Tail + SIZE, std::memory_order_release);
+		Tail++;
+		return true;
+	}
+
+	bool IsEmpty() const
+	{
+		return Slots[Tail & (SIZE - 1)].Sequence.load(std::memory_order_acquire) != Tail + 1;
+	}
+};
@@ -0,0 +1,202 @@
+/*
+** startupprofile.cpp
+** Hierarchical timing of the engine startup
+**
+** -profilestartup <file> records how long each startup phase and the
+** subsystems it calls take and writes the result in the Chrome trace
+** event format once startup is done. Each scope becomes a complete ("X")
+** event with its own thread ID so scopes opened on worker threads show up
+** in separate lanes. This works together with -errorlog/batchrun, so the
+** startup of a given set of mods can be profiled on machines without a
+** display and compared between versions.
+**
+*/
+
+#include <mutex>
+#include "doomtype.h"
+#include "i_time.h"
+#include "m_argv.h"
+#include "i_system.h"
+#include "version.h"
+#include "startupprofile.h"
+
+struct FStartupProfileEvent
+{
+	FString Name;
+	FString Detail;
+	uint64_t Start;
+	uint64_t End;
+	int Thread;
+};
+
+bool StartupProfiling;
+static FString ProfileFile;
+static FString ProfileCommandLine;
+static uint64_t ProfileStartTime;
+static TArray<FStartupProfileEvent> ProfileEvents;
+static std::mutex ProfileMutex;
+static int ProfileThreads;
+static bool ProfilePhaseOpen;
+
+static thread_local TArray<unsigned> OpenEvents;
+static thread_local int ProfileThread = -1;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void StartupProfile_Start(const char *filename)
+{
+	if (filename == nullptr || *filename == 0) return;
+	ProfileFile = filename;
+	ProfileStartTime = I_nsTime();
+	ProfileEvents.Clear();
+	ProfileThreads = 0;
+	ProfilePhaseOpen = false;
+	ProfileCommandLine = "";
+	for (int i = 0; i < Args->NumArgs(); i++)
+	{
+		if (i > 0) ProfileCommandLine += ' ';
+		ProfileCommandLine += Args->GetArg(i);
+	}
+	StartupProfiling = true;
+	StartupProfile_Begin("D_DoomMain");
+
+	// Also get a profile of a startup that gets aborted by an error.
+	atterm(StartupProfile_Finish);
+}
+
+//==========================================================================
+//
+// Opens a new scope. The detail string is for things like file names
+// that should not become part of the scope's name.
+//
+//==========================================================================
+
+void StartupProfile_Begin(const char *name, const char *detail)
+{
+	uint64_t now = I_nsTime();
+	std::lock_guard<std::mutex> lock(ProfileMutex);
+	if (!StartupProfiling) return;
+
+	if (ProfileThread < 0) ProfileThread = ProfileThreads++;
+	unsigned index = ProfileEvents.Reserve(1);
+	auto &event = ProfileEvents[index];
+	event.Name = name;
+	event.Detail = detail;
+	event.Start = now;
+	event.End = 0;
+	event.Thread = ProfileThread;
+	OpenEvents.Push(index);
+}
+
+//==========================================================================
+//
+// Closes the innermost scope of the calling thread.
+//
+//==========================================================================
+
+void StartupProfile_End()
+{
+	uint64_t now = I_nsTime();
+	std::lock_guard<std::mutex> lock(ProfileMutex);
+	unsigned index;
+	if (!StartupProfiling || !OpenEvents.Pop(index)) return;
+	ProfileEvents[index].End = now;
+}
+
+//==========================================================================
+//
+// Top level phases of D_DoomMain. Each one ends the one before it, which
+// keeps the code there free of scope blocks.
+//
+//==========================================================================
+
+void StartupProfile_Phase(const char *name)
+{
+	if (!StartupProfiling) return;
+	if (ProfilePhaseOpen) StartupProfile_End();
+	StartupProfile_Begin(name);
+	ProfilePhaseOpen = true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static void AppendJsonString(FString &out, const char *str)
+{
+	out += '"';
+	for (; *str; str++)
+	{
+		uint8_t c = *str;
+		if (c == '"' || c == '\\') out.AppendFormat("\\%c", c);
+		else if (c < 32) out.AppendFormat("\\u%04x", c);
+		else out += (char)c;
+	}
+	out += '"';
+}
+
+//==========================================================================
+//
+// Closes everything that is still open and writes the trace.
+//
+//==========================================================================
+
+void StartupProfile_Finish()
+{
+	if (!StartupProfiling) return;
+
+	{
+		uint64_t now = I_nsTime();
+		std::lock_guard<std::mutex> lock(ProfileMutex);
+		StartupProfiling = false;
+		for (auto &event : ProfileEvents)
+		{
+			if (event.End == 0) event.End = now;
+		}
+		OpenEvents.Clear();
+	}
+
+	FString out = "{\n\t\"traceEvents\": [\n";
+	for (unsigned i = 0; i < ProfileEvents.Size(); i++)
+	{
+		auto &event = ProfileEvents[i];
+		out += "\t\t{ \"name\": ";
+		AppendJsonString(out, event.Name);
+		out.AppendFormat(", \"cat\": \"startup\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+			event.Thread, (event.Start - ProfileStartTime) / 1000., (event.End - event.Start) / 1000.);
+		if (event.Detail.IsNotEmpty())
+		{
+			out += ", \"args\": { \"detail\": ";
+			AppendJsonString(out, event.Detail);
+			out += " }";
+		}
+		out += i + 1 < ProfileEvents.Size() ? " },\n" : " }\n";
+	}
+	out += "\t],\n\t\"displayTimeUnit\": \"ms\",\n\t\"otherData\": { \"version\": ";
+	AppendJsonString(out, GetVersionString());
+	out += ", \"githash\": ";
+	AppendJsonString(out, GetGitHash());
+	out += ", \"commandline\": ";
+	AppendJsonString(out, ProfileCommandLine);
+	out += " }\n}\n";
+
+	FILE *f = fopen(ProfileFile, "wt");
+	if (f != nullptr)
+	{
+		fputs(out.GetChars(), f);
+		fclose(f);
+		Printf("Startup profile (%.2f ms) saved to %s\n", (ProfileEvents[0].End - ProfileEvents[0].Start) / 1000000., ProfileFile.GetChars());
+	}
+	else
+	{
+		Printf("Could not write startup profile to %s\n", ProfileFile.GetChars());
+	}
+	ProfileEvents.Clear();
+	ProfileEvents.ShrinkToFit();
+}
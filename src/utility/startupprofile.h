@@ -0,0 +1,37 @@
+#pragma once
+
+//==========================================================================
+//
+// Startup profiler
+//
+// Records nested timing scopes for everything D_DoomMain does before the
+// game starts and writes them as a Chrome trace (chrome://tracing or
+// https://ui.perfetto.dev can load it) when startup is complete.
+// Only active with -profilestartup <file>, otherwise every scope costs a
+// single test of StartupProfiling.
+//
+//==========================================================================
+
+extern bool StartupProfiling;
+
+void StartupProfile_Start(const char *filename);
+void StartupProfile_Phase(const char *name);
+void StartupProfile_Begin(const char *name, const char *detail = nullptr);
+void StartupProfile_End();
+void StartupProfile_Finish();
+
+class FStartupProfileScope
+{
+	bool active;
+
+public:
+	FStartupProfileScope(const char *name, const char *detail = nullptr) : active(StartupProfiling)
+	{
+		if (active) StartupProfile_Begin(name, detail);
+	}
+
+	~FStartupProfileScope()
+	{
+		if (active) StartupProfile_End();
+	}
+};
@@ -47,6 +47,7 @@
 #include "doomerrors.h"
 #include "i_system.h"
 #include "swrenderer/r_swrenderer.h"
+#include "hwrenderer/utility/hw_benchscene.h"
 
 EXTERN_CVAR(Int, vid_maxfps)
 
@@ -126,7 +127,10 @@ void I_InitGraphics ()
 		// are the active app. Huh?
 	}
 
-	Video = new Win32GLVideo();
+	if (BenchScene_Active())
+		Video = BenchScene_CreateVideo();
+	else
+		Video = new Win32GLVideo();
 
 	if (Video == NULL)
 		I_FatalError ("Failed to initialize display");
@@ -226,6 +226,7 @@ struct MiniDumpThreadData
 
 // PUBLIC FUNCTION PROTOTYPES ----------------------------------------------
 void I_FlushBufferedConsoleStuff();
+void C_FlushLog();
 
 // PRIVATE FUNCTION PROTOTYPES ---------------------------------------------
 
@@ -577,6 +578,9 @@ void CreateCrashLog (char *custominfo, DWORD customsize, HWND richlog)
 		return;
 	}
 
+	// Get the log up to the crash into the file before anything else can go wrong.
+	C_FlushLog();
+
 	DbgThreadID = GetCurrentThreadId();
 	DbgProcessID = GetCurrentProcessId();
 	DbgProcess = GetCurrentProcess();
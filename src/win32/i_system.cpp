@@ -75,6 +75,7 @@
 #include "g_game.h"
 #include "i_input.h"
 #include "c_dispatch.h"
+#include "c_console.h"
 #include "templates.h"
 #include "gameconfigfile.h"
 #include "v_font.h"
@@ -449,8 +450,8 @@ void I_FatalError(const char *error, ...)
 		// Record error to log (if logging)
 		if (Logfile)
 		{
-			fprintf(Logfile, "\n**** DIED WITH FATAL ERROR:\n%s\n", errortext);
-			fflush(Logfile);
+			C_FlushLog();
+			C_WriteLog(FStringf("\n**** DIED WITH FATAL ERROR:\n%s\n", errortext));
 		}
 
 		throw CFatalError(errortext);